@@ -1,21 +1,26 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
-layout(location = 0) out vec3 fragColor;
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+// per instance: xy offset, z scale, w is only read by cull.comp
+layout(location = 2) in vec4 inInstance;
+
+// FViewUniforms, from the uniform ring with a dynamic offset
+layout(set = 0, binding = 0) uniform View {
+	// xy offset, zw scale from scene to clip space
+	vec4 transform;
+} view;
 
-vec2 positions[3] = vec2[] (
-	vec2(0.0, -0.5),
-	vec2(0.5, 0.5),
-	vec2(-0.5, 0.5)
-);
+// FDrawConstants, pushed before the draws
+layout(push_constant) uniform Draw {
+	vec4 tint;
+} draw;
 
-vec3 colors[3] = vec3[] (
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
+layout(location = 0) out vec3 fragColor;
 
 void main() {
-	gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+	vec2 position = inPosition.xy * inInstance.z + inInstance.xy;
+	gl_Position = vec4(position * view.transform.zw + view.transform.xy, inPosition.z, 1.0);
+	fragColor = inColor * draw.tint.rgb;
+}
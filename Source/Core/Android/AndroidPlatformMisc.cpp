@@ -1,6 +1,10 @@
 #include "AndroidPlatformMisc.h"
+#include <sched.h>
+#include <stdio.h>
+#include <algorithm>
 #include <android/log.h>
 #include <android_native_app_glue.h>
+#include "Logging/Logging.h"
 
 extern struct android_app* GNativeAndroidApp;
 
@@ -9,17 +13,18 @@ void FAndroidPlatformMisc::PlatformInit()
 	FPlatformMisc::LocalPrint("Android Platform Init");
 }
 
-void FAndroidPlatformMisc::LocalPrint(const char* Str)
+void FAndroidPlatformMisc::WriteToLog(ELogVerbosity Verbosity, const char* Line)
 {
-	__android_log_print(ANDROID_LOG_INFO, LOG_TAG, "%s", Str);
-}
-
-void FAndroidPlatformMisc::LocalPrintf(const char* Format, ...)
-{
-	va_list arg_list;
-	va_start(arg_list, Format);
-	__android_log_vprint(ANDROID_LOG_INFO, LOG_TAG, Format, arg_list);
-	va_end(arg_list);
+	int Priority = ANDROID_LOG_INFO;
+	switch (Verbosity)
+	{
+	case ELogVerbosity::Fatal: Priority = ANDROID_LOG_FATAL; break;
+	case ELogVerbosity::Error: Priority = ANDROID_LOG_ERROR; break;
+	case ELogVerbosity::Warning: Priority = ANDROID_LOG_WARN; break;
+	case ELogVerbosity::Verbose: Priority = ANDROID_LOG_VERBOSE; break;
+	default: break;
+	}
+	__android_log_write(Priority, LOG_TAG, Line);
 }
 
 void FAndroidPlatformMisc::PumpMessages()
@@ -40,14 +45,14 @@ void FAndroidPlatformMisc::PumpMessages()
 	}
 }
 
-std::vector<char> FAndroidPlatformMisc::ReadFile(const char* Filename)
+std::vector<char> FAndroidPlatformMisc::ReadLooseFile(const char* Filename)
 {
     assert(GNativeAndroidApp != nullptr);
 	std::vector<char> Buffer;
     AAsset *file = AAssetManager_open(GNativeAndroidApp->activity->assetManager, Filename, AASSET_MODE_BUFFER);
     if (!file)
 	{
-    	FAndroidPlatformMisc::LocalPrintf("Load file failed: %s", Filename);
+    	TE_LOG(LogCore, Error, "Load file failed: %s", Filename);
     	return Buffer;
 	}
     size_t FileLength = AAsset_getLength(file);
@@ -58,4 +63,122 @@ std::vector<char> FAndroidPlatformMisc::ReadFile(const char* Filename)
         AAsset_read(file, &Buffer[0], FileLength);
     }
     return Buffer;
-}
\ No newline at end of file
+}
+
+FFileView FAndroidPlatformMisc::MapLooseFile(const char* Filename)
+{
+	assert(GNativeAndroidApp != nullptr);
+	AAsset* Asset = AAssetManager_open(GNativeAndroidApp->activity->assetManager, Filename, AASSET_MODE_BUFFER);
+	if (!Asset)
+	{
+		TE_LOG(LogCore, Error, "Load file failed: %s", Filename);
+		return FFileView();
+	}
+	// Uncompressed assets are mapped straight from the APK, compressed ones are inflated into a
+	// buffer the asset owns. Either way the buffer lives until the asset is closed.
+	const void* Data = AAsset_getBuffer(Asset);
+	size_t Size = (size_t)AAsset_getLength(Asset);
+	if (Data == nullptr)
+	{
+		AAsset_close(Asset);
+		TE_LOG(LogCore, Error, "Load file failed: %s", Filename);
+		return FFileView();
+	}
+	if (AAsset_isAllocated(Asset))
+	{
+		FAndroidPlatformMisc::LocalPrintf("Asset %s is compressed and was copied, store it uncompressed", Filename);
+	}
+	return FFileView((const char*)Data, Size, Asset, [](const char*, size_t, void* Asset) { AAsset_close((AAsset*)Asset); });
+}
+
+void* FAndroidPlatformMisc::OpenReadHandle(const char* Filename, uint64_t& OutSize)
+{
+	assert(GNativeAndroidApp != nullptr);
+	AAsset* Asset = AAssetManager_open(GNativeAndroidApp->activity->assetManager, Filename, AASSET_MODE_RANDOM);
+	if (!Asset)
+	{
+		return nullptr;
+	}
+	OutSize = (uint64_t)AAsset_getLength64(Asset);
+	return Asset;
+}
+
+bool FAndroidPlatformMisc::ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers)
+{
+	AAsset* Asset = (AAsset*)Handle;
+	if (AAsset_seek64(Asset, (off64_t)Offset, SEEK_SET) != (off64_t)Offset)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < NumBuffers; ++i)
+	{
+		size_t Done = 0;
+		while (Done < Buffers[i].Size)
+		{
+			int Read = AAsset_read(Asset, (char*)Buffers[i].Data + Done, Buffers[i].Size - Done);
+			if (Read <= 0)
+			{
+				return false;
+			}
+			Done += (size_t)Read;
+		}
+	}
+	return true;
+}
+
+void FAndroidPlatformMisc::CloseReadHandle(void* Handle)
+{
+	AAsset_close((AAsset*)Handle);
+}
+
+std::string FAndroidPlatformMisc::SavedDir()
+{
+	assert(GNativeAndroidApp != nullptr);
+	return std::string(GNativeAndroidApp->activity->internalDataPath) + "/";
+}
+
+uint64_t FAndroidPlatformMisc::GetPerformanceCoreMask()
+{
+	// cores of the big cluster report a higher maximum frequency than the LITTLE ones
+	uint32_t NumCores = FPlatformMisc::NumberOfCores();
+	std::vector<uint64_t> MaxFrequencies(NumCores, 0);
+	uint64_t LowestFrequency = UINT64_MAX;
+	for (uint32_t Core = 0; Core < NumCores && Core < 64; ++Core)
+	{
+		char Path[128];
+		snprintf(Path, sizeof(Path), "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", Core);
+		FILE* File = fopen(Path, "r");
+		unsigned long long Frequency = 0;
+		if (File)
+		{
+			if (fscanf(File, "%llu", &Frequency) != 1)
+				Frequency = 0;
+			fclose(File);
+		}
+		if (Frequency == 0)
+			return FGenericPlatformMisc::GetPerformanceCoreMask();
+		MaxFrequencies[Core] = Frequency;
+		LowestFrequency = std::min<uint64_t>(LowestFrequency, Frequency);
+	}
+
+	uint64_t Mask = 0;
+	for (uint32_t Core = 0; Core < NumCores && Core < 64; ++Core)
+	{
+		if (MaxFrequencies[Core] > LowestFrequency)
+			Mask |= 1ull << Core;
+	}
+	return Mask != 0 ? Mask : FGenericPlatformMisc::GetPerformanceCoreMask();
+}
+
+bool FAndroidPlatformMisc::SetThreadAffinityMask(uint64_t Mask)
+{
+	cpu_set_t CpuSet;
+	CPU_ZERO(&CpuSet);
+	for (uint32_t Core = 0; Core < 64; ++Core)
+	{
+		if (Mask & (1ull << Core))
+			CPU_SET(Core, &CpuSet);
+	}
+	// pid 0 is the calling thread
+	return sched_setaffinity(0, sizeof(CpuSet), &CpuSet) == 0;
+}
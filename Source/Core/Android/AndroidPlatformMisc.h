@@ -5,10 +5,16 @@
 struct FAndroidPlatformMisc : public FGenericPlatformMisc
 {
 	static void PlatformInit();
-	static void LocalPrint(const char* Str);
-	static void LocalPrintf(const char* Format, ...);
+	static void WriteToLog(ELogVerbosity Verbosity, const char* Line);
 	static void PumpMessages();
-	static std::vector<char> ReadFile(const char* Filename);
+	static std::vector<char> ReadLooseFile(const char* Filename);
+	static FFileView MapLooseFile(const char* Filename);
+	static void* OpenReadHandle(const char* Filename, uint64_t& OutSize);
+	static bool ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers);
+	static void CloseReadHandle(void* Handle);
+	static std::string SavedDir();
+	static uint64_t GetPerformanceCoreMask();
+	static bool SetThreadAffinityMask(uint64_t Mask);
 };
 
 typedef FAndroidPlatformMisc FPlatformMisc;
\ No newline at end of file
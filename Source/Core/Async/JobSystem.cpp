@@ -0,0 +1,343 @@
+#include "JobSystem.h"
+#include "HAL/PlatformMisc.h"
+#include "Logging/Logging.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+
+struct FJob
+{
+	FJobFunction Function;
+	FJobCounter* Counter;
+};
+
+// index of the calling thread in FJobSystem::Threads
+static thread_local uint32_t GJobThreadIndex = FJobSystem::INDEX_NONE;
+
+// spins through the queues this many times before a worker goes to sleep
+static const uint32_t IDLE_SPIN_COUNT = 64;
+
+FJobSystem& FJobSystem::Get()
+{
+	static FJobSystem JobSystem;
+	return JobSystem;
+}
+
+void FJobSystem::Init(uint32_t NumWorkers, EJobAffinity Affinity)
+{
+	uint64_t AffinityMask = 0;
+	uint32_t NumCores = FPlatformMisc::NumberOfCores();
+	if (Affinity == EJobAffinity::PerformanceCores)
+	{
+		AffinityMask = FPlatformMisc::GetPerformanceCoreMask();
+		uint32_t NumPerformanceCores = 0;
+		for (uint64_t Mask = AffinityMask; Mask; Mask &= Mask - 1)
+			++NumPerformanceCores;
+		NumCores = std::max(1u, NumPerformanceCores);
+	}
+	if (NumWorkers == 0)
+	{
+		NumWorkers = NumCores > 1 ? NumCores - 1 : 1;
+	}
+
+	StopWorkers = false;
+	Threads.resize(NumWorkers + 1);
+	for (uint32_t i = 0; i < Threads.size(); ++i)
+	{
+		Threads[i] = new FThreadState();
+		Threads[i]->RandomState = i * 2654435761u + 1;
+	}
+	GJobThreadIndex = 0;
+	for (uint32_t i = 1; i <= NumWorkers; ++i)
+	{
+		Workers.emplace_back(&FJobSystem::WorkerLoop, this, i, AffinityMask);
+	}
+	FPlatformMisc::LocalPrintf("Job system: %d workers%s", NumWorkers,
+		Affinity == EJobAffinity::PerformanceCores ? " on performance cores" : "");
+}
+
+void FJobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> Lock(SleepMutex);
+		StopWorkers = true;
+		++WakeGeneration;
+	}
+	SleepCondition.notify_all();
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+
+	// jobs nobody waited for are dropped
+	for (FThreadState* Thread : Threads)
+	{
+		while (FJob* Job = Thread->Queue.Steal())
+			delete Job;
+		delete Thread;
+	}
+	Threads.clear();
+	for (FJob* Job : InjectionQueue)
+		delete Job;
+	InjectionQueue.clear();
+	InjectionCount = 0;
+	GJobThreadIndex = INDEX_NONE;
+}
+
+uint32_t FJobSystem::GetThreadIndex() const
+{
+	return GJobThreadIndex;
+}
+
+void FJobSystem::Run(FJobFunction Function, FJobCounter* Counter, FJobCounter* Dependency)
+{
+	FJob* Job = new FJob{ std::move(Function), Counter };
+	if (Counter)
+	{
+		Counter->Value.fetch_add(1, std::memory_order_relaxed);
+	}
+	if (Dependency)
+	{
+		std::lock_guard<std::mutex> Lock(Dependency->Mutex);
+		if (Dependency->Value.load(std::memory_order_acquire) > 0)
+		{
+			Dependency->Waiters.push_back(Job);
+			return;
+		}
+	}
+	Submit(Job);
+}
+
+void FJobSystem::Submit(FJob* Job)
+{
+	uint32_t ThreadIndex = GJobThreadIndex;
+	if (ThreadIndex == INDEX_NONE || !Threads[ThreadIndex]->Queue.Push(Job))
+	{
+		std::lock_guard<std::mutex> Lock(InjectionMutex);
+		InjectionQueue.push_back(Job);
+		++InjectionCount;
+	}
+	WakeWorker();
+}
+
+void FJobSystem::WakeWorker()
+{
+	// pairs with the increment in WorkerLoop: either the worker sees the job, or we see the sleeper
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (NumSleeping.load(std::memory_order_relaxed) > 0)
+	{
+		{
+			std::lock_guard<std::mutex> Lock(SleepMutex);
+			++WakeGeneration;
+		}
+		SleepCondition.notify_one();
+	}
+}
+
+FJob* FJobSystem::FindJob(uint32_t ThreadIndex)
+{
+	if (ThreadIndex != INDEX_NONE)
+	{
+		if (FJob* Job = Threads[ThreadIndex]->Queue.Pop())
+			return Job;
+	}
+
+	if (InjectionCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> Lock(InjectionMutex);
+		if (!InjectionQueue.empty())
+		{
+			FJob* Job = InjectionQueue.front();
+			InjectionQueue.pop_front();
+			--InjectionCount;
+			return Job;
+		}
+	}
+
+	// start at a random victim so thieves don't all hammer the same deque
+	uint32_t NumThreads = (uint32_t)Threads.size();
+	uint32_t Start = 0;
+	FThreadState* Thief = ThreadIndex != INDEX_NONE ? Threads[ThreadIndex] : nullptr;
+	if (Thief)
+	{
+		uint32_t& X = Thief->RandomState;
+		X ^= X << 13;
+		X ^= X >> 17;
+		X ^= X << 5;
+		Start = X % NumThreads;
+	}
+	for (uint32_t i = 0; i < NumThreads; ++i)
+	{
+		uint32_t Victim = (Start + i) % NumThreads;
+		if (Victim == ThreadIndex || Threads[Victim]->Queue.IsEmpty())
+			continue;
+		if (Thief)
+			Thief->StealAttempts.fetch_add(1, std::memory_order_relaxed);
+		if (FJob* Job = Threads[Victim]->Queue.Steal())
+		{
+			if (Thief)
+				Thief->JobsStolen.fetch_add(1, std::memory_order_relaxed);
+			return Job;
+		}
+	}
+	return nullptr;
+}
+
+void FJobSystem::Execute(FJob* Job, uint32_t ThreadIndex)
+{
+	{
+		SCOPED_CPU_EVENT("Job");
+		Job->Function();
+	}
+	if (Job->Counter)
+	{
+		FinishJob(*Job->Counter);
+	}
+	if (ThreadIndex != INDEX_NONE)
+	{
+		Threads[ThreadIndex]->JobsExecuted.fetch_add(1, std::memory_order_relaxed);
+	}
+	delete Job;
+}
+
+void FJobSystem::FinishJob(FJobCounter& Counter)
+{
+	int32_t Value = Counter.Value.load(std::memory_order_relaxed);
+	while (Value > 1)
+	{
+		if (Counter.Value.compare_exchange_weak(Value, Value - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+			return;
+	}
+
+	// likely the last job, decrement under the lock so Wait can tell when we are done with the counter
+	std::vector<FJob*> Waiters;
+	{
+		std::lock_guard<std::mutex> Lock(Counter.Mutex);
+		if (Counter.Value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			Waiters.swap(Counter.Waiters);
+		}
+	}
+	for (FJob* Waiter : Waiters)
+	{
+		Submit(Waiter);
+	}
+}
+
+void FJobSystem::Wait(FJobCounter& Counter)
+{
+	uint32_t ThreadIndex = GJobThreadIndex;
+	while (!Counter.IsDone())
+	{
+		if (FJob* Job = FindJob(ThreadIndex))
+		{
+			Execute(Job, ThreadIndex);
+		}
+		else
+		{
+			// the remaining jobs are running elsewhere
+			std::this_thread::yield();
+		}
+	}
+	std::lock_guard<std::mutex> Lock(Counter.Mutex);
+}
+
+void FJobSystem::ParallelFor(uint32_t Num, uint32_t BatchSize, const std::function<void(uint32_t Begin, uint32_t End)>& Function)
+{
+	if (Num == 0)
+		return;
+	if (BatchSize == 0)
+	{
+		uint32_t NumBatches = std::max(1u, NumThreads()) * 4;
+		BatchSize = std::max(1u, (Num + NumBatches - 1) / NumBatches);
+	}
+	if (Num <= BatchSize || !IsInitialized())
+	{
+		Function(0, Num);
+		return;
+	}
+
+	FJobCounter Counter;
+	// the first batch runs here, the rest is up for grabs
+	for (uint32_t Begin = BatchSize; Begin < Num; Begin += BatchSize)
+	{
+		uint32_t End = std::min(Num, Begin + BatchSize);
+		Run([&Function, Begin, End]() { Function(Begin, End); }, &Counter);
+	}
+	Function(0, BatchSize);
+	Wait(Counter);
+}
+
+void FJobSystem::WorkerLoop(uint32_t ThreadIndex, uint64_t AffinityMask)
+{
+	GJobThreadIndex = ThreadIndex;
+	FProfiler::Get().SetThreadName(("Job Worker " + std::to_string(ThreadIndex)).c_str());
+	if (AffinityMask != 0 && !FPlatformMisc::SetThreadAffinityMask(AffinityMask))
+	{
+		TE_LOG(LogCore, Warning, "Job worker %d: setting thread affinity failed", ThreadIndex);
+	}
+
+	FThreadState* State = Threads[ThreadIndex];
+	uint32_t IdleSpins = 0;
+	while (!StopWorkers.load(std::memory_order_relaxed))
+	{
+		if (FJob* Job = FindJob(ThreadIndex))
+		{
+			Execute(Job, ThreadIndex);
+			IdleSpins = 0;
+			continue;
+		}
+		if (++IdleSpins < IDLE_SPIN_COUNT)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		uint64_t Generation;
+		{
+			std::lock_guard<std::mutex> Lock(SleepMutex);
+			Generation = WakeGeneration;
+		}
+		NumSleeping.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		// one more look, a job pushed before the fence is visible now
+		if (FJob* Job = FindJob(ThreadIndex))
+		{
+			NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+			Execute(Job, ThreadIndex);
+			IdleSpins = 0;
+			continue;
+		}
+		State->Sleeps.fetch_add(1, std::memory_order_relaxed);
+		{
+			std::unique_lock<std::mutex> Lock(SleepMutex);
+			SleepCondition.wait(Lock, [&] { return WakeGeneration != Generation; });
+		}
+		NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+		IdleSpins = 0;
+	}
+}
+
+FJobSystemStats FJobSystem::GetStats() const
+{
+	FJobSystemStats Stats;
+	for (const FThreadState* Thread : Threads)
+	{
+		Stats.JobsExecuted += Thread->JobsExecuted.load(std::memory_order_relaxed);
+		Stats.JobsStolen += Thread->JobsStolen.load(std::memory_order_relaxed);
+		Stats.StealAttempts += Thread->StealAttempts.load(std::memory_order_relaxed);
+		Stats.Sleeps += Thread->Sleeps.load(std::memory_order_relaxed);
+	}
+	return Stats;
+}
+
+void FJobSystem::ResetStats()
+{
+	for (FThreadState* Thread : Threads)
+	{
+		Thread->JobsExecuted = 0;
+		Thread->JobsStolen = 0;
+		Thread->StealAttempts = 0;
+		Thread->Sleeps = 0;
+	}
+}
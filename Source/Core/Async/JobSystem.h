@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Async/WorkStealingQueue.h"
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+struct FJob;
+
+// Counts unfinished jobs. Pass one to FJobSystem::Run to track jobs, and to wait on them or
+// make other jobs depend on them. Counters can be reused once they reached zero, and must
+// outlive the jobs they count.
+class FJobCounter
+{
+public:
+	bool IsDone() const { return Value.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class FJobSystem;
+
+	std::atomic<int32_t> Value{0};
+	// taken for the final decrement, so a waiter that saw zero knows nobody touches the counter anymore
+	std::mutex Mutex;
+	// jobs that start once Value drops to zero
+	std::vector<FJob*> Waiters;
+};
+
+typedef std::function<void()> FJobFunction;
+
+enum class EJobAffinity : uint8_t
+{
+	// let the OS schedule workers anywhere
+	Any,
+	// keep workers on the big cluster of big.LITTLE CPUs
+	PerformanceCores,
+};
+
+struct FJobSystemStats
+{
+	uint64_t JobsExecuted = 0;
+	uint64_t JobsStolen = 0;
+	uint64_t StealAttempts = 0;
+	// times a worker went to sleep for lack of work
+	uint64_t Sleeps = 0;
+};
+
+// Work-stealing job scheduler. Every worker, and the thread that called Init, owns a deque: jobs
+// are pushed to and popped from the local deque, idle threads steal from the others. Threads
+// outside the system submit through a shared injection queue.
+class FJobSystem
+{
+public:
+	static const uint32_t INDEX_NONE = ~0u;
+
+	static FJobSystem& Get();
+
+	// NumWorkers 0 picks one worker per core (per performance core with EJobAffinity::PerformanceCores),
+	// minus the calling thread, which joins the system as thread 0.
+	void Init(uint32_t NumWorkers = 0, EJobAffinity Affinity = EJobAffinity::Any);
+	void Shutdown();
+
+	// Queues Function. Counter, if any, is incremented now and decremented when the job finished.
+	// With a Dependency the job only becomes runnable once that counter reaches zero.
+	void Run(FJobFunction Function, FJobCounter* Counter = nullptr, FJobCounter* Dependency = nullptr);
+
+	// Runs other jobs until Counter reaches zero.
+	void Wait(FJobCounter& Counter);
+
+	// Calls Function(Begin, End) over [0, Num) in batches of at most BatchSize and waits for all of
+	// them; 0 picks a batch size that gives every thread a few batches to balance with.
+	void ParallelFor(uint32_t Num, uint32_t BatchSize, const std::function<void(uint32_t Begin, uint32_t End)>& Function);
+
+	// Index of the calling thread in [0, NumThreads()), INDEX_NONE for threads outside the system.
+	uint32_t GetThreadIndex() const;
+	uint32_t NumThreads() const { return (uint32_t)Threads.size(); }
+	bool IsInitialized() const { return !Threads.empty(); }
+
+	FJobSystemStats GetStats() const;
+	void ResetStats();
+
+private:
+	// deque size per thread; pushes beyond it go to the injection queue
+	static const uint32_t QUEUE_CAPACITY = 4096;
+
+	struct alignas(64) FThreadState
+	{
+		TWorkStealingQueue<FJob, QUEUE_CAPACITY> Queue;
+		std::atomic<uint64_t> JobsExecuted{0};
+		std::atomic<uint64_t> JobsStolen{0};
+		std::atomic<uint64_t> StealAttempts{0};
+		std::atomic<uint64_t> Sleeps{0};
+		uint32_t RandomState = 1;
+	};
+
+	void Submit(FJob* Job);
+	FJob* FindJob(uint32_t ThreadIndex);
+	void Execute(FJob* Job, uint32_t ThreadIndex);
+	void FinishJob(FJobCounter& Counter);
+	void WorkerLoop(uint32_t ThreadIndex, uint64_t AffinityMask);
+	void WakeWorker();
+
+	std::vector<FThreadState*> Threads;
+	std::vector<std::thread> Workers;
+
+	std::mutex InjectionMutex;
+	std::deque<FJob*> InjectionQueue;
+	std::atomic<uint32_t> InjectionCount{0};
+
+	std::mutex SleepMutex;
+	std::condition_variable SleepCondition;
+	uint64_t WakeGeneration = 0;
+	std::atomic<uint32_t> NumSleeping{0};
+	std::atomic<bool> StopWorkers{false};
+};
@@ -0,0 +1,145 @@
+#include "RenderThread.h"
+#include "HAL/PlatformMisc.h"
+#include "Stats/Profiler.h"
+
+void FRenderThread::Start(bool InThreaded, uint32_t InFrameLag)
+{
+	Threaded = InThreaded;
+	FrameLag = InFrameLag;
+	Stopping = false;
+	if (Threaded)
+	{
+		Thread = std::thread([this]() { ThreadLoop(); });
+	}
+}
+
+void FRenderThread::Stop()
+{
+	if (!Thread.joinable())
+	{
+		return;
+	}
+	Flush();
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		Stopping = true;
+	}
+	RenderCondition.notify_one();
+	Thread.join();
+}
+
+void FRenderThread::Enqueue(FRenderCommand Command)
+{
+	++CommandsEnqueued;
+	if (!IsThreaded())
+	{
+		Command();
+		CommandsCompleted.store(CommandsEnqueued, std::memory_order_relaxed);
+		return;
+	}
+	// a frame rarely has a handful of commands, a full queue means the render thread is far behind
+	while (!Queue.Push(std::move(Command)))
+	{
+		std::this_thread::yield();
+	}
+	// pairs with the fence in ThreadLoop: either the render thread sees the command, or we see it sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (RenderSleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		RenderCondition.notify_one();
+	}
+}
+
+void FRenderThread::EndFrame()
+{
+	FrameEnds.push_back(CommandsEnqueued);
+	if (FrameEnds.size() > FrameLag)
+	{
+		uint64_t FrameEnd = FrameEnds.front();
+		FrameEnds.pop_front();
+		double WaitStart = FPlatformMisc::Seconds();
+		bool Waited = CommandsCompleted.load(std::memory_order_acquire) < FrameEnd;
+		WaitForCommands(FrameEnd);
+		if (Waited)
+		{
+			GameWait.Add((FPlatformMisc::Seconds() - WaitStart) * 1000.0);
+		}
+	}
+}
+
+void FRenderThread::Flush()
+{
+	WaitForCommands(CommandsEnqueued);
+	FrameEnds.clear();
+}
+
+void FRenderThread::WaitForCommands(uint64_t Count)
+{
+	if (CommandsCompleted.load(std::memory_order_acquire) >= Count)
+	{
+		return;
+	}
+	SCOPED_CPU_EVENT("WaitForRenderThread");
+	std::unique_lock<std::mutex> Lock(Mutex);
+	GameSleeping = true;
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	GameCondition.wait(Lock, [this, Count]() { return CommandsCompleted.load(std::memory_order_acquire) >= Count; });
+	GameSleeping = false;
+}
+
+void FRenderThread::CompleteCommand()
+{
+	CommandsCompleted.fetch_add(1, std::memory_order_release);
+	// pairs with the fence in WaitForCommands
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (GameSleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		GameCondition.notify_one();
+	}
+}
+
+void FRenderThread::ThreadLoop()
+{
+	FProfiler::Get().SetThreadName("Render Thread");
+	FRenderCommand Command;
+	for (;;)
+	{
+		if (Queue.Pop(Command))
+		{
+			Command();
+			Command = nullptr;
+			CompleteCommand();
+			continue;
+		}
+
+		double IdleStart = FPlatformMisc::Seconds();
+		{
+			std::unique_lock<std::mutex> Lock(Mutex);
+			RenderSleeping = true;
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			RenderCondition.wait(Lock, [this]() { return !Queue.IsEmpty() || Stopping; });
+			RenderSleeping = false;
+		}
+		if (Queue.IsEmpty() && Stopping)
+		{
+			return;
+		}
+		RenderIdle.Add((FPlatformMisc::Seconds() - IdleStart) * 1000.0);
+	}
+}
+
+void FRenderThread::ReportStats() const
+{
+	FPlatformMisc::LocalPrintf("Render thread: %s, %u frames of lag, %llu commands", IsThreaded() ? "threaded" : "inline",
+		FrameLag, (unsigned long long)CommandsEnqueued);
+	if (GameWait.Num() > 0)
+	{
+		GameWait.Report();
+	}
+	if (RenderIdle.Num() > 0)
+	{
+		RenderIdle.Report();
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Async/SpscQueue.h"
+#include "Stats/StatSamples.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <deque>
+
+typedef std::function<void()> FRenderCommand;
+
+// Runs render commands on a dedicated thread, in the order the game thread enqueued them, so the
+// game thread can simulate the next frame while the current one renders. The game thread may run
+// FrameLag frames ahead: EndFrame blocks until the render thread finished the frame FrameLag
+// frames back. Started without a thread, commands run right away on the game thread, in the same
+// order, which is easier to debug.
+class FRenderThread
+{
+public:
+	static const uint32_t QUEUE_CAPACITY = 256;
+
+	void Start(bool InThreaded, uint32_t InFrameLag);
+	// Runs every command enqueued so far, then ends the thread.
+	void Stop();
+	bool IsThreaded() const { return Threaded; }
+	uint32_t GetFrameLag() const { return FrameLag; }
+
+	// The functions below are for the game thread only.
+	void Enqueue(FRenderCommand Command);
+	// Ends the game thread's frame, see FrameLag.
+	void EndFrame();
+	// Blocks until every command enqueued so far ran.
+	void Flush();
+
+	// After Stop.
+	void ReportStats() const;
+
+private:
+	void ThreadLoop();
+	void CompleteCommand();
+	// until CommandsCompleted reaches Count
+	void WaitForCommands(uint64_t Count);
+
+	TSpscQueue<FRenderCommand, QUEUE_CAPACITY> Queue;
+	std::thread Thread;
+	bool Threaded = false;
+	uint32_t FrameLag = 1;
+	uint64_t CommandsEnqueued = 0;
+	// CommandsEnqueued at the end of the frames the game thread may still have to wait for
+	std::deque<uint64_t> FrameEnds;
+	std::atomic<uint64_t> CommandsCompleted{0};
+	std::atomic<bool> Stopping{false};
+
+	// each thread sleeps on its condition when the other is behind, and raises its flag first,
+	// so the other side knows to take the mutex and wake it
+	std::mutex Mutex;
+	std::condition_variable RenderCondition;
+	std::condition_variable GameCondition;
+	std::atomic<bool> RenderSleeping{false};
+	std::atomic<bool> GameSleeping{false};
+
+	FStatSamples GameWait{"Game thread wait for render thread"};
+	FStatSamples RenderIdle{"Render thread idle"};
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <utility>
+
+// Fixed-size ring buffer for one producer and one consumer thread, without locks: each side only
+// writes its own index and reads the other's with acquire, which publishes the items written
+// before it. Each side also caches the other's index, and only reloads it when the ring looks
+// full or empty, so the two cache lines aren't bounced for every item.
+template<typename T, uint32_t Capacity>
+class TSpscQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	// Producer only. Returns false when full.
+	bool Push(T&& Item)
+	{
+		uint32_t Write = WriteIndex.load(std::memory_order_relaxed);
+		if (Write - CachedReadIndex == Capacity)
+		{
+			CachedReadIndex = ReadIndex.load(std::memory_order_acquire);
+			if (Write - CachedReadIndex == Capacity)
+				return false;
+		}
+		Items[Write & (Capacity - 1)] = std::move(Item);
+		WriteIndex.store(Write + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only. Returns false when empty.
+	bool Pop(T& OutItem)
+	{
+		uint32_t Read = ReadIndex.load(std::memory_order_relaxed);
+		if (Read == CachedWriteIndex)
+		{
+			CachedWriteIndex = WriteIndex.load(std::memory_order_acquire);
+			if (Read == CachedWriteIndex)
+				return false;
+		}
+		T& Slot = Items[Read & (Capacity - 1)];
+		OutItem = std::move(Slot);
+		// whatever the item holds is released now, not when the slot is reused
+		Slot = T();
+		ReadIndex.store(Read + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Exact on either side for items the other side added or removed before.
+	bool IsEmpty() const
+	{
+		return ReadIndex.load(std::memory_order_acquire) == WriteIndex.load(std::memory_order_acquire);
+	}
+
+private:
+	// the producer's line, then the consumer's
+	alignas(64) std::atomic<uint32_t> WriteIndex{0};
+	uint32_t CachedReadIndex = 0;
+	alignas(64) std::atomic<uint32_t> ReadIndex{0};
+	uint32_t CachedWriteIndex = 0;
+	alignas(64) T Items[Capacity];
+};
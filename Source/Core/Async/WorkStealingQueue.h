@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Fixed-size Chase-Lev deque. The owning thread pushes and pops at the bottom (LIFO, cache-warm),
+// any other thread steals from the top (FIFO, oldest and usually biggest work first).
+// Memory orders follow Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+template<typename T, uint32_t Capacity>
+class TWorkStealingQueue
+{
+	static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+	// Owner only. Returns false when full.
+	bool Push(T* Item)
+	{
+		int64_t B = Bottom.load(std::memory_order_relaxed);
+		int64_t T0 = Top.load(std::memory_order_acquire);
+		if (B - T0 >= (int64_t)Capacity)
+			return false;
+		Items[B & (Capacity - 1)].store(Item, std::memory_order_relaxed);
+		// publishes the item to thieves, which load Bottom with acquire
+		Bottom.store(B + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Owner only.
+	T* Pop()
+	{
+		int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+		Bottom.store(B, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t T0 = Top.load(std::memory_order_relaxed);
+		if (T0 > B)
+		{
+			Bottom.store(B + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+		T* Item = Items[B & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (T0 == B)
+		{
+			// last item, race the thieves for it
+			if (!Top.compare_exchange_strong(T0, T0 + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				Item = nullptr;
+			Bottom.store(B + 1, std::memory_order_relaxed);
+		}
+		return Item;
+	}
+
+	// Any thread. Returns nullptr when empty or when another thread won the race.
+	T* Steal()
+	{
+		int64_t T0 = Top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t B = Bottom.load(std::memory_order_acquire);
+		if (T0 >= B)
+			return nullptr;
+		T* Item = Items[T0 & (Capacity - 1)].load(std::memory_order_relaxed);
+		if (!Top.compare_exchange_strong(T0, T0 + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return Item;
+	}
+
+	bool IsEmpty() const
+	{
+		return Top.load(std::memory_order_relaxed) >= Bottom.load(std::memory_order_relaxed);
+	}
+
+private:
+	// owner and thieves touch different ends, keep them on different cache lines
+	alignas(64) std::atomic<int64_t> Top{0};
+	alignas(64) std::atomic<int64_t> Bottom{0};
+	alignas(64) std::atomic<T*> Items[Capacity] = {};
+};
@@ -0,0 +1,114 @@
+#include "ECS/Archetype.h"
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static uint32_t AlignUp(uint32_t Value, uint32_t Alignment)
+{
+	return (Value + Alignment - 1) & ~(Alignment - 1);
+}
+
+static void FreeChunk(FArchetypeChunk* Chunk)
+{
+	free(Chunk->Allocation);
+	delete Chunk;
+}
+
+FArchetype::FArchetype(FComponentMask InMask)
+	: Mask(InMask)
+{
+	for (int32_t& Column : Columns)
+	{
+		Column = -1;
+	}
+	for (uint32_t Id = 0; Id < MAX_COMPONENT_TYPES; ++Id)
+	{
+		if (Mask & (FComponentMask(1) << Id))
+		{
+			Columns[Id] = (int32_t)Components.size();
+			Components.push_back(Id);
+			Sizes.push_back(GetComponentTypeInfo(Id).Size);
+		}
+	}
+
+	// the most entities whose columns, each starting on a cache line, fit in a chunk
+	uint32_t RowSize = sizeof(FEntity);
+	for (uint32_t Size : Sizes)
+	{
+		RowSize += Size;
+	}
+	Offsets.resize(Components.size());
+	for (ChunkCapacity = FArchetypeChunk::SIZE / RowSize; ChunkCapacity > 0; --ChunkCapacity)
+	{
+		uint32_t End = ChunkCapacity * sizeof(FEntity);
+		for (size_t Column = 0; Column < Components.size(); ++Column)
+		{
+			Offsets[Column] = AlignUp(End, CACHE_LINE);
+			End = Offsets[Column] + ChunkCapacity * Sizes[Column];
+		}
+		if (End <= FArchetypeChunk::SIZE)
+		{
+			break;
+		}
+	}
+	assert(ChunkCapacity > 0);
+}
+
+FArchetype::~FArchetype()
+{
+	for (FArchetypeChunk* Chunk : Chunks)
+	{
+		FreeChunk(Chunk);
+	}
+}
+
+uint32_t FArchetype::NumEntities() const
+{
+	// all chunks but the last are full
+	return Chunks.empty() ? 0 : (uint32_t)(Chunks.size() - 1) * ChunkCapacity + Chunks.back()->Num;
+}
+
+void FArchetype::AddRow(FEntity Entity, uint32_t Version, uint32_t& OutChunk, uint32_t& OutRow)
+{
+	if (Chunks.empty() || Chunks.back()->Num == ChunkCapacity)
+	{
+		// aligned by hand, aligned_alloc isn't available everywhere
+		FArchetypeChunk* Chunk = new FArchetypeChunk();
+		Chunk->Allocation = malloc(FArchetypeChunk::SIZE + CACHE_LINE - 1);
+		Chunk->Data = (uint8_t*)(((uintptr_t)Chunk->Allocation + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+		Chunk->Versions.resize(Components.size(), Version);
+		Chunks.push_back(Chunk);
+	}
+	FArchetypeChunk& Chunk = *Chunks.back();
+	OutChunk = (uint32_t)Chunks.size() - 1;
+	OutRow = Chunk.Num++;
+	GetEntities(Chunk)[OutRow] = Entity;
+	for (uint32_t& ColumnVersion : Chunk.Versions)
+	{
+		ColumnVersion = Version;
+	}
+}
+
+FEntity FArchetype::RemoveRow(uint32_t ChunkIndex, uint32_t Row, uint32_t Version)
+{
+	FArchetypeChunk& Chunk = *Chunks[ChunkIndex];
+	FArchetypeChunk& LastChunk = *Chunks.back();
+	uint32_t LastRow = LastChunk.Num - 1;
+	FEntity Moved;
+	if (&Chunk != &LastChunk || Row != LastRow)
+	{
+		Moved = GetEntities(LastChunk)[LastRow];
+		GetEntities(Chunk)[Row] = Moved;
+		for (uint32_t Column = 0; Column < Components.size(); ++Column)
+		{
+			memcpy(GetComponent(Chunk, Column, Row), GetComponent(LastChunk, Column, LastRow), Sizes[Column]);
+			Chunk.Versions[Column] = Version;
+		}
+	}
+	if (--LastChunk.Num == 0)
+	{
+		FreeChunk(&LastChunk);
+		Chunks.pop_back();
+	}
+	return Moved;
+}
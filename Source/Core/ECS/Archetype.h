@@ -0,0 +1,68 @@
+#pragma once
+
+#include "ECS/Entity.h"
+#include <vector>
+
+// A fixed size block holding the entities of one archetype as structure of arrays: the FEntity
+// handles, then one cache line aligned column per component, so a system reading a component
+// walks contiguous memory.
+struct FArchetypeChunk
+{
+	static const uint32_t SIZE = 16 * 1024;
+
+	// cache line aligned, into Allocation
+	uint8_t* Data = nullptr;
+	void* Allocation = nullptr;
+	uint32_t Num = 0;
+	// world version of the last write, per column
+	std::vector<uint32_t> Versions;
+};
+
+// Every entity with exactly the same set of components lives in the same archetype. Chunks are
+// kept full but for the last one: removing an entity moves the archetype's last entity into the
+// hole.
+class FArchetype
+{
+public:
+	static const uint32_t CACHE_LINE = 64;
+
+	explicit FArchetype(FComponentMask InMask);
+	~FArchetype();
+	FArchetype(const FArchetype&) = delete;
+	FArchetype& operator=(const FArchetype&) = delete;
+
+	FComponentMask GetMask() const { return Mask; }
+	// component ids in increasing order
+	const std::vector<uint32_t>& GetComponents() const { return Components; }
+	// -1 when the archetype doesn't have the component
+	int32_t GetColumn(uint32_t ComponentId) const { return Columns[ComponentId]; }
+	uint32_t GetChunkCapacity() const { return ChunkCapacity; }
+	const std::vector<FArchetypeChunk*>& GetChunks() const { return Chunks; }
+	uint32_t NumEntities() const;
+
+	FEntity* GetEntities(const FArchetypeChunk& Chunk) const { return (FEntity*)Chunk.Data; }
+	uint8_t* GetColumnData(const FArchetypeChunk& Chunk, uint32_t Column) const { return Chunk.Data + Offsets[Column]; }
+	void* GetComponent(const FArchetypeChunk& Chunk, uint32_t Column, uint32_t Row) const
+	{
+		return GetColumnData(Chunk, Column) + Row * Sizes[Column];
+	}
+
+	// Appends Entity with uninitialized components, and marks its chunk written at Version.
+	void AddRow(FEntity Entity, uint32_t Version, uint32_t& OutChunk, uint32_t& OutRow);
+	// Returns the entity moved into the row, or a null entity when the row was the last one.
+	FEntity RemoveRow(uint32_t Chunk, uint32_t Row, uint32_t Version);
+
+	// Cached archetype of Mask with a component added or removed, see FWorld.
+	FArchetype* AddEdges[MAX_COMPONENT_TYPES] = {};
+	FArchetype* RemoveEdges[MAX_COMPONENT_TYPES] = {};
+
+private:
+	FComponentMask Mask;
+	std::vector<uint32_t> Components;
+	std::vector<uint32_t> Sizes;
+	// of each column from the start of a chunk, the entities being at 0
+	std::vector<uint32_t> Offsets;
+	int32_t Columns[MAX_COMPONENT_TYPES];
+	uint32_t ChunkCapacity = 0;
+	std::vector<FArchetypeChunk*> Chunks;
+};
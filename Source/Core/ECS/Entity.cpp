@@ -0,0 +1,26 @@
+#include "ECS/Entity.h"
+#include "Logging/Logging.h"
+#include <mutex>
+#include <assert.h>
+
+static FComponentTypeInfo GComponentTypes[MAX_COMPONENT_TYPES];
+static uint32_t GNumComponentTypes = 0;
+static std::mutex GComponentTypesMutex;
+
+uint32_t RegisterComponentType(uint32_t Size, uint32_t Alignment)
+{
+	std::lock_guard<std::mutex> Lock(GComponentTypesMutex);
+	// component masks have one bit per type, so a release build must not carry on either
+	if (GNumComponentTypes >= MAX_COMPONENT_TYPES)
+	{
+		TE_LOG(LogCore, Fatal, "Too many component types, at most %u are supported", (uint32_t)MAX_COMPONENT_TYPES);
+	}
+	GComponentTypes[GNumComponentTypes] = { Size, Alignment };
+	return GNumComponentTypes++;
+}
+
+const FComponentTypeInfo& GetComponentTypeInfo(uint32_t Id)
+{
+	assert(Id < GNumComponentTypes);
+	return GComponentTypes[Id];
+}
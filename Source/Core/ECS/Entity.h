@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <type_traits>
+
+// Handle to an entity of an FWorld. The generation tells a destroyed entity from the one that
+// reused its index; the default handle is never alive.
+struct FEntity
+{
+	uint32_t Index = 0;
+	uint32_t Generation = 0;
+
+	bool IsNull() const { return Generation == 0; }
+	bool operator==(const FEntity& Other) const { return Index == Other.Index && Generation == Other.Generation; }
+	bool operator!=(const FEntity& Other) const { return !(*this == Other); }
+};
+
+static const uint32_t MAX_COMPONENT_TYPES = 64;
+
+// Bit i set for component type i.
+typedef uint64_t FComponentMask;
+
+struct FComponentTypeInfo
+{
+	uint32_t Size;
+	uint32_t Alignment;
+};
+
+// Component types get their id on first use, in any order, so ids are only stable within a run.
+uint32_t RegisterComponentType(uint32_t Size, uint32_t Alignment);
+const FComponentTypeInfo& GetComponentTypeInfo(uint32_t Id);
+
+// Components are plain data: chunks move them around with memcpy and never run constructors.
+template<typename ComponentType>
+struct TComponentType
+{
+	static_assert(std::is_trivially_copyable<ComponentType>::value, "components are moved with memcpy");
+	static_assert(alignof(ComponentType) <= 64, "component columns are aligned to a cache line");
+
+	static uint32_t Id()
+	{
+		static const uint32_t Value = RegisterComponentType(sizeof(ComponentType), alignof(ComponentType));
+		return Value;
+	}
+};
+
+template<typename... ComponentTypes>
+FComponentMask MakeComponentMask()
+{
+	return (FComponentMask(0) | ... | (FComponentMask(1) << TComponentType<ComponentTypes>::Id()));
+}
@@ -0,0 +1,70 @@
+#include "ECS/EntityCommandBuffer.h"
+
+void FEntityCommandBuffer::WriteHeader(ECommand Command, FEntity Entity, FComponentMask Mask)
+{
+	FCommandHeader Header = { Command, Entity, Mask };
+	const uint8_t* Bytes = (const uint8_t*)&Header;
+	Data.insert(Data.end(), Bytes, Bytes + sizeof(Header));
+}
+
+void FEntityCommandBuffer::WriteComponent(uint32_t Id, const void* Component)
+{
+	const uint8_t* IdBytes = (const uint8_t*)&Id;
+	Data.insert(Data.end(), IdBytes, IdBytes + sizeof(Id));
+	const uint8_t* Bytes = (const uint8_t*)Component;
+	Data.insert(Data.end(), Bytes, Bytes + GetComponentTypeInfo(Id).Size);
+}
+
+void FEntityCommandBuffer::Playback(FWorld& World)
+{
+	// the buffer is unaligned, so everything is read with memcpy
+	size_t Offset = 0;
+	while (Offset < Data.size())
+	{
+		FCommandHeader Header;
+		memcpy(&Header, Data.data() + Offset, sizeof(Header));
+		Offset += sizeof(Header);
+
+		FEntity Entity = Header.Entity;
+		switch (Header.Command)
+		{
+		case ECommand::Create:
+			Entity = World.CreateEntityRaw(Header.Mask);
+			break;
+		case ECommand::Destroy:
+			World.DestroyEntity(Entity);
+			break;
+		case ECommand::Add:
+			break;
+		case ECommand::Remove:
+			for (uint32_t Id = 0; Id < MAX_COMPONENT_TYPES; ++Id)
+			{
+				if (Header.Mask & (FComponentMask(1) << Id))
+					World.RemoveComponentRaw(Entity, Id);
+			}
+			break;
+		}
+
+		if (Header.Command == ECommand::Create || Header.Command == ECommand::Add)
+		{
+			FComponentMask Remaining = Header.Mask;
+			while (Remaining != 0)
+			{
+				uint32_t Id;
+				memcpy(&Id, Data.data() + Offset, sizeof(Id));
+				Offset += sizeof(Id);
+				uint32_t Size = GetComponentTypeInfo(Id).Size;
+				// an entity destroyed before the Add was played back
+				void* Destination = Header.Command == ECommand::Create ? World.GetComponentRaw(Entity, Id) :
+					World.IsAlive(Entity) ? World.AddComponentRaw(Entity, Id) : nullptr;
+				if (Destination != nullptr)
+				{
+					memcpy(Destination, Data.data() + Offset, Size);
+				}
+				Offset += Size;
+				Remaining &= ~(FComponentMask(1) << Id);
+			}
+		}
+	}
+	Data.clear();
+}
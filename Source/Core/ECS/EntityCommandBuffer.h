@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ECS/World.h"
+
+// Structural changes recorded while iterating, or from jobs, and applied to a world later in the
+// order they were recorded. A buffer is used by one thread at a time: give every job thread its
+// own, see FJobSystem::GetThreadIndex.
+class FEntityCommandBuffer
+{
+public:
+	template<typename... ComponentTypes>
+	void CreateEntity(const ComponentTypes&... Components)
+	{
+		WriteHeader(ECommand::Create, FEntity(), MakeComponentMask<ComponentTypes...>());
+		(WriteComponent(TComponentType<ComponentTypes>::Id(), &Components), ...);
+	}
+	// Entities destroyed by then are skipped, so several jobs may destroy the same one.
+	void DestroyEntity(FEntity Entity) { WriteHeader(ECommand::Destroy, Entity, 0); }
+	template<typename ComponentType>
+	void AddComponent(FEntity Entity, const ComponentType& Component)
+	{
+		uint32_t Id = TComponentType<ComponentType>::Id();
+		WriteHeader(ECommand::Add, Entity, FComponentMask(1) << Id);
+		WriteComponent(Id, &Component);
+	}
+	template<typename ComponentType>
+	void RemoveComponent(FEntity Entity) { WriteHeader(ECommand::Remove, Entity, MakeComponentMask<ComponentType>()); }
+
+	bool IsEmpty() const { return Data.empty(); }
+	// Applies the commands to World and empties the buffer.
+	void Playback(FWorld& World);
+
+private:
+	enum class ECommand : uint32_t
+	{
+		Create,
+		Destroy,
+		Add,
+		Remove,
+	};
+
+	// followed by the components of Mask for Create and Add, each after its id
+	struct FCommandHeader
+	{
+		ECommand Command;
+		FEntity Entity;
+		FComponentMask Mask;
+	};
+
+	void WriteHeader(ECommand Command, FEntity Entity, FComponentMask Mask);
+	void WriteComponent(uint32_t Id, const void* Component);
+
+	std::vector<uint8_t> Data;
+};
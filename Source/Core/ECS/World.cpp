@@ -0,0 +1,176 @@
+#include "ECS/World.h"
+
+FWorld::FWorld()
+{
+	// entities without components
+	FindOrCreateArchetype(0);
+}
+
+FWorld::~FWorld() = default;
+
+FArchetype* FWorld::FindOrCreateArchetype(FComponentMask Mask)
+{
+	auto It = ArchetypesByMask.find(Mask);
+	if (It != ArchetypesByMask.end())
+	{
+		return It->second;
+	}
+	Archetypes.emplace_back(new FArchetype(Mask));
+	FArchetype* Archetype = Archetypes.back().get();
+	ArchetypesByMask.emplace(Mask, Archetype);
+	return Archetype;
+}
+
+FEntity FWorld::CreateEntityRaw(FComponentMask Mask)
+{
+	assert(NumIterations == 0);
+	FEntity Entity;
+	if (FreeIndices.empty())
+	{
+		Entity.Index = (uint32_t)Records.size();
+		Records.emplace_back();
+	}
+	else
+	{
+		Entity.Index = FreeIndices.back();
+		FreeIndices.pop_back();
+	}
+	FEntityRecord& Record = Records[Entity.Index];
+	Entity.Generation = Record.Generation;
+	Record.Archetype = FindOrCreateArchetype(Mask);
+	Record.Archetype->AddRow(Entity, Version, Record.Chunk, Record.Row);
+	const FArchetypeChunk& Chunk = *Record.Archetype->GetChunks()[Record.Chunk];
+	for (uint32_t Column = 0; Column < Record.Archetype->GetComponents().size(); ++Column)
+	{
+		memset(Record.Archetype->GetComponent(Chunk, Column, Record.Row), 0, GetComponentTypeInfo(Record.Archetype->GetComponents()[Column]).Size);
+	}
+	++NumAlive;
+	return Entity;
+}
+
+void FWorld::RemoveRow(FEntityRecord& Record)
+{
+	FEntity Moved = Record.Archetype->RemoveRow(Record.Chunk, Record.Row, Version);
+	if (!Moved.IsNull())
+	{
+		Records[Moved.Index].Chunk = Record.Chunk;
+		Records[Moved.Index].Row = Record.Row;
+	}
+}
+
+void FWorld::DestroyEntity(FEntity Entity)
+{
+	assert(NumIterations == 0);
+	if (!IsAlive(Entity))
+	{
+		return;
+	}
+	FEntityRecord& Record = Records[Entity.Index];
+	RemoveRow(Record);
+	Record.Archetype = nullptr;
+	// 0 is the null entity's
+	Record.Generation = Record.Generation + 1 == 0 ? 1 : Record.Generation + 1;
+	FreeIndices.push_back(Entity.Index);
+	--NumAlive;
+}
+
+void FWorld::MoveEntity(FEntity Entity, FArchetype* Target)
+{
+	FEntityRecord& Record = Records[Entity.Index];
+	FArchetype* Source = Record.Archetype;
+	const FArchetypeChunk& SourceChunk = *Source->GetChunks()[Record.Chunk];
+	uint32_t TargetChunkIndex, TargetRow;
+	Target->AddRow(Entity, Version, TargetChunkIndex, TargetRow);
+	const FArchetypeChunk& TargetChunk = *Target->GetChunks()[TargetChunkIndex];
+	for (uint32_t TargetColumn = 0; TargetColumn < Target->GetComponents().size(); ++TargetColumn)
+	{
+		uint32_t Id = Target->GetComponents()[TargetColumn];
+		void* Destination = Target->GetComponent(TargetChunk, TargetColumn, TargetRow);
+		int32_t SourceColumn = Source->GetColumn(Id);
+		if (SourceColumn >= 0)
+			memcpy(Destination, Source->GetComponent(SourceChunk, SourceColumn, Record.Row), GetComponentTypeInfo(Id).Size);
+		else
+			memset(Destination, 0, GetComponentTypeInfo(Id).Size);
+	}
+	RemoveRow(Record);
+	Record.Archetype = Target;
+	Record.Chunk = TargetChunkIndex;
+	Record.Row = TargetRow;
+}
+
+void* FWorld::AddComponentRaw(FEntity Entity, uint32_t ComponentId)
+{
+	assert(NumIterations == 0 && IsAlive(Entity));
+	FEntityRecord& Record = Records[Entity.Index];
+	FArchetype* Source = Record.Archetype;
+	if (Source->GetColumn(ComponentId) < 0)
+	{
+		FArchetype*& Target = Source->AddEdges[ComponentId];
+		if (Target == nullptr)
+		{
+			Target = FindOrCreateArchetype(Source->GetMask() | (FComponentMask(1) << ComponentId));
+		}
+		MoveEntity(Entity, Target);
+	}
+	else
+	{
+		Source->GetChunks()[Record.Chunk]->Versions[Source->GetColumn(ComponentId)] = Version;
+	}
+	return GetComponentRaw(Entity, ComponentId);
+}
+
+void FWorld::RemoveComponentRaw(FEntity Entity, uint32_t ComponentId)
+{
+	assert(NumIterations == 0);
+	if (!IsAlive(Entity) || Records[Entity.Index].Archetype->GetColumn(ComponentId) < 0)
+	{
+		return;
+	}
+	FArchetype* Source = Records[Entity.Index].Archetype;
+	FArchetype*& Target = Source->RemoveEdges[ComponentId];
+	if (Target == nullptr)
+	{
+		Target = FindOrCreateArchetype(Source->GetMask() & ~(FComponentMask(1) << ComponentId));
+	}
+	MoveEntity(Entity, Target);
+}
+
+void* FWorld::GetComponentRaw(FEntity Entity, uint32_t ComponentId) const
+{
+	if (!IsAlive(Entity))
+	{
+		return nullptr;
+	}
+	const FEntityRecord& Record = Records[Entity.Index];
+	int32_t Column = Record.Archetype->GetColumn(ComponentId);
+	return Column >= 0 ? Record.Archetype->GetComponent(*Record.Archetype->GetChunks()[Record.Chunk], Column, Record.Row) : nullptr;
+}
+
+void FWorld::UpdateQuery(FEntityQuery& Query) const
+{
+	if (Query.World != this)
+	{
+		Query.World = this;
+		Query.Archetypes.clear();
+		Query.NumArchetypesChecked = 0;
+	}
+	for (; Query.NumArchetypesChecked < Archetypes.size(); ++Query.NumArchetypesChecked)
+	{
+		FArchetype* Archetype = Archetypes[Query.NumArchetypesChecked].get();
+		if (Query.Matches(Archetype->GetMask()))
+		{
+			Query.Archetypes.push_back(Archetype);
+		}
+	}
+}
+
+uint32_t FWorld::Count(FEntityQuery& Query)
+{
+	UpdateQuery(Query);
+	uint32_t Num = 0;
+	for (const FArchetype* Archetype : Query.Archetypes)
+	{
+		Num += Archetype->NumEntities();
+	}
+	return Num;
+}
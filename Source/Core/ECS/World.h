@@ -0,0 +1,229 @@
+#pragma once
+
+#include "ECS/Archetype.h"
+#include "Async/JobSystem.h"
+#include <unordered_map>
+#include <memory>
+#include <string.h>
+#include <assert.h>
+
+// One chunk as a system sees it. Write stamps the column with the world's version, which is
+// how ChangedSince tells the chunks a system has to look at again.
+class FChunkView
+{
+public:
+	FChunkView(const FArchetype& InArchetype, FArchetypeChunk& InChunk, uint32_t InVersion)
+		: Archetype(&InArchetype), Chunk(&InChunk), Version(InVersion) {}
+
+	uint32_t Num() const { return Chunk->Num; }
+	const FEntity* GetEntities() const { return Archetype->GetEntities(*Chunk); }
+	const FArchetype& GetArchetype() const { return *Archetype; }
+
+	template<typename ComponentType>
+	bool Has() const { return Archetype->GetColumn(TComponentType<ComponentType>::Id()) >= 0; }
+
+	// nullptr when the chunk doesn't have the component
+	template<typename ComponentType>
+	const ComponentType* Read() const
+	{
+		int32_t Column = Archetype->GetColumn(TComponentType<ComponentType>::Id());
+		return Column >= 0 ? (const ComponentType*)Archetype->GetColumnData(*Chunk, Column) : nullptr;
+	}
+	template<typename ComponentType>
+	ComponentType* Write() const
+	{
+		int32_t Column = Archetype->GetColumn(TComponentType<ComponentType>::Id());
+		if (Column < 0)
+		{
+			return nullptr;
+		}
+		Chunk->Versions[Column] = Version;
+		return (ComponentType*)Archetype->GetColumnData(*Chunk, Column);
+	}
+
+	// Whether the column was written, or entities were added to or moved into the chunk, after
+	// SinceVersion.
+	template<typename ComponentType>
+	bool ChangedSince(uint32_t SinceVersion) const
+	{
+		int32_t Column = Archetype->GetColumn(TComponentType<ComponentType>::Id());
+		return Column >= 0 && Chunk->Versions[Column] > SinceVersion;
+	}
+
+private:
+	const FArchetype* Archetype;
+	FArchetypeChunk* Chunk;
+	uint32_t Version;
+};
+
+// The archetypes having all of the With components and none of the Without ones. The matching
+// archetypes are cached, and only archetypes created since the last use are checked again.
+class FEntityQuery
+{
+public:
+	template<typename... ComponentTypes>
+	FEntityQuery& With() { All |= MakeComponentMask<ComponentTypes...>(); return *this; }
+	template<typename... ComponentTypes>
+	FEntityQuery& Without() { None |= MakeComponentMask<ComponentTypes...>(); return *this; }
+
+	bool Matches(FComponentMask Mask) const { return (Mask & All) == All && (Mask & None) == 0; }
+
+private:
+	friend class FWorld;
+
+	FComponentMask All = 0;
+	FComponentMask None = 0;
+	std::vector<FArchetype*> Archetypes;
+	size_t NumArchetypesChecked = 0;
+	const class FWorld* World = nullptr;
+};
+
+// Entities and their components, stored by archetype. Structural changes (creating and destroying
+// entities, adding and removing components) happen on the owning thread and never while iterating;
+// jobs record them into an FEntityCommandBuffer instead.
+class FWorld
+{
+public:
+	FWorld();
+	~FWorld();
+	FWorld(const FWorld&) = delete;
+	FWorld& operator=(const FWorld&) = delete;
+
+	// Version that writes are stamped with. A system that remembers the version it ran at, and
+	// increments it before running, sees every later write through FChunkView::ChangedSince.
+	uint32_t GetVersion() const { return Version; }
+	uint32_t IncrementVersion() { return ++Version; }
+
+	uint32_t NumEntities() const { return NumAlive; }
+	uint32_t NumArchetypes() const { return (uint32_t)Archetypes.size(); }
+	bool IsAlive(FEntity Entity) const
+	{
+		return Entity.Index < Records.size() && Records[Entity.Index].Generation == Entity.Generation && !Entity.IsNull();
+	}
+
+	template<typename... ComponentTypes>
+	FEntity CreateEntity(const ComponentTypes&... Components)
+	{
+		FEntity Entity = CreateEntityRaw(MakeComponentMask<ComponentTypes...>());
+		(memcpy(GetComponentRaw(Entity, TComponentType<ComponentTypes>::Id()), &Components, sizeof(ComponentTypes)), ...);
+		return Entity;
+	}
+	void DestroyEntity(FEntity Entity);
+
+	// Overwrites the component if the entity already has it.
+	template<typename ComponentType>
+	void AddComponent(FEntity Entity, const ComponentType& Component)
+	{
+		memcpy(AddComponentRaw(Entity, TComponentType<ComponentType>::Id()), &Component, sizeof(ComponentType));
+	}
+	template<typename ComponentType>
+	void RemoveComponent(FEntity Entity) { RemoveComponentRaw(Entity, TComponentType<ComponentType>::Id()); }
+
+	template<typename ComponentType>
+	bool HasComponent(FEntity Entity) const
+	{
+		return IsAlive(Entity) && Records[Entity.Index].Archetype->GetColumn(TComponentType<ComponentType>::Id()) >= 0;
+	}
+	// nullptr when the entity doesn't have the component
+	template<typename ComponentType>
+	const ComponentType* GetComponent(FEntity Entity) const
+	{
+		return (const ComponentType*)GetComponentRaw(Entity, TComponentType<ComponentType>::Id());
+	}
+	// Marks the entity's chunk written, like FChunkView::Write.
+	template<typename ComponentType>
+	void SetComponent(FEntity Entity, const ComponentType& Component)
+	{
+		uint32_t Id = TComponentType<ComponentType>::Id();
+		void* Destination = GetComponentRaw(Entity, Id);
+		assert(Destination != nullptr);
+		const FEntityRecord& Record = Records[Entity.Index];
+		Record.Archetype->GetChunks()[Record.Chunk]->Versions[Record.Archetype->GetColumn(Id)] = Version;
+		memcpy(Destination, &Component, sizeof(ComponentType));
+	}
+
+	// Calls Function(const FChunkView&) for every chunk of the archetypes matching Query.
+	template<typename FunctionType>
+	void ForEachChunk(FEntityQuery& Query, FunctionType&& Function)
+	{
+		UpdateQuery(Query);
+		++NumIterations;
+		for (FArchetype* Archetype : Query.Archetypes)
+		{
+			for (FArchetypeChunk* Chunk : Archetype->GetChunks())
+			{
+				Function(FChunkView(*Archetype, *Chunk, Version));
+			}
+		}
+		--NumIterations;
+	}
+
+	// Like ForEachChunk, but spreads the chunks over the job system and waits for all of them.
+	// Every chunk is visited by one job, so writes to its components don't need synchronization.
+	template<typename FunctionType>
+	void ParallelForEachChunk(FEntityQuery& Query, FunctionType&& Function)
+	{
+		UpdateQuery(Query);
+		std::vector<FChunkView> Views;
+		for (FArchetype* Archetype : Query.Archetypes)
+		{
+			for (FArchetypeChunk* Chunk : Archetype->GetChunks())
+			{
+				Views.emplace_back(*Archetype, *Chunk, Version);
+			}
+		}
+		++NumIterations;
+		FJobSystem& JobSystem = FJobSystem::Get();
+		if (JobSystem.IsInitialized() && Views.size() > 1)
+		{
+			JobSystem.ParallelFor((uint32_t)Views.size(), 0, [&Views, &Function](uint32_t Begin, uint32_t End)
+			{
+				for (uint32_t i = Begin; i < End; ++i)
+					Function(Views[i]);
+			});
+		}
+		else
+		{
+			for (const FChunkView& View : Views)
+				Function(View);
+		}
+		--NumIterations;
+	}
+
+	// Number of entities matching Query.
+	uint32_t Count(FEntityQuery& Query);
+
+private:
+	friend class FEntityCommandBuffer;
+
+	struct FEntityRecord
+	{
+		FArchetype* Archetype = nullptr;
+		uint32_t Chunk = 0;
+		uint32_t Row = 0;
+		// of the entity using the index, or of the next one while the index is free
+		uint32_t Generation = 1;
+	};
+
+	// Components are zeroed.
+	FEntity CreateEntityRaw(FComponentMask Mask);
+	// The component's storage, zeroed if the entity didn't have it.
+	void* AddComponentRaw(FEntity Entity, uint32_t ComponentId);
+	void RemoveComponentRaw(FEntity Entity, uint32_t ComponentId);
+	void* GetComponentRaw(FEntity Entity, uint32_t ComponentId) const;
+
+	FArchetype* FindOrCreateArchetype(FComponentMask Mask);
+	// Moves Entity's row to Target, copying the components both archetypes have.
+	void MoveEntity(FEntity Entity, FArchetype* Target);
+	void RemoveRow(FEntityRecord& Record);
+	void UpdateQuery(FEntityQuery& Query) const;
+
+	std::vector<std::unique_ptr<FArchetype>> Archetypes;
+	std::unordered_map<FComponentMask, FArchetype*> ArchetypesByMask;
+	std::vector<FEntityRecord> Records;
+	std::vector<uint32_t> FreeIndices;
+	uint32_t NumAlive = 0;
+	uint32_t Version = 1;
+	// structural changes would invalidate the chunks being iterated
+	int32_t NumIterations = 0;
+};
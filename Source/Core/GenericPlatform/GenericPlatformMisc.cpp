@@ -1,31 +1,100 @@
 #include "GenericPlatformMisc.h"
+#include "HAL/PlatformMisc.h"
+#include "Logging/Logging.h"
+#include "IO/PakFile.h"
 #include <stdio.h>
 #include <stdarg.h>
 #include <fstream>
-#include <sstream>
+#include <string.h>
+#include <chrono>
+#include <filesystem>
+#include <thread>
 
 void FGenericPlatformMisc::LocalPrint(const char* Str)
 {
-	printf("%s: %s\n", LOG_TAG, Str);
+	FLogger::Get().LogString(nullptr, ELogVerbosity::Display, Str);
 }
 
 void FGenericPlatformMisc::LocalPrintf(const char* Format, ...)
 {
 	va_list arg_list;
 	va_start(arg_list, Format);
-	fprintf(stdout, "%s: ", LOG_TAG);
-	vfprintf(stdout, Format, arg_list);
+	FLogger::Get().LogV(nullptr, ELogVerbosity::Display, Format, arg_list);
 	va_end(arg_list);
 }
 
+void FGenericPlatformMisc::WriteToLog(ELogVerbosity Verbosity, const char* Line)
+{
+	// errors go to stderr, so they still show when stdout is redirected
+	FILE* Stream = Verbosity <= ELogVerbosity::Error ? stderr : stdout;
+	fprintf(Stream, "%s: %s\n", LOG_TAG, Line);
+}
+
+void FGenericPlatformMisc::FlushLog()
+{
+	fflush(stdout);
+	fflush(stderr);
+}
+
+FFileView::FFileView(FFileView&& Other) noexcept
+	: Data(Other.Data), Size(Other.Size), Handle(Other.Handle), Release(Other.Release)
+{
+	Other.Data = nullptr;
+	Other.Size = 0;
+	Other.Handle = nullptr;
+	Other.Release = nullptr;
+}
+
+FFileView& FFileView::operator=(FFileView&& Other) noexcept
+{
+	if (this != &Other)
+	{
+		Reset();
+		Data = Other.Data;
+		Size = Other.Size;
+		Handle = Other.Handle;
+		Release = Other.Release;
+		Other.Data = nullptr;
+		Other.Size = 0;
+		Other.Handle = nullptr;
+		Other.Release = nullptr;
+	}
+	return *this;
+}
+
+void FFileView::Reset()
+{
+	if (Release)
+	{
+		Release(Data, Size, Handle);
+	}
+	Data = nullptr;
+	Size = 0;
+	Handle = nullptr;
+	Release = nullptr;
+}
+
 std::vector<char> FGenericPlatformMisc::ReadFile(const char* Filename)
 {
-	std::stringstream ss;
-	ss << "../../Resource/" << Filename;
-	std::ifstream File(ss.str(), std::ios::ate | std::ios::binary);
+	const FPakEntry* Entry = nullptr;
+	if (const FPakFile* Pak = FPakManager::Get().Find(Filename, Entry))
+	{
+		std::vector<char> Buffer((size_t)Entry->Size);
+		if (!Pak->Read(*Entry, 0, Buffer.data(), Entry->Size))
+		{
+			Buffer.clear();
+		}
+		return Buffer;
+	}
+	return FPlatformMisc::ReadLooseFile(Filename);
+}
+
+std::vector<char> FGenericPlatformMisc::ReadLooseFile(const char* Filename)
+{
+	std::ifstream File(std::string(FPlatformMisc::ResourceDir()) + Filename, std::ios::ate | std::ios::binary);
 	if (!File.is_open())
 	{
-		FGenericPlatformMisc::LocalPrintf("Failed to read file: %s", Filename);
+		TE_LOG(LogCore, Error, "Failed to read file: %s", Filename);
 		throw std::runtime_error("Failed to open file");
 	}
 	size_t FileSize = (size_t)File.tellg();
@@ -36,3 +105,138 @@ std::vector<char> FGenericPlatformMisc::ReadFile(const char* Filename)
 	return Buffer;
 }
 
+FFileView FGenericPlatformMisc::MapFile(const char* Filename)
+{
+	const FPakEntry* Entry = nullptr;
+	if (const FPakFile* Pak = FPakManager::Get().Find(Filename, Entry))
+	{
+		return Pak->Map(*Entry);
+	}
+	return FPlatformMisc::MapLooseFile(Filename);
+}
+
+FFileView FGenericPlatformMisc::MapLooseFile(const char* Filename)
+{
+	std::vector<char> Buffer;
+	try
+	{
+		Buffer = FPlatformMisc::ReadLooseFile(Filename);
+	}
+	catch (const std::runtime_error&)
+	{
+		return FFileView();
+	}
+	// the view owns the buffer read, an empty file still needs valid data
+	std::vector<char>* Owner = new std::vector<char>(std::move(Buffer));
+	const char* Data = Owner->empty() ? "" : Owner->data();
+	return FFileView(Data, Owner->size(), Owner, [](const char*, size_t, void* Handle) { delete (std::vector<char>*)Handle; });
+}
+
+void* FGenericPlatformMisc::OpenReadHandle(const char* Filename, uint64_t& OutSize)
+{
+	std::ifstream* File = new std::ifstream(std::string(FPlatformMisc::ResourceDir()) + Filename, std::ios::ate | std::ios::binary);
+	if (!File->is_open())
+	{
+		delete File;
+		return nullptr;
+	}
+	OutSize = (uint64_t)File->tellg();
+	return File;
+}
+
+bool FGenericPlatformMisc::ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers)
+{
+	std::ifstream& File = *(std::ifstream*)Handle;
+	File.clear();
+	File.seekg((std::streamoff)Offset);
+	for (uint32_t i = 0; i < NumBuffers && File; ++i)
+	{
+		File.read((char*)Buffers[i].Data, (std::streamsize)Buffers[i].Size);
+	}
+	return (bool)File;
+}
+
+void FGenericPlatformMisc::CloseReadHandle(void* Handle)
+{
+	delete (std::ifstream*)Handle;
+}
+
+std::string FGenericPlatformMisc::SavedDir()
+{
+	return "../../Saved/";
+}
+
+std::vector<char> FGenericPlatformMisc::ReadSavedFile(const char* Filename)
+{
+	std::vector<char> Buffer;
+	std::ifstream File(FPlatformMisc::SavedDir() + Filename, std::ios::ate | std::ios::binary);
+	if (!File.is_open())
+	{
+		return Buffer;
+	}
+	Buffer.resize((size_t)File.tellg());
+	File.seekg(0);
+	File.read(Buffer.data(), Buffer.size());
+	if (!File)
+	{
+		Buffer.clear();
+	}
+	return Buffer;
+}
+
+bool FGenericPlatformMisc::WriteSavedFile(const char* Filename, const void* Data, size_t Size)
+{
+	std::string Path = FPlatformMisc::SavedDir() + Filename;
+	std::string TempPath = Path + ".tmp";
+	std::error_code Error;
+	std::filesystem::create_directories(FPlatformMisc::SavedDir(), Error);
+	{
+		std::ofstream File(TempPath, std::ios::binary | std::ios::trunc);
+		if (!File.is_open())
+		{
+			TE_LOG(LogCore, Error, "Failed to write file: %s", TempPath.c_str());
+			return false;
+		}
+		File.write((const char*)Data, Size);
+		if (!File)
+		{
+			TE_LOG(LogCore, Error, "Failed to write file: %s", TempPath.c_str());
+			return false;
+		}
+	}
+	// rename replaces the target atomically on POSIX and on NTFS (MoveFileEx semantics)
+	std::filesystem::rename(TempPath, Path, Error);
+	if (Error)
+	{
+		TE_LOG(LogCore, Error, "Failed to rename %s: %s", TempPath.c_str(), Error.message().c_str());
+		std::filesystem::remove(TempPath, Error);
+		return false;
+	}
+	return true;
+}
+
+double FGenericPlatformMisc::Seconds()
+{
+	using namespace std::chrono;
+	return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void FGenericPlatformMisc::Sleep(double Seconds)
+{
+	if (Seconds > 0.0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(Seconds));
+	}
+}
+
+uint32_t FGenericPlatformMisc::NumberOfCores()
+{
+	uint32_t NumCores = std::thread::hardware_concurrency();
+	return NumCores > 0 ? NumCores : 1;
+}
+
+uint64_t FGenericPlatformMisc::GetPerformanceCoreMask()
+{
+	uint32_t NumCores = FPlatformMisc::NumberOfCores();
+	return NumCores >= 64 ? ~0ull : (1ull << NumCores) - 1;
+}
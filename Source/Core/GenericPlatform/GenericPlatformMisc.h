@@ -1,18 +1,113 @@
 #pragma once
 
 #include <vector>
+#include <string>
+#include <stdint.h>
+#include "Logging/Logging.h"
 
 static const char* LOG_TAG = "[TinyEngine]";
 
+// One destination of a scattered read, see FGenericPlatformMisc::ReadFileAt.
+struct FReadBuffer
+{
+	void* Data;
+	size_t Size;
+};
+
+// Read-only view of a whole file, mapped into memory for as long as the view lives instead of being
+// copied to the heap. Move-only; a default constructed view is invalid.
+class FFileView
+{
+public:
+	// Unmaps the view, Handle is whatever the platform needs besides the data.
+	typedef void (*FReleaseFunction)(const char* Data, size_t Size, void* Handle);
+
+	FFileView() = default;
+	FFileView(const char* InData, size_t InSize, void* InHandle, FReleaseFunction InRelease)
+		: Data(InData), Size(InSize), Handle(InHandle), Release(InRelease) {}
+	~FFileView() { Reset(); }
+
+	FFileView(FFileView&& Other) noexcept;
+	FFileView& operator=(FFileView&& Other) noexcept;
+	FFileView(const FFileView&) = delete;
+	FFileView& operator=(const FFileView&) = delete;
+
+	// true for empty files too
+	bool IsValid() const { return Data != nullptr; }
+	const char* GetData() const { return Data; }
+	size_t GetSize() const { return Size; }
+
+	void Reset();
+
+private:
+	const char* Data = nullptr;
+	size_t Size = 0;
+	void* Handle = nullptr;
+	FReleaseFunction Release = nullptr;
+};
+
 struct FGenericPlatformMisc
 {
 	static void PlatformInit() {}
 
+	// Log a message through FLogger. Output is asynchronous, the format must be a string literal.
 	static void LocalPrint(const char* Str);
 
-	static void LocalPrintf(const char* Format, ...);
+	static void LocalPrintf(const char* Format, ...) LOG_PRINTF_FORMAT(1, 2);
+
+	// Writes one formatted line to the platform's log, called by FLogger.
+	static void WriteToLog(ELogVerbosity Verbosity, const char* Line);
+
+	// Called by FLogger after writing a batch of lines.
+	static void FlushLog();
 
 	static void PumpMessages() {}
 
+	// Directory ReadFile and MapFile load resources from, with a trailing slash.
+	static const char* ResourceDir() { return "../../Resource/"; }
+
+	// Reads a resource into a new buffer. Prefer MapFile for data that is only read once.
+	// Resources are looked up in the mounted pak files first, see FPakManager.
 	static std::vector<char> ReadFile(const char* Filename);
+
+	// Maps a resource read-only, invalid if it does not exist. Platforms without file mapping
+	// read it into a buffer owned by the view.
+	static FFileView MapFile(const char* Filename);
+
+	// ReadFile and MapFile for resources outside of pak files, implemented by the platforms.
+	static std::vector<char> ReadLooseFile(const char* Filename);
+	static FFileView MapLooseFile(const char* Filename);
+
+	// Opens a resource for random access reads, nullptr if it does not exist. Handles may be used
+	// by one thread at a time.
+	static void* OpenReadHandle(const char* Filename, uint64_t& OutSize);
+	// Reads the bytes from Offset on into Buffers, one after the other, in as few calls as the
+	// platform allows. False on errors and when the file ends early.
+	static bool ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers);
+	static void CloseReadHandle(void* Handle);
+
+	// Directory for files the engine writes at runtime (caches, settings), with a trailing slash.
+	static std::string SavedDir();
+
+	// Reads a file from SavedDir(), empty if it does not exist.
+	static std::vector<char> ReadSavedFile(const char* Filename);
+
+	// Writes a file to SavedDir() through a temporary file and a rename, so readers never see a torn file.
+	static bool WriteSavedFile(const char* Filename, const void* Data, size_t Size);
+
+	// Monotonic time in seconds, for measuring intervals only.
+	static double Seconds();
+
+	// Blocks the calling thread for about Seconds, at the scheduler's resolution.
+	static void Sleep(double Seconds);
+
+	// Logical cores available to the process, at least 1.
+	static uint32_t NumberOfCores();
+
+	// Bit N set for every core of the fastest cluster on heterogeneous (big.LITTLE) CPUs,
+	// or for every core when all cores are alike or the topology is unknown.
+	static uint64_t GetPerformanceCoreMask();
+
+	// Restricts the calling thread to the cores in Mask. Returns false when not supported.
+	static bool SetThreadAffinityMask(uint64_t /*Mask*/) { return false; }
 };
\ No newline at end of file
@@ -2,4 +2,6 @@
 #include "Windows/WindowsPlatformMisc.h"
 #elif PLATFORM_ANDROID
 #include "Android/AndroidPlatformMisc.h"
+#elif PLATFORM_LINUX
+#include "Linux/LinuxPlatformMisc.h"
 #endif
\ No newline at end of file
@@ -0,0 +1,342 @@
+#include "AsyncIO.h"
+#include "PakFile.h"
+#include "HAL/PlatformMisc.h"
+#include "Logging/Logging.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+
+// runs of adjacent requests merged into one read, bounded by the scatter list
+static const uint32_t MAX_MERGED_REQUESTS = 64;
+
+FAsyncIO& FAsyncIO::Get()
+{
+	static FAsyncIO AsyncIO;
+	return AsyncIO;
+}
+
+void FAsyncIO::Init()
+{
+	StopRequested = false;
+	Thread = std::thread(&FAsyncIO::ThreadLoop, this);
+}
+
+void FAsyncIO::Shutdown()
+{
+	std::vector<FIORequestHandle> Cancelled;
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		StopRequested = true;
+		Cancelled.swap(Queue);
+	}
+	QueueCondition.notify_one();
+	if (Thread.joinable())
+	{
+		Thread.join();
+	}
+	for (FIORequestHandle& Request : Cancelled)
+	{
+		Request->Status.store(EIORequestStatus::Cancelled, std::memory_order_release);
+	}
+	{
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		Stats.RequestsCancelled += Cancelled.size();
+	}
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+	}
+	DoneCondition.notify_all();
+}
+
+FIORequestHandle FAsyncIO::Read(const char* Filename, uint64_t Offset, uint64_t Size, void* Destination,
+	EIOPriority Priority, FIOCallback Callback)
+{
+	FIORequestHandle Request = std::make_shared<FIORequest>();
+	Request->Filename = Filename;
+	Request->Offset = Offset;
+	Request->Size = Size;
+	Request->Destination = Destination;
+	Request->Priority = Priority;
+	Request->Callback = std::move(Callback);
+	Request->SubmitTime = FPlatformMisc::Seconds();
+	Request->SourceFilename = Filename;
+	const FPakEntry* Entry = nullptr;
+	if (const FPakFile* Pak = FPakManager::Get().Find(Filename, Entry))
+	{
+		if (Size == READ_TO_END)
+		{
+			Request->Size = Offset <= Entry->Size ? Entry->Size - Offset : READ_TO_END;
+		}
+		if (Offset > Entry->Size || Request->Size > Entry->Size - Offset)
+		{
+			TE_LOG(LogCore, Error, "Async read failed, out of bounds: %s", Filename);
+			Complete(*Request, false);
+			return Request;
+		}
+		if (Entry->NumBlocks == 0)
+		{
+			Request->SourceFilename = Pak->GetFilename();
+			Request->Offset = Entry->Offset + Offset;
+		}
+		else
+		{
+			Request->Pak = Pak;
+			Request->PakEntry = Entry;
+		}
+	}
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		if (Thread.joinable() && !StopRequested)
+		{
+			Request->Sequence = NextSequence++;
+			Queue.push_back(Request);
+			QueueCondition.notify_one();
+			return Request;
+		}
+	}
+	// no I/O thread, read right away
+	std::vector<FIORequestHandle> Batch(1, Request);
+	ReadBatch(Batch);
+	return Request;
+}
+
+bool FAsyncIO::Cancel(const FIORequestHandle& Request)
+{
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		auto It = std::find(Queue.begin(), Queue.end(), Request);
+		if (It == Queue.end())
+		{
+			return false;
+		}
+		*It = std::move(Queue.back());
+		Queue.pop_back();
+	}
+	Request->CompleteTime = FPlatformMisc::Seconds();
+	Request->Status.store(EIORequestStatus::Cancelled, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		++Stats.RequestsCancelled;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+	}
+	DoneCondition.notify_all();
+	return true;
+}
+
+void FAsyncIO::Wait(const FIORequestHandle& Request)
+{
+	if (Request->IsDone())
+	{
+		return;
+	}
+	SCOPED_CPU_EVENT("WaitForIO");
+	std::unique_lock<std::mutex> Lock(DoneMutex);
+	DoneCondition.wait(Lock, [&Request] { return Request->IsDone(); });
+}
+
+void FAsyncIO::SetPriority(const FIORequestHandle& Request, EIOPriority Priority)
+{
+	// the I/O thread only reads Priority under the lock, while the request is queued
+	std::lock_guard<std::mutex> Lock(QueueMutex);
+	Request->Priority = Priority;
+}
+
+void FAsyncIO::ThreadLoop()
+{
+	FProfiler::Get().SetThreadName("I/O Thread");
+	std::vector<FIORequestHandle> Batch;
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> Lock(QueueMutex);
+			QueueCondition.wait(Lock, [this] { return StopRequested || !Queue.empty(); });
+			if (StopRequested)
+			{
+				return;
+			}
+			TakeBatch(Batch);
+		}
+		ReadBatch(Batch);
+		Batch.clear();
+	}
+}
+
+void FAsyncIO::TakeBatch(std::vector<FIORequestHandle>& OutBatch)
+{
+	EIOPriority Highest = EIOPriority::Low;
+	for (const FIORequestHandle& Request : Queue)
+	{
+		Highest = std::max(Highest, Request->Priority);
+	}
+	// the oldest requests of the highest priority
+	auto End = std::partition(Queue.begin(), Queue.end(), [Highest](const FIORequestHandle& Request) { return Request->Priority != Highest; });
+	if ((size_t)(Queue.end() - End) > MAX_BATCH_SIZE)
+	{
+		std::nth_element(End, End + MAX_BATCH_SIZE, Queue.end(), [](const FIORequestHandle& A, const FIORequestHandle& B) { return A->Sequence < B->Sequence; });
+		OutBatch.assign(End, End + MAX_BATCH_SIZE);
+		Queue.erase(End, End + MAX_BATCH_SIZE);
+	}
+	else
+	{
+		OutBatch.assign(End, Queue.end());
+		Queue.erase(End, Queue.end());
+	}
+}
+
+void FAsyncIO::ReadBatch(std::vector<FIORequestHandle>& Batch)
+{
+	SCOPED_CPU_EVENT("ReadBatch");
+	double StartTime = FPlatformMisc::Seconds();
+	uint64_t NumReads = 0;
+	// compressed pak entries are decoded from the mapped archive
+	auto Compressed = std::partition(Batch.begin(), Batch.end(), [](const FIORequestHandle& Request) { return Request->PakEntry == nullptr; });
+	for (auto It = Compressed; It != Batch.end(); ++It)
+	{
+		FIORequest& Request = **It;
+		if (Request.Destination == nullptr)
+		{
+			Request.Buffer.resize((size_t)Request.Size);
+		}
+		bool Succeeded = Request.Pak->Read(*Request.PakEntry, Request.Offset, Request.Destination ? Request.Destination : Request.Buffer.data(), Request.Size);
+		++NumReads;
+		Complete(Request, Succeeded);
+	}
+	Batch.erase(Compressed, Batch.end());
+
+	std::sort(Batch.begin(), Batch.end(), [](const FIORequestHandle& A, const FIORequestHandle& B)
+	{
+		int Compare = A->SourceFilename.compare(B->SourceFilename);
+		return Compare != 0 ? Compare < 0 : A->Offset < B->Offset;
+	});
+
+	FReadBuffer Buffers[MAX_MERGED_REQUESTS];
+	for (size_t FileBegin = 0; FileBegin < Batch.size();)
+	{
+		size_t FileEnd = FileBegin + 1;
+		while (FileEnd < Batch.size() && Batch[FileEnd]->SourceFilename == Batch[FileBegin]->SourceFilename)
+		{
+			++FileEnd;
+		}
+
+		uint64_t FileSize = 0;
+		void* Handle = FPlatformMisc::OpenReadHandle(Batch[FileBegin]->SourceFilename.c_str(), FileSize);
+		if (Handle == nullptr)
+		{
+			TE_LOG(LogCore, Error, "Async read failed, no such file: %s", Batch[FileBegin]->Filename.c_str());
+		}
+		// sizes are resolved first so runs of adjacent requests can be found
+		for (size_t i = FileBegin; i < FileEnd; ++i)
+		{
+			FIORequest& Request = *Batch[i];
+			if (Handle && Request.Size == READ_TO_END)
+			{
+				Request.Size = Request.Offset <= FileSize ? FileSize - Request.Offset : READ_TO_END;
+			}
+		}
+
+		for (size_t RunBegin = FileBegin; RunBegin < FileEnd;)
+		{
+			FIORequest& First = *Batch[RunBegin];
+			if (Handle == nullptr || First.Offset > FileSize || First.Size > FileSize - First.Offset)
+			{
+				Complete(First, false);
+				++RunBegin;
+				continue;
+			}
+			size_t RunEnd = RunBegin;
+			uint64_t RunOffset = First.Offset;
+			uint64_t NextOffset = First.Offset;
+			uint32_t NumBuffers = 0;
+			while (RunEnd < FileEnd && NumBuffers < MAX_MERGED_REQUESTS)
+			{
+				FIORequest& Request = *Batch[RunEnd];
+				if (Request.Offset != NextOffset || Request.Size > FileSize - Request.Offset)
+				{
+					break;
+				}
+				if (Request.Destination == nullptr)
+				{
+					Request.Buffer.resize((size_t)Request.Size);
+				}
+				Buffers[NumBuffers].Data = Request.Destination ? Request.Destination : Request.Buffer.data();
+				Buffers[NumBuffers].Size = (size_t)Request.Size;
+				++NumBuffers;
+				NextOffset += Request.Size;
+				++RunEnd;
+			}
+			bool Succeeded = FPlatformMisc::ReadFileAt(Handle, RunOffset, Buffers, NumBuffers);
+			++NumReads;
+			if (!Succeeded)
+			{
+				TE_LOG(LogCore, Error, "Async read failed: %s", First.Filename.c_str());
+			}
+			for (size_t i = RunBegin; i < RunEnd; ++i)
+			{
+				Complete(*Batch[i], Succeeded);
+			}
+			RunBegin = RunEnd;
+		}
+
+		if (Handle)
+		{
+			FPlatformMisc::CloseReadHandle(Handle);
+		}
+		FileBegin = FileEnd;
+	}
+
+	std::lock_guard<std::mutex> Lock(StatsMutex);
+	Stats.Reads += NumReads;
+	++Stats.Batches;
+	Stats.BusySeconds += FPlatformMisc::Seconds() - StartTime;
+}
+
+void FAsyncIO::Complete(FIORequest& Request, bool Succeeded)
+{
+	Request.CompleteTime = FPlatformMisc::Seconds();
+	if (!Succeeded)
+	{
+		Request.Buffer = std::vector<char>();
+	}
+	{
+		std::lock_guard<std::mutex> Lock(StatsMutex);
+		if (Succeeded)
+		{
+			++Stats.RequestsCompleted;
+			Stats.BytesRead += Request.Size;
+		}
+		else
+		{
+			++Stats.RequestsFailed;
+		}
+		Stats.TotalLatency += Request.GetLatency();
+		Stats.MaxLatency = std::max(Stats.MaxLatency, Request.GetLatency());
+	}
+	Request.Status.store(Succeeded ? EIORequestStatus::Completed : EIORequestStatus::Failed, std::memory_order_release);
+	if (Request.Callback)
+	{
+		Request.Callback(Request);
+		Request.Callback = nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> Lock(DoneMutex);
+	}
+	DoneCondition.notify_all();
+}
+
+FAsyncIOStats FAsyncIO::GetStats() const
+{
+	std::lock_guard<std::mutex> Lock(StatsMutex);
+	return Stats;
+}
+
+void FAsyncIO::LogStats() const
+{
+	FAsyncIOStats Current = GetStats();
+	uint64_t NumDone = Current.RequestsCompleted + Current.RequestsFailed;
+	FPlatformMisc::LocalPrintf("Async IO: %llu requests (%llu failed, %llu cancelled) in %llu reads, %.2f MB at %.1f MB/s, latency avg %.3f ms max %.3f ms",
+		(unsigned long long)NumDone, (unsigned long long)Current.RequestsFailed, (unsigned long long)Current.RequestsCancelled,
+		(unsigned long long)Current.Reads, Current.BytesRead / (1024.0 * 1024.0),
+		Current.BusySeconds > 0.0 ? Current.BytesRead / (1024.0 * 1024.0) / Current.BusySeconds : 0.0,
+		NumDone ? Current.TotalLatency / NumDone * 1000.0 : 0.0, Current.MaxLatency * 1000.0);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <stdint.h>
+
+// Requests of a higher priority are always read first; within a priority, in submission order
+// unless they can be merged with a neighbour.
+enum class EIOPriority : uint8_t
+{
+	Low,
+	Normal,
+	High,
+	// needed by the current frame
+	Critical,
+};
+
+enum class EIORequestStatus : uint8_t
+{
+	Pending,
+	Completed,
+	Failed,
+	Cancelled,
+};
+
+class FIORequest;
+class FPakFile;
+struct FPakEntry;
+// Keeps a request, and the buffer it read into, alive.
+typedef std::shared_ptr<FIORequest> FIORequestHandle;
+// Called on the I/O thread once a request completed or failed, keep it short.
+typedef std::function<void(const FIORequest& Request)> FIOCallback;
+
+class FIORequest
+{
+public:
+	EIORequestStatus GetStatus() const { return Status.load(std::memory_order_acquire); }
+	bool IsDone() const { return GetStatus() != EIORequestStatus::Pending; }
+
+	// The bytes read once completed: the destination passed to FAsyncIO::Read, or a buffer
+	// owned by the request.
+	const char* GetData() const { return Destination ? (const char*)Destination : Buffer.data(); }
+	uint64_t GetSize() const { return Size; }
+	const std::string& GetFilename() const { return Filename; }
+	EIOPriority GetPriority() const { return Priority; }
+
+	// seconds from submission to completion
+	double GetLatency() const { return CompleteTime - SubmitTime; }
+
+private:
+	friend class FAsyncIO;
+
+	std::string Filename;
+	// the file read, a pak file for resources in one; Offset is relative to it
+	std::string SourceFilename;
+	// set for compressed pak entries, which are decompressed instead of read
+	const FPakFile* Pak = nullptr;
+	const FPakEntry* PakEntry = nullptr;
+	uint64_t Offset = 0;
+	uint64_t Size = 0;
+	void* Destination = nullptr;
+	std::vector<char> Buffer;
+	EIOPriority Priority = EIOPriority::Normal;
+	FIOCallback Callback;
+	uint64_t Sequence = 0;
+	double SubmitTime = 0.0;
+	double CompleteTime = 0.0;
+	std::atomic<EIORequestStatus> Status{EIORequestStatus::Pending};
+};
+
+struct FAsyncIOStats
+{
+	uint64_t RequestsCompleted = 0;
+	uint64_t RequestsFailed = 0;
+	uint64_t RequestsCancelled = 0;
+	uint64_t BytesRead = 0;
+	// platform reads issued, fewer than requests when neighbours were merged
+	uint64_t Reads = 0;
+	uint64_t Batches = 0;
+	double TotalLatency = 0.0;
+	double MaxLatency = 0.0;
+	// seconds the I/O thread spent reading
+	double BusySeconds = 0.0;
+};
+
+// Reads resources on a dedicated I/O thread so loads never block the caller. The thread takes
+// the highest priority requests in batches, sorts each file's requests by offset and reads runs
+// of adjacent ranges with a single scattered read (preadv on Linux) straight into their
+// destinations. Resources in mounted pak files are read from the archive, so neighbouring
+// entries merge too. Every request is timed from submission to completion.
+class FAsyncIO
+{
+public:
+	// requests of one batch; later, more urgent requests wait at most one batch
+	static const uint32_t MAX_BATCH_SIZE = 64;
+	// Size that reads the rest of the file
+	static const uint64_t READ_TO_END = ~0ull;
+
+	static FAsyncIO& Get();
+
+	void Init();
+	// Cancels the requests still queued and waits for the batch being read.
+	void Shutdown();
+
+	// Reads Size bytes from Offset of a resource (see FPlatformMisc::ResourceDir). Destination,
+	// which must stay valid until the request is done, receives the bytes; without one the request
+	// allocates a buffer. Reads past the end of the file fail.
+	FIORequestHandle Read(const char* Filename, uint64_t Offset = 0, uint64_t Size = READ_TO_END, void* Destination = nullptr,
+		EIOPriority Priority = EIOPriority::Normal, FIOCallback Callback = nullptr);
+
+	// Removes a request that was not read yet, its callback is not called. False when it
+	// is being read or is done already.
+	bool Cancel(const FIORequestHandle& Request);
+	// Blocks until the request is done.
+	void Wait(const FIORequestHandle& Request);
+	// Raises or lowers the priority of a request that was not read yet.
+	void SetPriority(const FIORequestHandle& Request, EIOPriority Priority);
+
+	FAsyncIOStats GetStats() const;
+	void LogStats() const;
+
+private:
+	FAsyncIO() = default;
+
+	void ThreadLoop();
+	// takes the next batch out of Queue, QueueMutex must be held
+	void TakeBatch(std::vector<FIORequestHandle>& OutBatch);
+	void ReadBatch(std::vector<FIORequestHandle>& Batch);
+	void Complete(FIORequest& Request, bool Succeeded);
+
+	std::thread Thread;
+	// pending requests, in no particular order
+	std::vector<FIORequestHandle> Queue;
+	mutable std::mutex QueueMutex;
+	std::condition_variable QueueCondition;
+	bool StopRequested = false;
+	uint64_t NextSequence = 0;
+
+	// notified whenever requests complete, for Wait
+	std::mutex DoneMutex;
+	std::condition_variable DoneCondition;
+
+	FAsyncIOStats Stats;
+	mutable std::mutex StatsMutex;
+};
@@ -0,0 +1,180 @@
+#include "Compression.h"
+#include <string.h>
+
+static const uint32_t HASH_BITS = 12;
+static const size_t MIN_MATCH = 4;
+// the format requires the last 5 bytes to be literals and the last match to start 12 bytes before the end
+static const size_t LAST_LITERALS = 5;
+static const size_t MATCH_START_LIMIT = 12;
+static const size_t MAX_OFFSET = 65535;
+
+static uint32_t Read32(const uint8_t* Ptr)
+{
+	uint32_t Value;
+	memcpy(&Value, Ptr, sizeof(Value));
+	return Value;
+}
+
+// writes a length above the token's 15 as a run of 255s and a remainder
+static uint8_t* WriteLength(uint8_t* Out, size_t Length)
+{
+	while (Length >= 255)
+	{
+		*Out++ = 255;
+		Length -= 255;
+	}
+	*Out++ = (uint8_t)Length;
+	return Out;
+}
+
+static bool ReadLength(const uint8_t*& In, const uint8_t* InEnd, size_t& Length)
+{
+	uint8_t Byte;
+	do
+	{
+		if (In == InEnd)
+		{
+			return false;
+		}
+		Byte = *In++;
+		Length += Byte;
+	} while (Byte == 255);
+	return true;
+}
+
+size_t FCompression::Compress(const void* Src, size_t SrcSize, void* Dst, size_t DstCapacity)
+{
+	const uint8_t* In = (const uint8_t*)Src;
+	uint8_t* Out = (uint8_t*)Dst;
+	uint8_t* OutEnd = Out + DstCapacity;
+	// positions of the last occurrence of each 4 byte sequence's hash, candidates are verified
+	uint32_t Table[1 << HASH_BITS] = {};
+
+	size_t Anchor = 0;
+	size_t Pos = 0;
+	if (SrcSize > MATCH_START_LIMIT)
+	{
+		size_t MatchStartEnd = SrcSize - MATCH_START_LIMIT;
+		size_t MatchEndLimit = SrcSize - LAST_LITERALS;
+		while (Pos < MatchStartEnd)
+		{
+			uint32_t Sequence = Read32(In + Pos);
+			uint32_t Hash = (Sequence * 2654435761u) >> (32 - HASH_BITS);
+			size_t Candidate = Table[Hash];
+			Table[Hash] = (uint32_t)Pos;
+			if (Candidate >= Pos || Pos - Candidate > MAX_OFFSET || Read32(In + Candidate) != Sequence)
+			{
+				++Pos;
+				continue;
+			}
+			size_t MatchEnd = Pos + MIN_MATCH;
+			while (MatchEnd < MatchEndLimit && In[MatchEnd] == In[Candidate + MatchEnd - Pos])
+			{
+				++MatchEnd;
+			}
+
+			size_t LiteralLength = Pos - Anchor;
+			size_t MatchLength = MatchEnd - Pos - MIN_MATCH;
+			if ((size_t)(OutEnd - Out) < 1 + LiteralLength / 255 + 1 + LiteralLength + 2 + MatchLength / 255 + 1)
+			{
+				return 0;
+			}
+			uint8_t* Token = Out++;
+			*Token = (uint8_t)((LiteralLength < 15 ? LiteralLength : 15) << 4);
+			if (LiteralLength >= 15)
+			{
+				Out = WriteLength(Out, LiteralLength - 15);
+			}
+			memcpy(Out, In + Anchor, LiteralLength);
+			Out += LiteralLength;
+			size_t Offset = Pos - Candidate;
+			*Out++ = (uint8_t)Offset;
+			*Out++ = (uint8_t)(Offset >> 8);
+			*Token |= (uint8_t)(MatchLength < 15 ? MatchLength : 15);
+			if (MatchLength >= 15)
+			{
+				Out = WriteLength(Out, MatchLength - 15);
+			}
+			Pos = MatchEnd;
+			Anchor = Pos;
+		}
+	}
+
+	size_t LiteralLength = SrcSize - Anchor;
+	if ((size_t)(OutEnd - Out) < 1 + LiteralLength / 255 + 1 + LiteralLength)
+	{
+		return 0;
+	}
+	*Out++ = (uint8_t)((LiteralLength < 15 ? LiteralLength : 15) << 4);
+	if (LiteralLength >= 15)
+	{
+		Out = WriteLength(Out, LiteralLength - 15);
+	}
+	memcpy(Out, In + Anchor, LiteralLength);
+	Out += LiteralLength;
+	return Out - (uint8_t*)Dst;
+}
+
+bool FCompression::Decompress(const void* Src, size_t SrcSize, void* Dst, size_t DstSize)
+{
+	const uint8_t* In = (const uint8_t*)Src;
+	const uint8_t* InEnd = In + SrcSize;
+	uint8_t* Out = (uint8_t*)Dst;
+	uint8_t* OutEnd = Out + DstSize;
+	for (;;)
+	{
+		if (In == InEnd)
+		{
+			return false;
+		}
+		uint8_t Token = *In++;
+		size_t LiteralLength = Token >> 4;
+		if (LiteralLength == 15 && !ReadLength(In, InEnd, LiteralLength))
+		{
+			return false;
+		}
+		if (LiteralLength > (size_t)(InEnd - In) || LiteralLength > (size_t)(OutEnd - Out))
+		{
+			return false;
+		}
+		memcpy(Out, In, LiteralLength);
+		In += LiteralLength;
+		Out += LiteralLength;
+		// the last sequence has literals only
+		if (In == InEnd)
+		{
+			return Out == OutEnd;
+		}
+
+		if (InEnd - In < 2)
+		{
+			return false;
+		}
+		size_t Offset = In[0] | (In[1] << 8);
+		In += 2;
+		size_t MatchLength = Token & 15;
+		if (MatchLength == 15 && !ReadLength(In, InEnd, MatchLength))
+		{
+			return false;
+		}
+		MatchLength += MIN_MATCH;
+		if (Offset == 0 || Offset > (size_t)(Out - (uint8_t*)Dst) || MatchLength > (size_t)(OutEnd - Out))
+		{
+			return false;
+		}
+		const uint8_t* Match = Out - Offset;
+		if (Offset >= MatchLength)
+		{
+			memcpy(Out, Match, MatchLength);
+			Out += MatchLength;
+		}
+		else
+		{
+			// overlapping copies repeat the last Offset bytes
+			for (size_t i = 0; i < MatchLength; ++i)
+			{
+				*Out++ = Match[i];
+			}
+		}
+	}
+}
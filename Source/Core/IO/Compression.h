@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Block compression in the LZ4 block format: byte oriented, no entropy coding, so decoding runs
+// at memory speed. Blocks are independent and at most 64 KB apart for matches, callers split
+// larger data into blocks.
+struct FCompression
+{
+	// Dst capacity that always fits the compressed form of Size bytes.
+	static size_t CompressBound(size_t Size) { return Size + Size / 255 + 16; }
+
+	// Returns the compressed size, 0 when it does not fit in DstCapacity.
+	static size_t Compress(const void* Src, size_t SrcSize, void* Dst, size_t DstCapacity);
+
+	// Decodes exactly DstSize bytes; false on corrupt input instead of reading or writing out of bounds.
+	static bool Decompress(const void* Src, size_t SrcSize, void* Dst, size_t DstSize);
+};
@@ -0,0 +1,221 @@
+#include "PakFile.h"
+#include "Compression.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/Hash.h"
+#include <string.h>
+#include <algorithm>
+
+bool FPakFile::Open(const char* PakFilename)
+{
+	Filename = PakFilename;
+	View = FPlatformMisc::MapLooseFile(PakFilename);
+	if (!View.IsValid())
+	{
+		return false;
+	}
+	const char* Data = View.GetData();
+	uint64_t FileSize = View.GetSize();
+	const FPakHeader* NewHeader = (const FPakHeader*)Data;
+	if (FileSize < sizeof(FPakHeader) || NewHeader->Magic != FPakHeader::MAGIC || NewHeader->Version != FPakHeader::VERSION ||
+		NewHeader->TocOffset > FileSize || NewHeader->TocSize > FileSize - NewHeader->TocOffset ||
+		(NewHeader->NumBuckets & (NewHeader->NumBuckets - 1)) != 0 || NewHeader->NumBuckets < NewHeader->NumEntries ||
+		(NewHeader->NumBlocks > 0 && NewHeader->BlockSize == 0))
+	{
+		FPlatformMisc::LocalPrintf("Invalid pak file: %s", PakFilename);
+		View.Reset();
+		return false;
+	}
+	uint64_t FixedSize = (uint64_t)NewHeader->NumEntries * sizeof(FPakEntry) + (uint64_t)NewHeader->NumBuckets * sizeof(uint32_t) +
+		(uint64_t)NewHeader->NumBlocks * sizeof(FPakBlock);
+	if (FixedSize > NewHeader->TocSize)
+	{
+		FPlatformMisc::LocalPrintf("Invalid pak file: %s", PakFilename);
+		View.Reset();
+		return false;
+	}
+	const char* Toc = Data + NewHeader->TocOffset;
+	Entries = (const FPakEntry*)Toc;
+	Buckets = (const uint32_t*)(Entries + NewHeader->NumEntries);
+	Blocks = (const FPakBlock*)(Buckets + NewHeader->NumBuckets);
+	Paths = (const char*)(Blocks + NewHeader->NumBlocks);
+	PathsSize = NewHeader->TocSize - FixedSize;
+
+	// checked once here so lookups and reads can trust the table of contents
+	for (uint32_t i = 0; i < NewHeader->NumEntries; ++i)
+	{
+		const FPakEntry& Entry = Entries[i];
+		bool Valid = (uint64_t)Entry.PathOffset + Entry.PathLength <= PathsSize;
+		if (Entry.NumBlocks == 0)
+		{
+			Valid &= Entry.Offset <= FileSize && Entry.Size <= FileSize - Entry.Offset;
+		}
+		else
+		{
+			Valid &= (uint64_t)Entry.FirstBlock + Entry.NumBlocks <= NewHeader->NumBlocks &&
+				Entry.Size <= (uint64_t)Entry.NumBlocks * NewHeader->BlockSize;
+			for (uint32_t Block = Entry.FirstBlock; Valid && Block < Entry.FirstBlock + Entry.NumBlocks; ++Block)
+			{
+				Valid &= Blocks[Block].Offset <= FileSize && Blocks[Block].CompressedSize <= FileSize - Blocks[Block].Offset;
+			}
+		}
+		if (!Valid)
+		{
+			FPlatformMisc::LocalPrintf("Invalid pak file: %s, entry %u out of bounds", PakFilename, i);
+			View.Reset();
+			return false;
+		}
+	}
+	for (uint32_t i = 0; i < NewHeader->NumBuckets; ++i)
+	{
+		if (Buckets[i] != INVALID_BUCKET && Buckets[i] >= NewHeader->NumEntries)
+		{
+			FPlatformMisc::LocalPrintf("Invalid pak file: %s", PakFilename);
+			View.Reset();
+			return false;
+		}
+	}
+	Header = NewHeader;
+	return true;
+}
+
+const FPakEntry* FPakFile::Find(const char* Path) const
+{
+	if (Header == nullptr || Header->NumBuckets == 0)
+	{
+		return nullptr;
+	}
+	size_t PathLength = strlen(Path);
+	uint64_t Hash = HashBytes(Path, PathLength);
+	uint32_t Mask = Header->NumBuckets - 1;
+	// linear probing, the table is at most half full
+	for (uint32_t Bucket = (uint32_t)Hash & Mask, Probes = 0; Probes < Header->NumBuckets; Bucket = (Bucket + 1) & Mask, ++Probes)
+	{
+		uint32_t Index = Buckets[Bucket];
+		if (Index == INVALID_BUCKET)
+		{
+			return nullptr;
+		}
+		const FPakEntry& Entry = Entries[Index];
+		if (Entry.PathHash == Hash && Entry.PathLength == PathLength && memcmp(Paths + Entry.PathOffset, Path, PathLength) == 0)
+		{
+			return &Entry;
+		}
+	}
+	return nullptr;
+}
+
+bool FPakFile::Read(const FPakEntry& Entry, uint64_t Offset, void* Destination, uint64_t Size) const
+{
+	if (Offset > Entry.Size || Size > Entry.Size - Offset)
+	{
+		return false;
+	}
+	if (Size == 0)
+	{
+		return true;
+	}
+	const char* Data = View.GetData();
+	if (Entry.NumBlocks == 0)
+	{
+		memcpy(Destination, Data + Entry.Offset + Offset, (size_t)Size);
+		return true;
+	}
+
+	char* Out = (char*)Destination;
+	std::vector<char> Scratch;
+	uint64_t BlockSize = Header->BlockSize;
+	uint64_t End = Offset + Size;
+	for (uint64_t BlockIndex = Offset / BlockSize; BlockIndex * BlockSize < End; ++BlockIndex)
+	{
+		const FPakBlock& Block = Blocks[Entry.FirstBlock + BlockIndex];
+		uint64_t BlockStart = BlockIndex * BlockSize;
+		uint64_t RawSize = std::min(BlockSize, Entry.Size - BlockStart);
+		uint64_t CopyBegin = std::max(Offset, BlockStart) - BlockStart;
+		uint64_t CopyEnd = std::min(End, BlockStart + RawSize) - BlockStart;
+		const char* Source = Data + Block.Offset;
+		if (Block.CompressedSize == RawSize)
+		{
+			memcpy(Out, Source + CopyBegin, (size_t)(CopyEnd - CopyBegin));
+		}
+		else if (CopyBegin == 0 && CopyEnd == RawSize)
+		{
+			// whole blocks decode in place
+			if (!FCompression::Decompress(Source, Block.CompressedSize, Out, (size_t)RawSize))
+			{
+				FPlatformMisc::LocalPrintf("Corrupt block in %s", Filename.c_str());
+				return false;
+			}
+		}
+		else
+		{
+			Scratch.resize((size_t)RawSize);
+			if (!FCompression::Decompress(Source, Block.CompressedSize, Scratch.data(), (size_t)RawSize))
+			{
+				FPlatformMisc::LocalPrintf("Corrupt block in %s", Filename.c_str());
+				return false;
+			}
+			memcpy(Out, Scratch.data() + CopyBegin, (size_t)(CopyEnd - CopyBegin));
+		}
+		Out += CopyEnd - CopyBegin;
+	}
+	return true;
+}
+
+FFileView FPakFile::Map(const FPakEntry& Entry) const
+{
+	if (Entry.NumBlocks == 0)
+	{
+		return FFileView(View.GetData() + Entry.Offset, (size_t)Entry.Size, nullptr, nullptr);
+	}
+	char* Data = new char[(size_t)Entry.Size + 1];
+	if (!Read(Entry, 0, Data, Entry.Size))
+	{
+		delete[] Data;
+		return FFileView();
+	}
+	return FFileView(Data, (size_t)Entry.Size, nullptr, [](const char* Data, size_t, void*) { delete[] Data; });
+}
+
+FPakManager& FPakManager::Get()
+{
+	static FPakManager PakManager;
+	return PakManager;
+}
+
+bool FPakManager::Mount(const char* PakFilename)
+{
+	FPakFile* Pak = new FPakFile();
+	if (!Pak->Open(PakFilename))
+	{
+		delete Pak;
+		return false;
+	}
+	FPlatformMisc::LocalPrintf("Mounted %s: %u files", PakFilename, Pak->GetNumEntries());
+	std::lock_guard<std::mutex> Lock(Mutex);
+	Paks.push_back(Pak);
+	return true;
+}
+
+void FPakManager::UnmountAll()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (FPakFile* Pak : Paks)
+	{
+		delete Pak;
+	}
+	Paks.clear();
+}
+
+const FPakFile* FPakManager::Find(const char* Path, const FPakEntry*& OutEntry) const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (auto It = Paks.rbegin(); It != Paks.rend(); ++It)
+	{
+		if (const FPakEntry* Entry = (*It)->Find(Path))
+		{
+			OutEntry = Entry;
+			return *It;
+		}
+	}
+	return nullptr;
+}
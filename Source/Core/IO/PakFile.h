@@ -0,0 +1,107 @@
+#pragma once
+
+#include "GenericPlatform/GenericPlatformMisc.h"
+#include <vector>
+#include <string>
+#include <mutex>
+#include <stdint.h>
+
+// Archive layout, little endian: FPakHeader, the entries' data, then the table of contents made
+// of FPakEntry[NumEntries], the hash table's uint32_t Buckets[NumBuckets], FPakBlock[NumBlocks]
+// and the entries' paths. Stored entries start on a page boundary so they can be used straight
+// from a mapping of the archive; compressed entries are split into independent blocks.
+struct FPakHeader
+{
+	static const uint32_t MAGIC = 0x4B415054; // "TPAK"
+	static const uint32_t VERSION = 1;
+
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t NumEntries;
+	// a power of two, at least twice NumEntries
+	uint32_t NumBuckets;
+	uint32_t NumBlocks;
+	// uncompressed size of every block but an entry's last
+	uint32_t BlockSize;
+	uint64_t TocOffset;
+	uint64_t TocSize;
+};
+
+struct FPakEntry
+{
+	// HashBytes of the path
+	uint64_t PathHash;
+	// of the data, or of the first block when compressed
+	uint64_t Offset;
+	// uncompressed
+	uint64_t Size;
+	// into the paths, not null terminated
+	uint32_t PathOffset;
+	uint32_t PathLength;
+	uint32_t FirstBlock;
+	// 0 when stored uncompressed
+	uint32_t NumBlocks;
+};
+
+struct FPakBlock
+{
+	uint64_t Offset;
+	// equal to the uncompressed size for blocks stored as is
+	uint32_t CompressedSize;
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(FPakHeader) == 40 && sizeof(FPakEntry) == 40 && sizeof(FPakBlock) == 16, "pak structures are serialized as is");
+
+// A mounted archive. The whole file is mapped, the table of contents is used in place.
+class FPakFile
+{
+public:
+	static constexpr uint32_t INVALID_BUCKET = ~0u;
+	static const uint32_t DATA_ALIGNMENT = 4096;
+
+	// PakFilename is a resource, see FPlatformMisc::ResourceDir.
+	bool Open(const char* PakFilename);
+
+	// nullptr when the archive has no such path; O(1) through the hash table
+	const FPakEntry* Find(const char* Path) const;
+
+	// Copies, or decompresses, Size bytes from Offset of an entry.
+	bool Read(const FPakEntry& Entry, uint64_t Offset, void* Destination, uint64_t Size) const;
+	// Stored entries are viewed in place and must not outlive the archive, compressed ones are
+	// decompressed into a buffer owned by the view.
+	FFileView Map(const FPakEntry& Entry) const;
+
+	const std::string& GetFilename() const { return Filename; }
+	uint32_t GetNumEntries() const { return Header ? Header->NumEntries : 0; }
+
+private:
+	std::string Filename;
+	FFileView View;
+	const FPakHeader* Header = nullptr;
+	const FPakEntry* Entries = nullptr;
+	const uint32_t* Buckets = nullptr;
+	const FPakBlock* Blocks = nullptr;
+	const char* Paths = nullptr;
+	uint64_t PathsSize = 0;
+};
+
+// Archives that FPlatformMisc::ReadFile, MapFile and FAsyncIO look into before the loose files.
+class FPakManager
+{
+public:
+	static FPakManager& Get();
+
+	// Archives mounted later take precedence. False, and nothing is mounted, when the archive
+	// does not exist or is corrupt.
+	bool Mount(const char* PakFilename);
+	// Views of stored entries must be released first.
+	void UnmountAll();
+
+	// The archive containing Path and its entry, or nullptr.
+	const FPakFile* Find(const char* Path, const FPakEntry*& OutEntry) const;
+
+private:
+	std::vector<FPakFile*> Paks;
+	mutable std::mutex Mutex;
+};
@@ -0,0 +1,179 @@
+#include "LinuxPlatformMisc.h"
+#include "Logging/Logging.h"
+#include <sched.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <errno.h>
+#include <algorithm>
+
+
+void FLinuxPlatformMisc::PlatformInit()
+{
+	FPlatformMisc::LocalPrint("Linux Platform Init");
+}
+
+FFileView FLinuxPlatformMisc::MapLooseFile(const char* Filename)
+{
+	char Path[1024];
+	snprintf(Path, sizeof(Path), "%s%s", FPlatformMisc::ResourceDir(), Filename);
+	int File = open(Path, O_RDONLY | O_CLOEXEC);
+	if (File < 0)
+	{
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	struct stat Stat;
+	if (fstat(File, &Stat) != 0)
+	{
+		close(File);
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	size_t Size = (size_t)Stat.st_size;
+	if (Size == 0)
+	{
+		// mmap rejects empty ranges
+		close(File);
+		return FFileView("", 0, nullptr, nullptr);
+	}
+	// the mapping keeps the file referenced after the descriptor is closed
+	void* Data = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+	close(File);
+	if (Data == MAP_FAILED)
+	{
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	// resources are read front to back right after loading, start reading ahead
+	madvise(Data, Size, MADV_WILLNEED);
+	return FFileView((const char*)Data, Size, nullptr, [](const char* Data, size_t Size, void*) { munmap((void*)Data, Size); });
+}
+
+// file descriptors are stored in the handle plus one, so descriptor 0 is not nullptr
+void* FLinuxPlatformMisc::OpenReadHandle(const char* Filename, uint64_t& OutSize)
+{
+	char Path[1024];
+	snprintf(Path, sizeof(Path), "%s%s", FPlatformMisc::ResourceDir(), Filename);
+	int File = open(Path, O_RDONLY | O_CLOEXEC);
+	if (File < 0)
+	{
+		return nullptr;
+	}
+	struct stat Stat;
+	if (fstat(File, &Stat) != 0)
+	{
+		close(File);
+		return nullptr;
+	}
+	OutSize = (uint64_t)Stat.st_size;
+	return (void*)((intptr_t)File + 1);
+}
+
+bool FLinuxPlatformMisc::ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers)
+{
+	int File = (int)((intptr_t)Handle - 1);
+	iovec Vectors[64];
+	// first buffer not fully read, and how much of it was
+	uint32_t Next = 0;
+	size_t Consumed = 0;
+	for (;;)
+	{
+		while (Next < NumBuffers && Consumed == Buffers[Next].Size)
+		{
+			Consumed = 0;
+			++Next;
+		}
+		if (Next == NumBuffers)
+		{
+			return true;
+		}
+		int NumVectors = 0;
+		for (uint32_t i = Next; i < NumBuffers && NumVectors < 64 && NumVectors < IOV_MAX; ++i)
+		{
+			size_t Skip = i == Next ? Consumed : 0;
+			Vectors[NumVectors].iov_base = (char*)Buffers[i].Data + Skip;
+			Vectors[NumVectors].iov_len = Buffers[i].Size - Skip;
+			++NumVectors;
+		}
+		ssize_t Read = preadv(File, Vectors, NumVectors, (off_t)Offset);
+		if (Read < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (Read <= 0)
+		{
+			// error, or the file is shorter than requested
+			return false;
+		}
+		Offset += (uint64_t)Read;
+		// short reads happen for large requests, continue where the kernel stopped
+		size_t Remaining = (size_t)Read;
+		while (Remaining > 0)
+		{
+			size_t Step = std::min(Remaining, Buffers[Next].Size - Consumed);
+			Consumed += Step;
+			Remaining -= Step;
+			if (Consumed == Buffers[Next].Size)
+			{
+				Consumed = 0;
+				++Next;
+			}
+		}
+	}
+}
+
+void FLinuxPlatformMisc::CloseReadHandle(void* Handle)
+{
+	close((int)((intptr_t)Handle - 1));
+}
+
+uint64_t FLinuxPlatformMisc::GetPerformanceCoreMask()
+{
+	// cores of the big cluster report a higher maximum frequency than the LITTLE ones
+	uint32_t NumCores = FPlatformMisc::NumberOfCores();
+	std::vector<uint64_t> MaxFrequencies(NumCores, 0);
+	uint64_t LowestFrequency = UINT64_MAX;
+	for (uint32_t Core = 0; Core < NumCores && Core < 64; ++Core)
+	{
+		char Path[128];
+		snprintf(Path, sizeof(Path), "/sys/devices/system/cpu/cpu%u/cpufreq/cpuinfo_max_freq", Core);
+		FILE* File = fopen(Path, "r");
+		unsigned long long Frequency = 0;
+		if (File)
+		{
+			if (fscanf(File, "%llu", &Frequency) != 1)
+				Frequency = 0;
+			fclose(File);
+		}
+		if (Frequency == 0)
+			return FGenericPlatformMisc::GetPerformanceCoreMask();
+		MaxFrequencies[Core] = Frequency;
+		LowestFrequency = std::min<uint64_t>(LowestFrequency, Frequency);
+	}
+
+	uint64_t Mask = 0;
+	for (uint32_t Core = 0; Core < NumCores && Core < 64; ++Core)
+	{
+		if (MaxFrequencies[Core] > LowestFrequency)
+			Mask |= 1ull << Core;
+	}
+	return Mask != 0 ? Mask : FGenericPlatformMisc::GetPerformanceCoreMask();
+}
+
+bool FLinuxPlatformMisc::SetThreadAffinityMask(uint64_t Mask)
+{
+	cpu_set_t CpuSet;
+	CPU_ZERO(&CpuSet);
+	for (uint32_t Core = 0; Core < 64; ++Core)
+	{
+		if (Mask & (1ull << Core))
+			CPU_SET(Core, &CpuSet);
+	}
+	// pid 0 is the calling thread
+	return sched_setaffinity(0, sizeof(CpuSet), &CpuSet) == 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "GenericPlatform/GenericPlatformMisc.h"
+
+struct FLinuxPlatformMisc : public FGenericPlatformMisc
+{
+	static void PlatformInit();
+	static FFileView MapLooseFile(const char* Filename);
+	static void* OpenReadHandle(const char* Filename, uint64_t& OutSize);
+	static bool ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers);
+	static void CloseReadHandle(void* Handle);
+	static uint64_t GetPerformanceCoreMask();
+	static bool SetThreadAffinityMask(uint64_t Mask);
+};
+
+typedef FLinuxPlatformMisc FPlatformMisc;
@@ -0,0 +1,748 @@
+#include "Logging.h"
+#include "HAL/PlatformMisc.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+
+// records and arguments are 8 byte aligned in the rings
+static const uint32_t RECORD_ALIGNMENT = 8;
+// largest record, string arguments are truncated to fit
+static const uint32_t MAX_RECORD_SIZE = 4096;
+// how long the logging thread sleeps when nobody wakes it
+static const uint32_t THREAD_PERIOD_MS = 10;
+
+enum ELogRecordFlags : uint8_t
+{
+	// fills the end of the ring when the next record doesn't fit
+	RECORD_PADDING = 1,
+	// the payload is a string printed as is, not arguments for Format
+	RECORD_STRING = 2,
+	// arguments didn't fit in MAX_RECORD_SIZE
+	RECORD_TRUNCATED = 4,
+};
+
+struct FLogRecord
+{
+	// of the whole record, header included, a multiple of RECORD_ALIGNMENT
+	uint32_t Size;
+	ELogVerbosity Verbosity;
+	uint8_t Flags;
+	uint64_t Sequence;
+	const char* Category;
+	const char* Format;
+};
+
+struct FLogRing
+{
+	// monotonic byte positions, the ring offset is position % RING_SIZE. The owning thread
+	// advances Head, whoever holds DrainMutex advances Tail.
+	std::atomic<uint64_t> Head{0};
+	std::atomic<uint64_t> Tail{0};
+	// cleared when the owning thread exits, the ring is reused once drained
+	std::atomic<bool> IsOwned{true};
+	alignas(RECORD_ALIGNMENT) char Data[FLogger::RING_SIZE];
+};
+
+// Rings are never freed, threads may still log while statics are destroyed at exit.
+struct FLogRingHandle
+{
+	FLogRing* Ring = nullptr;
+
+	~FLogRingHandle()
+	{
+		if (Ring)
+		{
+			Ring->IsOwned.store(false, std::memory_order_release);
+		}
+	}
+};
+
+static thread_local FLogRingHandle GThreadRing;
+// the calling thread is draining, so a crash handler must not wait for DrainMutex
+static thread_local bool GIsDraining = false;
+// messages logged while statics are destroyed are written synchronously
+static bool GLoggerDestroyed = false;
+
+enum class EArgClass : uint8_t
+{
+	None,
+	Percent,
+	Signed,
+	Unsigned,
+	Char,
+	Double,
+	String,
+	Pointer,
+};
+
+// a printf conversion specification
+struct FFormatSpec
+{
+	// from the '%' to one past the conversion character
+	const char* Begin;
+	const char* End;
+	// where the length modifier starts
+	const char* LengthBegin;
+	char Length[3];
+	char Conversion;
+	EArgClass Class;
+	bool WidthFromArg;
+	bool PrecisionFromArg;
+};
+
+// P points at a '%'
+static const char* ParseSpec(const char* P, FFormatSpec& Spec)
+{
+	Spec.Begin = P++;
+	Spec.WidthFromArg = false;
+	Spec.PrecisionFromArg = false;
+	while (*P && strchr("-+ #0", *P))
+	{
+		++P;
+	}
+	if (*P == '*')
+	{
+		Spec.WidthFromArg = true;
+		++P;
+	}
+	while (*P >= '0' && *P <= '9')
+	{
+		++P;
+	}
+	if (*P == '.')
+	{
+		++P;
+		if (*P == '*')
+		{
+			Spec.PrecisionFromArg = true;
+			++P;
+		}
+		while (*P >= '0' && *P <= '9')
+		{
+			++P;
+		}
+	}
+
+	Spec.LengthBegin = P;
+	uint32_t LengthSize = 0;
+	while (*P && strchr("hljztLq", *P) && LengthSize < 2)
+	{
+		Spec.Length[LengthSize++] = *P++;
+	}
+	Spec.Length[LengthSize] = 0;
+
+	Spec.Conversion = *P;
+	switch (*P)
+	{
+	case '%': Spec.Class = EArgClass::Percent; break;
+	case 'd': case 'i': Spec.Class = EArgClass::Signed; break;
+	case 'u': case 'o': case 'x': case 'X': Spec.Class = EArgClass::Unsigned; break;
+	case 'c': Spec.Class = EArgClass::Char; break;
+	case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': Spec.Class = EArgClass::Double; break;
+	case 's': Spec.Class = EArgClass::String; break;
+	case 'p': Spec.Class = EArgClass::Pointer; break;
+	default: Spec.Class = EArgClass::None; break;
+	}
+	if (*P)
+	{
+		++P;
+	}
+	Spec.End = P;
+	return P;
+}
+
+// Appends 8 byte argument slots to a record, strings inline, until MAX_RECORD_SIZE.
+struct FArgWriter
+{
+	char* Data;
+	uint32_t Size;
+	bool IsTruncated = false;
+
+	void Put(uint64_t Value)
+	{
+		if (IsTruncated || Size + sizeof(Value) > MAX_RECORD_SIZE)
+		{
+			IsTruncated = true;
+			return;
+		}
+		memcpy(Data + Size, &Value, sizeof(Value));
+		Size += sizeof(Value);
+	}
+
+	void PutString(const char* Str)
+	{
+		uint32_t Available = MAX_RECORD_SIZE - std::min(Size, MAX_RECORD_SIZE);
+		if (IsTruncated || Available < RECORD_ALIGNMENT * 2)
+		{
+			IsTruncated = true;
+			return;
+		}
+		uint32_t Length = (uint32_t)std::min<size_t>(strlen(Str), Available - RECORD_ALIGNMENT - 1);
+		memcpy(Data + Size, &Length, sizeof(Length));
+		memcpy(Data + Size + RECORD_ALIGNMENT, Str, Length);
+		Data[Size + RECORD_ALIGNMENT + Length] = 0;
+		Size += RECORD_ALIGNMENT + (Length + RECORD_ALIGNMENT) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+	}
+};
+
+static bool IsLength(const FFormatSpec& Spec, const char* Length)
+{
+	return strcmp(Spec.Length, Length) == 0;
+}
+
+// captures the arguments Format consumes, in binary
+static void EncodeArgs(FArgWriter& Writer, const char* Format, va_list* Args)
+{
+	for (const char* P = Format; *P; )
+	{
+		if (*P != '%')
+		{
+			++P;
+			continue;
+		}
+		FFormatSpec Spec;
+		P = ParseSpec(P, Spec);
+		if (Spec.WidthFromArg)
+		{
+			Writer.Put((uint64_t)(int64_t)va_arg(*Args, int));
+		}
+		if (Spec.PrecisionFromArg)
+		{
+			Writer.Put((uint64_t)(int64_t)va_arg(*Args, int));
+		}
+		switch (Spec.Class)
+		{
+		case EArgClass::Signed:
+		{
+			int64_t Value;
+			if (IsLength(Spec, "l")) Value = va_arg(*Args, long);
+			else if (IsLength(Spec, "ll") || IsLength(Spec, "q")) Value = va_arg(*Args, long long);
+			else if (IsLength(Spec, "j")) Value = va_arg(*Args, intmax_t);
+			else if (IsLength(Spec, "z") || IsLength(Spec, "t")) Value = va_arg(*Args, ptrdiff_t);
+			else Value = va_arg(*Args, int);
+			Writer.Put((uint64_t)Value);
+			break;
+		}
+		case EArgClass::Unsigned:
+		{
+			uint64_t Value;
+			if (IsLength(Spec, "l")) Value = va_arg(*Args, unsigned long);
+			else if (IsLength(Spec, "ll") || IsLength(Spec, "q")) Value = va_arg(*Args, unsigned long long);
+			else if (IsLength(Spec, "j")) Value = va_arg(*Args, uintmax_t);
+			else if (IsLength(Spec, "z") || IsLength(Spec, "t")) Value = va_arg(*Args, size_t);
+			else Value = va_arg(*Args, unsigned int);
+			Writer.Put(Value);
+			break;
+		}
+		case EArgClass::Char:
+			Writer.Put((uint64_t)va_arg(*Args, int));
+			break;
+		case EArgClass::Double:
+		{
+			double Value = IsLength(Spec, "L") ? (double)va_arg(*Args, long double) : va_arg(*Args, double);
+			uint64_t Bits;
+			memcpy(&Bits, &Value, sizeof(Bits));
+			Writer.Put(Bits);
+			break;
+		}
+		case EArgClass::String:
+		{
+			// wide strings are not supported
+			const void* Str = va_arg(*Args, const void*);
+			Writer.PutString(IsLength(Spec, "l") ? "(wide string)" : Str ? (const char*)Str : "(null)");
+			break;
+		}
+		case EArgClass::Pointer:
+			Writer.Put((uint64_t)(uintptr_t)va_arg(*Args, void*));
+			break;
+		default:
+			if (Spec.Conversion == 'n')
+			{
+				(void)va_arg(*Args, void*);
+			}
+			break;
+		}
+	}
+}
+
+template <typename T>
+static void AppendFormatted(std::string& Out, const char* Spec, T Value)
+{
+	char Buffer[256];
+	int Length = snprintf(Buffer, sizeof(Buffer), Spec, Value);
+	if (Length < 0)
+	{
+		return;
+	}
+	if ((size_t)Length < sizeof(Buffer))
+	{
+		Out.append(Buffer, Length);
+		return;
+	}
+	size_t OldSize = Out.size();
+	Out.resize(OldSize + Length + 1);
+	snprintf(&Out[OldSize], Length + 1, Spec, Value);
+	Out.resize(OldSize + Length);
+}
+
+// reads arguments back in the order EncodeArgs wrote them
+struct FArgReader
+{
+	const char* Data;
+	const char* End;
+
+	bool Get(uint64_t& Value)
+	{
+		if (Data + sizeof(Value) > End)
+		{
+			return false;
+		}
+		memcpy(&Value, Data, sizeof(Value));
+		Data += sizeof(Value);
+		return true;
+	}
+
+	const char* GetString()
+	{
+		if (Data + RECORD_ALIGNMENT > End)
+		{
+			return nullptr;
+		}
+		uint32_t Length;
+		memcpy(&Length, Data, sizeof(Length));
+		const char* Str = Data + RECORD_ALIGNMENT;
+		Data += RECORD_ALIGNMENT + (Length + RECORD_ALIGNMENT) / RECORD_ALIGNMENT * RECORD_ALIGNMENT;
+		return Str;
+	}
+};
+
+static void FormatArgs(std::string& Out, const char* Format, FArgReader& Reader)
+{
+	for (const char* P = Format; *P; )
+	{
+		const char* Percent = strchr(P, '%');
+		if (Percent == nullptr)
+		{
+			Out.append(P);
+			return;
+		}
+		Out.append(P, Percent - P);
+		FFormatSpec Spec;
+		P = ParseSpec(Percent, Spec);
+		if (Spec.Class == EArgClass::Percent)
+		{
+			Out += '%';
+			continue;
+		}
+
+		// rebuild the specification with '*' resolved and the length modifier matching the stored type
+		char SpecBuffer[64];
+		uint32_t SpecSize = 0;
+		bool HasArgs = true;
+		for (const char* S = Spec.Begin; S < Spec.LengthBegin && SpecSize < sizeof(SpecBuffer) - 16; ++S)
+		{
+			uint64_t Value;
+			if (*S != '*')
+			{
+				SpecBuffer[SpecSize++] = *S;
+			}
+			else if (Reader.Get(Value))
+			{
+				SpecSize += snprintf(SpecBuffer + SpecSize, sizeof(SpecBuffer) - SpecSize, "%d", (int)(int64_t)Value);
+			}
+			else
+			{
+				HasArgs = false;
+			}
+		}
+		uint64_t Value = 0;
+		if (Spec.Class == EArgClass::Signed || Spec.Class == EArgClass::Unsigned)
+		{
+			SpecBuffer[SpecSize++] = 'l';
+			SpecBuffer[SpecSize++] = 'l';
+		}
+		SpecBuffer[SpecSize++] = Spec.Conversion;
+		SpecBuffer[SpecSize] = 0;
+
+		switch (Spec.Class)
+		{
+		case EArgClass::Signed:
+			if ((HasArgs = HasArgs && Reader.Get(Value)))
+				AppendFormatted(Out, SpecBuffer, (long long)Value);
+			break;
+		case EArgClass::Unsigned:
+			if ((HasArgs = HasArgs && Reader.Get(Value)))
+				AppendFormatted(Out, SpecBuffer, (unsigned long long)Value);
+			break;
+		case EArgClass::Char:
+			if ((HasArgs = HasArgs && Reader.Get(Value)))
+				AppendFormatted(Out, SpecBuffer, (int)Value);
+			break;
+		case EArgClass::Double:
+			if ((HasArgs = HasArgs && Reader.Get(Value)))
+			{
+				double Double;
+				memcpy(&Double, &Value, sizeof(Double));
+				AppendFormatted(Out, SpecBuffer, Double);
+			}
+			break;
+		case EArgClass::String:
+		{
+			const char* Str = HasArgs ? Reader.GetString() : nullptr;
+			if ((HasArgs = Str != nullptr))
+				AppendFormatted(Out, SpecBuffer, Str);
+			break;
+		}
+		case EArgClass::Pointer:
+			if ((HasArgs = HasArgs && Reader.Get(Value)))
+				AppendFormatted(Out, SpecBuffer, (void*)(uintptr_t)Value);
+			break;
+		default:
+			HasArgs = false;
+			break;
+		}
+		if (!HasArgs)
+		{
+			// arguments were truncated or the conversion is not supported
+			Out.append(Spec.Begin, Spec.End - Spec.Begin);
+		}
+	}
+}
+
+FLogger& FLogger::Get()
+{
+	static FLogger Logger;
+	return Logger;
+}
+
+FLogger::FLogger()
+{
+	Line.reserve(MAX_RECORD_SIZE);
+	IsRunning.store(true);
+	Thread = std::thread(&FLogger::ThreadLoop, this);
+}
+
+FLogger::~FLogger()
+{
+	{
+		std::lock_guard<std::mutex> Lock(WakeMutex);
+		StopRequested = true;
+	}
+	WakeCondition.notify_one();
+	Thread.join();
+	IsRunning.store(false);
+	{
+		std::lock_guard<std::mutex> Lock(DrainMutex);
+		Drain();
+	}
+	GLoggerDestroyed = true;
+}
+
+void FLogger::Log(const char* Category, ELogVerbosity Verbosity, const char* Format, ...)
+{
+	va_list Args;
+	va_start(Args, Format);
+	LogV(Category, Verbosity, Format, Args);
+	va_end(Args);
+}
+
+void FLogger::LogV(const char* Category, ELogVerbosity Verbosity, const char* Format, va_list Args)
+{
+	va_list ArgsCopy;
+	va_copy(ArgsCopy, Args);
+	if (GLoggerDestroyed)
+	{
+		char Buffer[MAX_RECORD_SIZE];
+		vsnprintf(Buffer, sizeof(Buffer), Format, ArgsCopy);
+		FPlatformMisc::WriteToLog(Verbosity, Buffer);
+	}
+	else
+	{
+		Write(Category, Verbosity, Format, &ArgsCopy, nullptr);
+	}
+	va_end(ArgsCopy);
+}
+
+void FLogger::LogString(const char* Category, ELogVerbosity Verbosity, const char* Str)
+{
+	if (GLoggerDestroyed)
+	{
+		FPlatformMisc::WriteToLog(Verbosity, Str);
+		return;
+	}
+	Write(Category, Verbosity, nullptr, nullptr, Str);
+}
+
+FLogRing* FLogger::GetThreadRing()
+{
+	if (GThreadRing.Ring == nullptr)
+	{
+		std::lock_guard<std::mutex> Lock(RingsMutex);
+		for (FLogRing* Ring : Rings)
+		{
+			// rings of exited threads, once everything they logged was written
+			if (!Ring->IsOwned.load(std::memory_order_acquire) &&
+				Ring->Tail.load(std::memory_order_acquire) == Ring->Head.load(std::memory_order_relaxed))
+			{
+				Ring->IsOwned.store(true, std::memory_order_relaxed);
+				GThreadRing.Ring = Ring;
+				break;
+			}
+		}
+		if (GThreadRing.Ring == nullptr)
+		{
+			GThreadRing.Ring = new FLogRing;
+			Rings.push_back(GThreadRing.Ring);
+		}
+	}
+	return GThreadRing.Ring;
+}
+
+void FLogger::Write(const char* Category, ELogVerbosity Verbosity, const char* Format, va_list* Args, const char* String)
+{
+	// records are built here, then copied into the ring in one piece
+	alignas(RECORD_ALIGNMENT) static thread_local char Scratch[MAX_RECORD_SIZE];
+	FArgWriter Writer{Scratch, sizeof(FLogRecord)};
+	if (String)
+	{
+		Writer.PutString(String);
+	}
+	else
+	{
+		EncodeArgs(Writer, Format, Args);
+	}
+	FLogRecord* Record = (FLogRecord*)Scratch;
+	Record->Size = Writer.Size;
+	Record->Verbosity = Verbosity;
+	Record->Flags = (String ? RECORD_STRING : 0) | (Writer.IsTruncated ? RECORD_TRUNCATED : 0);
+	Record->Sequence = NextSequence.fetch_add(1, std::memory_order_relaxed);
+	Record->Category = Category;
+	Record->Format = Format;
+
+	if (!IsRunning.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> Lock(DrainMutex);
+		Drain();
+		WriteRecord(Record);
+		FPlatformMisc::FlushLog();
+	}
+	else
+	{
+		FLogRing* Ring = GetThreadRing();
+		uint64_t Head = Ring->Head.load(std::memory_order_relaxed);
+		uint32_t Offset = (uint32_t)(Head % RING_SIZE);
+		// records never wrap around the end of the ring
+		uint32_t Skip = RING_SIZE - Offset < Record->Size ? RING_SIZE - Offset : 0;
+		uint64_t End = Head + Skip + Record->Size;
+		if (End - Ring->Tail.load(std::memory_order_acquire) > RING_SIZE)
+		{
+			NumRingFullWaits.fetch_add(1, std::memory_order_relaxed);
+			while (End - Ring->Tail.load(std::memory_order_acquire) > RING_SIZE)
+			{
+				if (IsRunning.load(std::memory_order_acquire))
+				{
+					WakeThread();
+					std::this_thread::yield();
+				}
+				else
+				{
+					std::lock_guard<std::mutex> Lock(DrainMutex);
+					Drain();
+				}
+			}
+		}
+		if (Skip >= sizeof(FLogRecord))
+		{
+			FLogRecord Padding{};
+			Padding.Size = Skip;
+			Padding.Flags = RECORD_PADDING;
+			memcpy(Ring->Data + Offset, &Padding, sizeof(Padding));
+		}
+		memcpy(Ring->Data + (Head + Skip) % RING_SIZE, Record, Record->Size);
+		Ring->Head.store(End, std::memory_order_release);
+		if (End - Ring->Tail.load(std::memory_order_relaxed) > RING_SIZE / 2)
+		{
+			WakeThread();
+		}
+	}
+
+	if (Verbosity == ELogVerbosity::Fatal)
+	{
+		Flush();
+		abort();
+	}
+}
+
+void FLogger::WakeThread()
+{
+	{
+		std::lock_guard<std::mutex> Lock(WakeMutex);
+		WakeRequested = true;
+	}
+	WakeCondition.notify_one();
+}
+
+void FLogger::ThreadLoop()
+{
+	for (;;)
+	{
+		bool Stop;
+		{
+			std::unique_lock<std::mutex> Lock(WakeMutex);
+			WakeCondition.wait_for(Lock, std::chrono::milliseconds(THREAD_PERIOD_MS), [this] { return WakeRequested || StopRequested; });
+			WakeRequested = false;
+			Stop = StopRequested;
+		}
+		{
+			std::lock_guard<std::mutex> Lock(DrainMutex);
+			Drain();
+		}
+		if (Stop)
+		{
+			return;
+		}
+	}
+}
+
+void FLogger::Drain()
+{
+	GIsDraining = true;
+	{
+		std::lock_guard<std::mutex> Lock(RingsMutex);
+		DrainRings = Rings;
+	}
+	DrainHeads.clear();
+	PendingRecords.clear();
+	for (FLogRing* Ring : DrainRings)
+	{
+		uint64_t Head = Ring->Head.load(std::memory_order_acquire);
+		for (uint64_t Position = Ring->Tail.load(std::memory_order_relaxed); Position < Head; )
+		{
+			uint32_t Offset = (uint32_t)(Position % RING_SIZE);
+			if (RING_SIZE - Offset < sizeof(FLogRecord))
+			{
+				// too small for a padding record
+				Position += RING_SIZE - Offset;
+				continue;
+			}
+			const FLogRecord* Record = (const FLogRecord*)(Ring->Data + Offset);
+			if (!(Record->Flags & RECORD_PADDING))
+			{
+				PendingRecords.push_back({Record->Sequence, (const char*)Record});
+			}
+			Position += Record->Size;
+		}
+		DrainHeads.push_back(Head);
+	}
+
+	if (!PendingRecords.empty())
+	{
+		std::sort(PendingRecords.begin(), PendingRecords.end(),
+			[](const std::pair<uint64_t, const char*>& A, const std::pair<uint64_t, const char*>& B) { return A.first < B.first; });
+		for (const std::pair<uint64_t, const char*>& Pending : PendingRecords)
+		{
+			WriteRecord((const FLogRecord*)Pending.second);
+		}
+		FPlatformMisc::FlushLog();
+		NumMessages.fetch_add(PendingRecords.size(), std::memory_order_relaxed);
+	}
+	for (size_t i = 0; i < DrainRings.size(); ++i)
+	{
+		DrainRings[i]->Tail.store(DrainHeads[i], std::memory_order_release);
+	}
+	GIsDraining = false;
+}
+
+void FLogger::WriteRecord(const FLogRecord* Record)
+{
+	Line.clear();
+	if (Record->Category)
+	{
+		Line += Record->Category;
+		Line += ": ";
+	}
+	switch (Record->Verbosity)
+	{
+	case ELogVerbosity::Fatal: Line += "Fatal: "; break;
+	case ELogVerbosity::Error: Line += "Error: "; break;
+	case ELogVerbosity::Warning: Line += "Warning: "; break;
+	default: break;
+	}
+
+	FArgReader Reader{(const char*)(Record + 1), (const char*)Record + Record->Size};
+	if (Record->Flags & RECORD_STRING)
+	{
+		const char* Str = Reader.GetString();
+		Line += Str ? Str : "";
+	}
+	else
+	{
+		FormatArgs(Line, Record->Format, Reader);
+	}
+	if (Record->Flags & RECORD_TRUNCATED)
+	{
+		Line += " [truncated]";
+	}
+	while (!Line.empty() && Line.back() == '\n')
+	{
+		Line.pop_back();
+	}
+	FPlatformMisc::WriteToLog(Record->Verbosity, Line.c_str());
+}
+
+void FLogger::Flush()
+{
+	std::lock_guard<std::mutex> Lock(DrainMutex);
+	Drain();
+}
+
+static const int CRASH_SIGNALS[] =
+{
+	SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifdef SIGBUS
+	SIGBUS,
+#endif
+};
+
+void FLogger::InstallCrashHandlers()
+{
+	for (int Signal : CRASH_SIGNALS)
+	{
+		std::signal(Signal, &FLogger::OnCrashSignal);
+	}
+}
+
+void FLogger::OnCrashSignal(int Signal)
+{
+	// Not async-signal-safe, but the process is going down anyway and the log is what tells why.
+	// The drain lock is only waited for briefly: its owner may be the crashing thread, or stopped.
+	// Without it the rings are left alone, draining them next to their owner would garble the log.
+	FLogger& Logger = Get();
+	bool IsLocked = false;
+	if (!GIsDraining)
+	{
+		for (int Attempt = 0; Attempt < 100 && !(IsLocked = Logger.DrainMutex.try_lock()); ++Attempt)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+	if (IsLocked)
+	{
+		Logger.Drain();
+	}
+	char Message[64];
+	snprintf(Message, sizeof(Message), "Crashed with signal %d", Signal);
+	FPlatformMisc::WriteToLog(ELogVerbosity::Fatal, Message);
+	FPlatformMisc::FlushLog();
+	if (IsLocked)
+	{
+		Logger.DrainMutex.unlock();
+	}
+
+	std::signal(Signal, SIG_DFL);
+	std::raise(Signal);
+}
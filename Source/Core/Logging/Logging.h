@@ -0,0 +1,131 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <string>
+#include <stdarg.h>
+#include <stdint.h>
+
+enum class ELogVerbosity : uint8_t
+{
+	// logged, flushed, then the process aborts
+	Fatal,
+	Error,
+	Warning,
+	Display,
+	Verbose,
+};
+
+// Messages more verbose than this are compiled out everywhere.
+#ifndef LOG_COMPILE_VERBOSITY
+	#ifdef NDEBUG
+		#define LOG_COMPILE_VERBOSITY Display
+	#else
+		#define LOG_COMPILE_VERBOSITY Verbose
+	#endif
+#endif
+
+// Declares a log category whose messages more verbose than CompileTimeVerbosity are compiled out.
+// Put it in a header to share the category between files.
+#define DECLARE_LOG_CATEGORY(CategoryName, CompileTimeVerbosity) \
+	struct FLogCategory##CategoryName \
+	{ \
+		static constexpr const char* Name = #CategoryName; \
+		static constexpr ELogVerbosity Verbosity = ELogVerbosity::CompileTimeVerbosity; \
+	}
+
+// TE_LOG(LogRHI, Warning, "Out of descriptors, %d sets", NumSets)
+// The format must be a string literal: it is stored as a pointer and only read when the message
+// is formatted, on the logging thread. Filtered out messages, arguments included, are not compiled.
+#define TE_LOG(CategoryName, LogVerbosity, Format, ...) \
+	do \
+	{ \
+		if constexpr (ELogVerbosity::LogVerbosity <= FLogCategory##CategoryName::Verbosity && \
+			ELogVerbosity::LogVerbosity <= ELogVerbosity::LOG_COMPILE_VERBOSITY) \
+		{ \
+			FLogger::Get().Log(FLogCategory##CategoryName::Name, ELogVerbosity::LogVerbosity, "" Format "", ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+// the engine core: platform, files, jobs
+DECLARE_LOG_CATEGORY(LogCore, Verbose);
+
+#if defined(__GNUC__) || defined(__clang__)
+	#define LOG_PRINTF_FORMAT(FormatIndex, FirstArg) __attribute__((format(printf, FormatIndex, FirstArg)))
+#else
+	#define LOG_PRINTF_FORMAT(FormatIndex, FirstArg)
+#endif
+
+struct FLogRing;
+struct FLogRecord;
+
+// Asynchronous logger. Every thread writes its messages into its own single producer ring buffer,
+// without locks: the format string pointer and the arguments in binary, with strings copied. A
+// background thread formats messages in the order they were logged and hands each line to
+// FPlatformMisc::WriteToLog. A thread whose ring is full waits for the logging thread, so no
+// message is lost.
+//
+// Fatal messages, Flush, and crashes (SIGSEGV, SIGABRT, ... through InstallCrashHandlers) write
+// out everything logged so far before returning. Messages logged before the logging thread
+// started or after it stopped are formatted and written synchronously.
+class FLogger
+{
+public:
+	static const uint32_t RING_SIZE = 64 * 1024;
+
+	static FLogger& Get();
+
+	void Log(const char* Category, ELogVerbosity Verbosity, const char* Format, ...) LOG_PRINTF_FORMAT(4, 5);
+	void LogV(const char* Category, ELogVerbosity Verbosity, const char* Format, va_list Args);
+	// Logs a copy of Str, which may be temporary.
+	void LogString(const char* Category, ELogVerbosity Verbosity, const char* Str);
+
+	// Blocks until everything logged before the call was written.
+	void Flush();
+
+	// Flushes the log when the process crashes, then lets the default handler run.
+	void InstallCrashHandlers();
+
+	// messages formatted so far, and times a thread waited for room in its ring
+	uint64_t GetNumMessages() const { return NumMessages.load(std::memory_order_relaxed); }
+	uint64_t GetNumRingFullWaits() const { return NumRingFullWaits.load(std::memory_order_relaxed); }
+
+private:
+	FLogger();
+	~FLogger();
+
+	FLogRing* GetThreadRing();
+	// Copies a message into the calling thread's ring, or writes it right away without a logging
+	// thread. Either Format and Args or String are set.
+	void Write(const char* Category, ELogVerbosity Verbosity, const char* Format, va_list* Args, const char* String);
+	void WakeThread();
+	void ThreadLoop();
+	// Formats and writes the messages in all rings, oldest first. DrainMutex must be held.
+	void Drain();
+	// formats a record into Line and hands it to the platform
+	void WriteRecord(const FLogRecord* Record);
+	static void OnCrashSignal(int Signal);
+
+	std::vector<FLogRing*> Rings;
+	std::mutex RingsMutex;
+	// held by whoever consumes the rings: the logging thread, Flush or a crash handler
+	std::mutex DrainMutex;
+	std::thread Thread;
+	std::mutex WakeMutex;
+	std::condition_variable WakeCondition;
+	bool WakeRequested = false;
+	bool StopRequested = false;
+	std::atomic<bool> IsRunning{false};
+	// orders messages across threads
+	std::atomic<uint64_t> NextSequence{0};
+	std::atomic<uint64_t> NumMessages{0};
+	std::atomic<uint64_t> NumRingFullWaits{0};
+	// only used while holding DrainMutex
+	std::vector<std::pair<uint64_t, const char*>> PendingRecords;
+	std::vector<FLogRing*> DrainRings;
+	std::vector<uint64_t> DrainHeads;
+	std::string Line;
+};
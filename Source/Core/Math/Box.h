@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Math/Matrix.h"
+#include <float.h>
+
+// Axis aligned bounding box. The default box is empty: it contains nothing and adding a point
+// makes it that point.
+struct FBox
+{
+	FVector3 Min = FVector3(FLT_MAX);
+	FVector3 Max = FVector3(-FLT_MAX);
+
+	FBox() = default;
+	FBox(const FVector3& InMin, const FVector3& InMax) : Min(InMin), Max(InMax) {}
+	static FBox FromCenterExtent(const FVector3& Center, const FVector3& Extent) { return FBox(Center - Extent, Center + Extent); }
+
+	bool IsValid() const { return Min.X <= Max.X && Min.Y <= Max.Y && Min.Z <= Max.Z; }
+	FVector3 GetCenter() const { return (Min + Max) * 0.5f; }
+	// half the size
+	FVector3 GetExtent() const { return (Max - Min) * 0.5f; }
+
+	FBox& operator+=(const FVector3& Point)
+	{
+		Min = FVector3::Min(Min, Point);
+		Max = FVector3::Max(Max, Point);
+		return *this;
+	}
+	FBox& operator+=(const FBox& Box)
+	{
+		Min = FVector3::Min(Min, Box.Min);
+		Max = FVector3::Max(Max, Box.Max);
+		return *this;
+	}
+
+	bool Contains(const FVector3& Point) const
+	{
+		return Point.X >= Min.X && Point.X <= Max.X && Point.Y >= Min.Y && Point.Y <= Max.Y && Point.Z >= Min.Z && Point.Z <= Max.Z;
+	}
+	bool Intersects(const FBox& Box) const
+	{
+		return Min.X <= Box.Max.X && Max.X >= Box.Min.X && Min.Y <= Box.Max.Y && Max.Y >= Box.Min.Y && Min.Z <= Box.Max.Z && Max.Z >= Box.Min.Z;
+	}
+
+	// Bounds of the transformed box: the center is transformed, the extent grows by the absolute
+	// values of the matrix.
+	FBox TransformBy(const FMatrix& M) const
+	{
+		FVector3 Center = GetCenter();
+		FVector3 Extent = GetExtent();
+		VectorRegister NewCenter = M.TransformVector4(FVector4(Center, 1.f)).Load();
+		VectorRegister NewExtent = VectorMultiply(VectorAbs(M.Columns[0].Load()), VectorSplat(Extent.X));
+		NewExtent = VectorMultiplyAdd(VectorAbs(M.Columns[1].Load()), VectorSplat(Extent.Y), NewExtent);
+		NewExtent = VectorMultiplyAdd(VectorAbs(M.Columns[2].Load()), VectorSplat(Extent.Z), NewExtent);
+		return FBox(FVector4(VectorSubtract(NewCenter, NewExtent)).XYZ(), FVector4(VectorAdd(NewCenter, NewExtent)).XYZ());
+	}
+};
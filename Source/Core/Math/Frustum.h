@@ -0,0 +1,64 @@
+#pragma once
+
+#include "Math/Box.h"
+
+// The six planes of a view frustum: XYZ the normal pointing inside, W the distance, so points
+// inside have Dot3(Plane, P) + W >= 0.
+struct FFrustum
+{
+	enum EPlane { Left, Right, Bottom, Top, Near, Far, NumPlanes };
+
+	FVector4 Planes[NumPlanes];
+
+	FFrustum() = default;
+	// From the rows of a Vulkan view projection, whose clip space depth goes from 0 to 1.
+	explicit FFrustum(const FMatrix& ViewProjection)
+	{
+		FVector4 Rows[4];
+		for (int Row = 0; Row < 4; ++Row)
+		{
+			Rows[Row] = FVector4(ViewProjection(Row, 0), ViewProjection(Row, 1), ViewProjection(Row, 2), ViewProjection(Row, 3));
+		}
+		Planes[Left] = Rows[3] + Rows[0];
+		Planes[Right] = Rows[3] - Rows[0];
+		Planes[Bottom] = Rows[3] + Rows[1];
+		Planes[Top] = Rows[3] - Rows[1];
+		Planes[Near] = Rows[2];
+		Planes[Far] = Rows[3] - Rows[2];
+		for (FVector4& Plane : Planes)
+		{
+			float Length = sqrtf(FVector4::Dot3(Plane, Plane));
+			Plane = Length > FMath::SmallNumber ? Plane * (1.f / Length) : Plane;
+		}
+	}
+
+	bool IntersectsSphere(const FVector3& Center, float Radius) const
+	{
+		for (const FVector4& Plane : Planes)
+		{
+			if (Plane.X * Center.X + Plane.Y * Center.Y + Plane.Z * Center.Z + Plane.W < -Radius)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Conservative: boxes outside the frustum but across the line of two planes pass.
+	bool IntersectsBox(const FVector3& Center, const FVector3& Extent) const
+	{
+		VectorRegister C = VectorSet(Center.X, Center.Y, Center.Z, 1.f);
+		VectorRegister E = VectorSet(Extent.X, Extent.Y, Extent.Z, 0.f);
+		for (const FVector4& Plane : Planes)
+		{
+			VectorRegister P = Plane.Load();
+			VectorRegister Distance = VectorAdd(VectorDot4(P, C), VectorDot4(VectorAbs(P), E));
+			if (VectorGetX(Distance) < 0.f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	bool IntersectsBox(const FBox& Box) const { return IntersectsBox(Box.GetCenter(), Box.GetExtent()); }
+};
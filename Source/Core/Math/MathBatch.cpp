@@ -0,0 +1,277 @@
+#include "MathBatch.h"
+#if MATH_BATCH_AVX2 && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if MATH_BATCH_AVX2
+extern const FMathBatchKernels GMathBatchKernelsAVX2;
+#endif
+
+// Scalar kernels: the reference the others are checked against, and the tails of the SIMD loops.
+
+static void MultiplyMatricesScalar(const FMatrix* A, const FMatrix* B, FMatrix* Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		float Result[4][4];
+		for (int Column = 0; Column < 4; ++Column)
+		{
+			for (int Row = 0; Row < 4; ++Row)
+			{
+				Result[Column][Row] = A[i](Row, 0) * B[i](0, Column) + A[i](Row, 1) * B[i](1, Column) +
+					A[i](Row, 2) * B[i](2, Column) + A[i](Row, 3) * B[i](3, Column);
+			}
+		}
+		for (int Column = 0; Column < 4; ++Column)
+		{
+			Out[i].Columns[Column] = FVector4(Result[Column][0], Result[Column][1], Result[Column][2], Result[Column][3]);
+		}
+	}
+}
+
+static void TransformPointsScalar(const FMatrix& M, const FPointsSoA& In, const FPointsSoA& Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		float X = In.X[i], Y = In.Y[i], Z = In.Z[i];
+		Out.X[i] = M(0, 0) * X + M(0, 1) * Y + M(0, 2) * Z + M(0, 3);
+		Out.Y[i] = M(1, 0) * X + M(1, 1) * Y + M(1, 2) * Z + M(1, 3);
+		Out.Z[i] = M(2, 0) * X + M(2, 1) * Y + M(2, 2) * Z + M(2, 3);
+	}
+}
+
+static void TransformBoxesScalar(const FMatrix& M, const FBoxesSoA& In, const FBoxesSoA& Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		float X = In.CenterX[i], Y = In.CenterY[i], Z = In.CenterZ[i];
+		float EX = In.ExtentX[i], EY = In.ExtentY[i], EZ = In.ExtentZ[i];
+		Out.CenterX[i] = M(0, 0) * X + M(0, 1) * Y + M(0, 2) * Z + M(0, 3);
+		Out.CenterY[i] = M(1, 0) * X + M(1, 1) * Y + M(1, 2) * Z + M(1, 3);
+		Out.CenterZ[i] = M(2, 0) * X + M(2, 1) * Y + M(2, 2) * Z + M(2, 3);
+		Out.ExtentX[i] = fabsf(M(0, 0)) * EX + fabsf(M(0, 1)) * EY + fabsf(M(0, 2)) * EZ;
+		Out.ExtentY[i] = fabsf(M(1, 0)) * EX + fabsf(M(1, 1)) * EY + fabsf(M(1, 2)) * EZ;
+		Out.ExtentZ[i] = fabsf(M(2, 0)) * EX + fabsf(M(2, 1)) * EY + fabsf(M(2, 2)) * EZ;
+	}
+}
+
+static size_t CullBoxesScalar(const FFrustum& Frustum, const FBoxesSoA& Boxes, uint32_t* OutVisible, size_t Count, size_t First)
+{
+	size_t NumVisible = 0;
+	for (size_t i = First; i < Count; ++i)
+	{
+		bool Visible = true;
+		for (const FVector4& Plane : Frustum.Planes)
+		{
+			float Distance = Plane.X * Boxes.CenterX[i] + Plane.Y * Boxes.CenterY[i] + Plane.Z * Boxes.CenterZ[i] + Plane.W +
+				fabsf(Plane.X) * Boxes.ExtentX[i] + fabsf(Plane.Y) * Boxes.ExtentY[i] + fabsf(Plane.Z) * Boxes.ExtentZ[i];
+			Visible = Visible && Distance >= 0.f;
+		}
+		OutVisible[NumVisible] = (uint32_t)i;
+		NumVisible += Visible ? 1 : 0;
+	}
+	return NumVisible;
+}
+
+static size_t CullBoxesScalar(const FFrustum& Frustum, const FBoxesSoA& Boxes, uint32_t* OutVisible, size_t Count)
+{
+	return CullBoxesScalar(Frustum, Boxes, OutVisible, Count, 0);
+}
+
+static const FMathBatchKernels GMathBatchKernelsScalar = { MultiplyMatricesScalar, TransformPointsScalar, TransformBoxesScalar, CullBoxesScalar };
+
+#if !MATH_SIMD_SCALAR
+
+// VectorRegister kernels, 4 elements per iteration. The scalar kernels finish the remainder.
+
+static void MultiplyMatricesVector(const FMatrix* A, const FMatrix* B, FMatrix* Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		Out[i] = A[i] * B[i];
+	}
+}
+
+static void TransformPointsVector(const FMatrix& M, const FPointsSoA& In, const FPointsSoA& Out, size_t Count)
+{
+	VectorRegister Matrix[3][4];
+	for (int Row = 0; Row < 3; ++Row)
+		for (int Column = 0; Column < 4; ++Column)
+			Matrix[Row][Column] = VectorSplat(M(Row, Column));
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		VectorRegister X = VectorLoad(In.X + i), Y = VectorLoad(In.Y + i), Z = VectorLoad(In.Z + i);
+		float* Outputs[3] = { Out.X + i, Out.Y + i, Out.Z + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			VectorRegister R = VectorMultiplyAdd(Matrix[Row][0], X, Matrix[Row][3]);
+			R = VectorMultiplyAdd(Matrix[Row][1], Y, R);
+			VectorStore(VectorMultiplyAdd(Matrix[Row][2], Z, R), Outputs[Row]);
+		}
+	}
+	FPointsSoA InTail = { In.X + i, In.Y + i, In.Z + i };
+	FPointsSoA OutTail = { Out.X + i, Out.Y + i, Out.Z + i };
+	TransformPointsScalar(M, InTail, OutTail, Count - i);
+}
+
+static void TransformBoxesVector(const FMatrix& M, const FBoxesSoA& In, const FBoxesSoA& Out, size_t Count)
+{
+	VectorRegister Matrix[3][4];
+	VectorRegister AbsMatrix[3][3];
+	for (int Row = 0; Row < 3; ++Row)
+	{
+		for (int Column = 0; Column < 4; ++Column)
+			Matrix[Row][Column] = VectorSplat(M(Row, Column));
+		for (int Column = 0; Column < 3; ++Column)
+			AbsMatrix[Row][Column] = VectorSplat(fabsf(M(Row, Column)));
+	}
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		VectorRegister X = VectorLoad(In.CenterX + i), Y = VectorLoad(In.CenterY + i), Z = VectorLoad(In.CenterZ + i);
+		VectorRegister EX = VectorLoad(In.ExtentX + i), EY = VectorLoad(In.ExtentY + i), EZ = VectorLoad(In.ExtentZ + i);
+		float* Centers[3] = { Out.CenterX + i, Out.CenterY + i, Out.CenterZ + i };
+		float* Extents[3] = { Out.ExtentX + i, Out.ExtentY + i, Out.ExtentZ + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			VectorRegister C = VectorMultiplyAdd(Matrix[Row][0], X, Matrix[Row][3]);
+			C = VectorMultiplyAdd(Matrix[Row][1], Y, C);
+			C = VectorMultiplyAdd(Matrix[Row][2], Z, C);
+			VectorRegister E = VectorMultiply(AbsMatrix[Row][0], EX);
+			E = VectorMultiplyAdd(AbsMatrix[Row][1], EY, E);
+			E = VectorMultiplyAdd(AbsMatrix[Row][2], EZ, E);
+			VectorStore(C, Centers[Row]);
+			VectorStore(E, Extents[Row]);
+		}
+	}
+	FBoxesSoA InTail = { In.CenterX + i, In.CenterY + i, In.CenterZ + i, In.ExtentX + i, In.ExtentY + i, In.ExtentZ + i };
+	FBoxesSoA OutTail = { Out.CenterX + i, Out.CenterY + i, Out.CenterZ + i, Out.ExtentX + i, Out.ExtentY + i, Out.ExtentZ + i };
+	TransformBoxesScalar(M, InTail, OutTail, Count - i);
+}
+
+static size_t CullBoxesVector(const FFrustum& Frustum, const FBoxesSoA& Boxes, uint32_t* OutVisible, size_t Count)
+{
+	VectorRegister Planes[FFrustum::NumPlanes][4];
+	VectorRegister AbsPlanes[FFrustum::NumPlanes][3];
+	for (int p = 0; p < FFrustum::NumPlanes; ++p)
+	{
+		for (int c = 0; c < 4; ++c)
+			Planes[p][c] = VectorSplat(Frustum.Planes[p][c]);
+		for (int c = 0; c < 3; ++c)
+			AbsPlanes[p][c] = VectorSplat(fabsf(Frustum.Planes[p][c]));
+	}
+	VectorRegister Zero = VectorZero();
+	size_t NumVisible = 0;
+	size_t i = 0;
+	for (; i + 4 <= Count; i += 4)
+	{
+		VectorRegister X = VectorLoad(Boxes.CenterX + i), Y = VectorLoad(Boxes.CenterY + i), Z = VectorLoad(Boxes.CenterZ + i);
+		VectorRegister EX = VectorLoad(Boxes.ExtentX + i), EY = VectorLoad(Boxes.ExtentY + i), EZ = VectorLoad(Boxes.ExtentZ + i);
+		uint32_t OutsideMask = 0;
+		for (int p = 0; p < FFrustum::NumPlanes; ++p)
+		{
+			VectorRegister Distance = VectorMultiplyAdd(Planes[p][0], X, Planes[p][3]);
+			Distance = VectorMultiplyAdd(Planes[p][1], Y, Distance);
+			Distance = VectorMultiplyAdd(Planes[p][2], Z, Distance);
+			Distance = VectorMultiplyAdd(AbsPlanes[p][0], EX, Distance);
+			Distance = VectorMultiplyAdd(AbsPlanes[p][1], EY, Distance);
+			Distance = VectorMultiplyAdd(AbsPlanes[p][2], EZ, Distance);
+			OutsideMask |= VectorMaskLessThan(Distance, Zero);
+		}
+		// branchless append: every lane is written, only the visible ones advance
+		for (uint32_t Lane = 0; Lane < 4; ++Lane)
+		{
+			OutVisible[NumVisible] = (uint32_t)(i + Lane);
+			NumVisible += (OutsideMask >> Lane) & 1 ? 0 : 1;
+		}
+	}
+	return NumVisible + CullBoxesScalar(Frustum, Boxes, OutVisible + NumVisible, Count, i);
+}
+
+static const FMathBatchKernels GMathBatchKernelsVector = { MultiplyMatricesVector, TransformPointsVector, TransformBoxesVector, CullBoxesVector };
+
+#endif
+
+#if MATH_BATCH_AVX2
+static bool CpuSupportsAVX2()
+{
+#if defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] < 7)
+	{
+		return false;
+	}
+	__cpuid(Info, 1);
+	const int FMA = 1 << 12, OSXSAVE = 1 << 27, AVX = 1 << 28;
+	if ((Info[2] & (FMA | OSXSAVE | AVX)) != (FMA | OSXSAVE | AVX) || (_xgetbv(0) & 6) != 6)
+	{
+		return false;
+	}
+	__cpuidex(Info, 7, 0);
+	return (Info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif
+}
+#endif
+
+const char* GetMathBackendName(EMathBackend Backend)
+{
+	switch (Backend)
+	{
+	case EMathBackend::Scalar: return "Scalar";
+	case EMathBackend::SSE: return "SSE4.1";
+	case EMathBackend::NEON: return "NEON";
+	case EMathBackend::AVX2: return "AVX2";
+	default: return "Unknown";
+	}
+}
+
+const FMathBatchKernels* GetMathBatchKernels(EMathBackend Backend)
+{
+	switch (Backend)
+	{
+	case EMathBackend::Scalar:
+		return &GMathBatchKernelsScalar;
+#if MATH_SIMD_SSE
+	case EMathBackend::SSE:
+		return &GMathBatchKernelsVector;
+#elif MATH_SIMD_NEON
+	case EMathBackend::NEON:
+		return &GMathBatchKernelsVector;
+#endif
+#if MATH_BATCH_AVX2
+	case EMathBackend::AVX2:
+	{
+		static const bool Supported = CpuSupportsAVX2();
+		return Supported ? &GMathBatchKernelsAVX2 : nullptr;
+	}
+#endif
+	default:
+		return nullptr;
+	}
+}
+
+EMathBackend GetBestMathBackend()
+{
+	static const EMathBackend Best = []
+	{
+		const EMathBackend Preferred[] = { EMathBackend::AVX2, EMathBackend::SSE, EMathBackend::NEON };
+		for (EMathBackend Backend : Preferred)
+		{
+			if (GetMathBatchKernels(Backend) != nullptr)
+			{
+				return Backend;
+			}
+		}
+		return EMathBackend::Scalar;
+	}();
+	return Best;
+}
+
+const FMathBatchKernels& GetMathBatchKernels()
+{
+	return *GetMathBatchKernels(GetBestMathBackend());
+}
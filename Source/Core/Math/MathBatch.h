@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Math/Frustum.h"
+#include <stddef.h>
+
+// x86-64 builds carry AVX2 kernels, picked at runtime on CPUs with AVX2 and FMA
+#if defined(__x86_64__) || defined(_M_X64)
+	#define MATH_BATCH_AVX2 1
+#endif
+
+// Kernels over many elements at once, for transform and culling loops. Points and boxes are
+// passed as structures of arrays, so a SIMD lane handles one element and nothing is shuffled.
+// Inputs are only read; outputs may be the inputs.
+struct FPointsSoA
+{
+	float* X;
+	float* Y;
+	float* Z;
+};
+
+struct FBoxesSoA
+{
+	float* CenterX;
+	float* CenterY;
+	float* CenterZ;
+	float* ExtentX;
+	float* ExtentY;
+	float* ExtentZ;
+};
+
+enum class EMathBackend : uint8_t
+{
+	Scalar,
+	// the VectorRegister backend, 4 lanes
+	SSE,
+	NEON,
+	// 8 lanes with FMA, x86-64 CPUs reporting AVX2 and FMA
+	AVX2,
+	Num
+};
+
+struct FMathBatchKernels
+{
+	// Out[i] = A[i] * B[i]
+	void (*MultiplyMatrices)(const FMatrix* A, const FMatrix* B, FMatrix* Out, size_t Count);
+	// Out[i] = M * (In[i], 1), without the perspective divide
+	void (*TransformPoints)(const FMatrix& M, const FPointsSoA& In, const FPointsSoA& Out, size_t Count);
+	// bounds of the transformed boxes, see FBox::TransformBy
+	void (*TransformBoxes)(const FMatrix& M, const FBoxesSoA& In, const FBoxesSoA& Out, size_t Count);
+	// Writes the indices of the boxes FFrustum::IntersectsBox passes in order, returns their count.
+	// OutVisible has room for Count indices.
+	size_t (*CullBoxes)(const FFrustum& Frustum, const FBoxesSoA& Boxes, uint32_t* OutVisible, size_t Count);
+};
+
+const char* GetMathBackendName(EMathBackend Backend);
+// nullptr when the backend isn't compiled in or the CPU lacks it.
+const FMathBatchKernels* GetMathBatchKernels(EMathBackend Backend);
+// The fastest backend available, checked once.
+EMathBackend GetBestMathBackend();
+const FMathBatchKernels& GetMathBatchKernels();
@@ -0,0 +1,170 @@
+#include "MathBatch.h"
+
+#if MATH_BATCH_AVX2
+#include <immintrin.h>
+
+// 8 elements per iteration with FMA. The kernels are compiled for AVX2 through a target attribute
+// rather than a file-wide flag, so the inline functions of the math headers instantiated here are
+// still compiled for the baseline and stay safe for every other caller the linker hands them to.
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define MATH_AVX2_FUNCTION
+#else
+	#define MATH_AVX2_FUNCTION __attribute__((target("avx2,fma")))
+#endif
+
+MATH_AVX2_FUNCTION static void MultiplyMatricesAVX2(const FMatrix* A, const FMatrix* B, FMatrix* Out, size_t Count)
+{
+	for (size_t i = 0; i < Count; ++i)
+	{
+		// A's columns in both halves, two of B's columns per register
+		const float* AData = &A[i].Columns[0].X;
+		const float* BData = &B[i].Columns[0].X;
+		__m256 A0 = _mm256_broadcast_ps((const __m128*)AData);
+		__m256 A1 = _mm256_broadcast_ps((const __m128*)(AData + 4));
+		__m256 A2 = _mm256_broadcast_ps((const __m128*)(AData + 8));
+		__m256 A3 = _mm256_broadcast_ps((const __m128*)(AData + 12));
+		// matrices are only 16 byte aligned
+		__m256 B01 = _mm256_loadu_ps(BData);
+		__m256 B23 = _mm256_loadu_ps(BData + 8);
+		__m256 R01 = _mm256_mul_ps(A0, _mm256_shuffle_ps(B01, B01, 0x00));
+		__m256 R23 = _mm256_mul_ps(A0, _mm256_shuffle_ps(B23, B23, 0x00));
+		R01 = _mm256_fmadd_ps(A1, _mm256_shuffle_ps(B01, B01, 0x55), R01);
+		R23 = _mm256_fmadd_ps(A1, _mm256_shuffle_ps(B23, B23, 0x55), R23);
+		R01 = _mm256_fmadd_ps(A2, _mm256_shuffle_ps(B01, B01, 0xAA), R01);
+		R23 = _mm256_fmadd_ps(A2, _mm256_shuffle_ps(B23, B23, 0xAA), R23);
+		R01 = _mm256_fmadd_ps(A3, _mm256_shuffle_ps(B01, B01, 0xFF), R01);
+		R23 = _mm256_fmadd_ps(A3, _mm256_shuffle_ps(B23, B23, 0xFF), R23);
+		float* OutData = &Out[i].Columns[0].X;
+		_mm256_storeu_ps(OutData, R01);
+		_mm256_storeu_ps(OutData + 8, R23);
+	}
+}
+
+MATH_AVX2_FUNCTION static void TransformPointsAVX2(const FMatrix& M, const FPointsSoA& In, const FPointsSoA& Out, size_t Count)
+{
+	__m256 Matrix[3][4];
+	for (int Row = 0; Row < 3; ++Row)
+		for (int Column = 0; Column < 4; ++Column)
+			Matrix[Row][Column] = _mm256_set1_ps(M.Columns[Column][Row]);
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		__m256 X = _mm256_loadu_ps(In.X + i), Y = _mm256_loadu_ps(In.Y + i), Z = _mm256_loadu_ps(In.Z + i);
+		float* Outputs[3] = { Out.X + i, Out.Y + i, Out.Z + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			__m256 R = _mm256_fmadd_ps(Matrix[Row][0], X, Matrix[Row][3]);
+			R = _mm256_fmadd_ps(Matrix[Row][1], Y, R);
+			_mm256_storeu_ps(Outputs[Row], _mm256_fmadd_ps(Matrix[Row][2], Z, R));
+		}
+	}
+	for (; i < Count; ++i)
+	{
+		float X = In.X[i], Y = In.Y[i], Z = In.Z[i];
+		float* Outputs[3] = { Out.X + i, Out.Y + i, Out.Z + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			*Outputs[Row] = M.Columns[0][Row] * X + M.Columns[1][Row] * Y + M.Columns[2][Row] * Z + M.Columns[3][Row];
+		}
+	}
+}
+
+MATH_AVX2_FUNCTION static void TransformBoxesAVX2(const FMatrix& M, const FBoxesSoA& In, const FBoxesSoA& Out, size_t Count)
+{
+	__m256 Matrix[3][4];
+	__m256 AbsMatrix[3][3];
+	for (int Row = 0; Row < 3; ++Row)
+	{
+		for (int Column = 0; Column < 4; ++Column)
+			Matrix[Row][Column] = _mm256_set1_ps(M.Columns[Column][Row]);
+		for (int Column = 0; Column < 3; ++Column)
+			AbsMatrix[Row][Column] = _mm256_set1_ps(fabsf(M.Columns[Column][Row]));
+	}
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		__m256 X = _mm256_loadu_ps(In.CenterX + i), Y = _mm256_loadu_ps(In.CenterY + i), Z = _mm256_loadu_ps(In.CenterZ + i);
+		__m256 EX = _mm256_loadu_ps(In.ExtentX + i), EY = _mm256_loadu_ps(In.ExtentY + i), EZ = _mm256_loadu_ps(In.ExtentZ + i);
+		float* Centers[3] = { Out.CenterX + i, Out.CenterY + i, Out.CenterZ + i };
+		float* Extents[3] = { Out.ExtentX + i, Out.ExtentY + i, Out.ExtentZ + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			__m256 C = _mm256_fmadd_ps(Matrix[Row][0], X, Matrix[Row][3]);
+			C = _mm256_fmadd_ps(Matrix[Row][1], Y, C);
+			C = _mm256_fmadd_ps(Matrix[Row][2], Z, C);
+			__m256 E = _mm256_mul_ps(AbsMatrix[Row][0], EX);
+			E = _mm256_fmadd_ps(AbsMatrix[Row][1], EY, E);
+			E = _mm256_fmadd_ps(AbsMatrix[Row][2], EZ, E);
+			_mm256_storeu_ps(Centers[Row], C);
+			_mm256_storeu_ps(Extents[Row], E);
+		}
+	}
+	for (; i < Count; ++i)
+	{
+		float X = In.CenterX[i], Y = In.CenterY[i], Z = In.CenterZ[i];
+		float EX = In.ExtentX[i], EY = In.ExtentY[i], EZ = In.ExtentZ[i];
+		float* Centers[3] = { Out.CenterX + i, Out.CenterY + i, Out.CenterZ + i };
+		float* Extents[3] = { Out.ExtentX + i, Out.ExtentY + i, Out.ExtentZ + i };
+		for (int Row = 0; Row < 3; ++Row)
+		{
+			*Centers[Row] = M.Columns[0][Row] * X + M.Columns[1][Row] * Y + M.Columns[2][Row] * Z + M.Columns[3][Row];
+			*Extents[Row] = fabsf(M.Columns[0][Row]) * EX + fabsf(M.Columns[1][Row]) * EY + fabsf(M.Columns[2][Row]) * EZ;
+		}
+	}
+}
+
+MATH_AVX2_FUNCTION static size_t CullBoxesAVX2(const FFrustum& Frustum, const FBoxesSoA& Boxes, uint32_t* OutVisible, size_t Count)
+{
+	__m256 Planes[FFrustum::NumPlanes][4];
+	__m256 AbsPlanes[FFrustum::NumPlanes][3];
+	for (int p = 0; p < FFrustum::NumPlanes; ++p)
+	{
+		const float* Plane = &Frustum.Planes[p].X;
+		for (int c = 0; c < 4; ++c)
+			Planes[p][c] = _mm256_set1_ps(Plane[c]);
+		for (int c = 0; c < 3; ++c)
+			AbsPlanes[p][c] = _mm256_set1_ps(fabsf(Plane[c]));
+	}
+	__m256 Zero = _mm256_setzero_ps();
+	size_t NumVisible = 0;
+	size_t i = 0;
+	for (; i + 8 <= Count; i += 8)
+	{
+		__m256 X = _mm256_loadu_ps(Boxes.CenterX + i), Y = _mm256_loadu_ps(Boxes.CenterY + i), Z = _mm256_loadu_ps(Boxes.CenterZ + i);
+		__m256 EX = _mm256_loadu_ps(Boxes.ExtentX + i), EY = _mm256_loadu_ps(Boxes.ExtentY + i), EZ = _mm256_loadu_ps(Boxes.ExtentZ + i);
+		int OutsideMask = 0;
+		for (int p = 0; p < FFrustum::NumPlanes; ++p)
+		{
+			__m256 Distance = _mm256_fmadd_ps(Planes[p][0], X, Planes[p][3]);
+			Distance = _mm256_fmadd_ps(Planes[p][1], Y, Distance);
+			Distance = _mm256_fmadd_ps(Planes[p][2], Z, Distance);
+			Distance = _mm256_fmadd_ps(AbsPlanes[p][0], EX, Distance);
+			Distance = _mm256_fmadd_ps(AbsPlanes[p][1], EY, Distance);
+			Distance = _mm256_fmadd_ps(AbsPlanes[p][2], EZ, Distance);
+			OutsideMask |= _mm256_movemask_ps(_mm256_cmp_ps(Distance, Zero, _CMP_LT_OQ));
+		}
+		for (uint32_t Lane = 0; Lane < 8; ++Lane)
+		{
+			OutVisible[NumVisible] = (uint32_t)(i + Lane);
+			NumVisible += (OutsideMask >> Lane) & 1 ? 0 : 1;
+		}
+	}
+	for (; i < Count; ++i)
+	{
+		bool Visible = true;
+		for (int p = 0; p < FFrustum::NumPlanes; ++p)
+		{
+			const float* Plane = &Frustum.Planes[p].X;
+			float Distance = Plane[0] * Boxes.CenterX[i] + Plane[1] * Boxes.CenterY[i] + Plane[2] * Boxes.CenterZ[i] + Plane[3] +
+				fabsf(Plane[0]) * Boxes.ExtentX[i] + fabsf(Plane[1]) * Boxes.ExtentY[i] + fabsf(Plane[2]) * Boxes.ExtentZ[i];
+			Visible = Visible && Distance >= 0.f;
+		}
+		OutVisible[NumVisible] = (uint32_t)i;
+		NumVisible += Visible ? 1 : 0;
+	}
+	return NumVisible;
+}
+
+extern const FMathBatchKernels GMathBatchKernelsAVX2 = { MultiplyMatricesAVX2, TransformPointsAVX2, TransformBoxesAVX2, CullBoxesAVX2 };
+
+#endif
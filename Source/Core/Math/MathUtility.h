@@ -0,0 +1,20 @@
+#pragma once
+
+#include <math.h>
+
+struct FMath
+{
+	static constexpr float Pi = 3.14159265358979f;
+	static constexpr float SmallNumber = 1e-8f;
+
+	static float DegreesToRadians(float Degrees) { return Degrees * (Pi / 180.f); }
+	static float RadiansToDegrees(float Radians) { return Radians * (180.f / Pi); }
+
+	template<typename T>
+	static T Min(T A, T B) { return A < B ? A : B; }
+	template<typename T>
+	static T Max(T A, T B) { return A > B ? A : B; }
+	template<typename T>
+	static T Clamp(T Value, T Low, T High) { return Value < Low ? Low : Value > High ? High : Value; }
+	static float Lerp(float A, float B, float Alpha) { return A + (B - A) * Alpha; }
+};
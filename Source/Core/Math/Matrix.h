@@ -0,0 +1,152 @@
+#pragma once
+
+#include "Math/Vector.h"
+#include "Math/Quat.h"
+
+// 4x4 matrix for column vectors, stored column-major like a GLSL mat4 so it can be copied into
+// uniform and push constant data as is. Transforms compose right to left: (A * B) applies B first.
+// Projections follow Vulkan: clip space y points down and depth goes from 0 to 1.
+struct alignas(16) FMatrix
+{
+	FVector4 Columns[4];
+
+	FMatrix() = default;
+	FMatrix(const FVector4& Column0, const FVector4& Column1, const FVector4& Column2, const FVector4& Column3)
+		: Columns{ Column0, Column1, Column2, Column3 } {}
+
+	float operator()(int Row, int Column) const { return Columns[Column][Row]; }
+	float& operator()(int Row, int Column) { return Columns[Column][Row]; }
+	const float* Data() const { return Columns[0].Data(); }
+
+	static FMatrix Identity()
+	{
+		return FMatrix({ 1.f, 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f }, { 0.f, 0.f, 0.f, 1.f });
+	}
+	static FMatrix Translation(const FVector3& T)
+	{
+		return FMatrix({ 1.f, 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f }, { T, 1.f });
+	}
+	static FMatrix Scale(const FVector3& S)
+	{
+		return FMatrix({ S.X, 0.f, 0.f, 0.f }, { 0.f, S.Y, 0.f, 0.f }, { 0.f, 0.f, S.Z, 0.f }, { 0.f, 0.f, 0.f, 1.f });
+	}
+	// Q must be normalized.
+	static FMatrix Rotation(const FQuat& Q)
+	{
+		float X2 = Q.X + Q.X, Y2 = Q.Y + Q.Y, Z2 = Q.Z + Q.Z;
+		float XX = Q.X * X2, XY = Q.X * Y2, XZ = Q.X * Z2;
+		float YY = Q.Y * Y2, YZ = Q.Y * Z2, ZZ = Q.Z * Z2;
+		float WX = Q.W * X2, WY = Q.W * Y2, WZ = Q.W * Z2;
+		return FMatrix(
+			{ 1.f - (YY + ZZ), XY + WZ, XZ - WY, 0.f },
+			{ XY - WZ, 1.f - (XX + ZZ), YZ + WX, 0.f },
+			{ XZ + WY, YZ - WX, 1.f - (XX + YY), 0.f },
+			{ 0.f, 0.f, 0.f, 1.f });
+	}
+	// Translation * Rotation * Scale without the two multiplies.
+	static FMatrix FromTRS(const FVector3& T, const FQuat& R, const FVector3& S)
+	{
+		FMatrix Result = Rotation(R);
+		Result.Columns[0] = Result.Columns[0] * S.X;
+		Result.Columns[1] = Result.Columns[1] * S.Y;
+		Result.Columns[2] = Result.Columns[2] * S.Z;
+		Result.Columns[3] = FVector4(T, 1.f);
+		return Result;
+	}
+	// Right-handed view space looking down -Z.
+	static FMatrix LookAt(const FVector3& Eye, const FVector3& Target, const FVector3& Up)
+	{
+		FVector3 F = (Target - Eye).GetSafeNormal();
+		FVector3 S = FVector3::Cross(F, Up).GetSafeNormal();
+		FVector3 U = FVector3::Cross(S, F);
+		return FMatrix({ S.X, U.X, -F.X, 0.f }, { S.Y, U.Y, -F.Y, 0.f }, { S.Z, U.Z, -F.Z, 0.f },
+			{ -FVector3::Dot(S, Eye), -FVector3::Dot(U, Eye), FVector3::Dot(F, Eye), 1.f });
+	}
+	// FovY in radians. Maps view space depth -Near to 0 and -Far to 1.
+	static FMatrix Perspective(float FovY, float Aspect, float Near, float Far)
+	{
+		float F = 1.f / tanf(0.5f * FovY);
+		float RangeInv = 1.f / (Near - Far);
+		return FMatrix({ F / Aspect, 0.f, 0.f, 0.f }, { 0.f, -F, 0.f, 0.f }, { 0.f, 0.f, Far * RangeInv, -1.f },
+			{ 0.f, 0.f, Near * Far * RangeInv, 0.f });
+	}
+	static FMatrix Orthographic(float Left, float Right, float Bottom, float Top, float Near, float Far)
+	{
+		float Width = Right - Left, Height = Top - Bottom, RangeInv = 1.f / (Near - Far);
+		return FMatrix({ 2.f / Width, 0.f, 0.f, 0.f }, { 0.f, -2.f / Height, 0.f, 0.f }, { 0.f, 0.f, RangeInv, 0.f },
+			{ -(Right + Left) / Width, (Top + Bottom) / Height, Near * RangeInv, 1.f });
+	}
+
+	FMatrix operator*(const FMatrix& B) const
+	{
+		VectorRegister A0 = Columns[0].Load(), A1 = Columns[1].Load(), A2 = Columns[2].Load(), A3 = Columns[3].Load();
+		FMatrix Result;
+		for (int i = 0; i < 4; ++i)
+		{
+			VectorRegister Column = B.Columns[i].Load();
+			VectorRegister R = VectorMultiply(A0, VectorReplicate<0>(Column));
+			R = VectorMultiplyAdd(A1, VectorReplicate<1>(Column), R);
+			R = VectorMultiplyAdd(A2, VectorReplicate<2>(Column), R);
+			R = VectorMultiplyAdd(A3, VectorReplicate<3>(Column), R);
+			VectorStoreAligned(R, &Result.Columns[i].X);
+		}
+		return Result;
+	}
+
+	FVector4 TransformVector4(const FVector4& V) const
+	{
+		VectorRegister R = VectorMultiply(Columns[0].Load(), VectorSplat(V.X));
+		R = VectorMultiplyAdd(Columns[1].Load(), VectorSplat(V.Y), R);
+		R = VectorMultiplyAdd(Columns[2].Load(), VectorSplat(V.Z), R);
+		return FVector4(VectorMultiplyAdd(Columns[3].Load(), VectorSplat(V.W), R));
+	}
+	// W = 1, without the perspective divide.
+	FVector3 TransformPoint(const FVector3& P) const { return TransformVector4(FVector4(P, 1.f)).XYZ(); }
+	// W = 0, ignores the translation.
+	FVector3 TransformVector(const FVector3& V) const { return TransformVector4(FVector4(V, 0.f)).XYZ(); }
+
+	FMatrix GetTransposed() const
+	{
+		FMatrix Result;
+		for (int Row = 0; Row < 4; ++Row)
+			for (int Column = 0; Column < 4; ++Column)
+				Result(Column, Row) = (*this)(Row, Column);
+		return Result;
+	}
+
+	// General inverse by cofactors. Singular matrices return the identity.
+	FMatrix Inverse() const
+	{
+		const float* M = Data();
+		float Inv[16];
+		Inv[0] = M[5] * M[10] * M[15] - M[5] * M[11] * M[14] - M[9] * M[6] * M[15] + M[9] * M[7] * M[14] + M[13] * M[6] * M[11] - M[13] * M[7] * M[10];
+		Inv[4] = -M[4] * M[10] * M[15] + M[4] * M[11] * M[14] + M[8] * M[6] * M[15] - M[8] * M[7] * M[14] - M[12] * M[6] * M[11] + M[12] * M[7] * M[10];
+		Inv[8] = M[4] * M[9] * M[15] - M[4] * M[11] * M[13] - M[8] * M[5] * M[15] + M[8] * M[7] * M[13] + M[12] * M[5] * M[11] - M[12] * M[7] * M[9];
+		Inv[12] = -M[4] * M[9] * M[14] + M[4] * M[10] * M[13] + M[8] * M[5] * M[14] - M[8] * M[6] * M[13] - M[12] * M[5] * M[10] + M[12] * M[6] * M[9];
+		Inv[1] = -M[1] * M[10] * M[15] + M[1] * M[11] * M[14] + M[9] * M[2] * M[15] - M[9] * M[3] * M[14] - M[13] * M[2] * M[11] + M[13] * M[3] * M[10];
+		Inv[5] = M[0] * M[10] * M[15] - M[0] * M[11] * M[14] - M[8] * M[2] * M[15] + M[8] * M[3] * M[14] + M[12] * M[2] * M[11] - M[12] * M[3] * M[10];
+		Inv[9] = -M[0] * M[9] * M[15] + M[0] * M[11] * M[13] + M[8] * M[1] * M[15] - M[8] * M[3] * M[13] - M[12] * M[1] * M[11] + M[12] * M[3] * M[9];
+		Inv[13] = M[0] * M[9] * M[14] - M[0] * M[10] * M[13] - M[8] * M[1] * M[14] + M[8] * M[2] * M[13] + M[12] * M[1] * M[10] - M[12] * M[2] * M[9];
+		Inv[2] = M[1] * M[6] * M[15] - M[1] * M[7] * M[14] - M[5] * M[2] * M[15] + M[5] * M[3] * M[14] + M[13] * M[2] * M[7] - M[13] * M[3] * M[6];
+		Inv[6] = -M[0] * M[6] * M[15] + M[0] * M[7] * M[14] + M[4] * M[2] * M[15] - M[4] * M[3] * M[14] - M[12] * M[2] * M[7] + M[12] * M[3] * M[6];
+		Inv[10] = M[0] * M[5] * M[15] - M[0] * M[7] * M[13] - M[4] * M[1] * M[15] + M[4] * M[3] * M[13] + M[12] * M[1] * M[7] - M[12] * M[3] * M[5];
+		Inv[14] = -M[0] * M[5] * M[14] + M[0] * M[6] * M[13] + M[4] * M[1] * M[14] - M[4] * M[2] * M[13] - M[12] * M[1] * M[6] + M[12] * M[2] * M[5];
+		Inv[3] = -M[1] * M[6] * M[11] + M[1] * M[7] * M[10] + M[5] * M[2] * M[11] - M[5] * M[3] * M[10] - M[9] * M[2] * M[7] + M[9] * M[3] * M[6];
+		Inv[7] = M[0] * M[6] * M[11] - M[0] * M[7] * M[10] - M[4] * M[2] * M[11] + M[4] * M[3] * M[10] + M[8] * M[2] * M[7] - M[8] * M[3] * M[6];
+		Inv[11] = -M[0] * M[5] * M[11] + M[0] * M[7] * M[9] + M[4] * M[1] * M[11] - M[4] * M[3] * M[9] - M[8] * M[1] * M[7] + M[8] * M[3] * M[5];
+		Inv[15] = M[0] * M[5] * M[10] - M[0] * M[6] * M[9] - M[4] * M[1] * M[10] + M[4] * M[2] * M[9] + M[8] * M[1] * M[6] - M[8] * M[2] * M[5];
+
+		float Determinant = M[0] * Inv[0] + M[1] * Inv[4] + M[2] * Inv[8] + M[3] * Inv[12];
+		if (fabsf(Determinant) <= FMath::SmallNumber)
+		{
+			return Identity();
+		}
+		float Scale = 1.f / Determinant;
+		FMatrix Result;
+		for (int i = 0; i < 4; ++i)
+		{
+			Result.Columns[i] = FVector4(Inv[i * 4] * Scale, Inv[i * 4 + 1] * Scale, Inv[i * 4 + 2] * Scale, Inv[i * 4 + 3] * Scale);
+		}
+		return Result;
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Math/Vector.h"
+
+// Rotation quaternion, W is the real part. Rotations compose right to left like matrices:
+// (A * B).RotateVector(V) == A.RotateVector(B.RotateVector(V)).
+struct alignas(16) FQuat
+{
+	float X = 0.f, Y = 0.f, Z = 0.f, W = 1.f;
+
+	FQuat() = default;
+	FQuat(float InX, float InY, float InZ, float InW) : X(InX), Y(InY), Z(InZ), W(InW) {}
+	explicit FQuat(VectorRegister V) { VectorStoreAligned(V, &X); }
+
+	static FQuat Identity() { return FQuat(); }
+	// Axis must be normalized, angle in radians, counter-clockwise looking down the axis.
+	static FQuat FromAxisAngle(const FVector3& Axis, float Angle)
+	{
+		float S = sinf(0.5f * Angle);
+		return FQuat(Axis.X * S, Axis.Y * S, Axis.Z * S, cosf(0.5f * Angle));
+	}
+
+	VectorRegister Load() const { return VectorLoadAligned(&X); }
+
+	FQuat operator*(const FQuat& Q) const
+	{
+		VectorRegister A = Load();
+		VectorRegister B = Q.Load();
+		VectorRegister Result = VectorMultiply(VectorReplicate<3>(A), B);
+		Result = VectorMultiplyAdd(VectorReplicate<0>(A), VectorMultiply(VectorSwizzle<3, 2, 1, 0>(B), VectorSet(1.f, -1.f, 1.f, -1.f)), Result);
+		Result = VectorMultiplyAdd(VectorReplicate<1>(A), VectorMultiply(VectorSwizzle<2, 3, 0, 1>(B), VectorSet(1.f, 1.f, -1.f, -1.f)), Result);
+		Result = VectorMultiplyAdd(VectorReplicate<2>(A), VectorMultiply(VectorSwizzle<1, 0, 3, 2>(B), VectorSet(-1.f, 1.f, 1.f, -1.f)), Result);
+		return FQuat(Result);
+	}
+
+	FVector3 RotateVector(const FVector3& V) const
+	{
+		// V + W * T + Q x T, with T = 2 * (Q x V)
+		VectorRegister Q = Load();
+		VectorRegister Vector = VectorSet(V.X, V.Y, V.Z, 0.f);
+		VectorRegister T = VectorCross(Q, Vector);
+		T = VectorAdd(T, T);
+		VectorRegister Result = VectorAdd(VectorMultiplyAdd(VectorReplicate<3>(Q), T, Vector), VectorCross(Q, T));
+		return FVector4(Result).XYZ();
+	}
+
+	// The inverse of a normalized quaternion.
+	FQuat Inverse() const { return FQuat(-X, -Y, -Z, W); }
+	FQuat GetNormalized() const
+	{
+		VectorRegister Q = Load();
+		VectorRegister SquareSum = VectorDot4(Q, Q);
+		if (VectorGetX(SquareSum) <= FMath::SmallNumber)
+		{
+			return FQuat();
+		}
+		return FQuat(VectorDivide(Q, VectorSqrt(SquareSum)));
+	}
+
+	static float Dot(const FQuat& A, const FQuat& B) { return VectorGetX(VectorDot4(A.Load(), B.Load())); }
+
+	// Interpolates along the shorter arc; normalized lerp once the two are nearly equal.
+	static FQuat Slerp(const FQuat& A, const FQuat& B, float Alpha)
+	{
+		float CosAngle = Dot(A, B);
+		float Sign = CosAngle < 0.f ? -1.f : 1.f;
+		CosAngle *= Sign;
+		float ScaleA = 1.f - Alpha;
+		float ScaleB = Alpha * Sign;
+		if (CosAngle < 0.9999f)
+		{
+			float Angle = acosf(CosAngle);
+			float InvSin = 1.f / sinf(Angle);
+			ScaleA = sinf(ScaleA * Angle) * InvSin;
+			ScaleB = sinf(Alpha * Angle) * InvSin * Sign;
+		}
+		VectorRegister Result = VectorMultiplyAdd(A.Load(), VectorSplat(ScaleA), VectorMultiply(B.Load(), VectorSplat(ScaleB)));
+		return FQuat(Result).GetNormalized();
+	}
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Math/VectorRegister.h"
+#include "Math/MathUtility.h"
+
+// Positions and directions as stored in meshes and components: 12 bytes, scalar math.
+struct FVector3
+{
+	float X = 0.f, Y = 0.f, Z = 0.f;
+
+	FVector3() = default;
+	FVector3(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+	explicit FVector3(float Value) : X(Value), Y(Value), Z(Value) {}
+
+	FVector3 operator+(const FVector3& V) const { return { X + V.X, Y + V.Y, Z + V.Z }; }
+	FVector3 operator-(const FVector3& V) const { return { X - V.X, Y - V.Y, Z - V.Z }; }
+	FVector3 operator*(const FVector3& V) const { return { X * V.X, Y * V.Y, Z * V.Z }; }
+	FVector3 operator*(float Scale) const { return { X * Scale, Y * Scale, Z * Scale }; }
+	FVector3 operator/(float Scale) const { return *this * (1.f / Scale); }
+	FVector3 operator-() const { return { -X, -Y, -Z }; }
+	FVector3& operator+=(const FVector3& V) { X += V.X; Y += V.Y; Z += V.Z; return *this; }
+	FVector3& operator-=(const FVector3& V) { X -= V.X; Y -= V.Y; Z -= V.Z; return *this; }
+	FVector3& operator*=(float Scale) { X *= Scale; Y *= Scale; Z *= Scale; return *this; }
+	bool operator==(const FVector3& V) const { return X == V.X && Y == V.Y && Z == V.Z; }
+	bool operator!=(const FVector3& V) const { return !(*this == V); }
+	float operator[](int Index) const { return (&X)[Index]; }
+	float& operator[](int Index) { return (&X)[Index]; }
+
+	float SizeSquared() const { return X * X + Y * Y + Z * Z; }
+	float Size() const { return sqrtf(SizeSquared()); }
+	// Zero for vectors too short to normalize.
+	FVector3 GetSafeNormal() const
+	{
+		float SquareSum = SizeSquared();
+		return SquareSum > FMath::SmallNumber ? *this * (1.f / sqrtf(SquareSum)) : FVector3();
+	}
+
+	static float Dot(const FVector3& A, const FVector3& B) { return A.X * B.X + A.Y * B.Y + A.Z * B.Z; }
+	static FVector3 Cross(const FVector3& A, const FVector3& B)
+	{
+		return { A.Y * B.Z - A.Z * B.Y, A.Z * B.X - A.X * B.Z, A.X * B.Y - A.Y * B.X };
+	}
+	static FVector3 Min(const FVector3& A, const FVector3& B) { return { FMath::Min(A.X, B.X), FMath::Min(A.Y, B.Y), FMath::Min(A.Z, B.Z) }; }
+	static FVector3 Max(const FVector3& A, const FVector3& B) { return { FMath::Max(A.X, B.X), FMath::Max(A.Y, B.Y), FMath::Max(A.Z, B.Z) }; }
+	static FVector3 Abs(const FVector3& V) { return { fabsf(V.X), fabsf(V.Y), fabsf(V.Z) }; }
+};
+
+inline FVector3 operator*(float Scale, const FVector3& V) { return V * Scale; }
+
+// 16 byte aligned and computed in a VectorRegister. Also the layout of a GLSL vec4.
+struct alignas(16) FVector4
+{
+	float X = 0.f, Y = 0.f, Z = 0.f, W = 0.f;
+
+	FVector4() = default;
+	FVector4(float InX, float InY, float InZ, float InW) : X(InX), Y(InY), Z(InZ), W(InW) {}
+	FVector4(const FVector3& V, float InW) : X(V.X), Y(V.Y), Z(V.Z), W(InW) {}
+	explicit FVector4(VectorRegister V) { VectorStoreAligned(V, &X); }
+
+	VectorRegister Load() const { return VectorLoadAligned(&X); }
+	FVector3 XYZ() const { return { X, Y, Z }; }
+	const float* Data() const { return &X; }
+
+	FVector4 operator+(const FVector4& V) const { return FVector4(VectorAdd(Load(), V.Load())); }
+	FVector4 operator-(const FVector4& V) const { return FVector4(VectorSubtract(Load(), V.Load())); }
+	FVector4 operator*(const FVector4& V) const { return FVector4(VectorMultiply(Load(), V.Load())); }
+	FVector4 operator*(float Scale) const { return FVector4(VectorMultiply(Load(), VectorSplat(Scale))); }
+	FVector4 operator-() const { return FVector4(VectorNegate(Load())); }
+	bool operator==(const FVector4& V) const { return X == V.X && Y == V.Y && Z == V.Z && W == V.W; }
+	bool operator!=(const FVector4& V) const { return !(*this == V); }
+	float operator[](int Index) const { return (&X)[Index]; }
+	float& operator[](int Index) { return (&X)[Index]; }
+
+	static float Dot3(const FVector4& A, const FVector4& B) { return VectorGetX(VectorDot3(A.Load(), B.Load())); }
+	static float Dot4(const FVector4& A, const FVector4& B) { return VectorGetX(VectorDot4(A.Load(), B.Load())); }
+	static FVector4 Cross3(const FVector4& A, const FVector4& B) { return FVector4(VectorCross(A.Load(), B.Load())); }
+};
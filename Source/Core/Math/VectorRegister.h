@@ -0,0 +1,175 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// The 4-wide float register the math types are built on. The backend is picked at compile time:
+// SSE4.1 on x86-64, NEON on ARM64, plain floats otherwise or when MATH_FORCE_SCALAR is defined.
+// Every translation unit must see the same backend, so Core passes its SIMD flags on to the
+// targets linking it. AVX2 is only used by the batch kernels, behind a CPU check, see MathBatch.h.
+#if defined(MATH_FORCE_SCALAR)
+	#define MATH_SIMD_SCALAR 1
+	#define MATH_SIMD_NAME "Scalar"
+#elif defined(__SSE4_1__) || (defined(_MSC_VER) && defined(_M_X64))
+	#define MATH_SIMD_SSE 1
+	#define MATH_SIMD_NAME "SSE4.1"
+	#include <smmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define MATH_SIMD_NEON 1
+	#define MATH_SIMD_NAME "NEON"
+	#include <arm_neon.h>
+#else
+	#define MATH_SIMD_SCALAR 1
+	#define MATH_SIMD_NAME "Scalar"
+#endif
+
+#if MATH_SIMD_SSE
+
+typedef __m128 VectorRegister;
+
+inline VectorRegister VectorLoad(const float* Ptr) { return _mm_loadu_ps(Ptr); }
+// Ptr is 16 byte aligned
+inline VectorRegister VectorLoadAligned(const float* Ptr) { return _mm_load_ps(Ptr); }
+inline void VectorStore(VectorRegister V, float* Ptr) { _mm_storeu_ps(Ptr, V); }
+inline void VectorStoreAligned(VectorRegister V, float* Ptr) { _mm_store_ps(Ptr, V); }
+inline VectorRegister VectorSet(float X, float Y, float Z, float W) { return _mm_setr_ps(X, Y, Z, W); }
+inline VectorRegister VectorSplat(float Value) { return _mm_set1_ps(Value); }
+inline VectorRegister VectorZero() { return _mm_setzero_ps(); }
+inline float VectorGetX(VectorRegister V) { return _mm_cvtss_f32(V); }
+
+template<int X, int Y, int Z, int W>
+inline VectorRegister VectorSwizzle(VectorRegister V) { return _mm_shuffle_ps(V, V, _MM_SHUFFLE(W, Z, Y, X)); }
+template<int Index>
+inline VectorRegister VectorReplicate(VectorRegister V) { return _mm_shuffle_ps(V, V, _MM_SHUFFLE(Index, Index, Index, Index)); }
+
+inline VectorRegister VectorAdd(VectorRegister A, VectorRegister B) { return _mm_add_ps(A, B); }
+inline VectorRegister VectorSubtract(VectorRegister A, VectorRegister B) { return _mm_sub_ps(A, B); }
+inline VectorRegister VectorMultiply(VectorRegister A, VectorRegister B) { return _mm_mul_ps(A, B); }
+inline VectorRegister VectorDivide(VectorRegister A, VectorRegister B) { return _mm_div_ps(A, B); }
+// A * B + C
+inline VectorRegister VectorMultiplyAdd(VectorRegister A, VectorRegister B, VectorRegister C) { return _mm_add_ps(_mm_mul_ps(A, B), C); }
+inline VectorRegister VectorMin(VectorRegister A, VectorRegister B) { return _mm_min_ps(A, B); }
+inline VectorRegister VectorMax(VectorRegister A, VectorRegister B) { return _mm_max_ps(A, B); }
+inline VectorRegister VectorNegate(VectorRegister V) { return _mm_xor_ps(V, _mm_set1_ps(-0.f)); }
+inline VectorRegister VectorAbs(VectorRegister V) { return _mm_andnot_ps(_mm_set1_ps(-0.f), V); }
+inline VectorRegister VectorSqrt(VectorRegister V) { return _mm_sqrt_ps(V); }
+// the dot product in every component
+inline VectorRegister VectorDot3(VectorRegister A, VectorRegister B) { return _mm_dp_ps(A, B, 0x7F); }
+inline VectorRegister VectorDot4(VectorRegister A, VectorRegister B) { return _mm_dp_ps(A, B, 0xFF); }
+// bit i set when component i of A is less than component i of B
+inline uint32_t VectorMaskLessThan(VectorRegister A, VectorRegister B) { return (uint32_t)_mm_movemask_ps(_mm_cmplt_ps(A, B)); }
+
+#elif MATH_SIMD_NEON
+
+typedef float32x4_t VectorRegister;
+
+inline VectorRegister VectorLoad(const float* Ptr) { return vld1q_f32(Ptr); }
+inline VectorRegister VectorLoadAligned(const float* Ptr) { return vld1q_f32(Ptr); }
+inline void VectorStore(VectorRegister V, float* Ptr) { vst1q_f32(Ptr, V); }
+inline void VectorStoreAligned(VectorRegister V, float* Ptr) { vst1q_f32(Ptr, V); }
+inline VectorRegister VectorSet(float X, float Y, float Z, float W)
+{
+	const float Values[4] = { X, Y, Z, W };
+	return vld1q_f32(Values);
+}
+inline VectorRegister VectorSplat(float Value) { return vdupq_n_f32(Value); }
+inline VectorRegister VectorZero() { return vdupq_n_f32(0.f); }
+inline float VectorGetX(VectorRegister V) { return vgetq_lane_f32(V, 0); }
+
+template<int X, int Y, int Z, int W>
+inline VectorRegister VectorSwizzle(VectorRegister V)
+{
+#if defined(__clang__)
+	return __builtin_shufflevector(V, V, X, Y, Z, W);
+#else
+	VectorRegister Result = vdupq_n_f32(vgetq_lane_f32(V, X));
+	Result = vsetq_lane_f32(vgetq_lane_f32(V, Y), Result, 1);
+	Result = vsetq_lane_f32(vgetq_lane_f32(V, Z), Result, 2);
+	return vsetq_lane_f32(vgetq_lane_f32(V, W), Result, 3);
+#endif
+}
+template<int Index>
+inline VectorRegister VectorReplicate(VectorRegister V) { return vdupq_laneq_f32(V, Index); }
+
+inline VectorRegister VectorAdd(VectorRegister A, VectorRegister B) { return vaddq_f32(A, B); }
+inline VectorRegister VectorSubtract(VectorRegister A, VectorRegister B) { return vsubq_f32(A, B); }
+inline VectorRegister VectorMultiply(VectorRegister A, VectorRegister B) { return vmulq_f32(A, B); }
+inline VectorRegister VectorDivide(VectorRegister A, VectorRegister B) { return vdivq_f32(A, B); }
+inline VectorRegister VectorMultiplyAdd(VectorRegister A, VectorRegister B, VectorRegister C) { return vfmaq_f32(C, A, B); }
+inline VectorRegister VectorMin(VectorRegister A, VectorRegister B) { return vminq_f32(A, B); }
+inline VectorRegister VectorMax(VectorRegister A, VectorRegister B) { return vmaxq_f32(A, B); }
+inline VectorRegister VectorNegate(VectorRegister V) { return vnegq_f32(V); }
+inline VectorRegister VectorAbs(VectorRegister V) { return vabsq_f32(V); }
+inline VectorRegister VectorSqrt(VectorRegister V) { return vsqrtq_f32(V); }
+inline VectorRegister VectorDot3(VectorRegister A, VectorRegister B)
+{
+	return vdupq_n_f32(vaddvq_f32(vsetq_lane_f32(0.f, vmulq_f32(A, B), 3)));
+}
+inline VectorRegister VectorDot4(VectorRegister A, VectorRegister B) { return vdupq_n_f32(vaddvq_f32(vmulq_f32(A, B))); }
+inline uint32_t VectorMaskLessThan(VectorRegister A, VectorRegister B)
+{
+	static const uint32_t Bits[4] = { 1, 2, 4, 8 };
+	return vaddvq_u32(vandq_u32(vcltq_f32(A, B), vld1q_u32(Bits)));
+}
+
+#else
+
+struct alignas(16) VectorRegister
+{
+	float V[4];
+};
+
+inline VectorRegister VectorLoad(const float* Ptr) { return { { Ptr[0], Ptr[1], Ptr[2], Ptr[3] } }; }
+inline VectorRegister VectorLoadAligned(const float* Ptr) { return VectorLoad(Ptr); }
+inline void VectorStore(VectorRegister V, float* Ptr) { for (int i = 0; i < 4; ++i) Ptr[i] = V.V[i]; }
+inline void VectorStoreAligned(VectorRegister V, float* Ptr) { VectorStore(V, Ptr); }
+inline VectorRegister VectorSet(float X, float Y, float Z, float W) { return { { X, Y, Z, W } }; }
+inline VectorRegister VectorSplat(float Value) { return { { Value, Value, Value, Value } }; }
+inline VectorRegister VectorZero() { return VectorSplat(0.f); }
+inline float VectorGetX(VectorRegister V) { return V.V[0]; }
+
+template<int X, int Y, int Z, int W>
+inline VectorRegister VectorSwizzle(VectorRegister V) { return { { V.V[X], V.V[Y], V.V[Z], V.V[W] } }; }
+template<int Index>
+inline VectorRegister VectorReplicate(VectorRegister V) { return VectorSplat(V.V[Index]); }
+
+#define MATH_SCALAR_BINARY(Name, Expression) \
+	inline VectorRegister Name(VectorRegister A, VectorRegister B) \
+	{ \
+		VectorRegister R; \
+		for (int i = 0; i < 4; ++i) { float a = A.V[i], b = B.V[i]; R.V[i] = Expression; } \
+		return R; \
+	}
+MATH_SCALAR_BINARY(VectorAdd, a + b)
+MATH_SCALAR_BINARY(VectorSubtract, a - b)
+MATH_SCALAR_BINARY(VectorMultiply, a * b)
+MATH_SCALAR_BINARY(VectorDivide, a / b)
+MATH_SCALAR_BINARY(VectorMin, a < b ? a : b)
+MATH_SCALAR_BINARY(VectorMax, a > b ? a : b)
+#undef MATH_SCALAR_BINARY
+
+inline VectorRegister VectorMultiplyAdd(VectorRegister A, VectorRegister B, VectorRegister C) { return VectorAdd(VectorMultiply(A, B), C); }
+inline VectorRegister VectorNegate(VectorRegister V) { return { { -V.V[0], -V.V[1], -V.V[2], -V.V[3] } }; }
+inline VectorRegister VectorAbs(VectorRegister V) { return { { fabsf(V.V[0]), fabsf(V.V[1]), fabsf(V.V[2]), fabsf(V.V[3]) } }; }
+inline VectorRegister VectorSqrt(VectorRegister V) { return { { sqrtf(V.V[0]), sqrtf(V.V[1]), sqrtf(V.V[2]), sqrtf(V.V[3]) } }; }
+inline VectorRegister VectorDot3(VectorRegister A, VectorRegister B) { return VectorSplat(A.V[0] * B.V[0] + A.V[1] * B.V[1] + A.V[2] * B.V[2]); }
+inline VectorRegister VectorDot4(VectorRegister A, VectorRegister B) { return VectorSplat(A.V[0] * B.V[0] + A.V[1] * B.V[1] + A.V[2] * B.V[2] + A.V[3] * B.V[3]); }
+inline uint32_t VectorMaskLessThan(VectorRegister A, VectorRegister B)
+{
+	uint32_t Mask = 0;
+	for (int i = 0; i < 4; ++i)
+		Mask |= A.V[i] < B.V[i] ? 1u << i : 0u;
+	return Mask;
+}
+
+#endif
+
+// (A.yzx * B.zxy - A.zxy * B.yzx), W is 0
+inline VectorRegister VectorCross(VectorRegister A, VectorRegister B)
+{
+	VectorRegister A1 = VectorSwizzle<1, 2, 0, 3>(A);
+	VectorRegister B1 = VectorSwizzle<2, 0, 1, 3>(B);
+	VectorRegister A2 = VectorSwizzle<2, 0, 1, 3>(A);
+	VectorRegister B2 = VectorSwizzle<1, 2, 0, 3>(B);
+	return VectorSubtract(VectorMultiply(A1, B1), VectorMultiply(A2, B2));
+}
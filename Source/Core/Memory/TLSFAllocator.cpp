@@ -0,0 +1,268 @@
+#include "TLSFAllocator.h"
+#include <assert.h>
+#include <algorithm>
+
+// index of the highest set bit, Value must not be 0
+static uint32_t HighestBit(uint64_t Value)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanReverse64(&Index, Value);
+	return (uint32_t)Index;
+#else
+	return 63 - (uint32_t)__builtin_clzll(Value);
+#endif
+}
+
+static uint32_t LowestBit(uint64_t Value)
+{
+#if defined(_MSC_VER)
+	unsigned long Index;
+	_BitScanForward64(&Index, Value);
+	return (uint32_t)Index;
+#else
+	return (uint32_t)__builtin_ctzll(Value);
+#endif
+}
+
+FTLSFAllocator::FTLSFAllocator(uint64_t InSize)
+{
+	Reset(InSize);
+}
+
+void FTLSFAllocator::Reset(uint64_t InSize)
+{
+	Size = InSize;
+	FreeSize = 0;
+	AllocationCount = 0;
+	FreeBlockCount = 0;
+	Nodes.clear();
+	UnusedNodes.clear();
+	FirstNode = INVALID_NODE;
+	FLBitmap = 0;
+	for (uint32_t FL = 0; FL < FL_COUNT; ++FL)
+	{
+		SLBitmap[FL] = 0;
+		for (uint32_t SL = 0; SL < SL_COUNT; ++SL)
+			FreeLists[FL][SL] = INVALID_NODE;
+	}
+
+	if (Size > 0)
+	{
+		uint32_t Node = NewNode();
+		Nodes[Node].Offset = 0;
+		Nodes[Node].Size = Size;
+		FirstNode = Node;
+		InsertFree(Node);
+	}
+}
+
+void FTLSFAllocator::MapSize(uint64_t Size, uint32_t& OutFL, uint32_t& OutSL)
+{
+	if (Size < SL_COUNT)
+	{
+		// small sizes get one exact list each
+		OutFL = 0;
+		OutSL = (uint32_t)Size;
+	}
+	else
+	{
+		uint32_t Log2 = HighestBit(Size);
+		OutFL = Log2 - SL_BITS + 1;
+		OutSL = (uint32_t)(Size >> (Log2 - SL_BITS)) - SL_COUNT;
+	}
+}
+
+uint32_t FTLSFAllocator::FindFreeNode(uint64_t Size) const
+{
+	// round up to the next size class, so every block in the list found is big enough
+	if (Size >= SL_COUNT)
+	{
+		uint64_t Round = (1ull << (HighestBit(Size) - SL_BITS)) - 1;
+		if (Size > ~0ull - Round)
+			return INVALID_NODE;
+		Size += Round;
+	}
+	uint32_t FL, SL;
+	MapSize(Size, FL, SL);
+
+	uint32_t SLMap = SLBitmap[FL] & (~0u << SL);
+	if (SLMap == 0)
+	{
+		uint64_t FLMap = FL + 1 < 64 ? FLBitmap & (~0ull << (FL + 1)) : 0;
+		if (FLMap == 0)
+			return INVALID_NODE;
+		FL = LowestBit(FLMap);
+		SLMap = SLBitmap[FL];
+	}
+	SL = LowestBit(SLMap);
+	return FreeLists[FL][SL];
+}
+
+void FTLSFAllocator::InsertFree(uint32_t Node)
+{
+	FNode& Block = Nodes[Node];
+	uint32_t FL, SL;
+	MapSize(Block.Size, FL, SL);
+	Block.IsFree = true;
+	Block.PrevFree = INVALID_NODE;
+	Block.NextFree = FreeLists[FL][SL];
+	if (Block.NextFree != INVALID_NODE)
+		Nodes[Block.NextFree].PrevFree = Node;
+	FreeLists[FL][SL] = Node;
+	SLBitmap[FL] |= 1u << SL;
+	FLBitmap |= 1ull << FL;
+	FreeSize += Block.Size;
+	++FreeBlockCount;
+}
+
+void FTLSFAllocator::RemoveFree(uint32_t Node)
+{
+	FNode& Block = Nodes[Node];
+	uint32_t FL, SL;
+	MapSize(Block.Size, FL, SL);
+	if (Block.PrevFree != INVALID_NODE)
+		Nodes[Block.PrevFree].NextFree = Block.NextFree;
+	else
+		FreeLists[FL][SL] = Block.NextFree;
+	if (Block.NextFree != INVALID_NODE)
+		Nodes[Block.NextFree].PrevFree = Block.PrevFree;
+	if (FreeLists[FL][SL] == INVALID_NODE)
+	{
+		SLBitmap[FL] &= ~(1u << SL);
+		if (SLBitmap[FL] == 0)
+			FLBitmap &= ~(1ull << FL);
+	}
+	Block.IsFree = false;
+	FreeSize -= Block.Size;
+	--FreeBlockCount;
+}
+
+uint32_t FTLSFAllocator::NewNode()
+{
+	uint32_t Node;
+	if (!UnusedNodes.empty())
+	{
+		Node = UnusedNodes.back();
+		UnusedNodes.pop_back();
+	}
+	else
+	{
+		Node = (uint32_t)Nodes.size();
+		Nodes.emplace_back();
+	}
+	Nodes[Node] = { 0, 0, INVALID_NODE, INVALID_NODE, INVALID_NODE, INVALID_NODE, false };
+	return Node;
+}
+
+void FTLSFAllocator::DeleteNode(uint32_t Node)
+{
+	UnusedNodes.push_back(Node);
+}
+
+bool FTLSFAllocator::Allocate(uint64_t AllocSize, uint64_t Alignment, FAllocation& OutAllocation)
+{
+	assert(Alignment > 0 && (Alignment & (Alignment - 1)) == 0);
+	AllocSize = std::max<uint64_t>(AllocSize, 1);
+
+	// the first fit for the plain size usually happens to be aligned, only pay for the padding if not
+	uint32_t Node = FindFreeNode(AllocSize);
+	if (Node == INVALID_NODE ||
+		((Nodes[Node].Offset + Alignment - 1) & ~(Alignment - 1)) + AllocSize > Nodes[Node].Offset + Nodes[Node].Size)
+	{
+		Node = FindFreeNode(AllocSize + Alignment - 1);
+		if (Node == INVALID_NODE)
+			return false;
+	}
+	RemoveFree(Node);
+
+	uint64_t AlignedOffset = (Nodes[Node].Offset + Alignment - 1) & ~(Alignment - 1);
+	uint64_t Padding = AlignedOffset - Nodes[Node].Offset;
+	if (Padding > 0)
+	{
+		// the previous block is in use (free neighbours are always merged), so the padding stays on its own
+		uint32_t PaddingNode = NewNode();
+		FNode& Block = Nodes[Node];
+		FNode& PaddingBlock = Nodes[PaddingNode];
+		PaddingBlock.Offset = Block.Offset;
+		PaddingBlock.Size = Padding;
+		PaddingBlock.PrevPhysical = Block.PrevPhysical;
+		PaddingBlock.NextPhysical = Node;
+		if (Block.PrevPhysical != INVALID_NODE)
+			Nodes[Block.PrevPhysical].NextPhysical = PaddingNode;
+		else
+			FirstNode = PaddingNode;
+		Block.PrevPhysical = PaddingNode;
+		Block.Offset = AlignedOffset;
+		Block.Size -= Padding;
+		InsertFree(PaddingNode);
+	}
+
+	if (Nodes[Node].Size > AllocSize)
+	{
+		uint32_t RestNode = NewNode();
+		FNode& Block = Nodes[Node];
+		FNode& RestBlock = Nodes[RestNode];
+		RestBlock.Offset = Block.Offset + AllocSize;
+		RestBlock.Size = Block.Size - AllocSize;
+		RestBlock.PrevPhysical = Node;
+		RestBlock.NextPhysical = Block.NextPhysical;
+		if (Block.NextPhysical != INVALID_NODE)
+			Nodes[Block.NextPhysical].PrevPhysical = RestNode;
+		Block.NextPhysical = RestNode;
+		Block.Size = AllocSize;
+		InsertFree(RestNode);
+	}
+
+	++AllocationCount;
+	OutAllocation.Offset = Nodes[Node].Offset;
+	OutAllocation.Size = Nodes[Node].Size;
+	OutAllocation.Node = Node;
+	return true;
+}
+
+void FTLSFAllocator::Free(uint32_t Node)
+{
+	assert(Node < Nodes.size() && !Nodes[Node].IsFree);
+	--AllocationCount;
+
+	uint32_t Prev = Nodes[Node].PrevPhysical;
+	if (Prev != INVALID_NODE && Nodes[Prev].IsFree)
+	{
+		RemoveFree(Prev);
+		Nodes[Prev].Size += Nodes[Node].Size;
+		Nodes[Prev].NextPhysical = Nodes[Node].NextPhysical;
+		if (Nodes[Node].NextPhysical != INVALID_NODE)
+			Nodes[Nodes[Node].NextPhysical].PrevPhysical = Prev;
+		DeleteNode(Node);
+		Node = Prev;
+	}
+
+	uint32_t Next = Nodes[Node].NextPhysical;
+	if (Next != INVALID_NODE && Nodes[Next].IsFree)
+	{
+		RemoveFree(Next);
+		Nodes[Node].Size += Nodes[Next].Size;
+		Nodes[Node].NextPhysical = Nodes[Next].NextPhysical;
+		if (Nodes[Next].NextPhysical != INVALID_NODE)
+			Nodes[Nodes[Next].NextPhysical].PrevPhysical = Node;
+		DeleteNode(Next);
+	}
+
+	InsertFree(Node);
+}
+
+uint64_t FTLSFAllocator::GetLargestFreeBlock() const
+{
+	if (FLBitmap == 0)
+		return 0;
+	// the largest block is in the highest non-empty list, which is not sorted
+	uint32_t FL = HighestBit(FLBitmap);
+	uint32_t SL = HighestBit(SLBitmap[FL]);
+	uint64_t Largest = 0;
+	for (uint32_t Node = FreeLists[FL][SL]; Node != INVALID_NODE; Node = Nodes[Node].NextFree)
+	{
+		Largest = std::max(Largest, Nodes[Node].Size);
+	}
+	return Largest;
+}
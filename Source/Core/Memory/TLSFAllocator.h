@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+// Two-level segregated fit allocator over an abstract range [0, Size). It hands out offsets only,
+// the memory itself lives elsewhere (a VkDeviceMemory block, a mapped buffer...), so the same
+// allocator serves every kind of heap and runs without a GPU.
+// Allocate and Free are O(1): free blocks are binned by size class in a two-level table with
+// bitmaps, and a freed block is merged with its free neighbours right away.
+class FTLSFAllocator
+{
+public:
+	static const uint32_t INVALID_NODE = ~0u;
+
+	struct FAllocation
+	{
+		uint64_t Offset = 0;
+		uint64_t Size = 0;
+		// pass back to Free
+		uint32_t Node = INVALID_NODE;
+	};
+
+	explicit FTLSFAllocator(uint64_t InSize = 0);
+	void Reset(uint64_t InSize);
+
+	// Alignment must be a power of two. Returns false when no free block fits.
+	bool Allocate(uint64_t Size, uint64_t Alignment, FAllocation& OutAllocation);
+	void Free(uint32_t Node);
+
+	uint64_t GetSize() const { return Size; }
+	uint64_t GetFreeSize() const { return FreeSize; }
+	uint64_t GetLargestFreeBlock() const;
+	uint32_t NumAllocations() const { return AllocationCount; }
+	uint32_t NumFreeBlocks() const { return FreeBlockCount; }
+
+	// Calls Visitor(Offset, Size, Node) for every allocation in address order.
+	template<typename VisitorType>
+	void ForEachAllocation(VisitorType&& Visitor) const
+	{
+		for (uint32_t Node = FirstNode; Node != INVALID_NODE; Node = Nodes[Node].NextPhysical)
+		{
+			if (!Nodes[Node].IsFree)
+				Visitor(Nodes[Node].Offset, Nodes[Node].Size, Node);
+		}
+	}
+
+private:
+	// 2^SL_BITS second level lists per first level (power of two) size class
+	static const uint32_t SL_BITS = 5;
+	static const uint32_t SL_COUNT = 1u << SL_BITS;
+	static const uint32_t FL_COUNT = 64 - SL_BITS + 1;
+
+	struct FNode
+	{
+		uint64_t Offset;
+		uint64_t Size;
+		// neighbours in address order
+		uint32_t PrevPhysical;
+		uint32_t NextPhysical;
+		// neighbours in the free list of the node's size class
+		uint32_t PrevFree;
+		uint32_t NextFree;
+		bool IsFree;
+	};
+
+	static void MapSize(uint64_t Size, uint32_t& OutFL, uint32_t& OutSL);
+	uint32_t FindFreeNode(uint64_t Size) const;
+	void InsertFree(uint32_t Node);
+	void RemoveFree(uint32_t Node);
+	uint32_t NewNode();
+	void DeleteNode(uint32_t Node);
+
+	uint64_t Size = 0;
+	uint64_t FreeSize = 0;
+	uint32_t AllocationCount = 0;
+	uint32_t FreeBlockCount = 0;
+
+	std::vector<FNode> Nodes;
+	std::vector<uint32_t> UnusedNodes;
+	uint32_t FirstNode = INVALID_NODE;
+
+	uint64_t FLBitmap = 0;
+	uint32_t SLBitmap[FL_COUNT] = {};
+	uint32_t FreeLists[FL_COUNT][SL_COUNT];
+};
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <assert.h>
+
+// Like assert, but the expression is still evaluated when asserts are compiled out.
+// Use it for calls with side effects, e.g. verify(vkCreateFence(...) == VK_SUCCESS).
+#ifdef NDEBUG
+	#define verify(expr) ((void)(expr))
+#else
+	#define verify(expr) assert(expr)
+#endif
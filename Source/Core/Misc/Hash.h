@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 64-bit FNV-1a. Not cryptographic; good enough for cache keys and content checksums.
+inline uint64_t HashBytes(const void* Data, size_t Size, uint64_t Seed = 14695981039346656037ull)
+{
+	const uint8_t* Bytes = (const uint8_t*)Data;
+	uint64_t Hash = Seed;
+	for (size_t i = 0; i < Size; ++i)
+	{
+		Hash ^= Bytes[i];
+		Hash *= 1099511628211ull;
+	}
+	return Hash;
+}
+
+inline uint64_t HashCombine(uint64_t Hash, uint64_t Value)
+{
+	return Hash ^ (Value + 0x9e3779b97f4a7c15ull + (Hash << 6) + (Hash >> 2));
+}
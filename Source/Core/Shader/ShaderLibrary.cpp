@@ -0,0 +1,127 @@
+#include "ShaderLibrary.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/Hash.h"
+#include <string.h>
+#include <algorithm>
+
+void FShaderLibrary::BeginLoad(const char* Filename)
+{
+	Unload();
+	PendingFilename = Filename;
+	Request = FAsyncIO::Get().Read(Filename, 0, FAsyncIO::READ_TO_END, nullptr, EIOPriority::Low);
+}
+
+bool FShaderLibrary::FinishLoad()
+{
+	if (Request == nullptr)
+	{
+		return IsLoaded();
+	}
+	// needed now, ahead of whatever else is queued
+	FAsyncIO::Get().SetPriority(Request, EIOPriority::Critical);
+	FAsyncIO::Get().Wait(Request);
+	if (Request->GetStatus() != EIORequestStatus::Completed || !Parse(Request->GetData(), Request->GetSize(), PendingFilename.c_str()))
+	{
+		Request.reset();
+		return false;
+	}
+	return true;
+}
+
+bool FShaderLibrary::Parse(const char* InData, uint64_t FileSize, const char* Filename)
+{
+	const FShaderLibraryHeader* NewHeader = (const FShaderLibraryHeader*)InData;
+	if (FileSize < sizeof(FShaderLibraryHeader) || NewHeader->Magic != FShaderLibraryHeader::MAGIC || NewHeader->Version != FShaderLibraryHeader::VERSION)
+	{
+		FPlatformMisc::LocalPrintf("Invalid shader library: %s", Filename);
+		return false;
+	}
+	uint64_t TableSize = sizeof(FShaderLibraryHeader) + (uint64_t)NewHeader->NumNames * sizeof(FShaderLibraryName) +
+		(uint64_t)NewHeader->NumModules * sizeof(FShaderLibraryModule) + (uint64_t)NewHeader->NumBindings * sizeof(FShaderBinding) +
+		(uint64_t)NewHeader->NumVertexInputs * sizeof(FShaderVertexInput) + NewHeader->StringsSize;
+	if (TableSize > FileSize)
+	{
+		FPlatformMisc::LocalPrintf("Invalid shader library: %s", Filename);
+		return false;
+	}
+	Names = (const FShaderLibraryName*)(NewHeader + 1);
+	Modules = (const FShaderLibraryModule*)(Names + NewHeader->NumNames);
+	Bindings = (const FShaderBinding*)(Modules + NewHeader->NumModules);
+	VertexInputs = (const FShaderVertexInput*)(Bindings + NewHeader->NumBindings);
+	Strings = (const char*)(VertexInputs + NewHeader->NumVertexInputs);
+
+	// checked once here so lookups can trust the tables
+	bool Valid = true;
+	for (uint32_t i = 0; i < NewHeader->NumNames && Valid; ++i)
+	{
+		Valid = Names[i].Module < NewHeader->NumModules && (uint64_t)Names[i].NameOffset + Names[i].NameLength <= NewHeader->StringsSize;
+	}
+	for (uint32_t i = 0; i < NewHeader->NumModules && Valid; ++i)
+	{
+		const FShaderLibraryModule& Module = Modules[i];
+		Valid = Module.CodeOffset % 4 == 0 && Module.CodeOffset <= FileSize && Module.CodeSize <= FileSize - Module.CodeOffset &&
+			(uint64_t)Module.FirstBinding + Module.NumBindings <= NewHeader->NumBindings &&
+			(uint64_t)Module.FirstVertexInput + Module.NumVertexInputs <= NewHeader->NumVertexInputs &&
+			(uint64_t)Module.EntryPointOffset + Module.EntryPointLength <= NewHeader->StringsSize;
+	}
+	if (!Valid)
+	{
+		FPlatformMisc::LocalPrintf("Invalid shader library: %s", Filename);
+		return false;
+	}
+	Data = InData;
+	Header = NewHeader;
+	FPlatformMisc::LocalPrintf("Loaded shader library %s: %u shaders, %u modules", Filename, Header->NumNames, Header->NumModules);
+	return true;
+}
+
+void FShaderLibrary::Unload()
+{
+	if (Request != nullptr)
+	{
+		FAsyncIO::Get().Cancel(Request);
+		Request.reset();
+	}
+	Header = nullptr;
+	Data = nullptr;
+}
+
+const FShaderLibraryModule* FShaderLibrary::FindShader(const char* Name) const
+{
+	if (Header == nullptr)
+	{
+		return nullptr;
+	}
+	size_t NameLength = strlen(Name);
+	uint64_t NameHash = HashBytes(Name, NameLength);
+	const FShaderLibraryName* End = Names + Header->NumNames;
+	const FShaderLibraryName* It = std::lower_bound(Names, End, NameHash, [](const FShaderLibraryName& Entry, uint64_t Hash) { return Entry.NameHash < Hash; });
+	for (; It != End && It->NameHash == NameHash; ++It)
+	{
+		if (It->NameLength == NameLength && memcmp(Strings + It->NameOffset, Name, NameLength) == 0)
+		{
+			return &Modules[It->Module];
+		}
+	}
+	return nullptr;
+}
+
+const FShaderLibraryModule* FShaderLibrary::FindModule(uint64_t ContentHash) const
+{
+	if (Header == nullptr)
+	{
+		return nullptr;
+	}
+	const FShaderLibraryModule* End = Modules + Header->NumModules;
+	const FShaderLibraryModule* It = std::lower_bound(Modules, End, ContentHash, [](const FShaderLibraryModule& Module, uint64_t Hash) { return Module.ContentHash < Hash; });
+	return It != End && It->ContentHash == ContentHash ? It : nullptr;
+}
+
+void FShaderLibrary::GetReflection(const FShaderLibraryModule& Module, FShaderReflection& OutReflection) const
+{
+	OutReflection.Stage = Module.Stage;
+	OutReflection.EntryPoint.assign(Strings + Module.EntryPointOffset, Module.EntryPointLength);
+	OutReflection.PushConstantSize = Module.PushConstantSize;
+	OutReflection.Bindings.assign(Bindings + Module.FirstBinding, Bindings + Module.FirstBinding + Module.NumBindings);
+	OutReflection.VertexInputs.assign(VertexInputs + Module.FirstVertexInput, VertexInputs + Module.FirstVertexInput + Module.NumVertexInputs);
+}
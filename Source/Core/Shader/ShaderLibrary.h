@@ -0,0 +1,95 @@
+#pragma once
+
+#include "Shader/ShaderReflection.h"
+#include "GenericPlatform/GenericPlatformMisc.h"
+#include "IO/AsyncIO.h"
+#include <string>
+
+// Library layout: FShaderLibraryHeader, FShaderLibraryName[NumNames] sorted by name hash,
+// FShaderLibraryModule[NumModules] sorted by content hash, the modules' FShaderBinding and
+// FShaderVertexInput arrays, the strings, then the SPIR-V of every module, 4 byte aligned.
+// Shaders with identical SPIR-V share a module.
+struct FShaderLibraryHeader
+{
+	static const uint32_t MAGIC = 0x4C485354; // "TSHL"
+	static const uint32_t VERSION = 1;
+
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t NumNames;
+	uint32_t NumModules;
+	uint32_t NumBindings;
+	uint32_t NumVertexInputs;
+	uint32_t StringsSize;
+	uint32_t Reserved;
+};
+
+struct FShaderLibraryName
+{
+	// HashBytes of the name
+	uint64_t NameHash;
+	uint32_t NameOffset;
+	uint32_t NameLength;
+	uint32_t Module;
+	uint32_t Reserved;
+};
+
+struct FShaderLibraryModule
+{
+	// HashBytes of the SPIR-V, the key pipeline descriptions refer to shaders by
+	uint64_t ContentHash;
+	uint64_t CodeOffset;
+	uint32_t CodeSize;
+	EShaderStage Stage;
+	uint32_t PushConstantSize;
+	uint32_t FirstBinding;
+	uint32_t NumBindings;
+	uint32_t FirstVertexInput;
+	uint32_t NumVertexInputs;
+	uint32_t EntryPointOffset;
+	uint32_t EntryPointLength;
+	uint32_t Reserved;
+};
+
+static_assert(sizeof(FShaderLibraryHeader) == 32 && sizeof(FShaderLibraryName) == 24 && sizeof(FShaderLibraryModule) == 56,
+	"shader library structures are serialized as is");
+
+// A shader library read with a single FAsyncIO request while the caller does something else.
+// Names are the GLSL file names below Resource/Shaders, e.g. "shader.vert".
+class FShaderLibrary
+{
+public:
+	// Starts reading the library on the I/O thread at low priority, FinishLoad makes it urgent and
+	// waits for it. FAsyncIO must be initialized.
+	void BeginLoad(const char* Filename);
+	bool FinishLoad();
+	// Cancels a read that hasn't started yet.
+	void Unload();
+
+	bool IsLoaded() const { return Header != nullptr; }
+	uint32_t GetNumModules() const { return Header ? Header->NumModules : 0; }
+	uint32_t GetNumNames() const { return Header ? Header->NumNames : 0; }
+
+	// nullptr when unknown
+	const FShaderLibraryModule* FindShader(const char* Name) const;
+	const FShaderLibraryModule* FindModule(uint64_t ContentHash) const;
+
+	// 4 byte aligned, as VkShaderModuleCreateInfo::pCode needs
+	const uint32_t* GetCode(const FShaderLibraryModule& Module) const { return (const uint32_t*)(Data + Module.CodeOffset); }
+	void GetReflection(const FShaderLibraryModule& Module, FShaderReflection& OutReflection) const;
+
+private:
+	// checks the tables and points into them
+	bool Parse(const char* InData, uint64_t FileSize, const char* Filename);
+
+	// owns the bytes read
+	FIORequestHandle Request;
+	std::string PendingFilename;
+	const char* Data = nullptr;
+	const FShaderLibraryHeader* Header = nullptr;
+	const FShaderLibraryName* Names = nullptr;
+	const FShaderLibraryModule* Modules = nullptr;
+	const FShaderBinding* Bindings = nullptr;
+	const FShaderVertexInput* VertexInputs = nullptr;
+	const char* Strings = nullptr;
+};
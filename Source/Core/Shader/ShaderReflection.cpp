@@ -0,0 +1,395 @@
+#include "ShaderReflection.h"
+#include <algorithm>
+#include <string.h>
+
+// the subset of the SPIR-V specification reflection needs
+namespace Spirv
+{
+	static const uint32_t MAGIC = 0x07230203;
+	static const uint32_t HEADER_WORDS = 5;
+	// guards against corrupt headers asking for huge tables
+	static const uint32_t MAX_BOUND = 1 << 22;
+	static const uint32_t INVALID = ~0u;
+
+	enum EOp : uint32_t
+	{
+		OpEntryPoint = 15,
+		OpTypeInt = 21,
+		OpTypeFloat = 22,
+		OpTypeVector = 23,
+		OpTypeMatrix = 24,
+		OpTypeImage = 25,
+		OpTypeSampler = 26,
+		OpTypeSampledImage = 27,
+		OpTypeArray = 28,
+		OpTypeRuntimeArray = 29,
+		OpTypeStruct = 30,
+		OpTypePointer = 32,
+		OpConstant = 43,
+		OpVariable = 59,
+		OpDecorate = 71,
+		OpMemberDecorate = 72,
+	};
+
+	enum EDecoration : uint32_t
+	{
+		DecorationBufferBlock = 3,
+		DecorationArrayStride = 6,
+		DecorationMatrixStride = 7,
+		DecorationBuiltIn = 11,
+		DecorationLocation = 30,
+		DecorationBinding = 33,
+		DecorationDescriptorSet = 34,
+		DecorationOffset = 35,
+	};
+
+	enum EStorageClass : uint32_t
+	{
+		StorageClassUniformConstant = 0,
+		StorageClassInput = 1,
+		StorageClassUniform = 2,
+		StorageClassPushConstant = 9,
+		StorageClassStorageBuffer = 12,
+	};
+
+	enum EDim : uint32_t
+	{
+		DimBuffer = 5,
+		DimSubpassData = 6,
+	};
+}
+
+namespace
+{
+	struct FSpirvId
+	{
+		// the instruction defining the id, nullptr for ids that are not types, constants or variables
+		const uint32_t* Instruction = nullptr;
+		uint32_t NumWords = 0;
+		uint32_t Set = Spirv::INVALID;
+		uint32_t Binding = Spirv::INVALID;
+		uint32_t Location = Spirv::INVALID;
+		uint32_t ArrayStride = 0;
+		bool BuiltIn = false;
+		bool BufferBlock = false;
+		// struct members
+		std::vector<uint32_t> MemberOffsets;
+		std::vector<uint32_t> MemberMatrixStrides;
+		bool MemberBuiltIn = false;
+	};
+
+	struct FSpirvModule
+	{
+		std::vector<FSpirvId> Ids;
+
+		uint32_t Op(uint32_t Id) const
+		{
+			return Id < Ids.size() && Ids[Id].Instruction ? Ids[Id].Instruction[0] & 0xFFFF : 0;
+		}
+
+		// operand Index of the instruction defining Id, 0 when out of range
+		uint32_t Operand(uint32_t Id, uint32_t Index) const
+		{
+			return Id < Ids.size() && Index < Ids[Id].NumWords ? Ids[Id].Instruction[Index] : 0;
+		}
+
+		uint32_t ArrayLength(uint32_t ArrayType) const
+		{
+			uint32_t LengthId = Operand(ArrayType, 3);
+			return Op(LengthId) == Spirv::OpConstant ? Operand(LengthId, 3) : 0;
+		}
+
+		// size of a type in a push constant or buffer block, following the layout decorations
+		uint32_t TypeSize(uint32_t Type, uint32_t MatrixStride, uint32_t Depth) const
+		{
+			if (Depth > 16)
+			{
+				return 0;
+			}
+			switch (Op(Type))
+			{
+			case Spirv::OpTypeInt:
+			case Spirv::OpTypeFloat:
+				return Operand(Type, 2) / 8;
+			case Spirv::OpTypeVector:
+				return Operand(Type, 3) * TypeSize(Operand(Type, 2), 0, Depth + 1);
+			case Spirv::OpTypeMatrix:
+				return Operand(Type, 3) * (MatrixStride ? MatrixStride : TypeSize(Operand(Type, 2), 0, Depth + 1));
+			case Spirv::OpTypeArray:
+			{
+				uint32_t Stride = Ids[Type].ArrayStride ? Ids[Type].ArrayStride : TypeSize(Operand(Type, 2), MatrixStride, Depth + 1);
+				return ArrayLength(Type) * Stride;
+			}
+			case Spirv::OpTypeStruct:
+			{
+				const FSpirvId& Struct = Ids[Type];
+				uint32_t Size = 0;
+				for (uint32_t Member = 0; Member + 2 < Struct.NumWords; ++Member)
+				{
+					uint32_t Offset = Member < Struct.MemberOffsets.size() ? Struct.MemberOffsets[Member] : 0;
+					uint32_t Stride = Member < Struct.MemberMatrixStrides.size() ? Struct.MemberMatrixStrides[Member] : 0;
+					Size = std::max(Size, Offset + TypeSize(Struct.Instruction[2 + Member], Stride, Depth + 1));
+				}
+				return Size;
+			}
+			default:
+				return 0;
+			}
+		}
+	};
+}
+
+static bool ToStage(uint32_t ExecutionModel, EShaderStage& OutStage)
+{
+	static const EShaderStage Stages[] = { EShaderStage::Vertex, EShaderStage::TessellationControl, EShaderStage::TessellationEvaluation,
+		EShaderStage::Geometry, EShaderStage::Fragment, EShaderStage::Compute };
+	if (ExecutionModel >= sizeof(Stages) / sizeof(Stages[0]))
+	{
+		return false;
+	}
+	OutStage = Stages[ExecutionModel];
+	return true;
+}
+
+// VkFormat of a scalar or vector attribute, 0 (VK_FORMAT_UNDEFINED) for anything else
+static uint32_t ToVertexFormat(const FSpirvModule& Module, uint32_t Type)
+{
+	uint32_t NumComponents = 1;
+	if (Module.Op(Type) == Spirv::OpTypeVector)
+	{
+		NumComponents = Module.Operand(Type, 3);
+		Type = Module.Operand(Type, 2);
+	}
+	if (NumComponents < 1 || NumComponents > 4 || Module.Operand(Type, 2) != 32)
+	{
+		return 0;
+	}
+	// VK_FORMAT_R32_UINT, R32_SINT and R32_SFLOAT, each followed by R32G32, R32G32B32 and R32G32B32A32 three apart
+	uint32_t Base;
+	if (Module.Op(Type) == Spirv::OpTypeFloat)
+		Base = 100;
+	else if (Module.Op(Type) == Spirv::OpTypeInt)
+		Base = Module.Operand(Type, 3) ? 99 : 98;
+	else
+		return 0;
+	return Base + (NumComponents - 1) * 3;
+}
+
+static bool ToBindingType(const FSpirvModule& Module, uint32_t Type, uint32_t StorageClass, EShaderBindingType& OutType)
+{
+	switch (Module.Op(Type))
+	{
+	case Spirv::OpTypeSampler:
+		OutType = EShaderBindingType::Sampler;
+		return true;
+	case Spirv::OpTypeSampledImage:
+		OutType = Module.Operand(Module.Operand(Type, 2), 3) == Spirv::DimBuffer ? EShaderBindingType::UniformTexelBuffer : EShaderBindingType::CombinedImageSampler;
+		return true;
+	case Spirv::OpTypeImage:
+	{
+		uint32_t Dim = Module.Operand(Type, 3);
+		// Sampled is 2 for storage images
+		bool Storage = Module.Operand(Type, 7) == 2;
+		if (Dim == Spirv::DimSubpassData)
+			OutType = EShaderBindingType::InputAttachment;
+		else if (Dim == Spirv::DimBuffer)
+			OutType = Storage ? EShaderBindingType::StorageTexelBuffer : EShaderBindingType::UniformTexelBuffer;
+		else
+			OutType = Storage ? EShaderBindingType::StorageImage : EShaderBindingType::SampledImage;
+		return true;
+	}
+	case Spirv::OpTypeStruct:
+		if (StorageClass == Spirv::StorageClassStorageBuffer || Module.Ids[Type].BufferBlock)
+			OutType = EShaderBindingType::StorageBuffer;
+		else
+			OutType = EShaderBindingType::UniformBuffer;
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool ReflectSpirv(const void* Code, size_t Size, FShaderReflection& OutReflection)
+{
+	const uint32_t* Words = (const uint32_t*)Code;
+	size_t NumWords = Size / 4;
+	if (Size % 4 != 0 || NumWords < Spirv::HEADER_WORDS || Words[0] != Spirv::MAGIC || Words[3] > Spirv::MAX_BOUND)
+	{
+		return false;
+	}
+
+	FSpirvModule Module;
+	Module.Ids.resize(Words[3]);
+	bool FoundEntryPoint = false;
+	OutReflection = FShaderReflection();
+	for (size_t Index = Spirv::HEADER_WORDS; Index < NumWords;)
+	{
+		const uint32_t* Instruction = Words + Index;
+		uint32_t InstructionWords = Instruction[0] >> 16;
+		if (InstructionWords == 0 || Index + InstructionWords > NumWords)
+		{
+			return false;
+		}
+		Index += InstructionWords;
+		// operands past the end of the instruction read as 0
+		auto Operand = [&](uint32_t i) { return i < InstructionWords ? Instruction[i] : 0; };
+		uint32_t Op = Instruction[0] & 0xFFFF;
+		uint32_t Result = Spirv::INVALID;
+		switch (Op)
+		{
+		case Spirv::OpEntryPoint:
+			if (!FoundEntryPoint)
+			{
+				if (!ToStage(Operand(1), OutReflection.Stage))
+				{
+					return false;
+				}
+				const char* Name = (const char*)(Instruction + 3);
+				size_t MaxLength = InstructionWords > 3 ? (InstructionWords - 3) * 4 : 0;
+				OutReflection.EntryPoint.assign(Name, strnlen(Name, MaxLength));
+				FoundEntryPoint = true;
+			}
+			break;
+		case Spirv::OpTypeInt:
+		case Spirv::OpTypeFloat:
+		case Spirv::OpTypeVector:
+		case Spirv::OpTypeMatrix:
+		case Spirv::OpTypeImage:
+		case Spirv::OpTypeSampler:
+		case Spirv::OpTypeSampledImage:
+		case Spirv::OpTypeArray:
+		case Spirv::OpTypeRuntimeArray:
+		case Spirv::OpTypeStruct:
+		case Spirv::OpTypePointer:
+			Result = Operand(1);
+			break;
+		case Spirv::OpConstant:
+		case Spirv::OpVariable:
+			Result = Operand(2);
+			break;
+		case Spirv::OpDecorate:
+			if (Operand(1) < Module.Ids.size())
+			{
+				FSpirvId& Target = Module.Ids[Operand(1)];
+				switch (Operand(2))
+				{
+				case Spirv::DecorationBufferBlock: Target.BufferBlock = true; break;
+				case Spirv::DecorationArrayStride: Target.ArrayStride = Operand(3); break;
+				case Spirv::DecorationBuiltIn: Target.BuiltIn = true; break;
+				case Spirv::DecorationLocation: Target.Location = Operand(3); break;
+				case Spirv::DecorationBinding: Target.Binding = Operand(3); break;
+				case Spirv::DecorationDescriptorSet: Target.Set = Operand(3); break;
+				}
+			}
+			break;
+		case Spirv::OpMemberDecorate:
+			if (Operand(1) < Module.Ids.size() && Operand(2) < 4096)
+			{
+				FSpirvId& Struct = Module.Ids[Operand(1)];
+				uint32_t Member = Operand(2);
+				if (Operand(3) == Spirv::DecorationOffset || Operand(3) == Spirv::DecorationMatrixStride)
+				{
+					std::vector<uint32_t>& Values = Operand(3) == Spirv::DecorationOffset ? Struct.MemberOffsets : Struct.MemberMatrixStrides;
+					Values.resize(std::max<size_t>(Values.size(), Member + 1), 0);
+					Values[Member] = Operand(4);
+				}
+				else if (Operand(3) == Spirv::DecorationBuiltIn)
+				{
+					Struct.MemberBuiltIn = true;
+				}
+			}
+			break;
+		}
+		if (Result != Spirv::INVALID)
+		{
+			if (Result >= Module.Ids.size())
+			{
+				return false;
+			}
+			Module.Ids[Result].Instruction = Instruction;
+			Module.Ids[Result].NumWords = InstructionWords;
+		}
+	}
+	if (!FoundEntryPoint)
+	{
+		return false;
+	}
+
+	for (uint32_t Id = 0; Id < Module.Ids.size(); ++Id)
+	{
+		if (Module.Op(Id) != Spirv::OpVariable)
+		{
+			continue;
+		}
+		const FSpirvId& Variable = Module.Ids[Id];
+		uint32_t StorageClass = Module.Operand(Id, 3);
+		uint32_t Type = Module.Operand(Module.Operand(Id, 1), 3);
+		switch (StorageClass)
+		{
+		case Spirv::StorageClassPushConstant:
+			OutReflection.PushConstantSize = std::max(OutReflection.PushConstantSize, Module.TypeSize(Type, 0, 0));
+			break;
+		case Spirv::StorageClassInput:
+		{
+			if (OutReflection.Stage != EShaderStage::Vertex || Variable.BuiltIn || (Type < Module.Ids.size() && Module.Ids[Type].MemberBuiltIn) || Variable.Location == Spirv::INVALID)
+			{
+				break;
+			}
+			// arrays and matrices take one location per element or column
+			uint32_t NumLocations = 1;
+			if (Module.Op(Type) == Spirv::OpTypeArray)
+			{
+				NumLocations = Module.ArrayLength(Type);
+				Type = Module.Operand(Type, 2);
+			}
+			if (Module.Op(Type) == Spirv::OpTypeMatrix)
+			{
+				NumLocations *= Module.Operand(Type, 3);
+				Type = Module.Operand(Type, 2);
+			}
+			uint32_t Format = ToVertexFormat(Module, Type);
+			for (uint32_t i = 0; i < NumLocations; ++i)
+			{
+				OutReflection.VertexInputs.push_back({Variable.Location + i, Format});
+			}
+			break;
+		}
+		case Spirv::StorageClassUniformConstant:
+		case Spirv::StorageClassUniform:
+		case Spirv::StorageClassStorageBuffer:
+		{
+			if (Variable.Set == Spirv::INVALID || Variable.Binding == Spirv::INVALID)
+			{
+				break;
+			}
+			uint32_t Count = 1;
+			for (uint32_t Depth = 0; Depth < 8; ++Depth)
+			{
+				if (Module.Op(Type) == Spirv::OpTypeArray)
+					Count *= Module.ArrayLength(Type);
+				else if (Module.Op(Type) == Spirv::OpTypeRuntimeArray)
+					Count = 0;
+				else
+					break;
+				Type = Module.Operand(Type, 2);
+			}
+			FShaderBinding Binding{Variable.Set, Variable.Binding, Count, EShaderBindingType::UniformBuffer};
+			if (ToBindingType(Module, Type, StorageClass, Binding.Type))
+			{
+				OutReflection.Bindings.push_back(Binding);
+			}
+			break;
+		}
+		}
+	}
+
+	std::sort(OutReflection.Bindings.begin(), OutReflection.Bindings.end(), [](const FShaderBinding& A, const FShaderBinding& B)
+	{
+		return A.Set != B.Set ? A.Set < B.Set : A.Binding < B.Binding;
+	});
+	std::sort(OutReflection.VertexInputs.begin(), OutReflection.VertexInputs.end(), [](const FShaderVertexInput& A, const FShaderVertexInput& B)
+	{
+		return A.Location < B.Location;
+	});
+	return true;
+}
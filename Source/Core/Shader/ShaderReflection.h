@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+// Values match VkShaderStageFlagBits.
+enum class EShaderStage : uint32_t
+{
+	Vertex = 0x1,
+	TessellationControl = 0x2,
+	TessellationEvaluation = 0x4,
+	Geometry = 0x8,
+	Fragment = 0x10,
+	Compute = 0x20,
+};
+
+// Values match VkDescriptorType.
+enum class EShaderBindingType : uint32_t
+{
+	Sampler = 0,
+	CombinedImageSampler = 1,
+	SampledImage = 2,
+	StorageImage = 3,
+	UniformTexelBuffer = 4,
+	StorageTexelBuffer = 5,
+	UniformBuffer = 6,
+	StorageBuffer = 7,
+	InputAttachment = 10,
+};
+
+struct FShaderBinding
+{
+	uint32_t Set;
+	uint32_t Binding;
+	// array size, 0 for runtime sized arrays
+	uint32_t Count;
+	EShaderBindingType Type;
+};
+
+struct FShaderVertexInput
+{
+	uint32_t Location;
+	// VkFormat of one location, matrices take one location per column
+	uint32_t Format;
+};
+
+struct FShaderReflection
+{
+	EShaderStage Stage = EShaderStage::Vertex;
+	std::string EntryPoint;
+	// bytes of the push constant block, 0 without one
+	uint32_t PushConstantSize = 0;
+	// sorted by set and binding
+	std::vector<FShaderBinding> Bindings;
+	// vertex shaders only, sorted by location
+	std::vector<FShaderVertexInput> VertexInputs;
+};
+
+// Reads the resources of a SPIR-V module's first entry point. False for invalid modules.
+bool ReflectSpirv(const void* Code, size_t Size, FShaderReflection& OutReflection);
@@ -0,0 +1,173 @@
+#include "Profiler.h"
+#include <stdio.h>
+#include <algorithm>
+
+// the calling thread's track, created on its first event
+static thread_local FProfilerTrack* GThreadTrack = nullptr;
+
+FProfiler& FProfiler::Get()
+{
+	static FProfiler Profiler;
+	return Profiler;
+}
+
+void FProfiler::SetEnabled(bool InEnabled)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	if (InEnabled && StartTime == 0.0)
+	{
+		StartTime = FPlatformMisc::Seconds();
+	}
+	Enabled.store(InEnabled, std::memory_order_relaxed);
+}
+
+const char* FProfiler::InternName(const std::string& Name)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	// elements of an unordered_set never move
+	return Names.insert(Name).first->c_str();
+}
+
+FProfilerTrack* FProfiler::AddTrack(const std::string& Name, bool IsGpu)
+{
+	FProfilerTrack* Track = new FProfilerTrack;
+	Track->Name = Name;
+	Track->IsGpu = IsGpu;
+	std::lock_guard<std::mutex> Lock(Mutex);
+	Tracks.push_back(Track);
+	return Track;
+}
+
+FProfilerTrack* FProfiler::GetThreadTrack()
+{
+	if (GThreadTrack == nullptr)
+	{
+		uint32_t NumTracks;
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			NumTracks = (uint32_t)Tracks.size();
+		}
+		GThreadTrack = AddTrack("Thread " + std::to_string(NumTracks), false);
+	}
+	return GThreadTrack;
+}
+
+void FProfiler::SetThreadName(const char* Name)
+{
+	FProfilerTrack* Track = GetThreadTrack();
+	std::lock_guard<std::mutex> Lock(Track->Mutex);
+	Track->Name = Name;
+}
+
+void FProfiler::Shutdown()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	Enabled.store(false, std::memory_order_relaxed);
+	for (FProfilerTrack* Track : Tracks)
+	{
+		delete Track;
+	}
+	Tracks.clear();
+	// the other threads have ended, or never record again
+	GThreadTrack = nullptr;
+}
+
+void FProfiler::AddEvent(FProfilerTrack& Track, const char* Name, double Start, double End)
+{
+	std::lock_guard<std::mutex> Lock(Track.Mutex);
+	if (Track.Events.size() >= MAX_EVENTS_PER_TRACK)
+	{
+		++Track.NumDropped;
+		return;
+	}
+	Track.Events.push_back({Name, Start, End});
+}
+
+void FProfiler::AddCpuEvent(const char* Name, double Start, double End)
+{
+	AddEvent(*GetThreadTrack(), Name, Start, End);
+}
+
+uint32_t FProfiler::RegisterGpuTrack(const char* Name)
+{
+	FProfilerTrack* Track = AddTrack(Name, true);
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return (uint32_t)(std::find(Tracks.begin(), Tracks.end(), Track) - Tracks.begin());
+}
+
+void FProfiler::AddGpuEvent(uint32_t Track, const char* Name, double Start, double End)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+	FProfilerTrack* GpuTrack;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		GpuTrack = Tracks[Track];
+	}
+	AddEvent(*GpuTrack, Name, Start, End);
+}
+
+static void AppendEscaped(std::string& Out, const char* Str)
+{
+	for (; *Str; ++Str)
+	{
+		if (*Str == '"' || *Str == '\\')
+		{
+			Out += '\\';
+		}
+		Out += (unsigned char)*Str < 0x20 ? ' ' : *Str;
+	}
+}
+
+bool FProfiler::WriteChromeTrace(const char* Filename)
+{
+	std::vector<FProfilerTrack*> TracksCopy;
+	{
+		std::lock_guard<std::mutex> Lock(Mutex);
+		TracksCopy = Tracks;
+	}
+
+	// CPU threads and GPU queues are two processes, so the viewer groups them
+	const int CPU_PID = 1;
+	const int GPU_PID = 2;
+	std::string Json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	char Buffer[256];
+	snprintf(Buffer, sizeof(Buffer), "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"CPU\"}},\n"
+		"{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%d,\"args\":{\"name\":\"GPU\"}}", CPU_PID, GPU_PID);
+	Json += Buffer;
+
+	uint64_t NumEvents = 0;
+	uint64_t NumDropped = 0;
+	for (uint32_t TrackIndex = 0; TrackIndex < TracksCopy.size(); ++TrackIndex)
+	{
+		FProfilerTrack& Track = *TracksCopy[TrackIndex];
+		std::lock_guard<std::mutex> Lock(Track.Mutex);
+		int Pid = Track.IsGpu ? GPU_PID : CPU_PID;
+		snprintf(Buffer, sizeof(Buffer), ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"", Pid, TrackIndex);
+		Json += Buffer;
+		AppendEscaped(Json, Track.Name.c_str());
+		Json += "\"}}";
+		for (const FProfilerEvent& Event : Track.Events)
+		{
+			Json += ",\n{\"ph\":\"X\",\"name\":\"";
+			AppendEscaped(Json, Event.Name);
+			// microseconds since the profiler was enabled
+			snprintf(Buffer, sizeof(Buffer), "\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", Pid, TrackIndex,
+				(Event.Start - StartTime) * 1e6, (Event.End - Event.Start) * 1e6);
+			Json += Buffer;
+		}
+		NumEvents += Track.Events.size();
+		NumDropped += Track.NumDropped;
+	}
+	Json += "\n]}\n";
+
+	if (!FPlatformMisc::WriteSavedFile(Filename, Json.data(), Json.size()))
+	{
+		return false;
+	}
+	FPlatformMisc::LocalPrintf("Trace written to %s%s: %d events on %d tracks, %d dropped", FPlatformMisc::SavedDir().c_str(), Filename,
+		(int)NumEvents, (int)TracksCopy.size(), (int)NumDropped);
+	return true;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <unordered_set>
+#include <stdint.h>
+#include "HAL/PlatformMisc.h"
+
+// Compiles the profiling macros out entirely when 0.
+#ifndef ENABLE_PROFILER
+	#define ENABLE_PROFILER 1
+#endif
+
+struct FProfilerEvent
+{
+	const char* Name;
+	// FPlatformMisc::Seconds
+	double Start;
+	double End;
+};
+
+// A timeline in the trace: a CPU thread or a GPU queue.
+struct FProfilerTrack
+{
+	std::string Name;
+	bool IsGpu;
+	std::mutex Mutex;
+	std::vector<FProfilerEvent> Events;
+	uint64_t NumDropped = 0;
+};
+
+// Collects timed events from any thread and from GPU queues, and writes them as a Chrome trace
+// (chrome://tracing, ui.perfetto.dev) with CPU threads and GPU queues on one timeline.
+// Threads append to their own track, so recording only contends with WriteChromeTrace. While the
+// profiler is disabled a scoped event costs one relaxed load.
+class FProfiler
+{
+public:
+	// events kept per track, later ones are dropped
+	static const uint32_t MAX_EVENTS_PER_TRACK = 1 << 20;
+
+	static FProfiler& Get();
+
+	void SetEnabled(bool InEnabled);
+	bool IsEnabled() const { return Enabled.load(std::memory_order_relaxed); }
+
+	// Event names are stored as pointers and must stay valid until the trace was written: use
+	// string literals, or intern names that are built at runtime.
+	const char* InternName(const std::string& Name);
+
+	// Names the calling thread's track.
+	void SetThreadName(const char* Name);
+	void AddCpuEvent(const char* Name, double Start, double End);
+
+	// GPU timelines, their events are converted to FPlatformMisc::Seconds by the caller.
+	uint32_t RegisterGpuTrack(const char* Name);
+	void AddGpuEvent(uint32_t Track, const char* Name, double Start, double End);
+
+	// Writes all events recorded so far to SavedDir(). Returns false on I/O errors.
+	bool WriteChromeTrace(const char* Filename);
+	// Disables the profiler and frees all tracks, once no other thread records events anymore.
+	void Shutdown();
+
+private:
+	FProfilerTrack* GetThreadTrack();
+	FProfilerTrack* AddTrack(const std::string& Name, bool IsGpu);
+	static void AddEvent(FProfilerTrack& Track, const char* Name, double Start, double End);
+
+	std::atomic<bool> Enabled{false};
+	double StartTime = 0.0;
+	std::mutex Mutex;
+	// only shrinks in Shutdown, threads hold on to their track
+	std::vector<FProfilerTrack*> Tracks;
+	std::unordered_set<std::string> Names;
+};
+
+// Times the enclosing scope on the calling thread's track.
+class FScopedCpuEvent
+{
+public:
+	explicit FScopedCpuEvent(const char* InName)
+		: Name(FProfiler::Get().IsEnabled() ? InName : nullptr)
+		, Start(Name ? FPlatformMisc::Seconds() : 0.0)
+	{
+	}
+
+	~FScopedCpuEvent()
+	{
+		if (Name)
+		{
+			FProfiler::Get().AddCpuEvent(Name, Start, FPlatformMisc::Seconds());
+		}
+	}
+
+private:
+	// null when the profiler was disabled at the start of the scope
+	const char* Name;
+	double Start;
+};
+
+#if ENABLE_PROFILER
+	#define PROFILER_JOIN_INNER(A, B) A##B
+	#define PROFILER_JOIN(A, B) PROFILER_JOIN_INNER(A, B)
+	#define SCOPED_CPU_EVENT(Name) FScopedCpuEvent PROFILER_JOIN(ScopedCpuEvent, __LINE__)(Name)
+#else
+	#define SCOPED_CPU_EVENT(Name)
+#endif
@@ -0,0 +1,37 @@
+#include "StatSamples.h"
+#include "HAL/PlatformMisc.h"
+#include <algorithm>
+#include <math.h>
+
+
+double FStatSamples::Average() const
+{
+	if (Samples.empty())
+		return 0.0;
+	double Sum = 0.0;
+	for (double Value : Samples)
+		Sum += Value;
+	return Sum / (double)Samples.size();
+}
+
+double FStatSamples::Percentile(double P) const
+{
+	if (Samples.empty())
+		return 0.0;
+	std::vector<double> Sorted = Samples;
+	size_t Rank = (size_t)ceil(P / 100.0 * (double)Sorted.size());
+	Rank = std::min(std::max(Rank, (size_t)1), Sorted.size()) - 1;
+	std::nth_element(Sorted.begin(), Sorted.begin() + Rank, Sorted.end());
+	return Sorted[Rank];
+}
+
+void FStatSamples::Report() const
+{
+	if (Samples.empty())
+	{
+		FPlatformMisc::LocalPrintf("%-16s no samples", Name);
+		return;
+	}
+	FPlatformMisc::LocalPrintf("%-16s avg %8.3f  p50 %8.3f  p90 %8.3f  p99 %8.3f  max %8.3f ms (%zu samples)",
+		Name, Average(), Percentile(50), Percentile(90), Percentile(99), Percentile(100), Samples.size());
+}
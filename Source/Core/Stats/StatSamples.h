@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+
+// Collects raw timing samples (in milliseconds) and reports percentiles over them.
+struct FStatSamples
+{
+	explicit FStatSamples(const char* InName) : Name(InName) {}
+
+	void Add(double Value) { Samples.push_back(Value); }
+
+	void Reset() { Samples.clear(); }
+
+	size_t Num() const { return Samples.size(); }
+
+	double Average() const;
+
+	// Percentile in [0, 100], nearest-rank.
+	double Percentile(double P) const;
+
+	// Prints "Name: avg p50 p90 p99 max" through FPlatformMisc::LocalPrintf.
+	void Report() const;
+
+	const char* Name;
+	std::vector<double> Samples;
+};
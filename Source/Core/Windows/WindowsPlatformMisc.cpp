@@ -1,5 +1,7 @@
 #include "WindowsPlatformMisc.h"
+#include "Logging/Logging.h"
 #include <Windows.h>
+#include <stdio.h>
 
 
 void FWindowsPlatformMisc::PlatformInit()
@@ -15,4 +17,127 @@ void FWindowsPlatformMisc::PumpMessages()
 		::TranslateMessage(&msg);
 		::DispatchMessage(&msg);
 	}
-}
\ No newline at end of file
+}
+
+// Windows 10 1803 and later, older SDKs lack the flag
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+void FWindowsPlatformMisc::Sleep(double Seconds)
+{
+	if (Seconds <= 0.0)
+	{
+		return;
+	}
+	// ::Sleep wakes up on the 15.6ms scheduler tick, high resolution timers don't
+	static thread_local HANDLE Timer = ::CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	LARGE_INTEGER DueTime;
+	// relative, in 100ns units
+	DueTime.QuadPart = -(LONGLONG)(Seconds * 1e7);
+	if (Timer != nullptr && ::SetWaitableTimerEx(Timer, &DueTime, 0, nullptr, nullptr, nullptr, 0))
+	{
+		::WaitForSingleObject(Timer, INFINITE);
+	}
+	else
+	{
+		::Sleep((DWORD)(Seconds * 1000.0));
+	}
+}
+
+FFileView FWindowsPlatformMisc::MapLooseFile(const char* Filename)
+{
+	char Path[MAX_PATH];
+	snprintf(Path, sizeof(Path), "%s%s", FPlatformMisc::ResourceDir(), Filename);
+	HANDLE File = ::CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	LARGE_INTEGER Size;
+	if (!::GetFileSizeEx(File, &Size))
+	{
+		::CloseHandle(File);
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	if (Size.QuadPart == 0)
+	{
+		// empty files cannot be mapped
+		::CloseHandle(File);
+		return FFileView("", 0, nullptr, nullptr);
+	}
+	// the mapping keeps the file open after its handle is closed
+	HANDLE Mapping = ::CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	::CloseHandle(File);
+	const void* Data = Mapping ? ::MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (Data == nullptr)
+	{
+		if (Mapping)
+		{
+			::CloseHandle(Mapping);
+		}
+		TE_LOG(LogCore, Error, "Failed to map file: %s", Filename);
+		return FFileView();
+	}
+	return FFileView((const char*)Data, (size_t)Size.QuadPart, Mapping, [](const char* Data, size_t, void* Mapping)
+	{
+		::UnmapViewOfFile(Data);
+		::CloseHandle((HANDLE)Mapping);
+	});
+}
+
+void* FWindowsPlatformMisc::OpenReadHandle(const char* Filename, uint64_t& OutSize)
+{
+	char Path[MAX_PATH];
+	snprintf(Path, sizeof(Path), "%s%s", FPlatformMisc::ResourceDir(), Filename);
+	HANDLE File = ::CreateFileA(Path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		return nullptr;
+	}
+	LARGE_INTEGER Size;
+	if (!::GetFileSizeEx(File, &Size))
+	{
+		::CloseHandle(File);
+		return nullptr;
+	}
+	OutSize = (uint64_t)Size.QuadPart;
+	return File;
+}
+
+bool FWindowsPlatformMisc::ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers)
+{
+	// ReadFileScatter needs unbuffered, page aligned reads, so every buffer is a positioned read
+	for (uint32_t i = 0; i < NumBuffers; ++i)
+	{
+		size_t Done = 0;
+		while (Done < Buffers[i].Size)
+		{
+			OVERLAPPED Overlapped = {};
+			Overlapped.Offset = (DWORD)Offset;
+			Overlapped.OffsetHigh = (DWORD)(Offset >> 32);
+			size_t Left = Buffers[i].Size - Done;
+			DWORD ToRead = Left > (1u << 30) ? (1u << 30) : (DWORD)Left;
+			DWORD Read = 0;
+			if (!::ReadFile((HANDLE)Handle, (char*)Buffers[i].Data + Done, ToRead, &Read, &Overlapped) || Read == 0)
+			{
+				return false;
+			}
+			Done += Read;
+			Offset += Read;
+		}
+	}
+	return true;
+}
+
+void FWindowsPlatformMisc::CloseReadHandle(void* Handle)
+{
+	::CloseHandle((HANDLE)Handle);
+}
+
+bool FWindowsPlatformMisc::SetThreadAffinityMask(uint64_t Mask)
+{
+	return ::SetThreadAffinityMask(::GetCurrentThread(), (DWORD_PTR)Mask) != 0;
+}
@@ -7,6 +7,15 @@ struct FWindowsPlatformMisc : public FGenericPlatformMisc
 	static void PlatformInit();
 
 	static void PumpMessages();
+
+	static void Sleep(double Seconds);
+
+	static FFileView MapLooseFile(const char* Filename);
+	static void* OpenReadHandle(const char* Filename, uint64_t& OutSize);
+	static bool ReadFileAt(void* Handle, uint64_t Offset, const FReadBuffer* Buffers, uint32_t NumBuffers);
+	static void CloseReadHandle(void* Handle);
+
+	static bool SetThreadAffinityMask(uint64_t Mask);
 };
 
 typedef FWindowsPlatformMisc FPlatformMisc;
\ No newline at end of file
@@ -3,13 +3,15 @@
 #include "vulkan_wrapper.h"
 
 #include "HAL/PlatformMisc.h"
+#include <atomic>
 
 extern int GuardedMain();
 
 struct android_app* GNativeAndroidApp = nullptr;
 
 static bool GWindowInitialized = false;
-extern bool GIsRequestingExit;
+extern std::atomic<bool> GIsRequestingExit;
+extern std::atomic<bool> GWindowResized;
 
 void Android_handle_cmd(android_app* app, int32_t cmd)
 {
@@ -24,6 +26,11 @@ void Android_handle_cmd(android_app* app, int32_t cmd)
             FPlatformMisc::LocalPrint("Android Window Terminated!");
             GIsRequestingExit = true;
             break;
+        case APP_CMD_WINDOW_RESIZED:
+        case APP_CMD_CONFIG_CHANGED:
+            // e.g. rotated, the swapchain is recreated for the new size and transform
+            GWindowResized = true;
+            break;
         default:
             FPlatformMisc::LocalPrintf("Android Event not handed: %d", cmd);
             break;
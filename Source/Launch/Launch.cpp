@@ -1,28 +1,103 @@
 #include <iostream>
 #include <set>
 #include <vector>
+#include <atomic>
 #include <algorithm>
 #include <assert.h>
+#include <string.h>
+#include <math.h>
 #include "HAL/PlatformMisc.h"
-
-#if PLATFORM_WINDOWS
-	#include <vulkan/vulkan.h>
-#elif PLATFORM_ANDROID
-	#include "vulkan_wrapper.h"
+#include "Misc/AssertionMacros.h"
+#include "Stats/StatSamples.h"
+#include "Stats/Profiler.h"
+#include "Logging/Logging.h"
+#include "Misc/Hash.h"
+#include "Async/JobSystem.h"
+#include "Async/RenderThread.h"
+#include "IO/AsyncIO.h"
+#include "IO/PakFile.h"
+#include "Math/Vector.h"
+#include "ECS/World.h"
+#include "VulkanRHI/VulkanCommon.h"
+#include "VulkanRHI/VulkanPipelineState.h"
+#include "VulkanRHI/VulkanParallelRecorder.h"
+#include "VulkanRHI/VulkanMemory.h"
+#include "VulkanRHI/VulkanUpload.h"
+#include "VulkanRHI/VulkanRenderGraph.h"
+#include "VulkanRHI/VulkanGpuProfiler.h"
+#include "VulkanRHI/VulkanShaderLibrary.h"
+#include "VulkanRHI/VulkanMesh.h"
+#include "VulkanRHI/VulkanIndirectDraw.h"
+#include "VulkanRHI/VulkanGpuCulling.h"
+#include "VulkanRHI/VulkanDescriptors.h"
+#include "VulkanRHI/VulkanUniformRing.h"
+#include "VulkanRHI/VulkanFramePacing.h"
+#include "VulkanRHI/VulkanDeletionQueue.h"
+
+#if PLATFORM_ANDROID
 	#include <android_native_app_glue.h>
 	extern struct android_app* GNativeAndroidApp;
 #endif
 
-#undef max
-#undef min
-
 using namespace std;
 
 const static char* APP_SHORT_NAME = "LearnVulkan";
 const static char* ENGINE_SHORT_NAME = "TinyEngine";
 const static char* VALIDATION_LAYER_NAME = "VK_LAYER_KHRONOS_validation";
 const wchar_t* AppClassName = L"TinyEngine";
-bool GIsRequestingExit = false;
+// Set by the game thread, read by the render thread too.
+std::atomic<bool> GIsRequestingExit{false};
+// Set by the window system when the window was resized or rotated, the swapchain is recreated
+// before the next frame.
+std::atomic<bool> GWindowResized{false};
+// Render into offscreen images instead of a surface/swapchain, e.g. for benchmarking on a build farm.
+bool GIsHeadless = false;
+// When non-zero, exit after rendering this many frames and report frame timings.
+uint32_t GBenchmarkFrameCount = 0;
+// Frames rendered before timings are recorded, so startup costs don't skew the percentiles.
+const static uint32_t BENCHMARK_WARMUP_FRAMES = 10;
+// How many frames the CPU may record ahead of the GPU.
+uint32_t GMaxFramesInFlight = 2;
+// Falls back to vsync when the surface doesn't support it.
+EPresentMode GPresentMode = EPresentMode::Mailbox;
+// Frames per second the frame pacer limits to, 0 for no limit.
+uint32_t GTargetFrameRate = 0;
+// Render on a dedicated thread, see FRenderThread; off runs both on one thread, for debugging.
+bool GUseRenderThread = true;
+// Frames the game thread may run ahead of the render thread.
+uint32_t GRenderThreadFrameLag = 1;
+const static char* PIPELINE_CACHE_FILENAME = "PipelineCache.bin";
+// built by the ResourcePak target, resources are loaded from loose files without it
+const static char* RESOURCE_PAK_FILENAME = "Resource.pak";
+// built by the ShaderLibrary target from Resource/Shaders
+const static char* SHADER_LIBRARY_FILENAME = "Shaders/ShaderLibrary.bin";
+// Seconds between saves of a pipeline cache that gained new pipelines.
+const static double PIPELINE_CACHE_SAVE_INTERVAL = 60.0;
+// Seconds between defragmentation passes over device-local memory, and the bytes a pass may move.
+const static double DEFRAGMENT_INTERVAL = 10.0;
+const static VkDeviceSize DEFRAGMENT_BUDGET = 4ull << 20;
+// Pipeline state descriptions used by the last run, compiled in the background at startup.
+const static char* PIPELINE_PREWARM_FILENAME = "PipelinePrewarm.bin";
+// Mesh instances in the scene, spread over a grid covering the screen.
+uint32_t GNumInstances = 1;
+// Record one vkCmdDrawIndexed per instance instead of batched indirect draws, to compare CPU cost.
+bool GUseDirectDraws = false;
+// Cull instances and build the indirect draws in a compute pass, see FVulkanGpuCulling.
+bool GUseGpuCulling = false;
+// Run the culling on a compute-only queue when the device has one. Implies GUseGpuCulling.
+bool GUseAsyncCompute = false;
+// Meshes of the scene, regular polygons with 3 to NUM_SCENE_MESHES + 2 corners.
+const static uint32_t NUM_SCENE_MESHES = 8;
+// Job system worker threads, 0 picks one per core.
+uint32_t GNumJobWorkers = 0;
+// Direct draws per secondary command buffer; passes with fewer draws are recorded inline.
+const static uint32_t DRAWS_PER_RECORDING_CHUNK = 256;
+// Record CPU and GPU timings and write them to TRACE_FILENAME on exit.
+bool GEnableProfiler = false;
+const static char* TRACE_FILENAME = "Trace.json";
+// Key the main pass pipeline layout is registered under: the uniform ring's set, then the bindless
+// table's when there is one, and FDrawConstants for the vertex shader.
+const static uint64_t MAIN_PIPELINE_LAYOUT = 0;
 
 
 struct FVulkanLayerInfo
@@ -31,16 +106,145 @@ struct FVulkanLayerInfo
 	std::vector<VkExtensionProperties> SupportedExtensions;
 };
 
+struct FFrameTimingStats
+{
+	FStatSamples FrameTime{"Frame"};
+	FStatSamples CpuTime{"CPU (no wait)"};
+	FStatSamples SubmitTime{"Submit"};
+	FStatSamples FenceWaitTime{"Fence wait"};
+	FStatSamples ImageWaitTime{"Image wait"};
+	FStatSamples RecordTime{"Record"};
+	double LastFrameStart = 0.0;
+	// first frame that is recorded, i.e. after warmup
+	uint64_t FirstFrame = BENCHMARK_WARMUP_FRAMES;
+
+	void Report() const
+	{
+		FrameTime.Report();
+		CpuTime.Report();
+		SubmitTime.Report();
+		FenceWaitTime.Report();
+		ImageWaitTime.Report();
+		RecordTime.Report();
+	}
+};
+
+// Vertex and instance formats of shader.vert.
+struct FSceneVertex
+{
+	float Position[3];
+	float Color[3];
+};
+
+// Per instance: FGpuCullInstance, whose draw index the vertex shader ignores.
+typedef FGpuCullInstance FSceneInstance;
+
+// What the render thread needs of a game frame, copied out of the game state at the end of the frame.
+// The game thread writes one per frame, round robin over FrameLag + 1 of them, so it never
+// overwrites the state of a frame still being rendered.
+struct FRenderFrameState
+{
+	// scene to clip space: xy offset, zw scale
+	FVector4 ViewTransform;
+	// when the frame's input was sampled
+	double InputTime = 0.0;
+};
+
+// shader.vert's View uniform block, written once per frame.
+struct FViewUniforms
+{
+	// scene to clip space: xy offset, zw scale
+	FVector4 Transform;
+};
+
+// shader.vert's Draw push constants, for data too small and short-lived for the uniform ring. Push
+// them again before a draw that needs other values; indirect draws can't change them between their
+// commands and share the values pushed before them.
+struct FDrawConstants
+{
+	// multiplies the vertex color
+	FVector4 Tint;
+};
+
+// Components of the scene's entities: where an instance is, and which of the scene's meshes it draws.
+struct FSceneTransform
+{
+	float Position[2];
+	float Scale;
+};
+
+struct FSceneMesh
+{
+	// < NUM_SCENE_MESHES
+	uint32_t MeshIndex;
+};
+
+// Consecutive instances drawing the same mesh.
+struct FSceneDraw
+{
+	uint32_t Mesh;
+	uint32_t FirstInstance;
+	uint32_t NumInstances;
+};
+
+// Everything one frame in flight owns, cycled through independently of the swapchain images.
+struct FFrameResources
+{
+	// reset as a whole once the frame's fence signaled
+	VkCommandPool CommandPool;
+	VkCommandBuffer CommandBuffer;
+	VkSemaphore PresentFinishedSemaphore;
+	VkSemaphore RenderFinishedSemaphore;
+	VkFence Fence;
+	// FrameNumber + 1 of the frame last submitted with it: once Fence signaled, every frame before
+	// this one finished on the GPU, as submissions to a queue complete in order
+	uint64_t SubmittedFrames = 0;
+};
+
+// Prepended to the driver's pipeline cache blob on disk. The blob carries its own header with
+// vendor/device id and pipelineCacheUUID; this adds the driver version and a checksum so a
+// truncated or stale file is never handed to the driver.
+struct FPipelineCacheFileHeader
+{
+	static const uint32_t MAGIC = 0x43505445; // "ETPC"
+	static const uint32_t VERSION = 1;
+
+	uint32_t Magic;
+	uint32_t Version;
+	uint32_t DriverVersion;
+	uint32_t DataSize;
+	uint64_t DataHash;
+};
+
 struct FVulkanContext
 {
 	VkInstance Instance;
 	std::vector<const char*> LayerNames;
 	std::vector<const char*> ExtensionNames;
+	// VK_KHR_get_physical_device_properties2, to query extension features before creating the device
+	bool SupportsPhysicalDeviceProperties2 = false;
 	VkPhysicalDevice PhysicalDevice;
+	VkPhysicalDeviceProperties PhysicalDeviceProperties;
+	std::vector<VkExtensionProperties> DeviceExtensions;
+	bool SupportsPipelineCreationFeedback = false;
+	VkPhysicalDeviceFeatures EnabledFeatures{};
+	bool SupportsDrawIndirectCount = false;
+	bool SupportsTimelineSemaphore = false;
+	bool SupportsCalibratedTimestamps = false;
+	// VK_KHR_present_id and VK_KHR_present_wait, for FVulkanFramePacer
+	bool SupportsPresentWait = false;
+	// VK_EXT_descriptor_indexing with what FVulkanBindlessTable needs, and its array sizes
+	bool SupportsDescriptorIndexing = false;
+	uint32_t MaxBindlessTextures = 0;
+	uint32_t MaxBindlessBuffers = 0;
 	VkDevice LogicalDevice;
 	uint32_t Width, Height;
 	int32_t GraphicsFamilyIndex;
 	int32_t PresentFamilyIndex;
+	// a transfer-only family when the device has one, the graphics family otherwise
+	int32_t TransferFamilyIndex;
+	// a compute family without graphics when async compute is used, the graphics family otherwise
+	int32_t ComputeFamilyIndex;
 #if PLATFORM_WINDOWS
 	HWND Window;
 	HINSTANCE WinInstance;
@@ -48,35 +252,99 @@ struct FVulkanContext
 	// todo
 #endif
 	VkSurfaceKHR Surface;
-	VkFormat SwapChainFormat;
+	VkFormat SwapChainFormat = VK_FORMAT_UNDEFINED;
 	VkQueue PresentQueue;
-	VkSwapchainKHR SwapChain;
+	VkQueue TransferQueue;
+	VkQueue ComputeQueue;
+	VkSwapchainKHR SwapChain = VK_NULL_HANDLE;
 	uint32_t SwapChainImageCount;
 	VkExtent2D SwapChainExtent;
 	std::vector<VkImage> SwapChainImages;
 	std::vector<VkImageView> SwapChainImageViews;
-	std::vector<VkFramebuffer> SwapChainFramebuffers;
+	// set when the swapchain no longer matches the surface, it is recreated before the next acquire
+	bool SwapChainOutOfDate = false;
+	FRenderGraph RenderGraph;
+	// render pass the main pass is recorded in, owned by the render graph
 	VkRenderPass RenderPass;
-	VkShaderModule VertShaderModule, FragShaderModule;
-	VkCommandPool CommandPool;
-	std::vector<VkCommandBuffer> CommandBuffers;
-	VkSemaphore PresentFinishedSemaphore;
-	VkSemaphore RenderFinishedSemaphore;
-	VkFence Fence;
+	uint32_t MainSubpass = 0;
+	uint64_t MainRenderPassKey = 0;
+	FVulkanShaderLibrary ShaderLibrary;
+	FVulkanParallelRecorder ParallelRecorder;
+	std::vector<VkCommandBuffer> SecondaryCommandBuffers;
+	std::vector<FFrameResources> Frames;
+	// frames actually cycled through, <= Frames.size()
+	uint32_t FramesInFlight;
+	// fence of the frame last rendering into each swapchain image
+	std::vector<VkFence> ImagesInFlight;
 	VkPipelineLayout PipelineLayout;
 	VkPipeline GraphicsPipeline;
-
+	VkPipelineCache PipelineCache;
+	// set when a pipeline was compiled since the last save
+	bool PipelineCacheDirty = false;
+	double PipelineCacheLastSave = 0.0;
+	FVulkanPipelineStateCache PipelineStateCache;
+	// what the main pass draws with once compiled, GraphicsPipeline until then
+	FGraphicsPipelineStateDesc MainPassPSO;
+	FVulkanMemoryAllocator MemoryAllocator;
+	double LastDefragment = 0.0;
+	// frame the last defragmentation pass was recorded in, UINT64_MAX once its old buffers were released
+	uint64_t DefragmentFrame = UINT64_MAX;
+	// backing memory of the offscreen "swapchain" images in headless mode
+	std::vector<FVulkanAllocation*> OffscreenImageAllocations;
+	FVulkanUploadManager UploadManager;
+	FVulkanGpuProfiler GpuProfiler;
+	FVulkanMeshPool MeshPool;
+	FVulkanIndirectDrawBatcher DrawBatcher;
+	FVulkanGpuCulling GpuCulling;
+	FVulkanDescriptorAllocator DescriptorAllocator;
+	// set 1 of the main pipeline layout when the device supports descriptor indexing
+	FVulkanBindlessTable BindlessTable;
+	// set 0 of the main pipeline layout
+	FVulkanUniformRing UniformRing;
+	// the frame's FViewUniforms
+	FUniformAllocation ViewUniforms;
+	FVulkanFramePacer FramePacer;
+	// objects the frames in flight may still use, destroyed as the frames finish
+	FVulkanDeletionQueue DeletionQueue;
+	// the scene's entities, each with an FSceneTransform and an FSceneMesh
+	FWorld Scene;
+	// FSceneInstance per instance, grouped by mesh
+	FVulkanAllocation* InstanceBuffer = nullptr;
+	std::vector<FSceneDraw> SceneDraws;
+	// mesh of every instance, for direct draws
+	std::vector<uint32_t> InstanceMeshes;
+	uint64_t SceneUploadTicket = 0;
+	uint64_t FrameNumber = 0;
+	// every frame before this one finished on the GPU
+	uint64_t CompletedFrames = 0;
+	FFrameTimingStats Stats;
 };
 
 bool InitLayersAndExtensions(FVulkanContext& VulkanContext, bool EnableValidationLayer)
 {
-	VulkanContext.ExtensionNames.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
-	//VulkanContext.ExtensionNames.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if (!GIsHeadless)
+	{
+		VulkanContext.ExtensionNames.emplace_back(VK_KHR_SURFACE_EXTENSION_NAME);
+		//VulkanContext.ExtensionNames.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 #if PLATFORM_WINDOWS
-	VulkanContext.ExtensionNames.emplace_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+		VulkanContext.ExtensionNames.emplace_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
 #elif PLATFORM_ANDROID
-	VulkanContext.ExtensionNames.emplace_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
+		VulkanContext.ExtensionNames.emplace_back(VK_KHR_ANDROID_SURFACE_EXTENSION_NAME);
 #endif
+	}
+
+	uint32_t InstanceExtensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &InstanceExtensionCount, nullptr);
+	std::vector<VkExtensionProperties> InstanceExtensions(InstanceExtensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &InstanceExtensionCount, InstanceExtensions.data());
+	for (const VkExtensionProperties& Extension : InstanceExtensions)
+	{
+		if (strcmp(Extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+		{
+			VulkanContext.ExtensionNames.emplace_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+			VulkanContext.SupportsPhysicalDeviceProperties2 = true;
+		}
+	}
 
 	if (EnableValidationLayer)
 	{
@@ -157,6 +425,8 @@ bool CreateSurface(FVulkanContext& VulkanContext)
 	SurfaceCreateInfo.window = GNativeAndroidApp->window;
 	FPlatformMisc::LocalPrintf("try to create surface: %x", vkCreateAndroidSurfaceKHR);
 	VkResult Res = vkCreateAndroidSurfaceKHR(VulkanContext.Instance, &SurfaceCreateInfo, nullptr, &VulkanContext.Surface);
+#else
+	VkResult Res = VK_ERROR_EXTENSION_NOT_PRESENT;
 #endif
 	if (Res != VK_SUCCESS)
 	{
@@ -181,7 +451,7 @@ bool SelectPhysicalDevice(FVulkanContext& VulkanContext)
 	}
 	std::vector<VkPhysicalDevice> Devices;
 	Devices.resize(DeviceCount);
-	assert(vkEnumeratePhysicalDevices(VulkanContext.Instance, &DeviceCount, Devices.data()) == VK_SUCCESS);
+	verify(vkEnumeratePhysicalDevices(VulkanContext.Instance, &DeviceCount, Devices.data()) == VK_SUCCESS);
 	for(uint32_t i = 0; i < Devices.size(); ++i)
 	{
 		VkPhysicalDevice& Device = Devices[i];
@@ -199,14 +469,113 @@ bool SelectPhysicalDevice(FVulkanContext& VulkanContext)
 			FPlatformMisc::LocalPrintf("Choose Device: [%s]\n", Properties.deviceName);
 		}
 	}
+	if (VulkanContext.PhysicalDevice == nullptr)
+	{
+		// no discrete GPU, e.g. integrated + software driver on a build machine
+		VulkanContext.PhysicalDevice = Devices[0];
+		FPlatformMisc::LocalPrint("No discrete GPU, choose Device 0");
+	}
 	bool Success = VulkanContext.PhysicalDevice != nullptr;
-	if (!Success)
+	if (Success)
+	{
+		vkGetPhysicalDeviceProperties(VulkanContext.PhysicalDevice, &VulkanContext.PhysicalDeviceProperties);
+	}
+	else
 	{
 		FPlatformMisc::LocalPrint("Select Physical Device Failed!");
 	}
 	return Success;
 }
 
+bool IsDeviceExtensionSupported(const FVulkanContext& VulkanContext, const char* ExtensionName)
+{
+	for (const VkExtensionProperties& Extension : VulkanContext.DeviceExtensions)
+	{
+		if (strcmp(Extension.extensionName, ExtensionName) == 0)
+			return true;
+	}
+	return false;
+}
+
+// Whether the device can back an FVulkanBindlessTable. If so, OutFeatures holds just the features
+// the table needs, and the table's sizes are set within the device's update-after-bind limits.
+bool QueryDescriptorIndexing(FVulkanContext& VulkanContext, VkPhysicalDeviceDescriptorIndexingFeaturesEXT& OutFeatures)
+{
+	if (!IsDeviceExtensionSupported(VulkanContext, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) ||
+		!IsDeviceExtensionSupported(VulkanContext, VK_KHR_MAINTENANCE3_EXTENSION_NAME))
+	{
+		return false;
+	}
+	PFN_vkGetPhysicalDeviceFeatures2KHR GetFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(VulkanContext.Instance, "vkGetPhysicalDeviceFeatures2KHR");
+	PFN_vkGetPhysicalDeviceProperties2KHR GetProperties2 = (PFN_vkGetPhysicalDeviceProperties2KHR)vkGetInstanceProcAddr(VulkanContext.Instance, "vkGetPhysicalDeviceProperties2KHR");
+	if (GetFeatures2 == nullptr || GetProperties2 == nullptr)
+	{
+		return false;
+	}
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT Supported{};
+	Supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2KHR Features2{};
+	Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	Features2.pNext = &Supported;
+	GetFeatures2(VulkanContext.PhysicalDevice, &Features2);
+	if (!Supported.runtimeDescriptorArray || !Supported.descriptorBindingPartiallyBound || !Supported.descriptorBindingUpdateUnusedWhilePending ||
+		!Supported.descriptorBindingSampledImageUpdateAfterBind || !Supported.descriptorBindingStorageBufferUpdateAfterBind ||
+		!Supported.shaderSampledImageArrayNonUniformIndexing || !Supported.shaderStorageBufferArrayNonUniformIndexing)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDescriptorIndexingPropertiesEXT Limits{};
+	Limits.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2KHR Properties2{};
+	Properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+	Properties2.pNext = &Limits;
+	GetProperties2(VulkanContext.PhysicalDevice, &Properties2);
+	VulkanContext.MaxBindlessTextures = std::min({ FVulkanBindlessTable::DEFAULT_MAX_TEXTURES, Limits.maxDescriptorSetUpdateAfterBindSampledImages,
+		Limits.maxPerStageDescriptorUpdateAfterBindSampledImages, Limits.maxDescriptorSetUpdateAfterBindSamplers, Limits.maxPerStageDescriptorUpdateAfterBindSamplers });
+	VulkanContext.MaxBindlessBuffers = std::min({ FVulkanBindlessTable::DEFAULT_MAX_BUFFERS, Limits.maxDescriptorSetUpdateAfterBindStorageBuffers,
+		Limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+	if (VulkanContext.MaxBindlessTextures == 0 || VulkanContext.MaxBindlessBuffers == 0)
+	{
+		return false;
+	}
+
+	OutFeatures.runtimeDescriptorArray = VK_TRUE;
+	OutFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+	OutFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	OutFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	OutFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	OutFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	OutFeatures.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+	return true;
+}
+
+// Whether presents can be waited for, see FVulkanFramePacer. The features are mandatory for the
+// extensions, but drivers may expose the extensions for platforms where they don't work.
+bool QueryPresentWait(FVulkanContext& VulkanContext)
+{
+	if (!IsDeviceExtensionSupported(VulkanContext, VK_KHR_PRESENT_ID_EXTENSION_NAME) ||
+		!IsDeviceExtensionSupported(VulkanContext, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		return false;
+	}
+	PFN_vkGetPhysicalDeviceFeatures2KHR GetFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2KHR)vkGetInstanceProcAddr(VulkanContext.Instance, "vkGetPhysicalDeviceFeatures2KHR");
+	if (GetFeatures2 == nullptr)
+	{
+		return false;
+	}
+	VkPhysicalDevicePresentWaitFeaturesKHR PresentWaitFeatures{};
+	PresentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	VkPhysicalDevicePresentIdFeaturesKHR PresentIdFeatures{};
+	PresentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	PresentIdFeatures.pNext = &PresentWaitFeatures;
+	VkPhysicalDeviceFeatures2KHR Features2{};
+	Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+	Features2.pNext = &PresentIdFeatures;
+	GetFeatures2(VulkanContext.PhysicalDevice, &Features2);
+	return PresentIdFeatures.presentId && PresentWaitFeatures.presentWait;
+}
+
 bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 {
 	uint32_t QueueCount = 0;
@@ -232,9 +601,12 @@ bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 		return false;
 	}
 
-	// choose present queue
-	VkBool32 PresentSupport = false;
-	assert(vkGetPhysicalDeviceSurfaceSupportKHR(VulkanContext.PhysicalDevice, VulkanContext.GraphicsFamilyIndex, VulkanContext.Surface, &PresentSupport) == VK_SUCCESS);
+	// choose present queue, headless mode only ever uses the graphics queue
+	VkBool32 PresentSupport = GIsHeadless;
+	if (!GIsHeadless)
+	{
+		verify(vkGetPhysicalDeviceSurfaceSupportKHR(VulkanContext.PhysicalDevice, VulkanContext.GraphicsFamilyIndex, VulkanContext.Surface, &PresentSupport) == VK_SUCCESS);
+	}
 	if (PresentSupport)
 	{
 		VulkanContext.PresentFamilyIndex = VulkanContext.GraphicsFamilyIndex;
@@ -247,7 +619,7 @@ bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 
 		for (uint32_t i = 0; i < QueueCount; ++i)
 		{
-			assert(vkGetPhysicalDeviceSurfaceSupportKHR(VulkanContext.PhysicalDevice, i, VulkanContext.Surface, &PresentSupport) == VK_SUCCESS);
+			verify(vkGetPhysicalDeviceSurfaceSupportKHR(VulkanContext.PhysicalDevice, i, VulkanContext.Surface, &PresentSupport) == VK_SUCCESS);
 			if (PresentSupport)
 			{
 				VulkanContext.PresentFamilyIndex = i;
@@ -256,8 +628,37 @@ bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 		}
 	}
 
+	// transfer-only families map to the copy engines, which stream data without stalling graphics work
+	VulkanContext.TransferFamilyIndex = VulkanContext.GraphicsFamilyIndex;
+	for (uint32_t i = 0; i < QueueCount; ++i)
+	{
+		VkQueueFlags Flags = QueueProperties[i].queueFlags;
+		if ((Flags & VK_QUEUE_TRANSFER_BIT) && !(Flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			VulkanContext.TransferFamilyIndex = i;
+			break;
+		}
+	}
+
+	// compute families without graphics run next to the graphics queue
+	VulkanContext.ComputeFamilyIndex = VulkanContext.GraphicsFamilyIndex;
+	for (uint32_t i = 0; i < QueueCount && GUseAsyncCompute; ++i)
+	{
+		VkQueueFlags Flags = QueueProperties[i].queueFlags;
+		if ((Flags & VK_QUEUE_COMPUTE_BIT) && !(Flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			VulkanContext.ComputeFamilyIndex = i;
+			break;
+		}
+	}
+	if (GUseAsyncCompute && VulkanContext.ComputeFamilyIndex == VulkanContext.GraphicsFamilyIndex)
+	{
+		FPlatformMisc::LocalPrint("No compute-only queue family, culling on the graphics queue");
+	}
+
 	std::vector<VkDeviceQueueCreateInfo> QueueCreateInfos;
-	std::set<uint32_t> UniqueQueueFamilies = { (uint32_t)VulkanContext.GraphicsFamilyIndex, (uint32_t)VulkanContext.PresentFamilyIndex };
+	std::set<uint32_t> UniqueQueueFamilies = { (uint32_t)VulkanContext.GraphicsFamilyIndex, (uint32_t)VulkanContext.PresentFamilyIndex,
+		(uint32_t)VulkanContext.TransferFamilyIndex, (uint32_t)VulkanContext.ComputeFamilyIndex };
 	float QueuePriority = 1.f;
 	for (uint32_t QueueFamily : UniqueQueueFamilies)
 	{
@@ -269,19 +670,94 @@ bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 		QueueCreateInfos.push_back(QueueInfo);
 	}
 
-	std::vector<const char*> deviceExtensionNames = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	uint32_t ExtensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(VulkanContext.PhysicalDevice, nullptr, &ExtensionCount, nullptr);
+	VulkanContext.DeviceExtensions.resize(ExtensionCount);
+	vkEnumerateDeviceExtensionProperties(VulkanContext.PhysicalDevice, nullptr, &ExtensionCount, VulkanContext.DeviceExtensions.data());
+
+	std::vector<const char*> deviceExtensionNames;
+	if (!GIsHeadless)
+	{
+		deviceExtensionNames.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
+	if (IsDeviceExtensionSupported(VulkanContext, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME))
+	{
+		deviceExtensionNames.push_back(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
+		VulkanContext.SupportsPipelineCreationFeedback = true;
+	}
+	// the feature is mandatory for devices exposing the extension
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR TimelineSemaphoreFeatures{};
+	TimelineSemaphoreFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+	TimelineSemaphoreFeatures.timelineSemaphore = VK_TRUE;
+	if (IsDeviceExtensionSupported(VulkanContext, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+	{
+		deviceExtensionNames.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		VulkanContext.SupportsTimelineSemaphore = true;
+	}
+	if (GEnableProfiler && IsDeviceExtensionSupported(VulkanContext, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+	{
+		deviceExtensionNames.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+		VulkanContext.SupportsCalibratedTimestamps = true;
+	}
+	if (IsDeviceExtensionSupported(VulkanContext, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+	{
+		deviceExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+		VulkanContext.SupportsDrawIndirectCount = true;
+	}
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT DescriptorIndexingFeatures{};
+	DescriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+	if (VulkanContext.SupportsPhysicalDeviceProperties2 && QueryDescriptorIndexing(VulkanContext, DescriptorIndexingFeatures))
+	{
+		deviceExtensionNames.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+		deviceExtensionNames.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		VulkanContext.SupportsDescriptorIndexing = true;
+	}
+	VkPhysicalDevicePresentIdFeaturesKHR PresentIdFeatures{};
+	PresentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	PresentIdFeatures.presentId = VK_TRUE;
+	VkPhysicalDevicePresentWaitFeaturesKHR PresentWaitFeatures{};
+	PresentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	PresentWaitFeatures.presentWait = VK_TRUE;
+	if (!GIsHeadless && VulkanContext.SupportsPhysicalDeviceProperties2 && QueryPresentWait(VulkanContext))
+	{
+		deviceExtensionNames.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		deviceExtensionNames.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		VulkanContext.SupportsPresentWait = true;
+	}
+	// indirect draws batch best with both, see FVulkanIndirectDrawBatcher
+	VkPhysicalDeviceFeatures SupportedFeatures{};
+	vkGetPhysicalDeviceFeatures(VulkanContext.PhysicalDevice, &SupportedFeatures);
+	VulkanContext.EnabledFeatures.multiDrawIndirect = SupportedFeatures.multiDrawIndirect;
+	VulkanContext.EnabledFeatures.drawIndirectFirstInstance = SupportedFeatures.drawIndirectFirstInstance;
 
 	VkDeviceCreateInfo DeviceInfo;
 	DeviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	DeviceInfo.pNext = nullptr;
+	void* FeatureChain = nullptr;
+	if (VulkanContext.SupportsTimelineSemaphore)
+	{
+		TimelineSemaphoreFeatures.pNext = FeatureChain;
+		FeatureChain = &TimelineSemaphoreFeatures;
+	}
+	if (VulkanContext.SupportsDescriptorIndexing)
+	{
+		DescriptorIndexingFeatures.pNext = FeatureChain;
+		FeatureChain = &DescriptorIndexingFeatures;
+	}
+	if (VulkanContext.SupportsPresentWait)
+	{
+		PresentIdFeatures.pNext = FeatureChain;
+		PresentWaitFeatures.pNext = &PresentIdFeatures;
+		FeatureChain = &PresentWaitFeatures;
+	}
+	DeviceInfo.pNext = FeatureChain;
 	DeviceInfo.flags = 0;
 	DeviceInfo.queueCreateInfoCount = (uint32_t)QueueCreateInfos.size();
 	DeviceInfo.pQueueCreateInfos = QueueCreateInfos.data();
 	DeviceInfo.enabledLayerCount = 0;
 	DeviceInfo.ppEnabledLayerNames = nullptr;
 	DeviceInfo.enabledExtensionCount = (uint32_t)deviceExtensionNames.size();
-	DeviceInfo.ppEnabledExtensionNames = deviceExtensionNames.data();
-	DeviceInfo.pEnabledFeatures = nullptr;
+	DeviceInfo.ppEnabledExtensionNames = deviceExtensionNames.empty() ? nullptr : deviceExtensionNames.data();
+	DeviceInfo.pEnabledFeatures = &VulkanContext.EnabledFeatures;
 	
 	VkResult Result = vkCreateDevice(VulkanContext.PhysicalDevice, &DeviceInfo, nullptr, &VulkanContext.LogicalDevice);
 	if (Result != VK_SUCCESS)
@@ -292,6 +768,8 @@ bool CreateLogicalDevice(FVulkanContext& VulkanContext)
 	FPlatformMisc::LocalPrint("Create Logical Device Successfully!");
 
 	vkGetDeviceQueue(VulkanContext.LogicalDevice, VulkanContext.PresentFamilyIndex, 0, &VulkanContext.PresentQueue);
+	vkGetDeviceQueue(VulkanContext.LogicalDevice, VulkanContext.TransferFamilyIndex, 0, &VulkanContext.TransferQueue);
+	vkGetDeviceQueue(VulkanContext.LogicalDevice, VulkanContext.ComputeFamilyIndex, 0, &VulkanContext.ComputeQueue);
 
 	return true;
 }
@@ -307,16 +785,6 @@ VkSurfaceFormatKHR ChooseSurfaceFormat(std::vector<VkSurfaceFormatKHR>& SurfaceF
 	return SurfaceFormats[0];
 }
 
-VkPresentModeKHR ChoosePresentMode(std::vector<VkPresentModeKHR>& PresentModes)
-{
-	for (const VkPresentModeKHR& Mode : PresentModes)
-	{
-		if (Mode == VK_PRESENT_MODE_MAILBOX_KHR)
-			return Mode;
-	}
-	return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& SurfaceCap, uint32_t DefaultWidth, uint32_t DefaultHeight)
 {
 	if (SurfaceCap.currentExtent.width != UINT32_MAX)
@@ -337,6 +805,9 @@ LRESULT WindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 	{
 	case WM_ACTIVATE:
 		break;
+	case WM_SIZE:
+		GWindowResized = true;
+		break;
 	case WM_DESTROY:
 	{
 		GIsRequestingExit = true;
@@ -391,12 +862,18 @@ bool CreateSwapChain(FVulkanContext& VulkanContext)
 	}
 	std::vector<VkSurfaceFormatKHR> SurfaceFormats;
 	SurfaceFormats.resize(FormatCount);
-	assert(vkGetPhysicalDeviceSurfaceFormatsKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &FormatCount, SurfaceFormats.data()) == VK_SUCCESS);
+	verify(vkGetPhysicalDeviceSurfaceFormatsKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &FormatCount, SurfaceFormats.data()) == VK_SUCCESS);
 	VkSurfaceFormatKHR SurfaceFormat = ChooseSurfaceFormat(SurfaceFormats);
+	// the pipelines are created against the render pass of the first format
+	if (VulkanContext.SwapChainFormat != VK_FORMAT_UNDEFINED && SurfaceFormat.format != VulkanContext.SwapChainFormat)
+	{
+		FPlatformMisc::LocalPrintf("Surface format changed from %d to %d", (int)VulkanContext.SwapChainFormat, (int)SurfaceFormat.format);
+		return false;
+	}
 	VulkanContext.SwapChainFormat = SurfaceFormat.format;
 
 	uint32_t PresentModeCount = 0;
-	assert(vkGetPhysicalDeviceSurfacePresentModesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &PresentModeCount, nullptr) == VK_SUCCESS);
+	verify(vkGetPhysicalDeviceSurfacePresentModesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &PresentModeCount, nullptr) == VK_SUCCESS);
 	if (PresentModeCount == 0)
 	{
 		FPlatformMisc::LocalPrint("No present mode is supported");
@@ -404,8 +881,8 @@ bool CreateSwapChain(FVulkanContext& VulkanContext)
 	}
 	std::vector< VkPresentModeKHR> PresentModes;
 	PresentModes.resize(PresentModeCount);
-	assert(vkGetPhysicalDeviceSurfacePresentModesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &PresentModeCount, PresentModes.data()) == VK_SUCCESS);
-	VkPresentModeKHR PresentMode = ChoosePresentMode(PresentModes);
+	verify(vkGetPhysicalDeviceSurfacePresentModesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &PresentModeCount, PresentModes.data()) == VK_SUCCESS);
+	VkPresentModeKHR PresentMode = FVulkanFramePacer::ChoosePresentMode(GPresentMode, PresentModes);
 
 	VkSurfaceCapabilitiesKHR SurfaceCap;
 	VkResult Res = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &SurfaceCap);
@@ -413,8 +890,14 @@ bool CreateSwapChain(FVulkanContext& VulkanContext)
 	VkExtent2D SwapExtend = ChooseSwapExtent(SurfaceCap, VulkanContext.Width, VulkanContext.Height);
 	FPlatformMisc::LocalPrintf("Window size %d x %d", SwapExtend.width, SwapExtend.height);
 
-	uint32_t ImageCount = 2;
-	ImageCount = std::min(SurfaceCap.maxImageCount, std::max(SurfaceCap.minImageCount, ImageCount));
+	// mailbox needs a third image to replace the queued one while another is displayed
+	uint32_t ImageCount = PresentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2;
+	ImageCount = std::max(SurfaceCap.minImageCount, ImageCount);
+	// 0 for no limit
+	if (SurfaceCap.maxImageCount > 0)
+	{
+		ImageCount = std::min(SurfaceCap.maxImageCount, ImageCount);
+	}
 
 	VkSwapchainCreateInfoKHR SwapChainCreateInfo = {};
 	SwapChainCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -443,25 +926,70 @@ bool CreateSwapChain(FVulkanContext& VulkanContext)
 	SwapChainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	SwapChainCreateInfo.presentMode = PresentMode;
 	SwapChainCreateInfo.clipped = VK_TRUE;
-	SwapChainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	// lets the driver reuse its resources and keep presenting the old images until the new ones are,
+	// and retires it, even if the creation fails
+	SwapChainCreateInfo.oldSwapchain = VulkanContext.SwapChain;
 
-	Res = vkCreateSwapchainKHR(VulkanContext.LogicalDevice, &SwapChainCreateInfo, nullptr, &VulkanContext.SwapChain);
+	VkSwapchainKHR SwapChain;
+	Res = vkCreateSwapchainKHR(VulkanContext.LogicalDevice, &SwapChainCreateInfo, nullptr, &SwapChain);
 	if (Res != VK_SUCCESS)
 	{
 		FPlatformMisc::LocalPrintf("Create Swapchain failed: %d", uint32_t(Res));
 		return false;
 	}
+	VulkanContext.SwapChain = SwapChain;
 
-	assert(vkGetSwapchainImagesKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, &VulkanContext.SwapChainImageCount, nullptr) == VK_SUCCESS);
+	verify(vkGetSwapchainImagesKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, &VulkanContext.SwapChainImageCount, nullptr) == VK_SUCCESS);
 	VulkanContext.SwapChainImages.resize(VulkanContext.SwapChainImageCount);
-	assert(vkGetSwapchainImagesKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, &VulkanContext.SwapChainImageCount, 
+	verify(vkGetSwapchainImagesKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, &VulkanContext.SwapChainImageCount, 
 			VulkanContext.SwapChainImages.data()) == VK_SUCCESS);
 
 	VulkanContext.SwapChainExtent = SwapExtend;
+	VulkanContext.FramePacer.SetSwapchain(VulkanContext.SwapChain);
 
 	return true;
 }
 
+// Headless replacement for CreateSwapChain: plain device-local color images that are
+// rendered into round robin and never presented.
+bool CreateOffscreenImages(FVulkanContext& VulkanContext, uint32_t Width, uint32_t Height)
+{
+	VulkanContext.Width = Width;
+	VulkanContext.Height = Height;
+	VulkanContext.Surface = VK_NULL_HANDLE;
+	VulkanContext.SwapChain = VK_NULL_HANDLE;
+	VulkanContext.SwapChainFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	VulkanContext.SwapChainExtent = { Width, Height };
+	VulkanContext.SwapChainImageCount = std::max(2u, GMaxFramesInFlight);
+	VulkanContext.SwapChainImages.resize(VulkanContext.SwapChainImageCount);
+	VulkanContext.OffscreenImageAllocations.resize(VulkanContext.SwapChainImageCount);
+
+	for (uint32_t i = 0; i < VulkanContext.SwapChainImageCount; ++i)
+	{
+		VkImageCreateInfo ImageInfo{};
+		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+		ImageInfo.format = VulkanContext.SwapChainFormat;
+		ImageInfo.extent = { Width, Height, 1 };
+		ImageInfo.mipLevels = 1;
+		ImageInfo.arrayLayers = 1;
+		ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		ImageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VulkanContext.OffscreenImageAllocations[i] = VulkanContext.MemoryAllocator.CreateImage(ImageInfo,
+			EVulkanMemoryUsage::GpuOnly, VulkanContext.SwapChainImages[i]);
+		if (!VulkanContext.OffscreenImageAllocations[i])
+		{
+			FPlatformMisc::LocalPrint("Create Offscreen Image Failed!");
+			return false;
+		}
+	}
+	FPlatformMisc::LocalPrintf("Offscreen images created: %d x %d x %d", Width, Height, VulkanContext.SwapChainImageCount);
+	return true;
+}
+
 bool CreateImageViews(FVulkanContext& VulkanContext)
 {
 	VulkanContext.SwapChainImageViews.resize(VulkanContext.SwapChainImageCount);
@@ -490,270 +1018,358 @@ bool CreateImageViews(FVulkanContext& VulkanContext)
 	return true;
 }
 
-bool CreateShaderModule(FVulkanContext& VulkanContext, const std::vector<char>& Code, VkShaderModule& ShaderModule)
+// Replaces the swapchain after a resize, a rotation or an out of date present, without waiting
+// for the GPU: the frames in flight keep rendering to and presenting the old one, which is
+// retired through the deletion queue. False while there is nothing to present to, e.g. while
+// the window is minimized, the swapchain is out of date until a later call succeeds.
+bool RecreateSwapChain(FVulkanContext& VulkanContext)
 {
-	VkShaderModuleCreateInfo CreateInfo = {};
-	CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	CreateInfo.codeSize = Code.size();
-	CreateInfo.pCode = reinterpret_cast<const uint32_t*>(Code.data());
-	
-	if (vkCreateShaderModule(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &ShaderModule) != VK_SUCCESS)
+	SCOPED_CPU_EVENT("RecreateSwapChain");
+	VulkanContext.SwapChainOutOfDate = true;
+	VkSurfaceCapabilitiesKHR SurfaceCap;
+	verify(vkGetPhysicalDeviceSurfaceCapabilitiesKHR(VulkanContext.PhysicalDevice, VulkanContext.Surface, &SurfaceCap) == VK_SUCCESS);
+	VkExtent2D Extent = ChooseSwapExtent(SurfaceCap, VulkanContext.Width, VulkanContext.Height);
+	if (Extent.width == 0 || Extent.height == 0)
 	{
 		return false;
 	}
 
+	// its last presents were queued before the frame fences signaled, which is as close as Vulkan
+	// 1.0 tells when the presentation engine is done with the images
+	std::vector<VkFramebuffer> Framebuffers;
+	VulkanContext.RenderGraph.ReleaseFramebuffers(VulkanContext.SwapChainImageViews, Framebuffers);
+	for (VkFramebuffer Framebuffer : Framebuffers)
+	{
+		VulkanContext.DeletionQueue.Delete(Framebuffer);
+	}
+	for (VkImageView ImageView : VulkanContext.SwapChainImageViews)
+	{
+		VulkanContext.DeletionQueue.Delete(ImageView);
+	}
+	VulkanContext.SwapChainImageViews.clear();
+	// still valid as the oldSwapchain of the new one
+	VulkanContext.DeletionQueue.Delete(VulkanContext.SwapChain);
+	VkExtent2D OldExtent = VulkanContext.SwapChainExtent;
+	if (!CreateSwapChain(VulkanContext))
+	{
+		// the old one is retired either way, the next attempt starts from scratch
+		VulkanContext.SwapChain = VK_NULL_HANDLE;
+		VulkanContext.SwapChainImages.clear();
+		VulkanContext.SwapChainImageCount = 0;
+		return false;
+	}
+	verify(CreateImageViews(VulkanContext));
+	if (VulkanContext.SwapChainExtent.width != OldExtent.width || VulkanContext.SwapChainExtent.height != OldExtent.height)
+	{
+		// the plan hash includes the extent, so the cached plans would only pile up with every size
+		VulkanContext.RenderGraph.RetirePlans(VulkanContext.DeletionQueue);
+	}
+	// the new images aren't used by any frame yet
+	VulkanContext.ImagesInFlight.assign(VulkanContext.SwapChainImageCount, VK_NULL_HANDLE);
+	VulkanContext.SwapChainOutOfDate = false;
 	return true;
 }
 
-bool CreateRenderPass(FVulkanContext& VulkanContext)
+// Acquires the next swapchain image into ImageIndex, signaling Semaphore, and first recreates the
+// swapchain when it's out of date or the window changed. False when there is nothing to render to.
+bool AcquireSwapChainImage(FVulkanContext& VulkanContext, VkSemaphore Semaphore, uint32_t& OutImageIndex)
 {
-	VkAttachmentDescription ColorAttachment{};
-	ColorAttachment.format = VulkanContext.SwapChainFormat;
-	ColorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	ColorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	ColorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	ColorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	ColorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	ColorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	ColorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	// a second attempt when the swapchain turns out of date at the acquire
+	for (uint32_t Attempt = 0; Attempt < 2; ++Attempt)
+	{
+		bool WindowResized = GWindowResized.exchange(false);
+		if ((WindowResized || VulkanContext.SwapChainOutOfDate) && !RecreateSwapChain(VulkanContext))
+		{
+			return false;
+		}
+		// the frame pacer already waited for the display, so this only blocks when the GPU is behind
+		VkResult Result = vkAcquireNextImageKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, UINT64_MAX,
+			Semaphore, VK_NULL_HANDLE, &OutImageIndex);
+		if (Result == VK_SUCCESS)
+		{
+			return true;
+		}
+		VulkanContext.SwapChainOutOfDate = true;
+		// still presentable, and Semaphore is signaled: the swapchain is replaced next frame
+		if (Result == VK_SUBOPTIMAL_KHR)
+		{
+			return true;
+		}
+		verify(Result == VK_ERROR_OUT_OF_DATE_KHR);
+	}
+	return false;
+}
 
-	VkAttachmentReference ColorAttachmentRef{};
-	ColorAttachmentRef.attachment = 0;
-	ColorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+// Returns the driver blob inside a saved cache file, or nullptr if the file is missing, corrupt
+// or was written by a different device or driver.
+const char* ValidatePipelineCacheFile(FVulkanContext& VulkanContext, const std::vector<char>& FileData, size_t& OutDataSize)
+{
+	const VkPhysicalDeviceProperties& Properties = VulkanContext.PhysicalDeviceProperties;
+	if (FileData.size() < sizeof(FPipelineCacheFileHeader) + sizeof(VkPipelineCacheHeaderVersionOne))
+	{
+		return nullptr;
+	}
+	FPipelineCacheFileHeader FileHeader;
+	memcpy(&FileHeader, FileData.data(), sizeof(FileHeader));
+	const char* Data = FileData.data() + sizeof(FileHeader);
+	if (FileHeader.Magic != FPipelineCacheFileHeader::MAGIC || FileHeader.Version != FPipelineCacheFileHeader::VERSION ||
+		FileHeader.DataSize != FileData.size() - sizeof(FileHeader) || FileHeader.DataHash != HashBytes(Data, FileHeader.DataSize))
+	{
+		FPlatformMisc::LocalPrint("Pipeline cache file is corrupt, ignored");
+		return nullptr;
+	}
 
-	VkSubpassDescription Subpass{};
-	Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	Subpass.colorAttachmentCount = 1;
-	Subpass.pColorAttachments = &ColorAttachmentRef;
+	VkPipelineCacheHeaderVersionOne CacheHeader;
+	memcpy(&CacheHeader, Data, sizeof(CacheHeader));
+	if (FileHeader.DriverVersion != Properties.driverVersion ||
+		CacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		CacheHeader.vendorID != Properties.vendorID ||
+		CacheHeader.deviceID != Properties.deviceID ||
+		memcmp(CacheHeader.pipelineCacheUUID, Properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		FPlatformMisc::LocalPrint("Pipeline cache file is from another device or driver, ignored");
+		return nullptr;
+	}
+	OutDataSize = FileHeader.DataSize;
+	return Data;
+}
 
-	VkRenderPassCreateInfo RenderPassInfo{};
-	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	RenderPassInfo.attachmentCount = 1;
-	RenderPassInfo.pAttachments = &ColorAttachment;
-	RenderPassInfo.subpassCount = 1;
-	RenderPassInfo.pSubpasses = &Subpass;
-	if (vkCreateRenderPass(VulkanContext.LogicalDevice, &RenderPassInfo, nullptr, &VulkanContext.RenderPass) != VK_SUCCESS)
+bool CreatePipelineCache(FVulkanContext& VulkanContext)
+{
+	double StartTime = FPlatformMisc::Seconds();
+	std::vector<char> FileData = FPlatformMisc::ReadSavedFile(PIPELINE_CACHE_FILENAME);
+	size_t DataSize = 0;
+	const char* Data = FileData.empty() ? nullptr : ValidatePipelineCacheFile(VulkanContext, FileData, DataSize);
+
+	VkPipelineCacheCreateInfo CreateInfo{};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	CreateInfo.initialDataSize = DataSize;
+	CreateInfo.pInitialData = Data;
+	if (vkCreatePipelineCache(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &VulkanContext.PipelineCache) != VK_SUCCESS)
 	{
-		FPlatformMisc::LocalPrint("Create Render Pass Failed!");
+		FPlatformMisc::LocalPrint("Create Pipeline Cache Failed!");
 		return false;
 	}
-	FPlatformMisc::LocalPrint("Create Render Pass Success!");
+	VulkanContext.PipelineCacheLastSave = FPlatformMisc::Seconds();
+	FPlatformMisc::LocalPrintf("Create Pipeline Cache Successfully! %s, %zu bytes, %.2f ms",
+		Data ? "warm" : "cold", DataSize, (VulkanContext.PipelineCacheLastSave - StartTime) * 1000.0);
 	return true;
 }
 
-bool CreateGraphicsPipeline(FVulkanContext& VulkanContext, bool EnableDepthTest, bool EnableBlend)
+bool SavePipelineCache(FVulkanContext& VulkanContext)
 {
-	std::vector<char> VertShaderCode = FPlatformMisc::ReadFile("Shaders/vert.spv");
-	std::vector<char> FragShaderCode = FPlatformMisc::ReadFile("Shaders/frag.spv");
-
-	if (!CreateShaderModule(VulkanContext, VertShaderCode, VulkanContext.VertShaderModule) ||
-		!CreateShaderModule(VulkanContext, FragShaderCode, VulkanContext.FragShaderModule))
+	size_t DataSize = 0;
+	if (vkGetPipelineCacheData(VulkanContext.LogicalDevice, VulkanContext.PipelineCache, &DataSize, nullptr) != VK_SUCCESS)
 	{
-		FPlatformMisc::LocalPrint("Create Shader Module Failed");
 		return false;
 	}
-
-	VkPipelineShaderStageCreateInfo VertShaderStageInfo{};
-	VertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	VertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-	VertShaderStageInfo.module = VulkanContext.VertShaderModule;
-	VertShaderStageInfo.pName = "main";
-	
-	VkPipelineShaderStageCreateInfo FragShaderStageInfo{};
-	FragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	FragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	FragShaderStageInfo.module = VulkanContext.FragShaderModule;
-	FragShaderStageInfo.pName = "main";
-
-	VkPipelineShaderStageCreateInfo ShaderStages[] = { VertShaderStageInfo, FragShaderStageInfo};
-
-	VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
-	VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	VertexInputInfo.vertexBindingDescriptionCount = 0;
-	VertexInputInfo.pVertexAttributeDescriptions = nullptr;
-	VertexInputInfo.vertexAttributeDescriptionCount = 0;
-	VertexInputInfo.pVertexAttributeDescriptions = nullptr;
-
-	VkPipelineInputAssemblyStateCreateInfo InputAssembly{};
-	InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-	InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-	InputAssembly.primitiveRestartEnable = VK_FALSE;
-
-	VkViewport Viewport{};
-	Viewport.x = Viewport.y = 0.f;
-	Viewport.width = (float)VulkanContext.SwapChainExtent.width;
-	Viewport.height = (float)VulkanContext.SwapChainExtent.height;
-	Viewport.minDepth = 0.f;
-	Viewport.maxDepth = 1.f;
-	VkRect2D Scissor = {{0, 0}, VulkanContext.SwapChainExtent};
-	VkPipelineViewportStateCreateInfo ViewportState{};
-	ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	ViewportState.viewportCount = 1;
-	ViewportState.pViewports = &Viewport;
-	ViewportState.scissorCount = 1;
-	ViewportState.pScissors = &Scissor;
-
-	VkPipelineRasterizationStateCreateInfo RasterState{};
-	RasterState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-	RasterState.depthClampEnable = VK_FALSE;
-	RasterState.rasterizerDiscardEnable = VK_FALSE;
-	RasterState.polygonMode = VK_POLYGON_MODE_FILL;
-	RasterState.lineWidth = 1.f;
-	RasterState.cullMode = VK_CULL_MODE_BACK_BIT;
-	RasterState.frontFace = VK_FRONT_FACE_CLOCKWISE;
-	RasterState.depthBiasEnable = VK_FALSE;
-	RasterState.depthBiasConstantFactor = 0.f;
-	RasterState.depthBiasClamp = 0.f;
-	RasterState.depthBiasSlopeFactor = 0.f;
-
-	VkPipelineMultisampleStateCreateInfo MultiSampleState{};
-	MultiSampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-	MultiSampleState.sampleShadingEnable = VK_FALSE;
-	MultiSampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	MultiSampleState.minSampleShading = 1.f;
-	MultiSampleState.pSampleMask = nullptr;
-	MultiSampleState.alphaToOneEnable = VK_FALSE;
-	MultiSampleState.alphaToCoverageEnable = VK_FALSE;
-
-	VkPipelineDepthStencilStateCreateInfo DepthStencilState{};
-	DepthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-	DepthStencilState.depthTestEnable = EnableDepthTest ? VK_TRUE : VK_FALSE;
-	DepthStencilState.depthWriteEnable = EnableDepthTest ? VK_TRUE : VK_FALSE;
-	DepthStencilState.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-	DepthStencilState.depthBoundsTestEnable = VK_FALSE;
-	DepthStencilState.stencilTestEnable = VK_FALSE;
-	DepthStencilState.back.failOp = VK_STENCIL_OP_KEEP;
-	DepthStencilState.back.passOp = VK_STENCIL_OP_KEEP;
-	DepthStencilState.back.compareOp = VK_COMPARE_OP_ALWAYS;
-	DepthStencilState.back.compareMask = 0;
-	DepthStencilState.back.reference = 0;
-	DepthStencilState.back.depthFailOp = VK_STENCIL_OP_KEEP;
-	DepthStencilState.back.writeMask = 0;
-	DepthStencilState.minDepthBounds = 0;
-	DepthStencilState.maxDepthBounds = 0;
-	DepthStencilState.stencilTestEnable = VK_FALSE;
-	DepthStencilState.front = DepthStencilState.back;
-	
-	VkPipelineColorBlendAttachmentState ColorBlendAttachState[1];
-	VkColorComponentFlags ColorMask = EnableBlend ? (VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT 
-												   | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT) : 0xf;
-	ColorBlendAttachState[0].colorWriteMask = ColorMask;
-	ColorBlendAttachState[0].blendEnable = EnableBlend ? VK_TRUE : VK_FALSE;
-	ColorBlendAttachState[0].alphaBlendOp = VK_BLEND_OP_ADD;
-	ColorBlendAttachState[0].colorBlendOp = VK_BLEND_OP_ADD;
-	ColorBlendAttachState[0].srcColorBlendFactor = EnableBlend ? VK_BLEND_FACTOR_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
-	ColorBlendAttachState[0].dstColorBlendFactor = EnableBlend ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA: VK_BLEND_FACTOR_ZERO;
-	ColorBlendAttachState[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-	ColorBlendAttachState[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-	VkPipelineColorBlendStateCreateInfo BlendState{};
-	BlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-	BlendState.attachmentCount = 1;
-	BlendState.pAttachments = ColorBlendAttachState;
-	BlendState.logicOpEnable = VK_FALSE;
-	BlendState.logicOp = VK_LOGIC_OP_NO_OP;
-	BlendState.blendConstants[0] = 1.0f;
-	BlendState.blendConstants[1] = 1.0f;
-	BlendState.blendConstants[2] = 1.0f;
-	BlendState.blendConstants[3] = 1.0f;
-
-	VkDynamicState DynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_LINE_WIDTH};
-	VkPipelineDynamicStateCreateInfo DynamicState{};
-	DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	DynamicState.dynamicStateCount = 2;
-	DynamicState.pDynamicStates = DynamicStates;
-
-	VkPipelineLayoutCreateInfo PipelineCreateInfo{};
-	PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	PipelineCreateInfo.setLayoutCount = 0;
-	PipelineCreateInfo.pSetLayouts = nullptr;
-	PipelineCreateInfo.pushConstantRangeCount = 0;
-	PipelineCreateInfo.pPushConstantRanges = nullptr;
-	assert(vkCreatePipelineLayout(VulkanContext.LogicalDevice, &PipelineCreateInfo, nullptr, &VulkanContext.PipelineLayout) == VK_SUCCESS);
-
-	VkGraphicsPipelineCreateInfo PipelineInfo{};
-	PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	PipelineInfo.stageCount = 2;
-	PipelineInfo.pStages = ShaderStages;
-	PipelineInfo.pVertexInputState = &VertexInputInfo;
-	PipelineInfo.pInputAssemblyState = &InputAssembly;
-	PipelineInfo.pViewportState = &ViewportState;
-	PipelineInfo.pRasterizationState = &RasterState;
-	PipelineInfo.pMultisampleState = &MultiSampleState;
-	PipelineInfo.pDepthStencilState = &DepthStencilState;
-	PipelineInfo.pColorBlendState = &BlendState;
-	PipelineInfo.pDynamicState = &DynamicState;
-	PipelineInfo.layout = VulkanContext.PipelineLayout;
-	PipelineInfo.renderPass = VulkanContext.RenderPass;
-	PipelineInfo.subpass = 0;
-	PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-	PipelineInfo.basePipelineIndex = -1;
-	VkResult Res = vkCreateGraphicsPipelines(VulkanContext.LogicalDevice, VK_NULL_HANDLE, 1, &PipelineInfo, 
-									nullptr, &VulkanContext.GraphicsPipeline);
-	assert(Res == VK_SUCCESS);
-
+	std::vector<char> FileData(sizeof(FPipelineCacheFileHeader) + DataSize);
+	char* Data = FileData.data() + sizeof(FPipelineCacheFileHeader);
+	if (vkGetPipelineCacheData(VulkanContext.LogicalDevice, VulkanContext.PipelineCache, &DataSize, Data) != VK_SUCCESS)
+	{
+		return false;
+	}
+	FileData.resize(sizeof(FPipelineCacheFileHeader) + DataSize);
+
+	FPipelineCacheFileHeader FileHeader;
+	FileHeader.Magic = FPipelineCacheFileHeader::MAGIC;
+	FileHeader.Version = FPipelineCacheFileHeader::VERSION;
+	FileHeader.DriverVersion = VulkanContext.PhysicalDeviceProperties.driverVersion;
+	FileHeader.DataSize = (uint32_t)DataSize;
+	FileHeader.DataHash = HashBytes(Data, DataSize);
+	memcpy(FileData.data(), &FileHeader, sizeof(FileHeader));
+
+	VulkanContext.PipelineCacheLastSave = FPlatformMisc::Seconds();
+	if (!FPlatformMisc::WriteSavedFile(PIPELINE_CACHE_FILENAME, FileData.data(), FileData.size()))
+	{
+		return false;
+	}
+	VulkanContext.PipelineCacheDirty = false;
+	FPlatformMisc::LocalPrintf("Saved pipeline cache: %zu bytes", DataSize);
 	return true;
 }
 
-bool CreateFrameBuffers(FVulkanContext& VulkanContext)
+// Saves the cache periodically while running, so a crash doesn't lose the pipelines compiled so far.
+void TickPipelineCache(FVulkanContext& VulkanContext)
 {
-	VulkanContext.SwapChainFramebuffers.resize(VulkanContext.SwapChainImageCount);
-	for (uint32_t i = 0; i < VulkanContext.SwapChainImageCount; ++i)
+	if (VulkanContext.PipelineStateCache.ConsumePipelineCacheDirty())
+	{
+		VulkanContext.PipelineCacheDirty = true;
+	}
+	if (VulkanContext.PipelineCacheDirty &&
+		FPlatformMisc::Seconds() - VulkanContext.PipelineCacheLastSave > PIPELINE_CACHE_SAVE_INTERVAL)
 	{
-		VkImageView attachments[] = {VulkanContext.SwapChainImageViews[i]};
-		VkFramebufferCreateInfo CreateInfo{};
-		CreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		CreateInfo.renderPass = VulkanContext.RenderPass;
-		CreateInfo.attachmentCount = 1;
-		CreateInfo.pAttachments = attachments;
-		CreateInfo.width = VulkanContext.SwapChainExtent.width;
-		CreateInfo.height = VulkanContext.SwapChainExtent.height;
-		CreateInfo.layers = 1;
-		if (vkCreateFramebuffer(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &VulkanContext.SwapChainFramebuffers[i]) != VK_SUCCESS)
+		SavePipelineCache(VulkanContext);
+	}
+}
+
+// Checks the layout feeds every input the vertex shader reads, with the format it was compiled for.
+bool ValidateVertexLayout(FVulkanContext& VulkanContext, uint64_t VertexShader, const FVertexInputLayout& VertexLayout)
+{
+	FShaderReflection Reflection;
+	if (!VulkanContext.ShaderLibrary.GetReflection(VertexShader, Reflection))
+	{
+		return false;
+	}
+	for (const FShaderVertexInput& Input : Reflection.VertexInputs)
+	{
+		auto Attribute = std::find_if(VertexLayout.Attributes.begin(), VertexLayout.Attributes.end(),
+			[&Input](const VkVertexInputAttributeDescription& Attribute) { return Attribute.location == Input.Location; });
+		if (Attribute == VertexLayout.Attributes.end())
 		{
+			TE_LOG(LogRHI, Error, "Vertex layout has no attribute for location %u of the vertex shader", Input.Location);
+			return false;
+		}
+		if (Input.Format != VK_FORMAT_UNDEFINED && Attribute->format != (VkFormat)Input.Format)
+		{
+			TE_LOG(LogRHI, Error, "Vertex attribute %u is format %d, the vertex shader reads format %u", Input.Location, (int)Attribute->format, Input.Format);
 			return false;
 		}
 	}
-	FPlatformMisc::LocalPrint("Create Frame Buffers Successfully!");
 	return true;
 }
 
-bool CreateCommandPool(FVulkanContext& VulkanContext)
+// Before CreateGraphicsPipeline, whose layout starts with the uniform ring's set, then the bindless
+// table's when there is one.
+bool CreateDescriptors(FVulkanContext& VulkanContext)
 {
-	VkCommandPoolCreateInfo CreateInfo{};
-	CreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	CreateInfo.queueFamilyIndex = VulkanContext.GraphicsFamilyIndex;
-	CreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-
-	if (vkCreateCommandPool(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &VulkanContext.CommandPool) != VK_SUCCESS)
+	VulkanContext.DescriptorAllocator.Init(VulkanContext.LogicalDevice, GMaxFramesInFlight);
+	if (!VulkanContext.UniformRing.Init(VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator, VulkanContext.DescriptorAllocator,
+		VulkanContext.PhysicalDeviceProperties.limits, GMaxFramesInFlight))
 	{
-		FPlatformMisc::LocalPrint("Create Command Pool Failed!");
 		return false;
 	}
-	else
+	if (!VulkanContext.SupportsDescriptorIndexing)
 	{
-		FPlatformMisc::LocalPrint("Create Command Pool Successfully!");
+		FPlatformMisc::LocalPrint("Bindless table: descriptor indexing not supported");
 		return true;
 	}
+	// without the table, resources can still be bound through the descriptor allocator
+	VulkanContext.BindlessTable.Init(VulkanContext.LogicalDevice, GMaxFramesInFlight, VulkanContext.MaxBindlessTextures, VulkanContext.MaxBindlessBuffers);
+	return true;
 }
 
-bool CreateCommandBuffers(FVulkanContext& VulkanContext)
+bool CreateGraphicsPipeline(FVulkanContext& VulkanContext, bool EnableDepthTest, bool EnableBlend)
 {
-	VulkanContext.CommandBuffers.resize(VulkanContext.SwapChainImageCount);
-	VkCommandBufferAllocateInfo AllocInfo{};
-	AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	AllocInfo.commandPool = VulkanContext.CommandPool;
-	AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	AllocInfo.commandBufferCount = (uint32_t)VulkanContext.CommandBuffers.size();
-	if (vkAllocateCommandBuffers(VulkanContext.LogicalDevice, &AllocInfo, VulkanContext.CommandBuffers.data()) != VK_SUCCESS)
+	// shaders are referred to by content hash, so the pre-warm list finds them again next run
+	FGraphicsPipelineStateDesc Desc;
+	Desc.VertexShader = VulkanContext.ShaderLibrary.FindShader("shader.vert");
+	Desc.FragmentShader = VulkanContext.ShaderLibrary.FindShader("shader.frag");
+	if (Desc.VertexShader == 0 || Desc.FragmentShader == 0)
 	{
-		FPlatformMisc::LocalPrint("Create Command Buffers Failed!");
 		return false;
 	}
-	else
+	// the layout's push-constant range must cover the shader's block
+	FShaderReflection VertexReflection;
+	if (VulkanContext.ShaderLibrary.GetReflection(Desc.VertexShader, VertexReflection) &&
+		VertexReflection.PushConstantSize > sizeof(FDrawConstants))
 	{
-		FPlatformMisc::LocalPrint("Create Command Buffers Successfully!");
-		return true;
+		TE_LOG(LogRHI, Error, "shader.vert reads %u bytes of push constants, FDrawConstants has %u",
+			VertexReflection.PushConstantSize, (uint32_t)sizeof(FDrawConstants));
+		return false;
+	}
+
+	VkPipelineLayoutCreateInfo PipelineCreateInfo{};
+	PipelineCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	VkDescriptorSetLayout SetLayouts[] = { VulkanContext.UniformRing.GetLayout(), VulkanContext.BindlessTable.GetLayout() };
+	PipelineCreateInfo.setLayoutCount = VulkanContext.BindlessTable.IsInitialized() ? 2 : 1;
+	PipelineCreateInfo.pSetLayouts = SetLayouts;
+	VkPushConstantRange DrawPushConstants{VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(FDrawConstants)};
+	PipelineCreateInfo.pushConstantRangeCount = 1;
+	PipelineCreateInfo.pPushConstantRanges = &DrawPushConstants;
+	verify(vkCreatePipelineLayout(VulkanContext.LogicalDevice, &PipelineCreateInfo, nullptr, &VulkanContext.PipelineLayout) == VK_SUCCESS);
+	Desc.Layout = MAIN_PIPELINE_LAYOUT;
+	VulkanContext.PipelineStateCache.RegisterLayout(Desc.Layout, VulkanContext.PipelineLayout);
+
+	// FSceneVertex per vertex, FSceneInstance per instance
+	FVertexInputLayout VertexLayout;
+	VertexLayout.Bindings = {
+		{ 0, sizeof(FSceneVertex), VK_VERTEX_INPUT_RATE_VERTEX },
+		{ 1, sizeof(FSceneInstance), VK_VERTEX_INPUT_RATE_INSTANCE },
+	};
+	VertexLayout.Attributes = {
+		{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FSceneVertex, Position) },
+		{ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(FSceneVertex, Color) },
+		{ 2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0 },
+	};
+	if (!ValidateVertexLayout(VulkanContext, Desc.VertexShader, VertexLayout))
+	{
+		return false;
 	}
+	Desc.VertexLayout = HashVertexInputLayout(VertexLayout);
+	VulkanContext.PipelineStateCache.RegisterVertexLayout(Desc.VertexLayout, VertexLayout);
+
+	Desc.RenderPass = VulkanContext.MainRenderPassKey;
+	Desc.Subpass = VulkanContext.MainSubpass;
+	VulkanContext.PipelineStateCache.RegisterRenderPass(Desc.RenderPass, VulkanContext.RenderPass);
+
+	uint32_t NumWorkers = std::max(1u, std::thread::hardware_concurrency() / 2);
+	VulkanContext.PipelineStateCache.Init(VulkanContext.LogicalDevice, VulkanContext.PipelineCache,
+		VulkanContext.SupportsPipelineCreationFeedback, NumWorkers);
+
+	// the opaque pipeline is compiled up front, and drawn with while anything else is compiling
+	double StartTime = FPlatformMisc::Seconds();
+	VulkanContext.GraphicsPipeline = VulkanContext.PipelineStateCache.FindOrCompileBlocking(Desc);
+	if (VulkanContext.GraphicsPipeline == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+	FPlatformMisc::LocalPrintf("Fallback pipeline created in %.2f ms", (FPlatformMisc::Seconds() - StartTime) * 1000.0);
+
+	Desc.DepthTestEnable = EnableDepthTest;
+	Desc.DepthWriteEnable = EnableDepthTest;
+	if (EnableBlend)
+	{
+		Desc.BlendEnable = VK_TRUE;
+		Desc.SrcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		Desc.DstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	}
+	VulkanContext.MainPassPSO = Desc;
+
+	VulkanContext.PipelineStateCache.LoadPrewarmList(PIPELINE_PREWARM_FILENAME);
+	return true;
+}
+
+bool CreateCommandPool(FVulkanContext& VulkanContext)
+{
+	VkCommandPoolCreateInfo CreateInfo{};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	CreateInfo.queueFamilyIndex = VulkanContext.GraphicsFamilyIndex;
+	CreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+	VulkanContext.Frames.resize(GMaxFramesInFlight);
+	VulkanContext.FramesInFlight = GMaxFramesInFlight;
+	for (FFrameResources& Frame : VulkanContext.Frames)
+	{
+		if (vkCreateCommandPool(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &Frame.CommandPool) != VK_SUCCESS)
+		{
+			FPlatformMisc::LocalPrint("Create Command Pool Failed!");
+			return false;
+		}
+	}
+
+	VulkanContext.ParallelRecorder.Init(VulkanContext.LogicalDevice, VulkanContext.GraphicsFamilyIndex, GMaxFramesInFlight);
+	FPlatformMisc::LocalPrint("Create Command Pool Successfully!");
+	return true;
+}
+
+bool CreateCommandBuffers(FVulkanContext& VulkanContext)
+{
+	for (FFrameResources& Frame : VulkanContext.Frames)
+	{
+		VkCommandBufferAllocateInfo AllocInfo{};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		AllocInfo.commandPool = Frame.CommandPool;
+		AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		AllocInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(VulkanContext.LogicalDevice, &AllocInfo, &Frame.CommandBuffer) != VK_SUCCESS)
+		{
+			FPlatformMisc::LocalPrint("Create Command Buffers Failed!");
+			return false;
+		}
+	}
+	FPlatformMisc::LocalPrint("Create Command Buffers Successfully!");
+	return true;
 }
 
 bool CreateSemaphoreAndFence(FVulkanContext& VulkanContext)
@@ -761,43 +1377,180 @@ bool CreateSemaphoreAndFence(FVulkanContext& VulkanContext)
 	VkSemaphoreCreateInfo CreateInfo{};
 	CreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	assert(vkCreateSemaphore(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &VulkanContext.PresentFinishedSemaphore) == VK_SUCCESS);
-	assert(vkCreateSemaphore(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &VulkanContext.RenderFinishedSemaphore) == VK_SUCCESS);
-
 	VkFenceCreateInfo FenceInfo{};
 	FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	FenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-	assert(vkCreateFence(VulkanContext.LogicalDevice, &FenceInfo, nullptr, &VulkanContext.Fence) == VK_SUCCESS);
-	FPlatformMisc::LocalPrint("Create Semaphore and Fence Successfully!");
+
+	for (FFrameResources& Frame : VulkanContext.Frames)
+	{
+		verify(vkCreateSemaphore(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &Frame.PresentFinishedSemaphore) == VK_SUCCESS);
+		verify(vkCreateSemaphore(VulkanContext.LogicalDevice, &CreateInfo, nullptr, &Frame.RenderFinishedSemaphore) == VK_SUCCESS);
+		verify(vkCreateFence(VulkanContext.LogicalDevice, &FenceInfo, nullptr, &Frame.Fence) == VK_SUCCESS);
+	}
+	VulkanContext.ImagesInFlight.assign(VulkanContext.SwapChainImageCount, VK_NULL_HANDLE);
+	FPlatformMisc::LocalPrintf("Create Semaphore and Fence Successfully! %d frames in flight", (int)VulkanContext.Frames.size());
 	return true;
 }
 
-void DrawFrame(FVulkanContext& VulkanContext)
+// Hands the scene to FVulkanGpuCulling, whose visible instances and indirect draws replace the
+// instance buffer and the draws built on the CPU.
+bool CreateGpuCulling(FVulkanContext& VulkanContext, const std::vector<FSceneInstance>& Instances)
 {
-	if (GIsRequestingExit)
-		return;
-	vkWaitForFences(VulkanContext.LogicalDevice, 1, &VulkanContext.Fence, VK_TRUE, UINT64_MAX);
-	vkResetFences(VulkanContext.LogicalDevice, 1, &VulkanContext.Fence);
+	bool IsAsync = VulkanContext.ComputeFamilyIndex != VulkanContext.GraphicsFamilyIndex;
+	std::vector<uint32_t> QueueFamilies = { (uint32_t)VulkanContext.GraphicsFamilyIndex, (uint32_t)VulkanContext.TransferFamilyIndex,
+		(uint32_t)VulkanContext.ComputeFamilyIndex };
+	uint32_t MaxDrawIndirectCount = VulkanContext.EnabledFeatures.multiDrawIndirect ? VulkanContext.PhysicalDeviceProperties.limits.maxDrawIndirectCount : 1;
+	if (!VulkanContext.GpuCulling.Init(VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator, VulkanContext.UploadManager,
+		VulkanContext.ShaderLibrary, VulkanContext.PipelineCache, (uint32_t)VulkanContext.Frames.size(), QueueFamilies,
+		IsAsync ? VulkanContext.ComputeQueue : VK_NULL_HANDLE, VulkanContext.ComputeFamilyIndex, VulkanContext.SupportsDrawIndirectCount, MaxDrawIndirectCount))
+	{
+		FPlatformMisc::LocalPrint("Create GPU Culling Failed!");
+		return false;
+	}
+	std::vector<const FVulkanMesh*> Meshes;
+	std::vector<uint32_t> FirstInstances;
+	std::vector<float> BoundingRadii;
+	for (const FSceneDraw& Draw : VulkanContext.SceneDraws)
+	{
+		Meshes.push_back(&VulkanContext.MeshPool.GetMesh(Draw.Mesh));
+		FirstInstances.push_back(Draw.FirstInstance);
+		// the polygons' corners are on a circle of radius 0.5
+		BoundingRadii.push_back(0.5f);
+	}
+	if (!VulkanContext.GpuCulling.SetScene(Instances.data(), (uint32_t)Instances.size(), Meshes, FirstInstances, BoundingRadii))
+	{
+		FPlatformMisc::LocalPrint("Create GPU Culling Failed!");
+		return false;
+	}
+	FPlatformMisc::LocalPrintf("Scene: %u instances of %u meshes, culled on the GPU", GNumInstances, NUM_SCENE_MESHES);
+	return true;
+}
 
-	uint32_t ImageIndex;
-	vkAcquireNextImageKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, 1000000000,
-		VulkanContext.PresentFinishedSemaphore, VK_NULL_HANDLE, &ImageIndex);
+// Walks the transform and mesh columns of the scene's entities and writes their instances grouped
+// by mesh, with one FSceneDraw per mesh. Meshes maps FSceneMesh::MeshIndex to the mesh pool.
+void ExtractSceneInstances(FVulkanContext& VulkanContext, const std::vector<uint32_t>& Meshes, std::vector<FSceneInstance>& OutInstances)
+{
+	FEntityQuery Query;
+	Query.With<FSceneTransform, FSceneMesh>();
 
-	VkCommandBufferBeginInfo BeginInfo{};
-	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	assert (vkBeginCommandBuffer(VulkanContext.CommandBuffers[ImageIndex], &BeginInfo) == VK_SUCCESS);
+	// counted first, so every instance is written straight to its mesh's range
+	std::vector<uint32_t> NumMeshInstances(Meshes.size(), 0);
+	VulkanContext.Scene.ForEachChunk(Query, [&NumMeshInstances](const FChunkView& Chunk)
+	{
+		const FSceneMesh* MeshComponents = Chunk.Read<FSceneMesh>();
+		for (uint32_t i = 0; i < Chunk.Num(); ++i)
+			++NumMeshInstances[MeshComponents[i].MeshIndex];
+	});
+	std::vector<uint32_t> NextInstance(Meshes.size());
+	std::vector<uint32_t> DrawIndices(Meshes.size());
+	uint32_t NumInstances = 0;
+	for (uint32_t MeshIndex = 0; MeshIndex < Meshes.size(); ++MeshIndex)
+	{
+		NextInstance[MeshIndex] = NumInstances;
+		DrawIndices[MeshIndex] = (uint32_t)VulkanContext.SceneDraws.size();
+		if (NumMeshInstances[MeshIndex] > 0)
+		{
+			VulkanContext.SceneDraws.push_back({ Meshes[MeshIndex], NumInstances, NumMeshInstances[MeshIndex] });
+			NumInstances += NumMeshInstances[MeshIndex];
+		}
+	}
+
+	OutInstances.resize(NumInstances);
+	VulkanContext.InstanceMeshes.resize(NumInstances);
+	VulkanContext.Scene.ForEachChunk(Query, [&](const FChunkView& Chunk)
+	{
+		const FSceneTransform* Transforms = Chunk.Read<FSceneTransform>();
+		const FSceneMesh* MeshComponents = Chunk.Read<FSceneMesh>();
+		for (uint32_t i = 0; i < Chunk.Num(); ++i)
+		{
+			uint32_t MeshIndex = MeshComponents[i].MeshIndex;
+			uint32_t Instance = NextInstance[MeshIndex]++;
+			OutInstances[Instance] = { { Transforms[i].Position[0], Transforms[i].Position[1] }, Transforms[i].Scale, DrawIndices[MeshIndex] };
+			VulkanContext.InstanceMeshes[Instance] = Meshes[MeshIndex];
+		}
+	});
+}
 
-	VkRenderPassBeginInfo RenderPassInfo{};
-	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	RenderPassInfo.renderPass = VulkanContext.RenderPass;
-	RenderPassInfo.framebuffer = VulkanContext.SwapChainFramebuffers[ImageIndex];
-	RenderPassInfo.renderArea = {{0, 0}, VulkanContext.SwapChainExtent};
-	VkClearValue ClearColor = {0.f, 0.f, 0.f, 1.f};
-	RenderPassInfo.clearValueCount = 1;
-	RenderPassInfo.pClearValues = &ClearColor;
-	vkCmdBeginRenderPass(VulkanContext.CommandBuffers[ImageIndex], &RenderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+// Packs the scene's meshes into the mesh pool and spreads GNumInstances entities over a grid
+// covering the screen. Entity i draws mesh i % NUM_SCENE_MESHES; their instances are extracted
+// grouped by mesh, so every mesh is one FSceneDraw.
+bool CreateScene(FVulkanContext& VulkanContext)
+{
+	if (!VulkanContext.MeshPool.Init(VulkanContext.MemoryAllocator, VulkanContext.UploadManager, sizeof(FSceneVertex)))
+	{
+		return false;
+	}
+	std::vector<FSceneVertex> Vertices;
+	std::vector<uint32_t> Indices;
+	std::vector<uint32_t> Meshes;
+	for (uint32_t MeshIndex = 0; MeshIndex < NUM_SCENE_MESHES; ++MeshIndex)
+	{
+		// clockwise in framebuffer space, which is y down
+		uint32_t NumCorners = MeshIndex + 3;
+		Vertices.resize(NumCorners);
+		for (uint32_t i = 0; i < NumCorners; ++i)
+		{
+			float Angle = 6.2831853f * i / NumCorners - 1.5707963f;
+			Vertices[i] = { { 0.5f * cosf(Angle), 0.5f * sinf(Angle), 0.f },
+				{ i % 3 == 0 ? 1.f : 0.f, i % 3 == 1 ? 1.f : 0.f, i % 3 == 2 ? 1.f : 0.f } };
+		}
+		Indices.clear();
+		for (uint32_t i = 1; i + 1 < NumCorners; ++i)
+		{
+			Indices.insert(Indices.end(), { 0, i, i + 1 });
+		}
+		uint32_t Mesh = VulkanContext.MeshPool.AddMesh(Vertices.data(), NumCorners, Indices.data(), (uint32_t)Indices.size());
+		if (Mesh == FVulkanMeshPool::INVALID_MESH)
+		{
+			FPlatformMisc::LocalPrint("Create Scene Failed!");
+			return false;
+		}
+		Meshes.push_back(Mesh);
+	}
 
-	vkCmdBindPipeline(VulkanContext.CommandBuffers[ImageIndex], VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanContext.GraphicsPipeline);
+	uint32_t GridSize = (uint32_t)ceil(sqrt((double)GNumInstances));
+	float CellSize = 2.f / GridSize;
+	for (uint32_t i = 0; i < GNumInstances; ++i)
+	{
+		float X = -1.f + CellSize * (i % GridSize + 0.5f);
+		float Y = -1.f + CellSize * (i / GridSize + 0.5f);
+		// half a cell wide, a single instance matches the original triangle
+		VulkanContext.Scene.CreateEntity(FSceneTransform{ { X, Y }, 0.5f * CellSize }, FSceneMesh{ i % NUM_SCENE_MESHES });
+	}
+	std::vector<FSceneInstance> Instances;
+	ExtractSceneInstances(VulkanContext, Meshes, Instances);
+	if (GUseGpuCulling && VulkanContext.EnabledFeatures.drawIndirectFirstInstance != VK_TRUE)
+	{
+		FPlatformMisc::LocalPrint("GPU culling needs drawIndirectFirstInstance, drawing everything");
+		GUseGpuCulling = false;
+	}
+	if (GUseGpuCulling)
+	{
+		GUseDirectDraws = false;
+		return CreateGpuCulling(VulkanContext, Instances);
+	}
+	VkDeviceSize InstanceBufferSize = Instances.size() * sizeof(FSceneInstance);
+	VulkanContext.InstanceBuffer = VulkanContext.MemoryAllocator.CreateBuffer(InstanceBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly);
+	if (VulkanContext.InstanceBuffer == nullptr)
+	{
+		FPlatformMisc::LocalPrint("Create Scene Failed!");
+		return false;
+	}
+	VulkanContext.SceneUploadTicket = VulkanContext.UploadManager.UploadBuffer(VulkanContext.InstanceBuffer->Buffer, 0, Instances.data(), InstanceBufferSize);
+
+	VulkanContext.DrawBatcher.Init(VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator, (uint32_t)VulkanContext.Frames.size(),
+		VulkanContext.EnabledFeatures, VulkanContext.PhysicalDeviceProperties.limits.maxDrawIndirectCount, VulkanContext.SupportsDrawIndirectCount);
+	FPlatformMisc::LocalPrintf("Scene: %u instances of %u meshes, %s", GNumInstances, NUM_SCENE_MESHES,
+		GUseDirectDraws ? "one draw per instance" : "batched into indirect draws");
+	return true;
+}
+
+// Records the main pass draws of NumInstances instances from FirstInstance on, which for indirect
+// draws must be the whole scene. Works for primary and secondary command buffers, so sets all
+// state a secondary buffer doesn't inherit.
+void RecordMainPass(FVulkanContext& VulkanContext, VkCommandBuffer CommandBuffer, VkPipeline Pipeline, uint32_t FirstInstance, uint32_t NumInstances)
+{
+	vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, Pipeline);
 
 	VkViewport Viewport{};
 	Viewport.x = Viewport.y = 0.f;
@@ -805,104 +1558,565 @@ void DrawFrame(FVulkanContext& VulkanContext)
 	Viewport.height = (float)VulkanContext.SwapChainExtent.height;
 	Viewport.minDepth = 0.f;
 	Viewport.maxDepth = 1.f;
-	vkCmdSetViewport(VulkanContext.CommandBuffers[ImageIndex], 0, 1, &Viewport);
-	//VkRect2D Scissor = { {0, 0}, VulkanContext.SwapChainExtent };
-	//VkPipelineViewportStateCreateInfo ViewportState{};
-	//ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-	//ViewportState.viewportCount = 1;
-	//ViewportState.pViewports = &Viewport;
-	//ViewportState.scissorCount = 1;
-	//ViewportState.pScissors = &Scissor;
-	vkCmdSetLineWidth(VulkanContext.CommandBuffers[ImageIndex], 1.f);
+	vkCmdSetViewport(CommandBuffer, 0, 1, &Viewport);
+	VkRect2D Scissor = { {0, 0}, VulkanContext.SwapChainExtent };
+	vkCmdSetScissor(CommandBuffer, 0, 1, &Scissor);
+	vkCmdSetLineWidth(CommandBuffer, 1.f);
+	const FUniformAllocation& ViewUniforms = VulkanContext.ViewUniforms;
+	vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanContext.PipelineLayout, 0, 1, &ViewUniforms.Set, 1, &ViewUniforms.Offset);
+	// once per command buffer, draws only pass indices into it
+	if (VulkanContext.BindlessTable.IsInitialized())
+	{
+		VulkanContext.BindlessTable.Bind(CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, VulkanContext.PipelineLayout, 1);
+	}
+	// the whole scene is drawn untinted, so the constants are pushed once for all draws
+	FDrawConstants DrawConstants{FVector4(1.f, 1.f, 1.f, 1.f)};
+	vkCmdPushConstants(CommandBuffer, VulkanContext.PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &DrawConstants);
 
-	vkCmdDraw(VulkanContext.CommandBuffers[ImageIndex], 3, 1, 0, 0);
+	if (GUseGpuCulling)
+	{
+		// the culling pass skipped the frame as well when its scene isn't usable yet
+		if (VulkanContext.GpuCulling.IsReady() && VulkanContext.UploadManager.IsComplete(VulkanContext.MeshPool.GetLastUploadTicket()))
+		{
+			VulkanContext.MeshPool.Bind(CommandBuffer);
+			VulkanContext.GpuCulling.RecordDraws(CommandBuffer);
+		}
+		return;
+	}
+	// meshes become usable once their upload was acquired by a previous command buffer
+	if (!VulkanContext.UploadManager.IsComplete(VulkanContext.SceneUploadTicket) ||
+		!VulkanContext.UploadManager.IsComplete(VulkanContext.MeshPool.GetLastUploadTicket()))
+	{
+		return;
+	}
+	VulkanContext.MeshPool.Bind(CommandBuffer);
+	VkDeviceSize InstanceOffset = 0;
+	vkCmdBindVertexBuffers(CommandBuffer, 1, 1, &VulkanContext.InstanceBuffer->Buffer, &InstanceOffset);
+	if (!GUseDirectDraws)
+	{
+		VulkanContext.DrawBatcher.Record(CommandBuffer);
+		return;
+	}
+	for (uint32_t i = FirstInstance; i < FirstInstance + NumInstances; ++i)
+	{
+		const FVulkanMesh& Mesh = VulkanContext.MeshPool.GetMesh(VulkanContext.InstanceMeshes[i]);
+		vkCmdDrawIndexed(CommandBuffer, Mesh.NumIndices, 1, Mesh.FirstIndex, Mesh.VertexOffset, i);
+	}
+}
+
+// Declares the frame's passes. Pipeline is only needed when the graph is executed.
+FRGPass BuildFrameGraph(FVulkanContext& VulkanContext, uint32_t ImageIndex, VkPipeline Pipeline)
+{
+	FRenderGraph& Graph = VulkanContext.RenderGraph;
+	Graph.BeginFrame();
+
+	FRGTextureDesc BackBufferDesc;
+	BackBufferDesc.Format = VulkanContext.SwapChainFormat;
+	BackBufferDesc.Extent = VulkanContext.SwapChainExtent;
+	// PRESENT_SRC is only valid with VK_KHR_swapchain enabled
+	FRGTexture BackBuffer = Graph.ImportTexture("BackBuffer", VulkanContext.SwapChainImages[ImageIndex], VulkanContext.SwapChainImageViews[ImageIndex],
+		BackBufferDesc, VK_IMAGE_LAYOUT_UNDEFINED, GIsHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-	vkCmdEndRenderPass(VulkanContext.CommandBuffers[ImageIndex]);
-	assert (vkEndCommandBuffer(VulkanContext.CommandBuffers[ImageIndex]) == VK_SUCCESS);
+	if (GUseGpuCulling && !VulkanContext.GpuCulling.IsAsync())
+	{
+		// writes buffers only, which the graph doesn't track
+		Graph.AddPass("GpuCulling", [&VulkanContext](const FRGPassContext& Context)
+		{
+			if (VulkanContext.GpuCulling.IsReady())
+			{
+				VulkanContext.GpuCulling.Record(Context.CommandBuffer);
+			}
+		}).SetSideEffects();
+	}
+
+	// indirect draws are a handful of commands, only direct draws are worth recording in parallel
+	uint32_t NumChunks = GUseDirectDraws ? (GNumInstances + DRAWS_PER_RECORDING_CHUNK - 1) / DRAWS_PER_RECORDING_CHUNK : 1;
+	FRGPassBuilder MainPass = Graph.AddRasterPass("Main", [&VulkanContext, Pipeline, NumChunks](const FRGPassContext& Context)
+	{
+		if (NumChunks > 1)
+		{
+			auto RecordChunk = [&VulkanContext, Pipeline](VkCommandBuffer ChunkCommandBuffer, uint32_t ChunkIndex)
+			{
+				uint32_t FirstInstance = ChunkIndex * DRAWS_PER_RECORDING_CHUNK;
+				RecordMainPass(VulkanContext, ChunkCommandBuffer, Pipeline, FirstInstance, std::min(DRAWS_PER_RECORDING_CHUNK, GNumInstances - FirstInstance));
+			};
+			VulkanContext.ParallelRecorder.Record(Context.RenderPass, Context.Subpass, Context.Framebuffer,
+				NumChunks, RecordChunk, VulkanContext.SecondaryCommandBuffers);
+			vkCmdExecuteCommands(Context.CommandBuffer, NumChunks, VulkanContext.SecondaryCommandBuffers.data());
+		}
+		else
+		{
+			RecordMainPass(VulkanContext, Context.CommandBuffer, Pipeline, 0, GNumInstances);
+		}
+	});
+	MainPass.WriteColor(BackBuffer, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.f, 0.f, 0.f, 1.f}});
+	if (NumChunks > 1)
+	{
+		MainPass.SetSecondaryCommandBuffers();
+	}
+	return MainPass;
+}
+
+// Compiles the frame graph once up front, for the render pass the main pass pipeline is created against.
+bool CreateFrameGraph(FVulkanContext& VulkanContext)
+{
+	VulkanContext.RenderGraph.Init(VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator);
+	FRGPass MainPass = BuildFrameGraph(VulkanContext, 0, VK_NULL_HANDLE);
+	VulkanContext.RenderGraph.Compile();
+	VulkanContext.RenderPass = VulkanContext.RenderGraph.GetRenderPass(MainPass, VulkanContext.MainSubpass);
+	if (VulkanContext.RenderPass == VK_NULL_HANDLE)
+	{
+		FPlatformMisc::LocalPrint("Create Frame Graph Failed!");
+		return false;
+	}
+	VulkanContext.MainRenderPassKey = VulkanContext.RenderGraph.GetRenderPassKey(MainPass);
+	VulkanContext.RenderGraph.DumpPlan();
+	return true;
+}
+
+// Moves device-local buffers out of mostly empty blocks every DEFRAGMENT_INTERVAL, recorded into
+// the frame's command buffer. Their users look the buffers up when recording, and the old ones are
+// released once the frame finished, the frames before it may still read them. Host visible
+// buffers stay put, the CPU writes them for frames that don't wait for this one.
+void TickDefragment(FVulkanContext& VulkanContext, VkCommandBuffer CommandBuffer)
+{
+	if (VulkanContext.DefragmentFrame != UINT64_MAX)
+	{
+		if (VulkanContext.CompletedFrames > VulkanContext.DefragmentFrame)
+		{
+			VulkanContext.MemoryAllocator.FinishDefragment();
+			VulkanContext.DefragmentFrame = UINT64_MAX;
+		}
+		return;
+	}
+	double Now = FPlatformMisc::Seconds();
+	// uploads still in flight would land in the old buffers after they were copied
+	if (Now - VulkanContext.LastDefragment < DEFRAGMENT_INTERVAL || !VulkanContext.UploadManager.IsIdle())
+		return;
+	VulkanContext.LastDefragment = Now;
+	SCOPED_CPU_EVENT("Defragment");
+	if (VulkanContext.MemoryAllocator.Defragment(CommandBuffer, DEFRAGMENT_BUDGET, false) > 0)
+	{
+		VulkanContext.DefragmentFrame = VulkanContext.FrameNumber;
+	}
+}
+
+// Renders a frame on the render thread, see FRenderThread.
+void DrawFrame(FVulkanContext& VulkanContext, const FRenderFrameState& State)
+{
+	if (GIsRequestingExit)
+		return;
+	SCOPED_CPU_EVENT("DrawFrame");
+	uint32_t FrameIndex = (uint32_t)(VulkanContext.FrameNumber % VulkanContext.FramesInFlight);
+	FFrameResources& Frame = VulkanContext.Frames[FrameIndex];
+	VkCommandBuffer CommandBuffer = Frame.CommandBuffer;
+	VulkanContext.PipelineStateCache.Tick();
+	VulkanContext.UploadManager.Tick();
+
+	// only blocks when the GPU is FramesInFlight frames behind
+	double FrameStart = FPlatformMisc::Seconds();
+	vkWaitForFences(VulkanContext.LogicalDevice, 1, &Frame.Fence, VK_TRUE, UINT64_MAX);
+	double FenceWaitEnd = FPlatformMisc::Seconds();
+	VulkanContext.CompletedFrames = std::max(VulkanContext.CompletedFrames, Frame.SubmittedFrames);
+	VulkanContext.DeletionQueue.BeginFrame(VulkanContext.FrameNumber, VulkanContext.CompletedFrames);
+
+	uint32_t ImageIndex;
+	if (GIsHeadless)
+	{
+		ImageIndex = (uint32_t)(VulkanContext.FrameNumber % VulkanContext.SwapChainImageCount);
+	}
+	else if (!AcquireSwapChainImage(VulkanContext, Frame.PresentFinishedSemaphore, ImageIndex))
+	{
+		// skipped, e.g. while minimized, without spinning until the window is back
+		FPlatformMisc::Sleep(0.01);
+		return;
+	}
+
+	// the image may be acquired out of order and still be in use by another frame in flight
+	VkFence& ImageFence = VulkanContext.ImagesInFlight[ImageIndex];
+	if (ImageFence != VK_NULL_HANDLE && ImageFence != Frame.Fence)
+	{
+		vkWaitForFences(VulkanContext.LogicalDevice, 1, &ImageFence, VK_TRUE, UINT64_MAX);
+	}
+	ImageFence = Frame.Fence;
+	double ImageWaitEnd = FPlatformMisc::Seconds();
+	vkResetFences(VulkanContext.LogicalDevice, 1, &Frame.Fence);
+	// everything recorded for this frame last time around has finished executing
+	verify(vkResetCommandPool(VulkanContext.LogicalDevice, Frame.CommandPool, 0) == VK_SUCCESS);
+	VulkanContext.ParallelRecorder.BeginFrame(FrameIndex);
+	VulkanContext.DescriptorAllocator.BeginFrame(FrameIndex);
+	VulkanContext.UniformRing.BeginFrame(FrameIndex);
+	if (VulkanContext.BindlessTable.IsInitialized())
+	{
+		VulkanContext.BindlessTable.BeginFrame(FrameIndex);
+	}
+
+	VkCommandBufferBeginInfo BeginInfo{};
+	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	verify(vkBeginCommandBuffer(CommandBuffer, &BeginInfo) == VK_SUCCESS);
+	VulkanContext.GpuProfiler.BeginFrame(CommandBuffer, FrameIndex);
+	VulkanContext.UploadManager.RecordAcquireBarriers(CommandBuffer);
+	TickDefragment(VulkanContext, CommandBuffer);
+
+	VulkanContext.FramePacer.MarkInputSampled(State.InputTime);
+	// written in place, the main pass only binds it with its offset
+	FViewUniforms* ViewUniforms = VulkanContext.UniformRing.Allocate<FViewUniforms>(VulkanContext.ViewUniforms);
+	verify(ViewUniforms != nullptr);
+	ViewUniforms->Transform = State.ViewTransform;
+
+	// the compute queue runs the frame's culling while the graphics queue finishes the previous frame
+	VkSemaphore CullingSemaphore = VK_NULL_HANDLE;
+	if (GUseGpuCulling)
+	{
+		VulkanContext.GpuCulling.BeginFrame(FrameIndex);
+		VulkanContext.GpuCulling.SetView(State.ViewTransform, (float)VulkanContext.SwapChainExtent.width, (float)VulkanContext.SwapChainExtent.height);
+		if (VulkanContext.GpuCulling.IsAsync() && VulkanContext.GpuCulling.IsReady())
+		{
+			CullingSemaphore = VulkanContext.GpuCulling.Submit();
+		}
+	}
+	// rebuilt every frame, at the cost of one command per mesh however many instances there are
+	else if (!GUseDirectDraws)
+	{
+		VulkanContext.DrawBatcher.BeginFrame(FrameIndex);
+		for (const FSceneDraw& Draw : VulkanContext.SceneDraws)
+		{
+			VulkanContext.DrawBatcher.AddDraw(VulkanContext.MeshPool.GetMesh(Draw.Mesh), Draw.FirstInstance, Draw.NumInstances);
+		}
+	}
+
+	VkPipeline Pipeline = VulkanContext.PipelineStateCache.FindOrCompile(VulkanContext.MainPassPSO);
+	if (Pipeline == VK_NULL_HANDLE)
+	{
+		Pipeline = VulkanContext.GraphicsPipeline;
+	}
+	// the graph is rebuilt every frame, but compiles to the cached plan as long as it doesn't change
+	BuildFrameGraph(VulkanContext, ImageIndex, Pipeline);
+	VulkanContext.RenderGraph.Compile();
+	VulkanContext.RenderGraph.Execute(CommandBuffer);
+	VulkanContext.GpuProfiler.EndFrame(CommandBuffer);
+	verify(vkEndCommandBuffer(CommandBuffer) == VK_SUCCESS);
+	double RecordEnd = FPlatformMisc::Seconds();
 
 	VkSubmitInfo SubmitInfo{};
 	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	
-	VkSemaphore WaitSemaphores[] = { VulkanContext.PresentFinishedSemaphore };
-	VkPipelineStageFlags WaitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-	SubmitInfo.waitSemaphoreCount = 1;
+	VkSemaphore WaitSemaphores[2];
+	VkPipelineStageFlags WaitStages[2];
+	uint32_t NumWaitSemaphores = 0;
+	if (!GIsHeadless)
+	{
+		WaitSemaphores[NumWaitSemaphores] = Frame.PresentFinishedSemaphore;
+		WaitStages[NumWaitSemaphores++] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	}
+	if (CullingSemaphore != VK_NULL_HANDLE)
+	{
+		WaitSemaphores[NumWaitSemaphores] = CullingSemaphore;
+		WaitStages[NumWaitSemaphores++] = VulkanContext.GpuCulling.GetWaitStage();
+	}
+	SubmitInfo.waitSemaphoreCount = NumWaitSemaphores;
 	SubmitInfo.pWaitSemaphores = WaitSemaphores;
 	SubmitInfo.pWaitDstStageMask = WaitStages;
 
 	SubmitInfo.commandBufferCount = 1;
-	SubmitInfo.pCommandBuffers = &VulkanContext.CommandBuffers[ImageIndex];
+	SubmitInfo.pCommandBuffers = &CommandBuffer;
 
-	VkSemaphore SignalSemaphores[] = { VulkanContext.RenderFinishedSemaphore };
-	SubmitInfo.signalSemaphoreCount = 1;
+	VkSemaphore SignalSemaphores[] = { Frame.RenderFinishedSemaphore };
+	SubmitInfo.signalSemaphoreCount = GIsHeadless ? 0 : 1;
 	SubmitInfo.pSignalSemaphores = SignalSemaphores;
 
-	assert (vkQueueSubmit(VulkanContext.PresentQueue, 1, &SubmitInfo, VulkanContext.Fence) == VK_SUCCESS);
+	double SubmitStart = FPlatformMisc::Seconds();
+	verify(vkQueueSubmit(VulkanContext.PresentQueue, 1, &SubmitInfo, Frame.Fence) == VK_SUCCESS);
+	Frame.SubmittedFrames = VulkanContext.FrameNumber + 1;
+	double SubmitEnd = FPlatformMisc::Seconds();
+	if (FProfiler::Get().IsEnabled())
+	{
+		FProfiler::Get().AddCpuEvent("WaitForFrameFence", FrameStart, FenceWaitEnd);
+		FProfiler::Get().AddCpuEvent("AcquireImage", FenceWaitEnd, ImageWaitEnd);
+		FProfiler::Get().AddCpuEvent("Record", ImageWaitEnd, RecordEnd);
+		FProfiler::Get().AddCpuEvent("Submit", SubmitStart, SubmitEnd);
+	}
+
+	FFrameTimingStats& Stats = VulkanContext.Stats;
+	if (VulkanContext.FrameNumber >= Stats.FirstFrame)
+	{
+		if (Stats.LastFrameStart > 0.0)
+		{
+			Stats.FrameTime.Add((FrameStart - Stats.LastFrameStart) * 1000.0);
+		}
+		Stats.CpuTime.Add((SubmitEnd - ImageWaitEnd) * 1000.0);
+		Stats.SubmitTime.Add((SubmitEnd - SubmitStart) * 1000.0);
+		Stats.RecordTime.Add((RecordEnd - ImageWaitEnd) * 1000.0);
+		Stats.FenceWaitTime.Add((FenceWaitEnd - FrameStart) * 1000.0);
+		// includes the acquire, which blocks when no swapchain image is free
+		Stats.ImageWaitTime.Add((ImageWaitEnd - FenceWaitEnd) * 1000.0);
+		Stats.LastFrameStart = FrameStart;
+	}
+	++VulkanContext.FrameNumber;
 
+	if (GIsHeadless)
+		return;
+
+	SCOPED_CPU_EVENT("Present");
 	VkPresentInfoKHR PresentInfo{};
 	PresentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	PresentInfo.waitSemaphoreCount = 1;
-	PresentInfo.pWaitSemaphores = &VulkanContext.RenderFinishedSemaphore;
+	PresentInfo.pWaitSemaphores = &Frame.RenderFinishedSemaphore;
 	PresentInfo.swapchainCount = 1;
 	PresentInfo.pSwapchains = &VulkanContext.SwapChain;
 	PresentInfo.pImageIndices = &ImageIndex;
 	PresentInfo.pResults = nullptr;
+	VulkanContext.FramePacer.OnPresent(PresentInfo);
 	VkResult Res = vkQueuePresentKHR(VulkanContext.PresentQueue, &PresentInfo);
-	if (Res != VK_SUCCESS)
+	// the window changed since the acquire, the frame may not have been displayed
+	if (Res == VK_ERROR_OUT_OF_DATE_KHR || Res == VK_SUBOPTIMAL_KHR)
 	{
-		FPlatformMisc::LocalPrint("vkQueuePresentKHR Failed!");
+		VulkanContext.SwapChainOutOfDate = true;
 	}
-	assert (Res == VK_SUCCESS);
+	else if (Res != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Fatal, "vkQueuePresentKHR failed: %d", (int)Res);
+	}
+}
+
+// The game thread's side: input and simulation.
+struct FGameState
+{
+	uint64_t FrameNumber = 0;
+	// scene to clip space: xy offset, zw scale
+	FVector4 ViewTransform = { 0.f, 0.f, 1.f, 1.f };
+	// when the last frame's input was sampled
+	double InputTime = 0.0;
+};
+
+// Samples input and advances the simulation by a frame.
+void TickGame(FGameState& Game)
+{
+	SCOPED_CPU_EVENT("TickGame");
+	FPlatformMisc::PumpMessages();
+	Game.InputTime = FPlatformMisc::Seconds();
+	// zooms in and out of the scene's center, so part of it leaves the view
+	float Zoom = 2.5f - 1.5f * cosf(Game.FrameNumber * 0.01f);
+	Game.ViewTransform.Z = Game.ViewTransform.W = Zoom;
+	++Game.FrameNumber;
 }
 
 int GuardedMain()
 {
 	FPlatformMisc::PlatformInit();
+	FLogger::Get().InstallCrashHandlers();
+	FProfiler::Get().SetEnabled(GEnableProfiler);
+	FProfiler::Get().SetThreadName("Main Thread");
+#if PLATFORM_ANDROID
+	// the LITTLE cores would hold up every frame that waits on their jobs
+	FJobSystem::Get().Init(GNumJobWorkers, EJobAffinity::PerformanceCores);
+#else
+	FJobSystem::Get().Init(GNumJobWorkers);
+#endif
+	FPakManager::Get().Mount(RESOURCE_PAK_FILENAME);
+	FAsyncIO::Get().Init();
 	
 	FVulkanContext VulkanContext;
-	bool EnableValidationLayer = true;
-	assert (InitLayersAndExtensions(VulkanContext, EnableValidationLayer));
-	assert (CreateInstance(VulkanContext));
+	// read while the device is created
+	VulkanContext.ShaderLibrary.BeginLoad(SHADER_LIBRARY_FILENAME);
+	// validation skews benchmark timings
+	bool EnableValidationLayer = !GIsHeadless;
+	verify(InitLayersAndExtensions(VulkanContext, EnableValidationLayer));
+	verify(CreateInstance(VulkanContext));
 #if PLATFORM_WINDOWS
-	assert (CreateWindowWin32(VulkanContext, 1024, 768)); // before surface
+	verify(CreateWindowWin32(VulkanContext, 1024, 768)); // before surface
 #endif
-	assert (CreateSurface(VulkanContext));
-	assert (SelectPhysicalDevice(VulkanContext));
-	assert (CreateLogicalDevice(VulkanContext));
-	assert (CreateSwapChain(VulkanContext));
-	assert (CreateImageViews(VulkanContext));
-	assert (CreateRenderPass(VulkanContext));
-	assert (CreateGraphicsPipeline(VulkanContext, false, false));
-	assert (CreateFrameBuffers(VulkanContext));
-	assert (CreateCommandPool(VulkanContext));
-	assert (CreateCommandBuffers(VulkanContext));
-	assert (CreateSemaphoreAndFence(VulkanContext));
+	if (!GIsHeadless)
+	{
+		verify(CreateSurface(VulkanContext));
+	}
+	verify(SelectPhysicalDevice(VulkanContext));
+	verify(CreateLogicalDevice(VulkanContext));
+	VulkanContext.MemoryAllocator.Init(VulkanContext.PhysicalDevice, VulkanContext.LogicalDevice);
+	// a finished frame's batch is destroyed by a job worker
+	VulkanContext.DeletionQueue.Init(VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator, true);
+	VulkanContext.FramePacer.Init(VulkanContext.LogicalDevice, GTargetFrameRate, VulkanContext.SupportsPresentWait);
+	VulkanContext.UploadManager.Init(VulkanContext.PhysicalDevice, VulkanContext.LogicalDevice, VulkanContext.MemoryAllocator,
+		VulkanContext.TransferQueue, VulkanContext.TransferFamilyIndex, VulkanContext.GraphicsFamilyIndex,
+		VulkanContext.SupportsTimelineSemaphore);
+	if (GIsHeadless)
+	{
+		verify(CreateOffscreenImages(VulkanContext, 1024, 768));
+	}
+	else
+	{
+		verify(CreateSwapChain(VulkanContext));
+	}
+	verify(CreateImageViews(VulkanContext));
+	verify(CreateFrameGraph(VulkanContext));
+	verify(CreatePipelineCache(VulkanContext));
+	verify(VulkanContext.ShaderLibrary.FinishLoad(VulkanContext.LogicalDevice));
+	VulkanContext.PipelineStateCache.SetShaderLibrary(&VulkanContext.ShaderLibrary);
+	verify(CreateDescriptors(VulkanContext));
+	verify(CreateGraphicsPipeline(VulkanContext, false, false));
+	// a cold start misses for the fallback pipeline, a warm one hits the cache saved by the last run
+	FPlatformMisc::LocalPrintf("Pipeline cache stats: %u hits, %u misses", VulkanContext.PipelineStateCache.NumDriverCacheHits(),
+		VulkanContext.PipelineStateCache.NumDriverCacheMisses());
+	verify(CreateCommandPool(VulkanContext));
+	verify(CreateCommandBuffers(VulkanContext));
+	verify(CreateSemaphoreAndFence(VulkanContext));
+	verify(CreateScene(VulkanContext));
+	VulkanContext.GpuProfiler.Init(VulkanContext.PhysicalDevice, VulkanContext.LogicalDevice, VulkanContext.PresentQueue,
+		VulkanContext.GraphicsFamilyIndex, (uint32_t)VulkanContext.Frames.size(), VulkanContext.SupportsCalibratedTimestamps, "Graphics Queue");
+	VulkanContext.RenderGraph.SetGpuProfiler(&VulkanContext.GpuProfiler);
+
+	// When benchmarking with several frames in flight, first run the same number of frames in
+	// lockstep (1 frame in flight) so the report shows how much CPU/GPU overlap is recovered.
+	bool RunLockstepBaseline = GBenchmarkFrameCount > 0 && GMaxFramesInFlight > 1;
+	FFrameTimingStats LockstepStats;
+	uint64_t BenchmarkEndFrame = GBenchmarkFrameCount;
+	if (RunLockstepBaseline)
+	{
+		VulkanContext.FramesInFlight = 1;
+	}
 
+	// from here on the render thread owns VulkanContext, the game thread only passes it to commands
+	FRenderThread RenderThread;
+	RenderThread.Start(GUseRenderThread, GRenderThreadFrameLag);
+	FGameState Game;
+	std::vector<FRenderFrameState> RenderStates(GRenderThreadFrameLag + 1);
 	while (!GIsRequestingExit)
 	{
-		FPlatformMisc::PumpMessages();
-		DrawFrame(VulkanContext);
+		// the pacer holds back the render thread, which holds back the game thread by the frame lag.
+		// Without a render thread it runs first, so input is sampled after its wait.
+		RenderThread.Enqueue([&VulkanContext]() { VulkanContext.FramePacer.WaitForNextFrame(); });
+		TickGame(Game);
+		if (GIsRequestingExit)
+		{
+			break;
+		}
+		// the sync point: the render thread only ever reads its copy
+		FRenderFrameState& State = RenderStates[Game.FrameNumber % RenderStates.size()];
+		State.ViewTransform = Game.ViewTransform;
+		State.InputTime = Game.InputTime;
+		RenderThread.Enqueue([&VulkanContext, &State]()
+		{
+			DrawFrame(VulkanContext, State);
+			TickPipelineCache(VulkanContext);
+		});
+		if (GBenchmarkFrameCount > 0 && Game.FrameNumber >= BenchmarkEndFrame)
+		{
+			if (RunLockstepBaseline)
+			{
+				RunLockstepBaseline = false;
+				BenchmarkEndFrame += GBenchmarkFrameCount;
+				// runs between the two frames on the render thread
+				RenderThread.Enqueue([&VulkanContext, &LockstepStats]()
+				{
+					LockstepStats = VulkanContext.Stats;
+					VulkanContext.Stats = FFrameTimingStats();
+					VulkanContext.Stats.FirstFrame = VulkanContext.FrameNumber + BENCHMARK_WARMUP_FRAMES;
+					VulkanContext.FramesInFlight = GMaxFramesInFlight;
+				});
+			}
+			else
+			{
+				// the frames still queued belong to the benchmark, and would be skipped after the exit request
+				RenderThread.Flush();
+				GIsRequestingExit = true;
+			}
+		}
+		RenderThread.EndFrame();
+	}
+	RenderThread.Stop();
+
+	if (GBenchmarkFrameCount > 0)
+	{
+		if (LockstepStats.FrameTime.Num() > 0)
+		{
+			FPlatformMisc::LocalPrintf("Frame timings over %d frames (%d warmup), 1 frame in flight:", GBenchmarkFrameCount, BENCHMARK_WARMUP_FRAMES);
+			LockstepStats.Report();
+		}
+		FPlatformMisc::LocalPrintf("Frame timings over %d frames (%d warmup), %d frames in flight:", GBenchmarkFrameCount, BENCHMARK_WARMUP_FRAMES, VulkanContext.FramesInFlight);
+		VulkanContext.Stats.Report();
+		if (LockstepStats.FrameTime.Num() > 0)
+		{
+			double LockstepFrame = LockstepStats.FrameTime.Average();
+			double Recovered = LockstepFrame - VulkanContext.Stats.FrameTime.Average();
+			FPlatformMisc::LocalPrintf("CPU/GPU overlap recovered: %.3f ms per frame (%.1f%%), fence wait %.3f -> %.3f ms",
+				Recovered, LockstepFrame > 0.0 ? Recovered / LockstepFrame * 100.0 : 0.0,
+				LockstepStats.FenceWaitTime.Average(), VulkanContext.Stats.FenceWaitTime.Average());
+		}
 	}
 
 	vkDeviceWaitIdle(VulkanContext.LogicalDevice);
-	vkDestroyPipeline(VulkanContext.LogicalDevice, VulkanContext.GraphicsPipeline, nullptr);
+	VulkanContext.FramePacer.ReportStats();
+	RenderThread.ReportStats();
+	VulkanContext.GpuProfiler.Shutdown();
+	VulkanContext.PipelineStateCache.ReportStats();
+	VulkanContext.PipelineStateCache.SavePrewarmList(PIPELINE_PREWARM_FILENAME);
+	// destroys every pipeline, including GraphicsPipeline
+	VulkanContext.PipelineStateCache.Shutdown();
+	if (VulkanContext.PipelineCacheDirty || VulkanContext.PipelineStateCache.ConsumePipelineCacheDirty())
+	{
+		SavePipelineCache(VulkanContext);
+	}
+	vkDestroyPipelineCache(VulkanContext.LogicalDevice, VulkanContext.PipelineCache, nullptr);
 	vkDestroyPipelineLayout(VulkanContext.LogicalDevice, VulkanContext.PipelineLayout, nullptr);
-	vkDestroyFence(VulkanContext.LogicalDevice, VulkanContext.Fence, nullptr);
-	vkDestroySemaphore(VulkanContext.LogicalDevice, VulkanContext.PresentFinishedSemaphore, nullptr);
-	vkDestroySemaphore(VulkanContext.LogicalDevice, VulkanContext.RenderFinishedSemaphore, nullptr);
-	vkDestroyCommandPool(VulkanContext.LogicalDevice, VulkanContext.CommandPool, nullptr);
-	vkDestroyShaderModule(VulkanContext.LogicalDevice, VulkanContext.VertShaderModule, nullptr);
-	vkDestroyShaderModule(VulkanContext.LogicalDevice, VulkanContext.FragShaderModule, nullptr);
+	VulkanContext.DescriptorAllocator.ReportStats();
+	VulkanContext.DescriptorAllocator.Shutdown();
+	VulkanContext.BindlessTable.ReportStats();
+	VulkanContext.BindlessTable.Shutdown();
+	VulkanContext.UniformRing.ReportStats();
+	VulkanContext.UniformRing.Shutdown();
+	for (FFrameResources& Frame : VulkanContext.Frames)
+	{
+		vkDestroyCommandPool(VulkanContext.LogicalDevice, Frame.CommandPool, nullptr);
+		vkDestroyFence(VulkanContext.LogicalDevice, Frame.Fence, nullptr);
+		vkDestroySemaphore(VulkanContext.LogicalDevice, Frame.PresentFinishedSemaphore, nullptr);
+		vkDestroySemaphore(VulkanContext.LogicalDevice, Frame.RenderFinishedSemaphore, nullptr);
+	}
+	VulkanContext.ParallelRecorder.Shutdown();
+	VulkanContext.ShaderLibrary.Shutdown();
+	// render passes, framebuffers and transient textures
+	VulkanContext.RenderGraph.Shutdown();
+	VulkanContext.DeletionQueue.ReportStats();
+	VulkanContext.DeletionQueue.Shutdown();
 	for (uint32_t i = 0; i < VulkanContext.SwapChainImageCount; ++i)
 	{
-		vkDestroyFramebuffer(VulkanContext.LogicalDevice, VulkanContext.SwapChainFramebuffers[i], nullptr);
 		vkDestroyImageView(VulkanContext.LogicalDevice, VulkanContext.SwapChainImageViews[i], nullptr);
 	}
-	vkDestroyRenderPass(VulkanContext.LogicalDevice, VulkanContext.RenderPass, nullptr);
-	vkDestroySwapchainKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, nullptr);
-	vkDestroySurfaceKHR(VulkanContext.Instance, VulkanContext.Surface, nullptr);
+	if (GIsHeadless)
+	{
+		for (uint32_t i = 0; i < VulkanContext.SwapChainImageCount; ++i)
+		{
+			VulkanContext.MemoryAllocator.DestroyImage(VulkanContext.SwapChainImages[i], VulkanContext.OffscreenImageAllocations[i]);
+		}
+	}
+	else
+	{
+		vkDestroySwapchainKHR(VulkanContext.LogicalDevice, VulkanContext.SwapChain, nullptr);
+		vkDestroySurfaceKHR(VulkanContext.Instance, VulkanContext.Surface, nullptr);
+	}
+	VulkanContext.GpuCulling.ReportStats();
+	VulkanContext.GpuCulling.Shutdown();
+	VulkanContext.DrawBatcher.ReportStats();
+	VulkanContext.DrawBatcher.Shutdown();
+	VulkanContext.MeshPool.ReportStats();
+	VulkanContext.MeshPool.Shutdown();
+	VulkanContext.MemoryAllocator.DestroyBuffer(VulkanContext.InstanceBuffer);
+	VulkanContext.UploadManager.ReportStats();
+	VulkanContext.UploadManager.Shutdown();
+	VulkanContext.MemoryAllocator.DumpStats();
+	VulkanContext.MemoryAllocator.Shutdown();
 	vkDestroyDevice(VulkanContext.LogicalDevice, nullptr);
 	vkDestroyInstance(VulkanContext.Instance, nullptr);
 	FPlatformMisc::LocalPrint("Vulkan Destroyed");
+	FAsyncIO::Get().LogStats();
+	FAsyncIO::Get().Shutdown();
+	FPakManager::Get().UnmountAll();
+	FJobSystem::Get().Shutdown();
+	if (FProfiler::Get().IsEnabled())
+	{
+		FProfiler::Get().WriteChromeTrace(TRACE_FILENAME);
+	}
+	FProfiler::Get().Shutdown();
 	FPlatformMisc::LocalPrint("GoodBye!");
 
 	return 0;
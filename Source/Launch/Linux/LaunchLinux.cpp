@@ -0,0 +1,98 @@
+#include "HAL/PlatformMisc.h"
+#include "VulkanRHI/VulkanFramePacing.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <algorithm>
+
+
+extern int GuardedMain();
+extern bool GIsHeadless;
+extern uint32_t GBenchmarkFrameCount;
+extern uint32_t GMaxFramesInFlight;
+extern EPresentMode GPresentMode;
+extern uint32_t GTargetFrameRate;
+extern bool GUseRenderThread;
+extern uint32_t GRenderThreadFrameLag;
+extern uint32_t GNumInstances;
+extern bool GUseDirectDraws;
+extern bool GUseGpuCulling;
+extern bool GUseAsyncCompute;
+extern uint32_t GNumJobWorkers;
+extern bool GEnableProfiler;
+
+// usage: TinyEngine [-frames=N] [-framesinflight=N] [-present=vsync|mailbox|immediate] [-fps=N] [-norenderthread] [-framelag=N] [-instances=N] [-directdraws] [-gpuculling] [-asynccompute] [-jobworkers=N] [-trace]
+int main(int argc, char* argv[])
+{
+	FPlatformMisc::LocalPrint("This is Linux platform");
+
+	// There is no window system integration on Linux yet, so always render offscreen.
+	GIsHeadless = true;
+	GBenchmarkFrameCount = 1000;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strncmp(argv[i], "-frames=", 8) == 0)
+		{
+			GBenchmarkFrameCount = (uint32_t)atoi(argv[i] + 8);
+		}
+		else if (strncmp(argv[i], "-framesinflight=", 16) == 0)
+		{
+			GMaxFramesInFlight = std::max(1, atoi(argv[i] + 16));
+		}
+		else if (strncmp(argv[i], "-present=", 9) == 0)
+		{
+			const char* Mode = argv[i] + 9;
+			if (strcmp(Mode, "vsync") == 0)
+				GPresentMode = EPresentMode::VSync;
+			else if (strcmp(Mode, "mailbox") == 0)
+				GPresentMode = EPresentMode::Mailbox;
+			else if (strcmp(Mode, "immediate") == 0)
+				GPresentMode = EPresentMode::Immediate;
+			else
+				FPlatformMisc::LocalPrintf("Unknown present mode: %s", Mode);
+		}
+		else if (strncmp(argv[i], "-fps=", 5) == 0)
+		{
+			GTargetFrameRate = (uint32_t)std::max(0, atoi(argv[i] + 5));
+		}
+		else if (strcmp(argv[i], "-norenderthread") == 0)
+		{
+			GUseRenderThread = false;
+		}
+		else if (strncmp(argv[i], "-framelag=", 10) == 0)
+		{
+			GRenderThreadFrameLag = (uint32_t)std::max(0, atoi(argv[i] + 10));
+		}
+		else if (strncmp(argv[i], "-instances=", 11) == 0)
+		{
+			GNumInstances = (uint32_t)std::max(1, atoi(argv[i] + 11));
+		}
+		else if (strcmp(argv[i], "-directdraws") == 0)
+		{
+			GUseDirectDraws = true;
+		}
+		else if (strcmp(argv[i], "-gpuculling") == 0)
+		{
+			GUseGpuCulling = true;
+		}
+		else if (strcmp(argv[i], "-asynccompute") == 0)
+		{
+			GUseGpuCulling = true;
+			GUseAsyncCompute = true;
+		}
+		else if (strncmp(argv[i], "-jobworkers=", 12) == 0)
+		{
+			GNumJobWorkers = (uint32_t)std::max(1, atoi(argv[i] + 12));
+		}
+		else if (strcmp(argv[i], "-trace") == 0)
+		{
+			GEnableProfiler = true;
+		}
+		else
+		{
+			FPlatformMisc::LocalPrintf("Unknown argument: %s", argv[i]);
+		}
+	}
+
+	return GuardedMain();
+}
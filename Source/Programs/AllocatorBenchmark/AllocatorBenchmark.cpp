@@ -0,0 +1,210 @@
+#include "HAL/PlatformMisc.h"
+#include "Memory/TLSFAllocator.h"
+#include "Stats/StatSamples.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+// Checks FTLSFAllocator's splitting, merging, alignment padding and exhaustion, then times random
+// allocations and frees of buffer-like sizes.
+// usage: AllocatorBenchmark [-count=N] [-runs=N]
+// Returns 1 when a check failed.
+
+static const uint64_t HEAP_SIZE = 512ull << 20;
+
+static bool GFailed = false;
+
+static void Check(bool Condition, const char* What)
+{
+	if (!Condition)
+	{
+		FPlatformMisc::LocalPrintf("FAILED: %s", What);
+		GFailed = true;
+	}
+}
+
+static uint32_t Random(uint32_t& Seed)
+{
+	Seed = Seed * 1664525u + 1013904223u;
+	return Seed >> 8;
+}
+
+// every byte is either allocated once or free, and allocations keep their alignment
+static bool IsConsistent(const FTLSFAllocator& Allocator)
+{
+	uint64_t End = 0;
+	uint64_t Allocated = 0;
+	bool Ordered = true;
+	Allocator.ForEachAllocation([&](uint64_t Offset, uint64_t Size, uint32_t)
+	{
+		Ordered = Ordered && Offset >= End;
+		End = Offset + Size;
+		Allocated += Size;
+	});
+	return Ordered && End <= Allocator.GetSize() && Allocated + Allocator.GetFreeSize() == Allocator.GetSize();
+}
+
+static void CheckSplitAndMerge()
+{
+	FTLSFAllocator Allocator(1024);
+	FTLSFAllocator::FAllocation A, B, C;
+	Check(Allocator.Allocate(256, 1, A) && Allocator.Allocate(256, 1, B) && Allocator.Allocate(256, 1, C), "split: three allocations fit");
+	Check(A.Offset == 0 && B.Offset == 256 && C.Offset == 512, "split: allocations are carved off in address order");
+	Check(Allocator.NumFreeBlocks() == 1 && Allocator.GetFreeSize() == 256, "split: the rest stays one free block");
+
+	Allocator.Free(B.Node);
+	Check(Allocator.NumFreeBlocks() == 2, "merge: a block between allocations stays on its own");
+	Allocator.Free(A.Node);
+	Check(Allocator.NumFreeBlocks() == 2 && Allocator.GetLargestFreeBlock() == 512, "merge: a freed block merges with the free block after it");
+	Allocator.Free(C.Node);
+	Check(Allocator.NumFreeBlocks() == 1 && Allocator.GetLargestFreeBlock() == 1024 && Allocator.NumAllocations() == 0,
+		"merge: freeing everything leaves the whole range");
+	Check(IsConsistent(Allocator), "merge: consistent");
+}
+
+static void CheckAlignment()
+{
+	FTLSFAllocator Allocator(4096);
+	FTLSFAllocator::FAllocation A, B;
+	Check(Allocator.Allocate(1, 1, A) && A.Offset == 0, "alignment: unaligned allocation at 0");
+	Check(Allocator.Allocate(64, 256, B) && B.Offset == 256 && B.Size == 64, "alignment: the next aligned offset is used");
+	// the padding before B and the rest after it
+	Check(Allocator.NumFreeBlocks() == 2 && Allocator.GetFreeSize() == 4096 - 1 - 64, "alignment: the padding stays free");
+	// a size class below the padding's, the search rounds sizes up to the next class
+	FTLSFAllocator::FAllocation Padding;
+	Check(Allocator.Allocate(248, 1, Padding) && Padding.Offset == 1, "alignment: the padding can be allocated");
+	Allocator.Free(Padding.Node);
+	Allocator.Free(A.Node);
+	Allocator.Free(B.Node);
+	Check(Allocator.NumFreeBlocks() == 1 && Allocator.GetFreeSize() == 4096, "alignment: padding merges back when freed");
+}
+
+static void CheckExhaustion()
+{
+	FTLSFAllocator Allocator(4096);
+	std::vector<FTLSFAllocator::FAllocation> Allocations;
+	FTLSFAllocator::FAllocation Allocation;
+	while (Allocator.Allocate(64, 64, Allocation))
+	{
+		Allocations.push_back(Allocation);
+	}
+	Check(Allocations.size() == 64 && Allocator.GetFreeSize() == 0 && Allocator.NumFreeBlocks() == 0, "exhaustion: the heap fills exactly");
+	Check(!Allocator.Allocate(1, 1, Allocation), "exhaustion: a full heap fails");
+
+	Allocator.Free(Allocations[10].Node);
+	Check(!Allocator.Allocate(65, 1, Allocation), "exhaustion: a hole too small fails");
+	Check(Allocator.Allocate(64, 64, Allocation) && Allocation.Offset == Allocations[10].Offset, "exhaustion: a freed hole is reused");
+
+	FTLSFAllocator Empty(4096);
+	Check(!Empty.Allocate(4097, 1, Allocation), "exhaustion: larger than the heap fails");
+}
+
+// random sizes and alignments, freed in random order, checked for overlaps along the way
+static void CheckRandom(uint32_t Count)
+{
+	FTLSFAllocator Allocator(HEAP_SIZE);
+	std::vector<FTLSFAllocator::FAllocation> Live;
+	uint32_t Seed = 1;
+	bool Aligned = true;
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		if (!Live.empty() && Random(Seed) % 3 == 0)
+		{
+			uint32_t Index = Random(Seed) % Live.size();
+			Allocator.Free(Live[Index].Node);
+			Live[Index] = Live.back();
+			Live.pop_back();
+			continue;
+		}
+		uint64_t Alignment = 1ull << (Random(Seed) % 13);
+		FTLSFAllocator::FAllocation Allocation;
+		if (Allocator.Allocate(1 + Random(Seed) % (256 << 10), Alignment, Allocation))
+		{
+			Aligned = Aligned && Allocation.Offset % Alignment == 0;
+			Live.push_back(Allocation);
+		}
+	}
+	Check(Aligned, "random: every allocation is aligned");
+	Check(IsConsistent(Allocator), "random: allocations don't overlap");
+	for (const FTLSFAllocator::FAllocation& Allocation : Live)
+	{
+		Allocator.Free(Allocation.Node);
+	}
+	Check(Allocator.NumFreeBlocks() == 1 && Allocator.GetFreeSize() == HEAP_SIZE, "random: freeing everything merges back to one block");
+}
+
+// Allocates Count blocks of random sizes, then frees them in random order.
+static void MeasureAllocateFree(uint32_t Count, uint32_t NumRuns)
+{
+	std::vector<uint64_t> Sizes(Count);
+	std::vector<uint32_t> FreeOrder(Count);
+	uint32_t Seed = 2;
+	for (uint32_t i = 0; i < Count; ++i)
+	{
+		// mostly small buffers, some large ones, like a scene's resources
+		Sizes[i] = Random(Seed) % 8 == 0 ? 64 + Random(Seed) % (256 << 10) : 64 + Random(Seed) % (16 << 10);
+		FreeOrder[i] = i;
+	}
+	for (uint32_t i = Count - 1; i > 0; --i)
+	{
+		std::swap(FreeOrder[i], FreeOrder[Random(Seed) % (i + 1)]);
+	}
+
+	FTLSFAllocator Allocator(HEAP_SIZE);
+	std::vector<FTLSFAllocator::FAllocation> Allocations(Count);
+	FStatSamples AllocateSamples("Allocate");
+	FStatSamples FreeSamples("Free");
+	uint32_t NumFailed = 0;
+	for (uint32_t Run = 0; Run < NumRuns; ++Run)
+	{
+		NumFailed = 0;
+		double StartTime = FPlatformMisc::Seconds();
+		for (uint32_t i = 0; i < Count; ++i)
+		{
+			if (!Allocator.Allocate(Sizes[i], 256, Allocations[i]))
+			{
+				Allocations[i].Node = FTLSFAllocator::INVALID_NODE;
+				++NumFailed;
+			}
+		}
+		double AllocateTime = FPlatformMisc::Seconds();
+		for (uint32_t i : FreeOrder)
+		{
+			if (Allocations[i].Node != FTLSFAllocator::INVALID_NODE)
+				Allocator.Free(Allocations[i].Node);
+		}
+		double EndTime = FPlatformMisc::Seconds();
+		AllocateSamples.Add((AllocateTime - StartTime) * 1000.0);
+		FreeSamples.Add((EndTime - AllocateTime) * 1000.0);
+	}
+	FPlatformMisc::LocalPrintf("%u allocations in a %llu MB heap (%u did not fit): Allocate %.1f ns, Free %.1f ns",
+		Count, (unsigned long long)(HEAP_SIZE >> 20), NumFailed,
+		AllocateSamples.Average() * 1e6 / Count, FreeSamples.Average() * 1e6 / Count);
+	AllocateSamples.Report();
+	FreeSamples.Report();
+	Check(Allocator.NumFreeBlocks() == 1 && Allocator.GetFreeSize() == HEAP_SIZE, "benchmark: the heap is empty again");
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t Count = 20000;
+	uint32_t NumRuns = 20;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strncmp(argv[i], "-count=", 7) == 0)
+			Count = (uint32_t)std::max(1, atoi(argv[i] + 7));
+		else if (strncmp(argv[i], "-runs=", 6) == 0)
+			NumRuns = (uint32_t)std::max(1, atoi(argv[i] + 6));
+		else
+			FPlatformMisc::LocalPrintf("Unknown argument: %s", argv[i]);
+	}
+
+	CheckSplitAndMerge();
+	CheckAlignment();
+	CheckExhaustion();
+	CheckRandom(Count * 5);
+	FPlatformMisc::LocalPrintf("TLSF allocator checks %s", GFailed ? "FAILED" : "passed");
+	MeasureAllocateFree(Count, NumRuns);
+	return GFailed ? 1 : 0;
+}
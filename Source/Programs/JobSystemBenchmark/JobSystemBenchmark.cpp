@@ -0,0 +1,144 @@
+#include "HAL/PlatformMisc.h"
+#include "Async/JobSystem.h"
+#include "Stats/StatSamples.h"
+#include "Stats/Profiler.h"
+#include <string.h>
+#include <stdlib.h>
+#include <atomic>
+
+// Measures the scheduling overhead of the job system and how much work gets stolen.
+// usage: JobSystemBenchmark [-workers=N] [-performancecores] [-runs=N]
+
+static const uint32_t NUM_EMPTY_JOBS = 100000;
+static const uint32_t PARALLEL_FOR_SIZE = 1 << 20;
+static const uint32_t TREE_DEPTH = 16;
+
+static std::atomic<uint64_t> GSink{0};
+
+static void ReportStats(const char* Name, double Seconds, uint64_t NumJobs)
+{
+	FJobSystemStats Stats = FJobSystem::Get().GetStats();
+	FPlatformMisc::LocalPrintf("%s: %.3f ms, %.1f ns/job, %llu executed, %llu stolen (%.1f%% of %llu attempts), %llu sleeps",
+		Name, Seconds * 1000.0, Seconds * 1e9 / NumJobs,
+		(unsigned long long)Stats.JobsExecuted, (unsigned long long)Stats.JobsStolen,
+		Stats.StealAttempts > 0 ? Stats.JobsStolen * 100.0 / Stats.StealAttempts : 0.0,
+		(unsigned long long)Stats.StealAttempts, (unsigned long long)Stats.Sleeps);
+}
+
+// many tiny jobs pushed by one thread: everything the others run is stolen from it
+static double RunEmptyJobs()
+{
+	FJobSystem& JobSystem = FJobSystem::Get();
+	FJobCounter Counter;
+	double StartTime = FPlatformMisc::Seconds();
+	for (uint32_t i = 0; i < NUM_EMPTY_JOBS; ++i)
+	{
+		JobSystem.Run([] { GSink.fetch_add(1, std::memory_order_relaxed); }, &Counter);
+	}
+	JobSystem.Wait(Counter);
+	return FPlatformMisc::Seconds() - StartTime;
+}
+
+static double RunParallelFor(uint32_t BatchSize)
+{
+	std::vector<float> Values(PARALLEL_FOR_SIZE, 1.f);
+	double StartTime = FPlatformMisc::Seconds();
+	FJobSystem::Get().ParallelFor(PARALLEL_FOR_SIZE, BatchSize, [&Values](uint32_t Begin, uint32_t End)
+	{
+		for (uint32_t i = Begin; i < End; ++i)
+			Values[i] = Values[i] * 0.5f + 1.f;
+	});
+	return FPlatformMisc::Seconds() - StartTime;
+}
+
+// every job spawns two children and waits for them, so work spreads from one deque to all threads
+static void SpawnTree(uint32_t Depth)
+{
+	if (Depth == 0)
+	{
+		GSink.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+	FJobCounter Counter;
+	FJobSystem::Get().Run([Depth] { SpawnTree(Depth - 1); }, &Counter);
+	FJobSystem::Get().Run([Depth] { SpawnTree(Depth - 1); }, &Counter);
+	FJobSystem::Get().Wait(Counter);
+}
+
+static double RunTree()
+{
+	double StartTime = FPlatformMisc::Seconds();
+	SpawnTree(TREE_DEPTH);
+	return FPlatformMisc::Seconds() - StartTime;
+}
+
+// a chain of dependent jobs, each released by the counter of the previous one
+static double RunDependencyChain(uint32_t Length)
+{
+	FJobSystem& JobSystem = FJobSystem::Get();
+	std::vector<FJobCounter> Counters(Length);
+	double StartTime = FPlatformMisc::Seconds();
+	for (uint32_t i = 0; i < Length; ++i)
+	{
+		JobSystem.Run([] { GSink.fetch_add(1, std::memory_order_relaxed); }, &Counters[i], i > 0 ? &Counters[i - 1] : nullptr);
+	}
+	JobSystem.Wait(Counters[Length - 1]);
+	return FPlatformMisc::Seconds() - StartTime;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t NumWorkers = 0;
+	uint32_t NumRuns = 10;
+	EJobAffinity Affinity = EJobAffinity::Any;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strncmp(argv[i], "-workers=", 9) == 0)
+			NumWorkers = (uint32_t)atoi(argv[i] + 9);
+		else if (strncmp(argv[i], "-runs=", 6) == 0)
+			NumRuns = (uint32_t)std::max(1, atoi(argv[i] + 6));
+		else if (strcmp(argv[i], "-performancecores") == 0)
+			Affinity = EJobAffinity::PerformanceCores;
+		else
+			FPlatformMisc::LocalPrintf("Unknown argument: %s", argv[i]);
+	}
+
+	FJobSystem& JobSystem = FJobSystem::Get();
+	JobSystem.Init(NumWorkers, Affinity);
+
+	struct FBenchmark
+	{
+		const char* Name;
+		double (*Function)();
+		uint64_t NumJobs;
+	};
+	const FBenchmark Benchmarks[] =
+	{
+		{ "Empty jobs", RunEmptyJobs, NUM_EMPTY_JOBS },
+		{ "ParallelFor (auto batch)", [] { return RunParallelFor(0); }, JobSystem.NumThreads() * 4 },
+		{ "ParallelFor (batch 1024)", [] { return RunParallelFor(1024); }, PARALLEL_FOR_SIZE / 1024 },
+		{ "Spawn tree", RunTree, (2ull << TREE_DEPTH) - 2 },
+		{ "Dependency chain", [] { return RunDependencyChain(10000); }, 10000 },
+	};
+	for (const FBenchmark& Benchmark : Benchmarks)
+	{
+		FStatSamples Samples(Benchmark.Name);
+		// first run warms up the allocator and wakes the workers
+		Benchmark.Function();
+		JobSystem.ResetStats();
+		double TotalTime = 0.0;
+		for (uint32_t Run = 0; Run < NumRuns; ++Run)
+		{
+			double Time = Benchmark.Function();
+			Samples.Add(Time * 1000.0);
+			TotalTime += Time;
+		}
+		ReportStats(Benchmark.Name, TotalTime / NumRuns, Benchmark.NumJobs);
+		Samples.Report();
+	}
+
+	JobSystem.Shutdown();
+	// the workers' tracks
+	FProfiler::Get().Shutdown();
+	return 0;
+}
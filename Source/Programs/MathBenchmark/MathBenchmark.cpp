@@ -0,0 +1,164 @@
+#include "HAL/PlatformMisc.h"
+#include "Math/MathBatch.h"
+#include "Stats/StatSamples.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+// Runs the batch kernels of every math backend the CPU supports over the same data, and checks
+// each against the scalar reference.
+// usage: MathBenchmark [-count=N] [-runs=N]
+
+static float RandomFloat(uint32_t& Seed, float Min, float Max)
+{
+	Seed = Seed * 1664525u + 1013904223u;
+	return Min + (Max - Min) * (float)(Seed >> 8) / (float)(1u << 24);
+}
+
+static FMatrix RandomTransform(uint32_t& Seed)
+{
+	FVector3 Axis = FVector3(RandomFloat(Seed, -1.f, 1.f), RandomFloat(Seed, -1.f, 1.f), RandomFloat(Seed, -1.f, 1.f)).GetSafeNormal();
+	FQuat Rotation = FQuat::FromAxisAngle(Axis, RandomFloat(Seed, 0.f, 2.f * FMath::Pi));
+	FVector3 Translation(RandomFloat(Seed, -50.f, 50.f), RandomFloat(Seed, -50.f, 50.f), RandomFloat(Seed, -50.f, 50.f));
+	float Scale = RandomFloat(Seed, 0.5f, 2.f);
+	return FMatrix::FromTRS(Translation, Rotation, FVector3(Scale, Scale, Scale));
+}
+
+// the columns of a structure of arrays, so the backends get identical copies of the input
+struct FStreams
+{
+	std::vector<std::vector<float>> Columns;
+
+	FStreams(size_t NumColumns, size_t Count) : Columns(NumColumns, std::vector<float>(Count)) {}
+	float* operator[](size_t Column) { return Columns[Column].data(); }
+
+	FPointsSoA Points() { return { (*this)[0], (*this)[1], (*this)[2] }; }
+	FBoxesSoA Boxes() { return { (*this)[0], (*this)[1], (*this)[2], (*this)[3], (*this)[4], (*this)[5] }; }
+
+	float MaxError(const FStreams& Reference) const
+	{
+		float Error = 0.f;
+		for (size_t Column = 0; Column < Columns.size(); ++Column)
+			for (size_t i = 0; i < Columns[Column].size(); ++i)
+				Error = std::max(Error, fabsf(Columns[Column][i] - Reference.Columns[Column][i]));
+		return Error;
+	}
+};
+
+struct FBenchmarkData
+{
+	std::vector<FMatrix> MatricesA;
+	std::vector<FMatrix> MatricesB;
+	FStreams Points;
+	FStreams Boxes;
+	FMatrix Transform;
+	FFrustum Frustum;
+
+	FBenchmarkData(size_t Count) : MatricesA(Count), MatricesB(Count), Points(3, Count), Boxes(6, Count)
+	{
+		uint32_t Seed = 1;
+		for (size_t i = 0; i < Count; ++i)
+		{
+			MatricesA[i] = RandomTransform(Seed);
+			MatricesB[i] = RandomTransform(Seed);
+			for (int Axis = 0; Axis < 3; ++Axis)
+			{
+				Points[Axis][i] = RandomFloat(Seed, -100.f, 100.f);
+				Boxes[Axis][i] = RandomFloat(Seed, -100.f, 100.f);
+				Boxes[Axis + 3][i] = RandomFloat(Seed, 0.1f, 5.f);
+			}
+		}
+		Transform = RandomTransform(Seed);
+		FMatrix View = FMatrix::LookAt(FVector3(0.f, 0.f, 150.f), FVector3(0.f, 0.f, 0.f), FVector3(0.f, 1.f, 0.f));
+		Frustum = FFrustum(FMatrix::Perspective(FMath::DegreesToRadians(60.f), 16.f / 9.f, 0.1f, 300.f) * View);
+	}
+};
+
+struct FBackendResults
+{
+	std::vector<FMatrix> Matrices;
+	FStreams Points;
+	FStreams Boxes;
+	std::vector<uint32_t> Visible;
+	size_t NumVisible = 0;
+
+	FBackendResults(size_t Count) : Matrices(Count), Points(3, Count), Boxes(6, Count), Visible(Count) {}
+};
+
+template <typename FunctionType>
+static void Measure(const char* Name, uint32_t NumRuns, size_t Count, FunctionType Function)
+{
+	FStatSamples Samples(Name);
+	// first run faults the output pages in
+	Function();
+	for (uint32_t Run = 0; Run < NumRuns; ++Run)
+	{
+		double StartTime = FPlatformMisc::Seconds();
+		Function();
+		Samples.Add((FPlatformMisc::Seconds() - StartTime) * 1000.0);
+	}
+	FPlatformMisc::LocalPrintf("  %s: %.2f ns/element", Name, Samples.Average() * 1e6 / Count);
+	Samples.Report();
+}
+
+static void RunBackend(EMathBackend Backend, const FMathBatchKernels& Kernels, FBenchmarkData& Data, FBackendResults& Results, uint32_t NumRuns)
+{
+	size_t Count = Data.MatricesA.size();
+	FPlatformMisc::LocalPrintf("%s%s", GetMathBackendName(Backend), Backend == GetBestMathBackend() ? " (default)" : "");
+	Measure("MultiplyMatrices", NumRuns, Count, [&] { Kernels.MultiplyMatrices(Data.MatricesA.data(), Data.MatricesB.data(), Results.Matrices.data(), Count); });
+	Measure("TransformPoints", NumRuns, Count, [&] { Kernels.TransformPoints(Data.Transform, Data.Points.Points(), Results.Points.Points(), Count); });
+	Measure("TransformBoxes", NumRuns, Count, [&] { Kernels.TransformBoxes(Data.Transform, Data.Boxes.Boxes(), Results.Boxes.Boxes(), Count); });
+	Measure("CullBoxes", NumRuns, Count, [&] { Results.NumVisible = Kernels.CullBoxes(Data.Frustum, Data.Boxes.Boxes(), Results.Visible.data(), Count); });
+}
+
+static float MaxMatrixError(const std::vector<FMatrix>& A, const std::vector<FMatrix>& B)
+{
+	float Error = 0.f;
+	for (size_t i = 0; i < A.size(); ++i)
+		for (int Element = 0; Element < 16; ++Element)
+			Error = std::max(Error, fabsf(A[i].Data()[Element] - B[i].Data()[Element]));
+	return Error;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t Count = 1 << 16;
+	uint32_t NumRuns = 50;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strncmp(argv[i], "-count=", 7) == 0)
+			Count = (size_t)std::max(1, atoi(argv[i] + 7));
+		else if (strncmp(argv[i], "-runs=", 6) == 0)
+			NumRuns = (uint32_t)std::max(1, atoi(argv[i] + 6));
+		else
+			FPlatformMisc::LocalPrintf("Unknown argument: %s", argv[i]);
+	}
+
+	FBenchmarkData Data(Count);
+	FBackendResults Reference(Count);
+	RunBackend(EMathBackend::Scalar, *GetMathBatchKernels(EMathBackend::Scalar), Data, Reference, NumRuns);
+	FPlatformMisc::LocalPrintf("  %zu of %zu boxes visible", Reference.NumVisible, Count);
+
+	bool Mismatch = false;
+	for (uint8_t Index = (uint8_t)EMathBackend::Scalar + 1; Index < (uint8_t)EMathBackend::Num; ++Index)
+	{
+		EMathBackend Backend = (EMathBackend)Index;
+		const FMathBatchKernels* Kernels = GetMathBatchKernels(Backend);
+		if (!Kernels)
+		{
+			FPlatformMisc::LocalPrintf("%s: not available", GetMathBackendName(Backend));
+			continue;
+		}
+		FBackendResults Results(Count);
+		RunBackend(Backend, *Kernels, Data, Results, NumRuns);
+		// FMA rounds differently from a multiply and an add, so results only agree approximately
+		bool SameVisible = Results.NumVisible == Reference.NumVisible &&
+			std::equal(Results.Visible.begin(), Results.Visible.begin() + Results.NumVisible, Reference.Visible.begin());
+		FPlatformMisc::LocalPrintf("  max error vs scalar: matrices %g, points %g, boxes %g, visible %s",
+			MaxMatrixError(Results.Matrices, Reference.Matrices), Results.Points.MaxError(Reference.Points),
+			Results.Boxes.MaxError(Reference.Boxes), SameVisible ? "identical" : "DIFFERENT");
+		Mismatch = Mismatch || !SameVisible;
+	}
+	return Mismatch ? 1 : 0;
+}
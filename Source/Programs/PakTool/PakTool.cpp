@@ -0,0 +1,206 @@
+#include "HAL/PlatformMisc.h"
+#include "IO/PakFile.h"
+#include "IO/Compression.h"
+#include "Misc/Hash.h"
+#include <string.h>
+#include <stdio.h>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+
+// Packs every file below a directory into a pak file, see FPakHeader for the layout.
+// usage: PakTool <InputDir> <Output.pak> [-compress]
+// With -compress, files that shrink by at least an eighth are stored as compressed blocks.
+
+static const uint32_t BLOCK_SIZE = 64 * 1024;
+static const uint32_t COMPRESSED_ALIGNMENT = 16;
+
+struct FInputFile
+{
+	std::string Path;
+	std::filesystem::path SourcePath;
+};
+
+static void Align(std::ofstream& Out, uint64_t& Offset, uint64_t Alignment)
+{
+	static const char Zeros[FPakFile::DATA_ALIGNMENT] = {};
+	uint64_t Padding = (Alignment - Offset % Alignment) % Alignment;
+	Out.write(Zeros, (std::streamsize)Padding);
+	Offset += Padding;
+}
+
+static bool ReadWholeFile(const std::filesystem::path& Path, std::vector<char>& OutData)
+{
+	std::ifstream File(Path, std::ios::ate | std::ios::binary);
+	if (!File.is_open())
+	{
+		return false;
+	}
+	OutData.resize((size_t)File.tellg());
+	File.seekg(0);
+	File.read(OutData.data(), OutData.size());
+	return (bool)File;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		FPlatformMisc::LocalPrint("usage: PakTool <InputDir> <Output.pak> [-compress]");
+		return 1;
+	}
+	std::filesystem::path InputDir = argv[1];
+	std::filesystem::path OutputPath = argv[2];
+	bool Compress = false;
+	for (int i = 3; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-compress") == 0)
+			Compress = true;
+	}
+
+	std::vector<FInputFile> Files;
+	std::error_code Error;
+	for (auto It = std::filesystem::recursive_directory_iterator(InputDir, Error); !Error && It != std::filesystem::recursive_directory_iterator(); It.increment(Error))
+	{
+		// the archive may be written into the directory it packs
+		if (!It->is_regular_file() || It->path().extension() == ".pak")
+			continue;
+		Files.push_back({std::filesystem::relative(It->path(), InputDir).generic_string(), It->path()});
+	}
+	if (Error)
+	{
+		FPlatformMisc::LocalPrintf("Failed to list %s: %s", argv[1], Error.message().c_str());
+		return 1;
+	}
+	// deterministic archives
+	std::sort(Files.begin(), Files.end(), [](const FInputFile& A, const FInputFile& B) { return A.Path < B.Path; });
+
+	std::string TempPath = OutputPath.string() + ".tmp";
+	std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+	if (!Out.is_open())
+	{
+		FPlatformMisc::LocalPrintf("Failed to write %s", TempPath.c_str());
+		return 1;
+	}
+	FPakHeader Header = {};
+	Out.write((const char*)&Header, sizeof(Header));
+	uint64_t Offset = sizeof(Header);
+
+	std::vector<FPakEntry> Entries;
+	std::vector<FPakBlock> Blocks;
+	std::string Paths;
+	std::vector<char> Data;
+	std::vector<char> CompressedData;
+	std::vector<FPakBlock> FileBlocks;
+	uint64_t RawBytes = 0;
+	uint32_t NumCompressed = 0;
+	for (const FInputFile& File : Files)
+	{
+		if (!ReadWholeFile(File.SourcePath, Data))
+		{
+			FPlatformMisc::LocalPrintf("Failed to read %s", File.SourcePath.string().c_str());
+			return 1;
+		}
+		FPakEntry Entry = {};
+		Entry.PathHash = HashBytes(File.Path.data(), File.Path.size());
+		Entry.Size = Data.size();
+		Entry.PathOffset = (uint32_t)Paths.size();
+		Entry.PathLength = (uint32_t)File.Path.size();
+		Paths += File.Path;
+		RawBytes += Data.size();
+
+		// blocks that do not shrink are stored as is, the decoder copies them
+		bool StoreCompressed = false;
+		if (Compress && !Data.empty())
+		{
+			CompressedData.clear();
+			FileBlocks.clear();
+			for (size_t BlockStart = 0; BlockStart < Data.size(); BlockStart += BLOCK_SIZE)
+			{
+				size_t RawSize = std::min<size_t>(BLOCK_SIZE, Data.size() - BlockStart);
+				size_t Start = CompressedData.size();
+				CompressedData.resize(Start + FCompression::CompressBound(RawSize));
+				size_t CompressedSize = FCompression::Compress(Data.data() + BlockStart, RawSize, CompressedData.data() + Start, CompressedData.size() - Start);
+				if (CompressedSize == 0 || CompressedSize >= RawSize)
+				{
+					memcpy(CompressedData.data() + Start, Data.data() + BlockStart, RawSize);
+					CompressedSize = RawSize;
+				}
+				CompressedData.resize(Start + CompressedSize);
+				FileBlocks.push_back({Start, (uint32_t)CompressedSize, 0});
+			}
+			StoreCompressed = CompressedData.size() < Data.size() && CompressedData.size() <= Data.size() - Data.size() / 8;
+		}
+
+		if (StoreCompressed)
+		{
+			Align(Out, Offset, COMPRESSED_ALIGNMENT);
+			Entry.Offset = Offset;
+			Entry.FirstBlock = (uint32_t)Blocks.size();
+			Entry.NumBlocks = (uint32_t)FileBlocks.size();
+			for (FPakBlock& Block : FileBlocks)
+			{
+				Block.Offset += Offset;
+				Blocks.push_back(Block);
+			}
+			Out.write(CompressedData.data(), CompressedData.size());
+			Offset += CompressedData.size();
+			++NumCompressed;
+		}
+		else
+		{
+			// page aligned so the entry can be used straight from a mapping
+			Align(Out, Offset, FPakFile::DATA_ALIGNMENT);
+			Entry.Offset = Offset;
+			Out.write(Data.data(), Data.size());
+			Offset += Data.size();
+		}
+		Entries.push_back(Entry);
+	}
+
+	// at least 2 keeps the blocks after the buckets 8 byte aligned
+	uint32_t NumBuckets = 2;
+	while (NumBuckets < Entries.size() * 2)
+		NumBuckets *= 2;
+	std::vector<uint32_t> Buckets(NumBuckets, FPakFile::INVALID_BUCKET);
+	for (uint32_t i = 0; i < Entries.size(); ++i)
+	{
+		uint32_t Bucket = (uint32_t)Entries[i].PathHash & (NumBuckets - 1);
+		while (Buckets[Bucket] != FPakFile::INVALID_BUCKET)
+			Bucket = (Bucket + 1) & (NumBuckets - 1);
+		Buckets[Bucket] = i;
+	}
+
+	Align(Out, Offset, 8);
+	Header.Magic = FPakHeader::MAGIC;
+	Header.Version = FPakHeader::VERSION;
+	Header.NumEntries = (uint32_t)Entries.size();
+	Header.NumBuckets = NumBuckets;
+	Header.NumBlocks = (uint32_t)Blocks.size();
+	Header.BlockSize = BLOCK_SIZE;
+	Header.TocOffset = Offset;
+	Out.write((const char*)Entries.data(), Entries.size() * sizeof(FPakEntry));
+	Out.write((const char*)Buckets.data(), Buckets.size() * sizeof(uint32_t));
+	Out.write((const char*)Blocks.data(), Blocks.size() * sizeof(FPakBlock));
+	Out.write(Paths.data(), Paths.size());
+	Header.TocSize = Entries.size() * sizeof(FPakEntry) + Buckets.size() * sizeof(uint32_t) + Blocks.size() * sizeof(FPakBlock) + Paths.size();
+	Out.seekp(0);
+	Out.write((const char*)&Header, sizeof(Header));
+	Out.close();
+	if (!Out)
+	{
+		FPlatformMisc::LocalPrintf("Failed to write %s", TempPath.c_str());
+		return 1;
+	}
+	std::filesystem::rename(TempPath, OutputPath, Error);
+	if (Error)
+	{
+		FPlatformMisc::LocalPrintf("Failed to rename %s: %s", TempPath.c_str(), Error.message().c_str());
+		return 1;
+	}
+
+	uint64_t PakSize = Header.TocOffset + Header.TocSize;
+	FPlatformMisc::LocalPrintf("Packed %zu files (%u compressed) into %s: %.2f KB of data, %.2f KB archive",
+		Entries.size(), NumCompressed, OutputPath.string().c_str(), RawBytes / 1024.0, PakSize / 1024.0);
+	return 0;
+}
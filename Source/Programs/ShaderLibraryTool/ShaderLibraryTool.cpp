@@ -0,0 +1,178 @@
+#include "HAL/PlatformMisc.h"
+#include "Shader/ShaderLibrary.h"
+#include "Misc/Hash.h"
+#include <string.h>
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <map>
+
+// Links SPIR-V modules into a shader library, see FShaderLibraryHeader for the layout. Every
+// shader is named after its file without the .spv extension: shader.vert.spv is "shader.vert".
+// usage: ShaderLibraryTool <Output> <Shader.spv>...
+
+struct FInputModule
+{
+	std::vector<char> Code;
+	FShaderReflection Reflection;
+};
+
+static bool ReadWholeFile(const std::filesystem::path& Path, std::vector<char>& OutData)
+{
+	std::ifstream File(Path, std::ios::ate | std::ios::binary);
+	if (!File.is_open())
+	{
+		return false;
+	}
+	OutData.resize((size_t)File.tellg());
+	File.seekg(0);
+	File.read(OutData.data(), OutData.size());
+	return (bool)File;
+}
+
+static const char* StageName(EShaderStage Stage)
+{
+	switch (Stage)
+	{
+	case EShaderStage::Vertex: return "vertex";
+	case EShaderStage::TessellationControl: return "tessellation control";
+	case EShaderStage::TessellationEvaluation: return "tessellation evaluation";
+	case EShaderStage::Geometry: return "geometry";
+	case EShaderStage::Fragment: return "fragment";
+	case EShaderStage::Compute: return "compute";
+	}
+	return "unknown";
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		FPlatformMisc::LocalPrint("usage: ShaderLibraryTool <Output> <Shader.spv>...");
+		return 1;
+	}
+	std::filesystem::path OutputPath = argv[1];
+
+	// modules by content hash, so identical SPIR-V is stored once
+	std::map<uint64_t, FInputModule> Modules;
+	std::vector<std::pair<std::string, uint64_t>> Shaders;
+	std::vector<char> Code;
+	for (int i = 2; i < argc; ++i)
+	{
+		std::filesystem::path Path = argv[i];
+		if (!ReadWholeFile(Path, Code))
+		{
+			FPlatformMisc::LocalPrintf("Failed to read %s", argv[i]);
+			return 1;
+		}
+		std::string Name = Path.filename().string();
+		if (Path.extension() == ".spv")
+		{
+			Name = Path.stem().string();
+		}
+		uint64_t ContentHash = HashBytes(Code.data(), Code.size());
+		if (Modules.find(ContentHash) == Modules.end())
+		{
+			FInputModule& Module = Modules[ContentHash];
+			if (!ReflectSpirv(Code.data(), Code.size(), Module.Reflection))
+			{
+				FPlatformMisc::LocalPrintf("Not a valid SPIR-V module: %s", argv[i]);
+				return 1;
+			}
+			Module.Code = Code;
+			FPlatformMisc::LocalPrintf("%s: %s shader, %zu bindings, %zu vertex inputs, %u bytes of push constants", Name.c_str(),
+				StageName(Module.Reflection.Stage), Module.Reflection.Bindings.size(), Module.Reflection.VertexInputs.size(),
+				Module.Reflection.PushConstantSize);
+		}
+		Shaders.push_back({Name, ContentHash});
+	}
+
+	std::string Strings;
+	std::vector<FShaderLibraryModule> ModuleTable;
+	std::vector<FShaderBinding> Bindings;
+	std::vector<FShaderVertexInput> VertexInputs;
+	std::map<uint64_t, uint32_t> ModuleIndices;
+	// std::map iterates in content hash order, which FShaderLibrary::FindModule searches
+	for (const auto& Pair : Modules)
+	{
+		const FShaderReflection& Reflection = Pair.second.Reflection;
+		FShaderLibraryModule Module = {};
+		Module.ContentHash = Pair.first;
+		Module.CodeSize = (uint32_t)Pair.second.Code.size();
+		Module.Stage = Reflection.Stage;
+		Module.PushConstantSize = Reflection.PushConstantSize;
+		Module.FirstBinding = (uint32_t)Bindings.size();
+		Module.NumBindings = (uint32_t)Reflection.Bindings.size();
+		Module.FirstVertexInput = (uint32_t)VertexInputs.size();
+		Module.NumVertexInputs = (uint32_t)Reflection.VertexInputs.size();
+		Module.EntryPointOffset = (uint32_t)Strings.size();
+		Module.EntryPointLength = (uint32_t)Reflection.EntryPoint.size();
+		Strings += Reflection.EntryPoint;
+		Bindings.insert(Bindings.end(), Reflection.Bindings.begin(), Reflection.Bindings.end());
+		VertexInputs.insert(VertexInputs.end(), Reflection.VertexInputs.begin(), Reflection.VertexInputs.end());
+		ModuleIndices[Pair.first] = (uint32_t)ModuleTable.size();
+		ModuleTable.push_back(Module);
+	}
+
+	std::vector<FShaderLibraryName> Names;
+	for (const auto& Shader : Shaders)
+	{
+		FShaderLibraryName Name = {};
+		Name.NameHash = HashBytes(Shader.first.data(), Shader.first.size());
+		Name.NameOffset = (uint32_t)Strings.size();
+		Name.NameLength = (uint32_t)Shader.first.size();
+		Name.Module = ModuleIndices[Shader.second];
+		Strings += Shader.first;
+		Names.push_back(Name);
+	}
+	std::sort(Names.begin(), Names.end(), [](const FShaderLibraryName& A, const FShaderLibraryName& B) { return A.NameHash < B.NameHash; });
+
+	FShaderLibraryHeader Header = {};
+	Header.Magic = FShaderLibraryHeader::MAGIC;
+	Header.Version = FShaderLibraryHeader::VERSION;
+	Header.NumNames = (uint32_t)Names.size();
+	Header.NumModules = (uint32_t)ModuleTable.size();
+	Header.NumBindings = (uint32_t)Bindings.size();
+	Header.NumVertexInputs = (uint32_t)VertexInputs.size();
+	Header.StringsSize = (uint32_t)Strings.size();
+	uint64_t Offset = sizeof(Header) + Names.size() * sizeof(FShaderLibraryName) + ModuleTable.size() * sizeof(FShaderLibraryModule) +
+		Bindings.size() * sizeof(FShaderBinding) + VertexInputs.size() * sizeof(FShaderVertexInput) + Strings.size();
+	for (FShaderLibraryModule& Module : ModuleTable)
+	{
+		Offset = (Offset + 3) & ~3ull;
+		Module.CodeOffset = Offset;
+		Offset += Module.CodeSize;
+	}
+
+	std::string TempPath = OutputPath.string() + ".tmp";
+	{
+		std::ofstream Out(TempPath, std::ios::binary | std::ios::trunc);
+		Out.write((const char*)&Header, sizeof(Header));
+		Out.write((const char*)Names.data(), Names.size() * sizeof(FShaderLibraryName));
+		Out.write((const char*)ModuleTable.data(), ModuleTable.size() * sizeof(FShaderLibraryModule));
+		Out.write((const char*)Bindings.data(), Bindings.size() * sizeof(FShaderBinding));
+		Out.write((const char*)VertexInputs.data(), VertexInputs.size() * sizeof(FShaderVertexInput));
+		Out.write(Strings.data(), Strings.size());
+		for (const FShaderLibraryModule& Module : ModuleTable)
+		{
+			static const char Zeros[4] = {};
+			Out.write(Zeros, Module.CodeOffset - (uint64_t)Out.tellp());
+			const std::vector<char>& ModuleCode = Modules[Module.ContentHash].Code;
+			Out.write(ModuleCode.data(), ModuleCode.size());
+		}
+		if (!Out)
+		{
+			FPlatformMisc::LocalPrintf("Failed to write %s", TempPath.c_str());
+			return 1;
+		}
+	}
+	std::error_code Error;
+	std::filesystem::rename(TempPath, OutputPath, Error);
+	if (Error)
+	{
+		FPlatformMisc::LocalPrintf("Failed to rename %s: %s", TempPath.c_str(), Error.message().c_str());
+		return 1;
+	}
+	FPlatformMisc::LocalPrintf("Linked %zu shaders into %zu modules: %s", Shaders.size(), ModuleTable.size(), OutputPath.string().c_str());
+	return 0;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#if PLATFORM_WINDOWS || PLATFORM_LINUX
+	#include <vulkan/vulkan.h>
+#elif PLATFORM_ANDROID
+	#include "vulkan_wrapper.h"
+#endif
+
+#undef max
+#undef min
+
+#include "Logging/Logging.h"
+
+DECLARE_LOG_CATEGORY(LogRHI, Verbose);
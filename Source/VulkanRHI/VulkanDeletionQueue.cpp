@@ -0,0 +1,94 @@
+#include "VulkanDeletionQueue.h"
+#include "VulkanMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+#include <utility>
+
+void FVulkanDeletionQueue::Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, bool InUseJobs)
+{
+	Device = InDevice;
+	MemoryAllocator = &InMemoryAllocator;
+	// with the calling thread alone, jobs from the render thread would only run at its next wait
+	UseJobs = InUseJobs && FJobSystem::Get().NumThreads() > 1;
+}
+
+void FVulkanDeletionQueue::Shutdown()
+{
+	if (UseJobs)
+	{
+		FJobSystem::Get().Wait(Jobs);
+	}
+	for (const FFrameDeletions& Frame : Frames)
+	{
+		Destroy(Frame.Deletions);
+	}
+	Frames.clear();
+}
+
+void FVulkanDeletionQueue::BeginFrame(uint64_t InFrameNumber, uint64_t CompletedFrames)
+{
+	FrameNumber = InFrameNumber;
+	uint32_t Pending = 0;
+	for (const FFrameDeletions& Frame : Frames)
+	{
+		Pending += (uint32_t)Frame.Deletions.size();
+	}
+	PeakPending = std::max(PeakPending, Pending);
+
+	while (!Frames.empty() && Frames.front().FrameNumber < CompletedFrames)
+	{
+		++NumBatches;
+		if (UseJobs)
+		{
+			// the allocator is thread-safe, and nothing else references the objects anymore
+			FJobSystem::Get().Run([this, Deletions = std::move(Frames.front().Deletions)]() { Destroy(Deletions); }, &Jobs);
+		}
+		else
+		{
+			Destroy(Frames.front().Deletions);
+		}
+		Frames.pop_front();
+	}
+}
+
+void FVulkanDeletionQueue::Enqueue(EType Type, uint64_t Handle, FVulkanAllocation* Allocation)
+{
+	if (Handle == 0 && Allocation == nullptr)
+	{
+		return;
+	}
+	if (Frames.empty() || Frames.back().FrameNumber != FrameNumber)
+	{
+		Frames.push_back({FrameNumber, {}});
+	}
+	Frames.back().Deletions.push_back({Type, Handle, Allocation});
+	++NumDeleted;
+}
+
+void FVulkanDeletionQueue::Destroy(const std::vector<FDeletion>& Deletions) const
+{
+	SCOPED_CPU_EVENT("DeferredDeletions");
+	for (const FDeletion& Deletion : Deletions)
+	{
+		switch (Deletion.Type)
+		{
+		case EType::Buffer: MemoryAllocator->DestroyBuffer(Deletion.Allocation); break;
+		case EType::Image: MemoryAllocator->DestroyImage((VkImage)Deletion.Handle, Deletion.Allocation); break;
+		case EType::Memory: MemoryAllocator->Free(Deletion.Allocation); break;
+		case EType::ImageView: vkDestroyImageView(Device, (VkImageView)Deletion.Handle, nullptr); break;
+		case EType::Framebuffer: vkDestroyFramebuffer(Device, (VkFramebuffer)Deletion.Handle, nullptr); break;
+		case EType::RenderPass: vkDestroyRenderPass(Device, (VkRenderPass)Deletion.Handle, nullptr); break;
+		case EType::Pipeline: vkDestroyPipeline(Device, (VkPipeline)Deletion.Handle, nullptr); break;
+		case EType::Sampler: vkDestroySampler(Device, (VkSampler)Deletion.Handle, nullptr); break;
+		case EType::DescriptorPool: vkDestroyDescriptorPool(Device, (VkDescriptorPool)Deletion.Handle, nullptr); break;
+		case EType::SwapChain: vkDestroySwapchainKHR(Device, (VkSwapchainKHR)Deletion.Handle, nullptr); break;
+		}
+	}
+}
+
+void FVulkanDeletionQueue::ReportStats() const
+{
+	FPlatformMisc::LocalPrintf("Deletion queue: %llu objects deleted in %llu batches%s, peak %u pending",
+		(unsigned long long)NumDeleted, (unsigned long long)NumBatches, UseJobs ? " on jobs" : "", PeakPending);
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "Async/JobSystem.h"
+#include <vector>
+#include <deque>
+
+class FVulkanMemoryAllocator;
+struct FVulkanAllocation;
+
+// Destroys Vulkan objects once the GPU is done with them, without waiting for the device to go
+// idle. A deletion is tagged with the frame being recorded, the last one that may use the object,
+// and carried out once that frame finished on the GPU, which the caller learns from the frame
+// fences and passes to BeginFrame. With jobs, the batch of a finished frame is destroyed on the
+// job system, so freeing many objects doesn't hold up the frame.
+// Used from the thread recording the frame.
+class FVulkanDeletionQueue
+{
+public:
+	// UseJobs only takes effect with job workers to run them.
+	void Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, bool InUseJobs);
+	// Destroys everything still queued. The GPU must be idle.
+	void Shutdown();
+
+	// Starts recording FrameNumber, which the deletions from now on wait for, and destroys the ones
+	// of the frames before CompletedFrames.
+	void BeginFrame(uint64_t FrameNumber, uint64_t CompletedFrames);
+
+	void Delete(VkImageView ImageView) { Enqueue(EType::ImageView, (uint64_t)ImageView); }
+	void Delete(VkFramebuffer Framebuffer) { Enqueue(EType::Framebuffer, (uint64_t)Framebuffer); }
+	void Delete(VkRenderPass RenderPass) { Enqueue(EType::RenderPass, (uint64_t)RenderPass); }
+	void Delete(VkPipeline Pipeline) { Enqueue(EType::Pipeline, (uint64_t)Pipeline); }
+	void Delete(VkSampler Sampler) { Enqueue(EType::Sampler, (uint64_t)Sampler); }
+	void Delete(VkDescriptorPool DescriptorPool) { Enqueue(EType::DescriptorPool, (uint64_t)DescriptorPool); }
+	void Delete(VkSwapchainKHR SwapChain) { Enqueue(EType::SwapChain, (uint64_t)SwapChain); }
+	// Created by FVulkanMemoryAllocator::CreateBuffer and CreateImage, with their memory.
+	void DeleteBuffer(FVulkanAllocation* Allocation) { Enqueue(EType::Buffer, 0, Allocation); }
+	void DeleteImage(VkImage Image, FVulkanAllocation* Allocation) { Enqueue(EType::Image, (uint64_t)Image, Allocation); }
+	// Memory from FVulkanMemoryAllocator::Allocate, e.g. shared by aliased images. Queue it after them.
+	void Free(FVulkanAllocation* Allocation) { Enqueue(EType::Memory, 0, Allocation); }
+
+	void ReportStats() const;
+
+private:
+	enum class EType : uint8_t
+	{
+		Buffer,
+		Image,
+		Memory,
+		ImageView,
+		Framebuffer,
+		RenderPass,
+		Pipeline,
+		Sampler,
+		DescriptorPool,
+		SwapChain,
+	};
+
+	struct FDeletion
+	{
+		EType Type;
+		uint64_t Handle;
+		FVulkanAllocation* Allocation;
+	};
+
+	struct FFrameDeletions
+	{
+		uint64_t FrameNumber;
+		std::vector<FDeletion> Deletions;
+	};
+
+	void Enqueue(EType Type, uint64_t Handle, FVulkanAllocation* Allocation = nullptr);
+	void Destroy(const std::vector<FDeletion>& Deletions) const;
+
+	VkDevice Device = VK_NULL_HANDLE;
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	bool UseJobs = false;
+	uint64_t FrameNumber = 0;
+	// oldest first, one per frame that queued deletions
+	std::deque<FFrameDeletions> Frames;
+	// the batches being destroyed by jobs
+	FJobCounter Jobs;
+
+	uint64_t NumDeleted = 0;
+	uint64_t NumBatches = 0;
+	uint32_t PeakPending = 0;
+};
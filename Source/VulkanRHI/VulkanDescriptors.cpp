@@ -0,0 +1,343 @@
+#include "VulkanDescriptors.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include "Misc/Hash.h"
+#include <string.h>
+#include <algorithm>
+#include <initializer_list>
+
+FDescriptorBinding FDescriptorBinding::Buffer(uint32_t Binding, VkDescriptorType Type, VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range)
+{
+	FDescriptorBinding Result;
+	memset(&Result, 0, sizeof(Result));
+	Result.Binding = Binding;
+	Result.Type = Type;
+	Result.BufferInfo = { Buffer, Offset, Range };
+	return Result;
+}
+
+FDescriptorBinding FDescriptorBinding::Image(uint32_t Binding, VkDescriptorType Type, VkImageView View, VkSampler Sampler, VkImageLayout Layout)
+{
+	FDescriptorBinding Result;
+	memset(&Result, 0, sizeof(Result));
+	Result.Binding = Binding;
+	Result.Type = Type;
+	Result.ImageInfo = { Sampler, View, Layout };
+	return Result;
+}
+
+void FVulkanDescriptorAllocator::Init(VkDevice InDevice, uint32_t InNumFrames, uint32_t InSetsPerPool)
+{
+	Device = InDevice;
+	SetsPerPool = std::max(1u, InSetsPerPool);
+	Frames.resize(InNumFrames);
+	CurrentFrame = &Frames[0];
+}
+
+void FVulkanDescriptorAllocator::Shutdown()
+{
+	for (FFramePools& Frame : Frames)
+	{
+		for (VkDescriptorPool Pool : Frame.Pools)
+		{
+			vkDestroyDescriptorPool(Device, Pool, nullptr);
+		}
+	}
+	Frames.clear();
+	CurrentFrame = nullptr;
+}
+
+VkDescriptorPool FVulkanDescriptorAllocator::CreatePool(uint32_t MaxSets)
+{
+	// descriptors per set, a guess at a typical mix; a set needing more moves on to the next pool
+	const VkDescriptorPoolSize Ratios[] =
+	{
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1 },
+	};
+	VkDescriptorPoolSize PoolSizes[sizeof(Ratios) / sizeof(Ratios[0])];
+	for (size_t i = 0; i < sizeof(Ratios) / sizeof(Ratios[0]); ++i)
+	{
+		PoolSizes[i] = { Ratios[i].type, Ratios[i].descriptorCount * MaxSets };
+	}
+	VkDescriptorPoolCreateInfo PoolInfo{};
+	PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	PoolInfo.maxSets = MaxSets;
+	PoolInfo.poolSizeCount = sizeof(PoolSizes) / sizeof(PoolSizes[0]);
+	PoolInfo.pPoolSizes = PoolSizes;
+	VkDescriptorPool Pool = VK_NULL_HANDLE;
+	if (vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &Pool) != VK_SUCCESS)
+	{
+		return VK_NULL_HANDLE;
+	}
+	++NumPools;
+	return Pool;
+}
+
+void FVulkanDescriptorAllocator::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentFrame = &Frames[FrameIndex];
+	for (VkDescriptorPool Pool : CurrentFrame->Pools)
+	{
+		verify(vkResetDescriptorPool(Device, Pool, 0) == VK_SUCCESS);
+	}
+	CurrentFrame->CurrentPool = 0;
+	CurrentFrame->Sets.clear();
+	++NumFrames;
+}
+
+VkDescriptorSet FVulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout Layout)
+{
+	FFramePools& Frame = *CurrentFrame;
+	VkDescriptorSetAllocateInfo AllocateInfo{};
+	AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	AllocateInfo.descriptorSetCount = 1;
+	AllocateInfo.pSetLayouts = &Layout;
+	// a full pool fails with VK_ERROR_OUT_OF_POOL_MEMORY or VK_ERROR_FRAGMENTED_POOL, or any error
+	// before VK_KHR_maintenance1, so any failure moves on to the next pool
+	for (;; ++Frame.CurrentPool)
+	{
+		bool IsNewPool = Frame.CurrentPool == Frame.Pools.size();
+		if (IsNewPool)
+		{
+			// each new pool twice the previous one, a frame needing many sets soon needs few pools
+			uint32_t MaxSets = std::min(MAX_SETS_PER_POOL, SetsPerPool << std::min<size_t>(Frame.Pools.size(), 16));
+			VkDescriptorPool Pool = CreatePool(MaxSets);
+			if (Pool == VK_NULL_HANDLE)
+			{
+				return VK_NULL_HANDLE;
+			}
+			Frame.Pools.push_back(Pool);
+		}
+		AllocateInfo.descriptorPool = Frame.Pools[Frame.CurrentPool];
+		VkDescriptorSet Set = VK_NULL_HANDLE;
+		if (vkAllocateDescriptorSets(Device, &AllocateInfo, &Set) == VK_SUCCESS)
+		{
+			++TotalAllocations;
+			return Set;
+		}
+		// an empty pool that can't hold the set never will
+		if (IsNewPool)
+		{
+			return VK_NULL_HANDLE;
+		}
+	}
+}
+
+VkDescriptorSet FVulkanDescriptorAllocator::FindOrAllocate(VkDescriptorSetLayout Layout, const FDescriptorBinding* Bindings, uint32_t NumBindings)
+{
+	uint64_t Hash = HashBytes(&Layout, sizeof(Layout));
+	Hash = HashBytes(Bindings, NumBindings * sizeof(FDescriptorBinding), Hash);
+	auto It = CurrentFrame->Sets.find(Hash);
+	if (It != CurrentFrame->Sets.end())
+	{
+		++TotalCacheHits;
+		return It->second;
+	}
+	VkDescriptorSet Set = Allocate(Layout);
+	if (Set == VK_NULL_HANDLE)
+	{
+		return VK_NULL_HANDLE;
+	}
+	std::vector<VkWriteDescriptorSet> Writes(NumBindings);
+	for (uint32_t i = 0; i < NumBindings; ++i)
+	{
+		const FDescriptorBinding& Binding = Bindings[i];
+		bool IsImage = Binding.Type == VK_DESCRIPTOR_TYPE_SAMPLER || Binding.Type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+			Binding.Type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || Binding.Type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+			Binding.Type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		VkWriteDescriptorSet& Write = Writes[i];
+		Write = {};
+		Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		Write.dstSet = Set;
+		Write.dstBinding = Binding.Binding;
+		Write.descriptorCount = 1;
+		Write.descriptorType = Binding.Type;
+		Write.pImageInfo = IsImage ? &Binding.ImageInfo : nullptr;
+		Write.pBufferInfo = IsImage ? nullptr : &Binding.BufferInfo;
+	}
+	vkUpdateDescriptorSets(Device, NumBindings, Writes.data(), 0, nullptr);
+	CurrentFrame->Sets.emplace(Hash, Set);
+	return Set;
+}
+
+void FVulkanDescriptorAllocator::ReportStats() const
+{
+	if (NumFrames == 0)
+	{
+		return;
+	}
+	FPlatformMisc::LocalPrintf("Descriptor sets: %.1f allocated and %.1f reused per frame, %u pools",
+		(double)TotalAllocations / NumFrames, (double)TotalCacheHits / NumFrames, NumPools);
+}
+
+uint32_t FVulkanBindlessTable::FSlots::Allocate()
+{
+	if (!Free.empty())
+	{
+		uint32_t Index = Free.back();
+		Free.pop_back();
+		return Index;
+	}
+	return NumAllocated < Max ? NumAllocated++ : INVALID_INDEX;
+}
+
+uint32_t FVulkanBindlessTable::FSlots::NumUsed() const
+{
+	size_t NumReleased = Free.size();
+	for (const std::vector<uint32_t>& FrameReleased : Released)
+	{
+		NumReleased += FrameReleased.size();
+	}
+	return NumAllocated - (uint32_t)NumReleased;
+}
+
+bool FVulkanBindlessTable::Init(VkDevice InDevice, uint32_t NumFrames, uint32_t MaxTextures, uint32_t MaxBuffers)
+{
+	Device = InDevice;
+	Textures.Max = MaxTextures;
+	Buffers.Max = MaxBuffers;
+	Textures.Released.resize(NumFrames);
+	Buffers.Released.resize(NumFrames);
+
+	// every binding partially bound: only the registered indices need valid descriptors
+	VkDescriptorSetLayoutBinding Bindings[2] = {};
+	Bindings[TEXTURE_BINDING] = { TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxTextures, VK_SHADER_STAGE_ALL, nullptr };
+	Bindings[BUFFER_BINDING] = { BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MaxBuffers, VK_SHADER_STAGE_ALL, nullptr };
+	VkDescriptorBindingFlagsEXT BindingFlags[2];
+	BindingFlags[TEXTURE_BINDING] = BindingFlags[BUFFER_BINDING] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+	VkDescriptorSetLayoutBindingFlagsCreateInfoEXT BindingFlagsInfo{};
+	BindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+	BindingFlagsInfo.bindingCount = 2;
+	BindingFlagsInfo.pBindingFlags = BindingFlags;
+	VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+	LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	LayoutInfo.pNext = &BindingFlagsInfo;
+	LayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+	LayoutInfo.bindingCount = 2;
+	LayoutInfo.pBindings = Bindings;
+	if (vkCreateDescriptorSetLayout(Device, &LayoutInfo, nullptr, &Layout) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Create Bindless Table Failed!");
+		Shutdown();
+		return false;
+	}
+
+	VkDescriptorPoolSize PoolSizes[2] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MaxTextures },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MaxBuffers },
+	};
+	VkDescriptorPoolCreateInfo PoolInfo{};
+	PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	PoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+	PoolInfo.maxSets = 1;
+	PoolInfo.poolSizeCount = 2;
+	PoolInfo.pPoolSizes = PoolSizes;
+	if (vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &Pool) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Create Bindless Table Failed!");
+		Shutdown();
+		return false;
+	}
+	VkDescriptorSetAllocateInfo AllocateInfo{};
+	AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	AllocateInfo.descriptorPool = Pool;
+	AllocateInfo.descriptorSetCount = 1;
+	AllocateInfo.pSetLayouts = &Layout;
+	if (vkAllocateDescriptorSets(Device, &AllocateInfo, &DescriptorSet) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Create Bindless Table Failed!");
+		Shutdown();
+		return false;
+	}
+	FPlatformMisc::LocalPrintf("Bindless table: %u textures, %u storage buffers", MaxTextures, MaxBuffers);
+	return true;
+}
+
+void FVulkanBindlessTable::Shutdown()
+{
+	if (Device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	vkDestroyDescriptorPool(Device, Pool, nullptr);
+	vkDestroyDescriptorSetLayout(Device, Layout, nullptr);
+	Device = VK_NULL_HANDLE;
+	Pool = VK_NULL_HANDLE;
+	Layout = VK_NULL_HANDLE;
+	DescriptorSet = VK_NULL_HANDLE;
+	Textures = FSlots();
+	Buffers = FSlots();
+}
+
+void FVulkanBindlessTable::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentFrame = FrameIndex;
+	for (FSlots* Slots : { &Textures, &Buffers })
+	{
+		std::vector<uint32_t>& Released = Slots->Released[FrameIndex];
+		Slots->Free.insert(Slots->Free.end(), Released.begin(), Released.end());
+		Released.clear();
+	}
+}
+
+uint32_t FVulkanBindlessTable::RegisterTexture(VkImageView View, VkSampler Sampler, VkImageLayout ImageLayout)
+{
+	uint32_t Index = Textures.Allocate();
+	if (Index == INVALID_INDEX)
+	{
+		return INVALID_INDEX;
+	}
+	VkDescriptorImageInfo ImageInfo{ Sampler, View, ImageLayout };
+	VkWriteDescriptorSet Write{};
+	Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	Write.dstSet = DescriptorSet;
+	Write.dstBinding = TEXTURE_BINDING;
+	Write.dstArrayElement = Index;
+	Write.descriptorCount = 1;
+	Write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	Write.pImageInfo = &ImageInfo;
+	vkUpdateDescriptorSets(Device, 1, &Write, 0, nullptr);
+	return Index;
+}
+
+uint32_t FVulkanBindlessTable::RegisterBuffer(VkBuffer Buffer, VkDeviceSize Offset, VkDeviceSize Range)
+{
+	uint32_t Index = Buffers.Allocate();
+	if (Index == INVALID_INDEX)
+	{
+		return INVALID_INDEX;
+	}
+	VkDescriptorBufferInfo BufferInfo{ Buffer, Offset, Range };
+	VkWriteDescriptorSet Write{};
+	Write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	Write.dstSet = DescriptorSet;
+	Write.dstBinding = BUFFER_BINDING;
+	Write.dstArrayElement = Index;
+	Write.descriptorCount = 1;
+	Write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	Write.pBufferInfo = &BufferInfo;
+	vkUpdateDescriptorSets(Device, 1, &Write, 0, nullptr);
+	return Index;
+}
+
+void FVulkanBindlessTable::Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout PipelineLayout, uint32_t Set) const
+{
+	vkCmdBindDescriptorSets(CommandBuffer, BindPoint, PipelineLayout, Set, 1, &DescriptorSet, 0, nullptr);
+}
+
+void FVulkanBindlessTable::ReportStats() const
+{
+	if (!IsInitialized())
+	{
+		return;
+	}
+	FPlatformMisc::LocalPrintf("Bindless table: %u of %u textures and %u of %u storage buffers in use",
+		Textures.NumUsed(), Textures.Max, Buffers.NumUsed(), Buffers.Max);
+}
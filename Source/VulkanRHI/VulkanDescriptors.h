@@ -0,0 +1,122 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+#include <unordered_map>
+
+// One resource of a descriptor set. Built through Buffer and Image, which zero the padding: sets
+// are cached by the bytes of their bindings.
+struct FDescriptorBinding
+{
+	uint32_t Binding;
+	VkDescriptorType Type;
+	VkDescriptorBufferInfo BufferInfo;
+	VkDescriptorImageInfo ImageInfo;
+
+	static FDescriptorBinding Buffer(uint32_t Binding, VkDescriptorType Type, VkBuffer Buffer, VkDeviceSize Offset = 0, VkDeviceSize Range = VK_WHOLE_SIZE);
+	static FDescriptorBinding Image(uint32_t Binding, VkDescriptorType Type, VkImageView View, VkSampler Sampler, VkImageLayout Layout);
+};
+
+// Transient descriptor sets for the frame being recorded. Every frame in flight allocates from its
+// own growable list of pools, reset as a whole when the frame slot comes around again, so sets
+// are never freed one by one. Within a frame, sets with the same layout and bindings are written
+// once and shared. Used from the thread recording the frame.
+class FVulkanDescriptorAllocator
+{
+public:
+	static const uint32_t DEFAULT_SETS_PER_POOL = 256;
+	static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+	void Init(VkDevice InDevice, uint32_t NumFrames, uint32_t InSetsPerPool = DEFAULT_SETS_PER_POOL);
+	void Shutdown();
+
+	// Starts a frame slot whose previous commands finished executing on the GPU.
+	void BeginFrame(uint32_t FrameIndex);
+
+	// An unwritten set, valid until the frame slot is used again. VK_NULL_HANDLE when out of memory.
+	VkDescriptorSet Allocate(VkDescriptorSetLayout Layout);
+	// A set of Layout with Bindings written, shared with every other request of the frame for the
+	// same layout and bindings.
+	VkDescriptorSet FindOrAllocate(VkDescriptorSetLayout Layout, const FDescriptorBinding* Bindings, uint32_t NumBindings);
+
+	void ReportStats() const;
+
+private:
+	struct FFramePools
+	{
+		std::vector<VkDescriptorPool> Pools;
+		// the pool allocations are made from, the ones before it are full
+		uint32_t CurrentPool = 0;
+		std::unordered_map<uint64_t, VkDescriptorSet> Sets;
+	};
+
+	VkDescriptorPool CreatePool(uint32_t MaxSets);
+
+	VkDevice Device = VK_NULL_HANDLE;
+	std::vector<FFramePools> Frames;
+	FFramePools* CurrentFrame = nullptr;
+	uint32_t SetsPerPool = DEFAULT_SETS_PER_POOL;
+
+	uint64_t NumFrames = 0;
+	uint64_t TotalAllocations = 0;
+	uint64_t TotalCacheHits = 0;
+	uint32_t NumPools = 0;
+};
+
+// Every texture and storage buffer in one descriptor set, bound once per command buffer: shaders
+// index the arrays with indices passed through push constants or instance data, so draws don't
+// update or bind descriptors at all. Needs VK_EXT_descriptor_indexing, whose update-after-bind
+// lets resources be registered while the set is bound in frames still in flight.
+class FVulkanBindlessTable
+{
+public:
+	static const uint32_t TEXTURE_BINDING = 0;
+	static const uint32_t BUFFER_BINDING = 1;
+	static const uint32_t INVALID_INDEX = ~0u;
+	static const uint32_t DEFAULT_MAX_TEXTURES = 4096;
+	static const uint32_t DEFAULT_MAX_BUFFERS = 1024;
+
+	// MaxTextures and MaxBuffers must be within the device's update-after-bind limits.
+	bool Init(VkDevice InDevice, uint32_t NumFrames, uint32_t MaxTextures = DEFAULT_MAX_TEXTURES, uint32_t MaxBuffers = DEFAULT_MAX_BUFFERS);
+	void Shutdown();
+	bool IsInitialized() const { return DescriptorSet != VK_NULL_HANDLE; }
+
+	// Starts a frame slot whose previous commands finished: the indices released then are free again.
+	void BeginFrame(uint32_t FrameIndex);
+
+	// Index into the texture array (combined image samplers), INVALID_INDEX when it is full.
+	uint32_t RegisterTexture(VkImageView View, VkSampler Sampler, VkImageLayout Layout);
+	// Index into the storage buffer array, INVALID_INDEX when it is full.
+	uint32_t RegisterBuffer(VkBuffer Buffer, VkDeviceSize Offset = 0, VkDeviceSize Range = VK_WHOLE_SIZE);
+	// The index is reused once the frames in flight that may still read it finished.
+	void ReleaseTexture(uint32_t Index) { Textures.Release(Index, CurrentFrame); }
+	void ReleaseBuffer(uint32_t Index) { Buffers.Release(Index, CurrentFrame); }
+
+	VkDescriptorSetLayout GetLayout() const { return Layout; }
+	void Bind(VkCommandBuffer CommandBuffer, VkPipelineBindPoint BindPoint, VkPipelineLayout PipelineLayout, uint32_t Set) const;
+
+	void ReportStats() const;
+
+private:
+	struct FSlots
+	{
+		uint32_t Max = 0;
+		// indices below are in use or free
+		uint32_t NumAllocated = 0;
+		std::vector<uint32_t> Free;
+		// released per frame slot, free once the slot comes around again
+		std::vector<std::vector<uint32_t>> Released;
+
+		uint32_t Allocate();
+		void Release(uint32_t Index, uint32_t FrameIndex) { Released[FrameIndex].push_back(Index); }
+		uint32_t NumUsed() const;
+	};
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+	VkDescriptorPool Pool = VK_NULL_HANDLE;
+	VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+	FSlots Textures;
+	FSlots Buffers;
+	uint32_t CurrentFrame = 0;
+};
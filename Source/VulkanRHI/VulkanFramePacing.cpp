@@ -0,0 +1,148 @@
+#include "VulkanFramePacing.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+#include <thread>
+#include <initializer_list>
+
+VkPresentModeKHR FVulkanFramePacer::ChoosePresentMode(EPresentMode Mode, const std::vector<VkPresentModeKHR>& Supported)
+{
+	VkPresentModeKHR Wanted = VK_PRESENT_MODE_FIFO_KHR;
+	switch (Mode)
+	{
+	case EPresentMode::VSync: Wanted = VK_PRESENT_MODE_FIFO_KHR; break;
+	case EPresentMode::Mailbox: Wanted = VK_PRESENT_MODE_MAILBOX_KHR; break;
+	case EPresentMode::Immediate: Wanted = VK_PRESENT_MODE_IMMEDIATE_KHR; break;
+	}
+	if (std::find(Supported.begin(), Supported.end(), Wanted) != Supported.end())
+	{
+		return Wanted;
+	}
+	FPlatformMisc::LocalPrintf("Present mode %s not supported, using vsync", GetName(Mode));
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+const char* FVulkanFramePacer::GetName(EPresentMode Mode)
+{
+	switch (Mode)
+	{
+	case EPresentMode::VSync: return "vsync";
+	case EPresentMode::Mailbox: return "mailbox";
+	case EPresentMode::Immediate: return "immediate";
+	}
+	return "unknown";
+}
+
+void FVulkanFramePacer::Init(VkDevice InDevice, double TargetFrameRate, bool SupportsPresentWait)
+{
+	Device = InDevice;
+	FramePeriod = TargetFrameRate > 0.0 ? 1.0 / TargetFrameRate : 0.0;
+	if (SupportsPresentWait)
+	{
+		WaitForPresent = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(Device, "vkWaitForPresentKHR");
+	}
+	PresentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+	PresentIdInfo.swapchainCount = 1;
+}
+
+void FVulkanFramePacer::SetSwapchain(VkSwapchainKHR InSwapchain)
+{
+	Swapchain = InSwapchain;
+	QueuedPresents.clear();
+}
+
+void FVulkanFramePacer::WaitForNextFrame()
+{
+	SCOPED_CPU_EVENT("FramePacing");
+	if (WaitForPresent != nullptr)
+	{
+		WaitForPresents(MAX_QUEUED_PRESENTS);
+	}
+	if (FramePeriod > 0.0)
+	{
+		LimitFrameRate();
+	}
+}
+
+void FVulkanFramePacer::WaitForPresents(size_t MaxQueued)
+{
+	double WaitStart = FPlatformMisc::Seconds();
+	bool Waited = false;
+	while (!QueuedPresents.empty())
+	{
+		const FQueuedPresent& Present = QueuedPresents.front();
+		// presents that already reached the display are picked up without blocking, they were
+		// displayed by now at the latest
+		bool MustWait = QueuedPresents.size() > MaxQueued;
+		// a present never displayed, e.g. of a minimized window, must not hang the frame
+		const uint64_t TIMEOUT = 100000000;
+		VkResult Result = WaitForPresent(Device, Swapchain, Present.PresentId, MustWait ? TIMEOUT : 0);
+		if (Result == VK_TIMEOUT && !MustWait)
+		{
+			break;
+		}
+		Waited |= MustWait;
+		double Now = FPlatformMisc::Seconds();
+		if (Result == VK_SUCCESS || Result == VK_SUBOPTIMAL_KHR)
+		{
+			InputToPresent.Add((Now - Present.InputTime) * 1000.0);
+		}
+		// out of date and lost swapchains never display it
+		QueuedPresents.pop_front();
+	}
+	if (Waited)
+	{
+		PresentWait.Add((FPlatformMisc::Seconds() - WaitStart) * 1000.0);
+	}
+}
+
+void FVulkanFramePacer::LimitFrameRate()
+{
+	double Now = FPlatformMisc::Seconds();
+	// a frame that ran late starts the schedule again instead of rushing the next ones
+	if (NextFrameTime == 0.0 || Now > NextFrameTime + FramePeriod)
+	{
+		NextFrameTime = Now;
+	}
+	double WaitStart = Now;
+	// sleep most of the wait, which saves power, and spin the part sleeps may overshoot
+	double SleepTime = NextFrameTime - Now - SleepOvershoot;
+	if (SleepTime > 0.0)
+	{
+		FPlatformMisc::Sleep(SleepTime);
+		double Overshoot = FPlatformMisc::Seconds() - Now - SleepTime;
+		// follows the overshoot up at once and down slowly, and is never all of the wait
+		SleepOvershoot = Overshoot > SleepOvershoot ? Overshoot : SleepOvershoot + (Overshoot - SleepOvershoot) * 0.05;
+		SleepOvershoot = std::min(std::max(SleepOvershoot, 0.0002), FramePeriod * 0.5);
+	}
+	while ((Now = FPlatformMisc::Seconds()) < NextFrameTime)
+	{
+		std::this_thread::yield();
+	}
+	LimiterWait.Add((Now - WaitStart) * 1000.0);
+	NextFrameTime += FramePeriod;
+}
+
+void FVulkanFramePacer::OnPresent(VkPresentInfoKHR& PresentInfo)
+{
+	if (WaitForPresent == nullptr)
+	{
+		InputToQueuedPresent.Add((FPlatformMisc::Seconds() - InputTime) * 1000.0);
+		return;
+	}
+	PresentId = NextPresentId++;
+	PresentIdInfo.pNext = PresentInfo.pNext;
+	PresentIdInfo.pPresentIds = &PresentId;
+	PresentInfo.pNext = &PresentIdInfo;
+	QueuedPresents.push_back({ PresentId, InputTime });
+}
+
+void FVulkanFramePacer::ReportStats() const
+{
+	for (const FStatSamples* Samples : { &LimiterWait, &PresentWait, &InputToPresent, &InputToQueuedPresent })
+	{
+		if (Samples->Num() > 0)
+		{
+			Samples->Report();
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "HAL/PlatformMisc.h"
+#include "Stats/StatSamples.h"
+#include <vector>
+#include <deque>
+
+enum class EPresentMode : uint8_t
+{
+	// FIFO: never tears, frames queue up behind the vertical blank
+	VSync,
+	// the newest frame replaces the queued one at the vertical blank, no tearing and less queuing
+	Mailbox,
+	// presents right away and may tear, the lowest latency
+	Immediate,
+};
+
+// Decides when the next frame starts. A frame rate limiter sleeps until the frame's slot, and on
+// devices with VK_KHR_present_wait the pacer also waits until few enough frames are queued for
+// display, so the CPU doesn't run ahead and every queued frame doesn't add a frame of latency.
+// With the render thread on, the pacer waits on the render thread and no longer delays the game
+// thread's input sampling, which can then run up to the frame lag ahead of recording. The reported
+// latency is the input's age when the frame reaches the display, or when the present is queued
+// without present wait.
+class FVulkanFramePacer
+{
+public:
+	// Presents that may wait for display when the next frame starts.
+	static const uint32_t MAX_QUEUED_PRESENTS = 1;
+
+	// Mode's present mode when the surface supports it, FIFO otherwise, which every surface supports.
+	static VkPresentModeKHR ChoosePresentMode(EPresentMode Mode, const std::vector<VkPresentModeKHR>& Supported);
+	static const char* GetName(EPresentMode Mode);
+
+	// TargetFrameRate 0 leaves the pace to the present mode and the GPU. SupportsPresentWait
+	// needs VK_KHR_present_id and VK_KHR_present_wait enabled with their features.
+	void Init(VkDevice InDevice, double TargetFrameRate, bool SupportsPresentWait);
+	// Presents made from now on are to Swapchain, the ones waiting for display are forgotten.
+	void SetSwapchain(VkSwapchainKHR InSwapchain);
+
+	// Blocks until the next frame should start, before its fence and image waits.
+	void WaitForNextFrame();
+	// When the input of the frame about to be presented was sampled, an FPlatformMisc::Seconds() time.
+	void MarkInputSampled(double Time) { InputTime = Time; }
+	// Right before vkQueuePresentKHR, whose PresentInfo gets the present id chained in with present wait.
+	void OnPresent(VkPresentInfoKHR& PresentInfo);
+
+	bool UsesPresentWait() const { return WaitForPresent != nullptr; }
+	void ReportStats() const;
+
+private:
+	struct FQueuedPresent
+	{
+		uint64_t PresentId;
+		double InputTime;
+	};
+
+	void WaitForPresents(size_t MaxQueued);
+	void LimitFrameRate();
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkSwapchainKHR Swapchain = VK_NULL_HANDLE;
+	PFN_vkWaitForPresentKHR WaitForPresent = nullptr;
+	VkPresentIdKHR PresentIdInfo{};
+	// of the present being made, PresentIdInfo points to it
+	uint64_t PresentId = 0;
+	uint64_t NextPresentId = 1;
+	std::deque<FQueuedPresent> QueuedPresents;
+	double InputTime = 0.0;
+
+	// seconds, 0 without a limit
+	double FramePeriod = 0.0;
+	double NextFrameTime = 0.0;
+	// sleeps end this much later than asked, the last part of a wait spins instead
+	double SleepOvershoot = 0.001;
+
+	FStatSamples LimiterWait{"Frame limiter wait"};
+	FStatSamples PresentWait{"Present wait"};
+	FStatSamples InputToPresent{"Input to present"};
+	FStatSamples InputToQueuedPresent{"Input to queued present"};
+};
@@ -0,0 +1,428 @@
+#include "VulkanGpuCulling.h"
+#include "VulkanMesh.h"
+#include "VulkanUpload.h"
+#include "VulkanShaderLibrary.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include <algorithm>
+
+// offset of the compacted draws in the draw arguments, after the draw count
+static const VkDeviceSize COMPACTED_DRAWS_OFFSET = 16;
+static const uint32_t NUM_BINDINGS = 5;
+
+struct FCullParams
+{
+	float View[4];
+	float ViewportSize[2];
+	float MinPixels;
+	uint32_t NumInstances;
+};
+
+bool FVulkanGpuCulling::Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, FVulkanUploadManager& InUploadManager,
+	FVulkanShaderLibrary& ShaderLibrary, VkPipelineCache PipelineCache, uint32_t NumFrames, const std::vector<uint32_t>& QueueFamilies,
+	VkQueue InComputeQueue, uint32_t ComputeFamilyIndex, bool UseDrawIndirectCount, uint32_t InMaxDrawIndirectCount)
+{
+	Device = InDevice;
+	MemoryAllocator = &InMemoryAllocator;
+	UploadManager = &InUploadManager;
+	ComputeQueue = InComputeQueue;
+	MaxDrawIndirectCount = std::max(InMaxDrawIndirectCount, 1u);
+	SharingFamilies = QueueFamilies;
+	std::sort(SharingFamilies.begin(), SharingFamilies.end());
+	SharingFamilies.erase(std::unique(SharingFamilies.begin(), SharingFamilies.end()), SharingFamilies.end());
+	if (UseDrawIndirectCount)
+	{
+		DrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(Device, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+
+	VkDescriptorSetLayoutBinding Bindings[NUM_BINDINGS] = {};
+	for (uint32_t i = 0; i < NUM_BINDINGS; ++i)
+	{
+		Bindings[i].binding = i;
+		Bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		Bindings[i].descriptorCount = 1;
+		Bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+	LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	LayoutInfo.bindingCount = NUM_BINDINGS;
+	LayoutInfo.pBindings = Bindings;
+	if (vkCreateDescriptorSetLayout(Device, &LayoutInfo, nullptr, &DescriptorSetLayout) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "GPU culling: failed to create the descriptor set layout");
+		return false;
+	}
+
+	VkPushConstantRange PushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FCullParams)};
+	VkPipelineLayoutCreateInfo PipelineLayoutInfo{};
+	PipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	PipelineLayoutInfo.setLayoutCount = 1;
+	PipelineLayoutInfo.pSetLayouts = &DescriptorSetLayout;
+	PipelineLayoutInfo.pushConstantRangeCount = 1;
+	PipelineLayoutInfo.pPushConstantRanges = &PushConstantRange;
+	if (vkCreatePipelineLayout(Device, &PipelineLayoutInfo, nullptr, &PipelineLayout) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "GPU culling: failed to create the pipeline layout");
+		return false;
+	}
+	CullPipeline = CreatePipeline(ShaderLibrary, PipelineCache, "cull.comp");
+	CompactPipeline = CreatePipeline(ShaderLibrary, PipelineCache, "compact.comp");
+	if (CullPipeline == VK_NULL_HANDLE || CompactPipeline == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+
+	VkDescriptorPoolSize PoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NUM_BINDINGS * NumFrames};
+	VkDescriptorPoolCreateInfo PoolInfo{};
+	PoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	PoolInfo.maxSets = NumFrames;
+	PoolInfo.poolSizeCount = 1;
+	PoolInfo.pPoolSizes = &PoolSize;
+	if (vkCreateDescriptorPool(Device, &PoolInfo, nullptr, &DescriptorPool) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "GPU culling: failed to create the descriptor pool");
+		return false;
+	}
+
+	Frames.resize(NumFrames);
+	for (FFrame& Frame : Frames)
+	{
+		VkDescriptorSetAllocateInfo AllocateInfo{};
+		AllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		AllocateInfo.descriptorPool = DescriptorPool;
+		AllocateInfo.descriptorSetCount = 1;
+		AllocateInfo.pSetLayouts = &DescriptorSetLayout;
+		verify(vkAllocateDescriptorSets(Device, &AllocateInfo, &Frame.DescriptorSet) == VK_SUCCESS);
+		if (!IsAsync())
+		{
+			continue;
+		}
+
+		VkCommandPoolCreateInfo CommandPoolInfo{};
+		CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		CommandPoolInfo.queueFamilyIndex = ComputeFamilyIndex;
+		verify(vkCreateCommandPool(Device, &CommandPoolInfo, nullptr, &Frame.CommandPool) == VK_SUCCESS);
+		VkCommandBufferAllocateInfo CommandBufferInfo{};
+		CommandBufferInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		CommandBufferInfo.commandPool = Frame.CommandPool;
+		CommandBufferInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		CommandBufferInfo.commandBufferCount = 1;
+		verify(vkAllocateCommandBuffers(Device, &CommandBufferInfo, &Frame.CommandBuffer) == VK_SUCCESS);
+		VkSemaphoreCreateInfo SemaphoreInfo{};
+		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		verify(vkCreateSemaphore(Device, &SemaphoreInfo, nullptr, &Frame.Semaphore) == VK_SUCCESS);
+	}
+	FPlatformMisc::LocalPrintf("GPU culling: %s, %s", IsAsync() ? "async compute queue" : "graphics queue",
+		DrawIndexedIndirectCount ? "compacted draws" : "all draws submitted");
+	return true;
+}
+
+void FVulkanGpuCulling::Shutdown()
+{
+	DestroySceneBuffers();
+	for (FFrame& Frame : Frames)
+	{
+		// command buffers and descriptor sets go with their pools
+		vkDestroyCommandPool(Device, Frame.CommandPool, nullptr);
+		vkDestroySemaphore(Device, Frame.Semaphore, nullptr);
+	}
+	Frames.clear();
+	CurrentFrame = nullptr;
+	vkDestroyPipeline(Device, CullPipeline, nullptr);
+	vkDestroyPipeline(Device, CompactPipeline, nullptr);
+	vkDestroyPipelineLayout(Device, PipelineLayout, nullptr);
+	vkDestroyDescriptorPool(Device, DescriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(Device, DescriptorSetLayout, nullptr);
+	CullPipeline = CompactPipeline = VK_NULL_HANDLE;
+	PipelineLayout = VK_NULL_HANDLE;
+	DescriptorPool = VK_NULL_HANDLE;
+	DescriptorSetLayout = VK_NULL_HANDLE;
+}
+
+bool FVulkanGpuCulling::SetScene(const FGpuCullInstance* InInstances, uint32_t InNumInstances, const std::vector<const FVulkanMesh*>& Meshes,
+	const std::vector<uint32_t>& FirstInstances, const std::vector<float>& BoundingRadii)
+{
+	DestroySceneBuffers();
+	NumInstances = InNumInstances;
+	NumDraws = (uint32_t)Meshes.size();
+	if (NumInstances == 0 || NumDraws == 0)
+	{
+		return false;
+	}
+
+	if (DrawIndexedIndirectCount && NumDraws > MaxDrawIndirectCount)
+	{
+		FPlatformMisc::LocalPrintf("GPU culling: %u draws exceed maxDrawIndirectCount, submitting all draws", NumDraws);
+		DrawIndexedIndirectCount = nullptr;
+	}
+
+	std::vector<VkDrawIndexedIndirectCommand> Templates(NumDraws);
+	for (uint32_t i = 0; i < NumDraws; ++i)
+	{
+		Templates[i].indexCount = Meshes[i]->NumIndices;
+		Templates[i].instanceCount = 0;
+		Templates[i].firstIndex = Meshes[i]->FirstIndex;
+		Templates[i].vertexOffset = Meshes[i]->VertexOffset;
+		Templates[i].firstInstance = FirstInstances[i];
+	}
+	VkDeviceSize InstancesSize = (VkDeviceSize)NumInstances * sizeof(FGpuCullInstance);
+	VkDeviceSize DrawsSize = (VkDeviceSize)NumDraws * sizeof(VkDrawIndexedIndirectCommand);
+	bool Created = CreateBuffer(InstancesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly, Instances) &&
+		CreateBuffer(NumDraws * sizeof(float), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly, DrawBounds) &&
+		CreateBuffer(DrawsSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, EVulkanMemoryUsage::GpuOnly, DrawTemplates);
+	for (FFrame& Frame : Frames)
+	{
+		Created = Created &&
+			CreateBuffer(DrawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, EVulkanMemoryUsage::GpuToCpu, Frame.Draws) &&
+			CreateBuffer(COMPACTED_DRAWS_OFFSET + DrawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+				EVulkanMemoryUsage::GpuOnly, Frame.DrawArguments) &&
+			CreateBuffer(InstancesSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly, Frame.VisibleInstances);
+	}
+	if (!Created)
+	{
+		TE_LOG(LogRHI, Error, "GPU culling: failed to create the scene buffers");
+		DestroySceneBuffers();
+		return false;
+	}
+
+	bool IsConcurrent = SharingFamilies.size() > 1;
+	UploadManager->UploadBuffer(Instances.Buffer, 0, InInstances, InstancesSize, IsConcurrent);
+	UploadManager->UploadBuffer(DrawBounds.Buffer, 0, BoundingRadii.data(), NumDraws * sizeof(float), IsConcurrent);
+	SceneUploadTicket = UploadManager->UploadBuffer(DrawTemplates.Buffer, 0, Templates.data(), DrawsSize, IsConcurrent);
+	WriteDescriptorSets();
+	FPlatformMisc::LocalPrintf("GPU culling: %u instances in %u draws", NumInstances, NumDraws);
+	return true;
+}
+
+bool FVulkanGpuCulling::IsReady() const
+{
+	return NumInstances > 0 && UploadManager->IsComplete(SceneUploadTicket);
+}
+
+void FVulkanGpuCulling::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentFrame = &Frames[FrameIndex];
+	if (!CurrentFrame->WasCulled)
+	{
+		return;
+	}
+	CurrentFrame->WasCulled = false;
+	MemoryAllocator->Invalidate(CurrentFrame->Draws.Allocation);
+	const VkDrawIndexedIndirectCommand* Draws = (const VkDrawIndexedIndirectCommand*)CurrentFrame->Draws.Allocation->MappedData;
+	for (uint32_t i = 0; i < NumDraws; ++i)
+	{
+		TotalVisibleInstances += Draws[i].instanceCount;
+		TotalVisibleDraws += Draws[i].instanceCount > 0 ? 1 : 0;
+	}
+	++NumCulledFrames;
+}
+
+void FVulkanGpuCulling::SetView(const FVector4& ViewTransform, float ViewportWidth, float ViewportHeight)
+{
+	std::copy(ViewTransform.Data(), ViewTransform.Data() + 4, View);
+	ViewportSize[0] = ViewportWidth;
+	ViewportSize[1] = ViewportHeight;
+}
+
+void FVulkanGpuCulling::Record(VkCommandBuffer CommandBuffer)
+{
+	RecordCulling(CommandBuffer);
+	// the draws read the results, and BeginFrame reads the instance counts once the frame's fence signaled
+	VkMemoryBarrier Barrier{};
+	Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	Barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	Barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr);
+}
+
+VkSemaphore FVulkanGpuCulling::Submit()
+{
+	FFrame& Frame = *CurrentFrame;
+	verify(vkResetCommandPool(Device, Frame.CommandPool, 0) == VK_SUCCESS);
+	VkCommandBufferBeginInfo BeginInfo{};
+	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	verify(vkBeginCommandBuffer(Frame.CommandBuffer, &BeginInfo) == VK_SUCCESS);
+	RecordCulling(Frame.CommandBuffer);
+	// the semaphore covers the graphics queue's reads, the host reads need their own barrier
+	VkMemoryBarrier Barrier{};
+	Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	Barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	Barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(Frame.CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr);
+	verify(vkEndCommandBuffer(Frame.CommandBuffer) == VK_SUCCESS);
+
+	VkSubmitInfo SubmitInfo{};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &Frame.CommandBuffer;
+	SubmitInfo.signalSemaphoreCount = 1;
+	SubmitInfo.pSignalSemaphores = &Frame.Semaphore;
+	verify(vkQueueSubmit(ComputeQueue, 1, &SubmitInfo, VK_NULL_HANDLE) == VK_SUCCESS);
+	return Frame.Semaphore;
+}
+
+void FVulkanGpuCulling::RecordDraws(VkCommandBuffer CommandBuffer)
+{
+	FFrame& Frame = *CurrentFrame;
+	VkDeviceSize Offset = 0;
+	vkCmdBindVertexBuffers(CommandBuffer, 1, 1, &Frame.VisibleInstances.Buffer, &Offset);
+	const uint32_t Stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (DrawIndexedIndirectCount)
+	{
+		DrawIndexedIndirectCount(CommandBuffer, Frame.DrawArguments.Buffer, COMPACTED_DRAWS_OFFSET, Frame.DrawArguments.Buffer, 0, NumDraws, Stride);
+		return;
+	}
+	for (uint32_t First = 0; First < NumDraws; First += MaxDrawIndirectCount)
+	{
+		uint32_t Count = std::min(NumDraws - First, MaxDrawIndirectCount);
+		vkCmdDrawIndexedIndirect(CommandBuffer, Frame.Draws.Buffer, (VkDeviceSize)First * Stride, Count, Stride);
+	}
+}
+
+void FVulkanGpuCulling::ReportStats() const
+{
+	if (NumCulledFrames == 0)
+	{
+		return;
+	}
+	FPlatformMisc::LocalPrintf("GPU culling: %.1f of %u instances and %.1f of %u draws visible per frame",
+		(double)TotalVisibleInstances / NumCulledFrames, NumInstances, (double)TotalVisibleDraws / NumCulledFrames, NumDraws);
+}
+
+bool FVulkanGpuCulling::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, EVulkanMemoryUsage MemoryUsage, FBuffer& OutBuffer)
+{
+	VkBufferCreateInfo BufferInfo{};
+	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	BufferInfo.size = Size;
+	BufferInfo.usage = Usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (SharingFamilies.size() > 1)
+	{
+		BufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		BufferInfo.queueFamilyIndexCount = (uint32_t)SharingFamilies.size();
+		BufferInfo.pQueueFamilyIndices = SharingFamilies.data();
+	}
+	if (vkCreateBuffer(Device, &BufferInfo, nullptr, &OutBuffer.Buffer) != VK_SUCCESS)
+	{
+		return false;
+	}
+	// allocated apart from CreateBuffer, defragmentation only moves buffers it created
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(Device, OutBuffer.Buffer, &Requirements);
+	OutBuffer.Allocation = MemoryAllocator->Allocate(Requirements, MemoryUsage, true);
+	return OutBuffer.Allocation != nullptr &&
+		vkBindBufferMemory(Device, OutBuffer.Buffer, OutBuffer.Allocation->Memory, OutBuffer.Allocation->Offset) == VK_SUCCESS;
+}
+
+void FVulkanGpuCulling::DestroyBuffer(FBuffer& Buffer)
+{
+	vkDestroyBuffer(Device, Buffer.Buffer, nullptr);
+	if (Buffer.Allocation != nullptr)
+	{
+		MemoryAllocator->Free(Buffer.Allocation);
+	}
+	Buffer = FBuffer();
+}
+
+VkPipeline FVulkanGpuCulling::CreatePipeline(FVulkanShaderLibrary& ShaderLibrary, VkPipelineCache PipelineCache, const char* ShaderName)
+{
+	VkShaderModule Module = ShaderLibrary.GetModule(ShaderLibrary.FindShader(ShaderName));
+	if (Module == VK_NULL_HANDLE)
+	{
+		FPlatformMisc::LocalPrintf("GPU culling: shader %s not found", ShaderName);
+		return VK_NULL_HANDLE;
+	}
+	VkComputePipelineCreateInfo PipelineInfo{};
+	PipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	PipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	PipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	PipelineInfo.stage.module = Module;
+	PipelineInfo.stage.pName = "main";
+	PipelineInfo.layout = PipelineLayout;
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+	if (vkCreateComputePipelines(Device, PipelineCache, 1, &PipelineInfo, nullptr, &Pipeline) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "GPU culling: failed to create the pipeline of %s", ShaderName);
+		return VK_NULL_HANDLE;
+	}
+	return Pipeline;
+}
+
+void FVulkanGpuCulling::DestroySceneBuffers()
+{
+	DestroyBuffer(Instances);
+	DestroyBuffer(DrawBounds);
+	DestroyBuffer(DrawTemplates);
+	for (FFrame& Frame : Frames)
+	{
+		DestroyBuffer(Frame.Draws);
+		DestroyBuffer(Frame.DrawArguments);
+		DestroyBuffer(Frame.VisibleInstances);
+		Frame.WasCulled = false;
+	}
+	NumInstances = NumDraws = 0;
+}
+
+void FVulkanGpuCulling::WriteDescriptorSets()
+{
+	for (FFrame& Frame : Frames)
+	{
+		VkDescriptorBufferInfo BufferInfos[NUM_BINDINGS] = {
+			{Instances.Buffer, 0, VK_WHOLE_SIZE},
+			{DrawBounds.Buffer, 0, VK_WHOLE_SIZE},
+			{Frame.Draws.Buffer, 0, VK_WHOLE_SIZE},
+			{Frame.VisibleInstances.Buffer, 0, VK_WHOLE_SIZE},
+			{Frame.DrawArguments.Buffer, 0, VK_WHOLE_SIZE},
+		};
+		VkWriteDescriptorSet Writes[NUM_BINDINGS] = {};
+		for (uint32_t i = 0; i < NUM_BINDINGS; ++i)
+		{
+			Writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			Writes[i].dstSet = Frame.DescriptorSet;
+			Writes[i].dstBinding = i;
+			Writes[i].descriptorCount = 1;
+			Writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			Writes[i].pBufferInfo = &BufferInfos[i];
+		}
+		vkUpdateDescriptorSets(Device, NUM_BINDINGS, Writes, 0, nullptr);
+	}
+}
+
+void FVulkanGpuCulling::RecordCulling(VkCommandBuffer CommandBuffer)
+{
+	// the frame slot's previous draws finished, BeginFrame is only called once its fence signaled
+	FFrame& Frame = *CurrentFrame;
+	VkBufferCopy Region{0, 0, (VkDeviceSize)NumDraws * sizeof(VkDrawIndexedIndirectCommand)};
+	vkCmdCopyBuffer(CommandBuffer, DrawTemplates.Buffer, Frame.Draws.Buffer, 1, &Region);
+	vkCmdFillBuffer(CommandBuffer, Frame.DrawArguments.Buffer, 0, sizeof(uint32_t), 0);
+	VkMemoryBarrier Barrier{};
+	Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr);
+
+	FCullParams Params;
+	std::copy(View, View + 4, Params.View);
+	Params.ViewportSize[0] = ViewportSize[0];
+	Params.ViewportSize[1] = ViewportSize[1];
+	Params.MinPixels = 1.f;
+	Params.NumInstances = NumInstances;
+	vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, CullPipeline);
+	vkCmdBindDescriptorSets(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, PipelineLayout, 0, 1, &Frame.DescriptorSet, 0, nullptr);
+	vkCmdPushConstants(CommandBuffer, PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Params), &Params);
+	vkCmdDispatch(CommandBuffer, (NumInstances + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+
+	if (DrawIndexedIndirectCount)
+	{
+		Barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		Barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &Barrier, 0, nullptr, 0, nullptr);
+		vkCmdBindPipeline(CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, CompactPipeline);
+		vkCmdPushConstants(CommandBuffer, PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t), &NumDraws);
+		vkCmdDispatch(CommandBuffer, (NumDraws + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+	}
+	Frame.WasCulled = true;
+}
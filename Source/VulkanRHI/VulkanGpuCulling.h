@@ -0,0 +1,132 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "VulkanRHI/VulkanMemory.h"
+#include "Math/Vector.h"
+#include <vector>
+
+class FVulkanUploadManager;
+class FVulkanShaderLibrary;
+struct FVulkanMesh;
+
+// What cull.comp reads of every instance, 16 bytes: the per-instance vertex data of the main pass,
+// whose last component carries the index of the instance's draw.
+struct FGpuCullInstance
+{
+	float Offset[2];
+	float Scale;
+	uint32_t Draw;
+};
+
+// Culls instances on the GPU and builds the indirect draws of the survivors, so the CPU records
+// the same few commands whatever the instance count. Per frame:
+// - the draws' instance counts are reset from a template with a buffer copy,
+// - cull.comp tests every instance against the view rectangle and drops the ones smaller than
+//   a pixel, appending the others to their draw's range of the visible instance buffer,
+// - compact.comp packs the draws left with instances for vkCmdDrawIndexedIndirectCountKHR.
+//   Without VK_KHR_draw_indirect_count all draws are submitted and the empty ones draw nothing.
+//
+// The work is recorded into the graphics command buffer, or with a compute queue given to Init
+// into command buffers of that queue: the frame's compute is then submitted before its graphics,
+// overlapping the previous frame's graphics, and the graphics submit waits for it. Buffers the
+// two queues share are created concurrent, so nothing changes queue family ownership.
+// Needs drawIndirectFirstInstance.
+class FVulkanGpuCulling
+{
+public:
+	static const uint32_t GROUP_SIZE = 64;
+
+	// ComputeQueue is VK_NULL_HANDLE to record into the graphics command buffer. QueueFamilies
+	// are all families touching the buffers, including the upload manager's transfer family.
+	bool Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, FVulkanUploadManager& InUploadManager,
+		FVulkanShaderLibrary& ShaderLibrary, VkPipelineCache PipelineCache, uint32_t NumFrames, const std::vector<uint32_t>& QueueFamilies,
+		VkQueue InComputeQueue, uint32_t ComputeFamilyIndex, bool UseDrawIndirectCount, uint32_t InMaxDrawIndirectCount);
+	// The GPU must be idle.
+	void Shutdown();
+
+	// Uploads the scene: instances grouped by draw, and per draw its mesh, its first instance and
+	// the bounding radius of the mesh at scale 1.
+	bool SetScene(const FGpuCullInstance* Instances, uint32_t NumInstances, const std::vector<const FVulkanMesh*>& Meshes,
+		const std::vector<uint32_t>& FirstInstances, const std::vector<float>& BoundingRadii);
+	// True once the scene's upload is usable.
+	bool IsReady() const;
+
+	// Starts a frame slot whose previous work finished executing, and reads back its instance counts.
+	void BeginFrame(uint32_t FrameIndex);
+	// View transform from scene to clip space, like the main pass vertex shader's.
+	void SetView(const FVector4& ViewTransform, float ViewportWidth, float ViewportHeight);
+
+	bool IsAsync() const { return ComputeQueue != VK_NULL_HANDLE; }
+	// Without a compute queue, records the culling into a graphics command buffer, outside of a render pass.
+	void Record(VkCommandBuffer CommandBuffer);
+	// With a compute queue, records and submits the frame's culling. Returns the semaphore the
+	// graphics submit has to wait for at GetWaitStage().
+	VkSemaphore Submit();
+	VkPipelineStageFlags GetWaitStage() const { return VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT; }
+
+	// Binds the visible instances to binding 1 and records the frame's draws. The pipeline and
+	// the mesh pool's buffers must be bound.
+	void RecordDraws(VkCommandBuffer CommandBuffer);
+
+	void ReportStats() const;
+
+private:
+	struct FBuffer
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		FVulkanAllocation* Allocation = nullptr;
+	};
+
+	struct FFrame
+	{
+		// the draws with their instance counts, host visible for the stats
+		FBuffer Draws;
+		// draw count and the compacted draws
+		FBuffer DrawArguments;
+		FBuffer VisibleInstances;
+		VkDescriptorSet DescriptorSet = VK_NULL_HANDLE;
+		// only with a compute queue
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkSemaphore Semaphore = VK_NULL_HANDLE;
+		bool WasCulled = false;
+	};
+
+	bool CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags Usage, EVulkanMemoryUsage MemoryUsage, FBuffer& OutBuffer);
+	void DestroyBuffer(FBuffer& Buffer);
+	VkPipeline CreatePipeline(FVulkanShaderLibrary& ShaderLibrary, VkPipelineCache PipelineCache, const char* ShaderName);
+	void DestroySceneBuffers();
+	void WriteDescriptorSets();
+	void RecordCulling(VkCommandBuffer CommandBuffer);
+
+	VkDevice Device = VK_NULL_HANDLE;
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	FVulkanUploadManager* UploadManager = nullptr;
+	std::vector<uint32_t> SharingFamilies;
+	VkQueue ComputeQueue = VK_NULL_HANDLE;
+	PFN_vkCmdDrawIndexedIndirectCountKHR DrawIndexedIndirectCount = nullptr;
+	uint32_t MaxDrawIndirectCount = 1;
+
+	VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+	VkPipeline CullPipeline = VK_NULL_HANDLE;
+	VkPipeline CompactPipeline = VK_NULL_HANDLE;
+
+	FBuffer Instances;
+	FBuffer DrawBounds;
+	// the draws with instance counts of 0
+	FBuffer DrawTemplates;
+	uint32_t NumInstances = 0;
+	uint32_t NumDraws = 0;
+	uint64_t SceneUploadTicket = 0;
+
+	std::vector<FFrame> Frames;
+	FFrame* CurrentFrame = nullptr;
+	float View[4] = { 0.f, 0.f, 1.f, 1.f };
+	float ViewportSize[2] = { 1.f, 1.f };
+
+	uint64_t NumCulledFrames = 0;
+	uint64_t TotalVisibleInstances = 0;
+	uint64_t TotalVisibleDraws = 0;
+};
@@ -0,0 +1,242 @@
+#include "VulkanGpuProfiler.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include "Stats/Profiler.h"
+
+static const uint32_t INDEX_NONE = ~0u;
+// GPU and CPU clocks drift apart by a few microseconds per second
+static const double RECALIBRATION_INTERVAL = 1.0;
+
+void FVulkanGpuProfiler::Init(VkPhysicalDevice PhysicalDevice, VkDevice InDevice, VkQueue Queue, uint32_t QueueFamilyIndex,
+	uint32_t NumFrames, bool UseCalibratedTimestamps, const char* TrackName)
+{
+	Device = InDevice;
+	if (!FProfiler::Get().IsEnabled())
+	{
+		return;
+	}
+
+	uint32_t NumFamilies = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, nullptr);
+	std::vector<VkQueueFamilyProperties> Families(NumFamilies);
+	vkGetPhysicalDeviceQueueFamilyProperties(PhysicalDevice, &NumFamilies, Families.data());
+	uint32_t ValidBits = Families[QueueFamilyIndex].timestampValidBits;
+	if (ValidBits == 0)
+	{
+		FPlatformMisc::LocalPrint("Queue family has no timestamps, GPU profiling disabled");
+		return;
+	}
+	TimestampMask = ValidBits >= 64 ? ~0ull : (1ull << ValidBits) - 1;
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+	TimestampPeriod = Properties.limits.timestampPeriod;
+
+	VkQueryPoolCreateInfo PoolInfo{};
+	PoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	PoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	PoolInfo.queryCount = NumFrames * MAX_QUERIES_PER_FRAME;
+	verify(vkCreateQueryPool(Device, &PoolInfo, nullptr, &QueryPool) == VK_SUCCESS);
+	Frames.resize(NumFrames);
+	Results.resize(MAX_QUERIES_PER_FRAME);
+	Track = FProfiler::Get().RegisterGpuTrack(TrackName);
+
+	if (UseCalibratedTimestamps)
+	{
+		GetCalibratedTimestamps = (PFN_vkGetCalibratedTimestampsEXT)vkGetDeviceProcAddr(Device, "vkGetCalibratedTimestampsEXT");
+	}
+	if (!CalibrateHostQuery())
+	{
+		GetCalibratedTimestamps = nullptr;
+		CalibrateSubmit(Queue, QueueFamilyIndex);
+	}
+	FPlatformMisc::LocalPrintf("GPU profiler: %d queries per frame, %.2f ns per tick, %s calibration", MAX_QUERIES_PER_FRAME,
+		TimestampPeriod, GetCalibratedTimestamps ? "calibrated timestamps" : "one-shot");
+}
+
+void FVulkanGpuProfiler::Shutdown()
+{
+	if (QueryPool != VK_NULL_HANDLE)
+	{
+		for (uint32_t FrameIndex = 0; FrameIndex < Frames.size(); ++FrameIndex)
+		{
+			ReadBack(Frames[FrameIndex], FrameIndex * MAX_QUERIES_PER_FRAME);
+		}
+		vkDestroyQueryPool(Device, QueryPool, nullptr);
+		QueryPool = VK_NULL_HANDLE;
+	}
+	Frames.clear();
+	CurrentFrame = nullptr;
+}
+
+bool FVulkanGpuProfiler::CalibrateHostQuery()
+{
+	if (GetCalibratedTimestamps == nullptr)
+	{
+		return false;
+	}
+	// Only the device domain is queried and bracketed with FPlatformMisc::Seconds, which avoids
+	// mapping each platform's host time domain to std::chrono. The call takes a few microseconds.
+	VkCalibratedTimestampInfoEXT Info{};
+	Info.sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	Info.timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+	uint64_t Ticks = 0;
+	uint64_t MaxDeviation = 0;
+	double Before = FPlatformMisc::Seconds();
+	if (GetCalibratedTimestamps(Device, 1, &Info, &Ticks, &MaxDeviation) != VK_SUCCESS)
+	{
+		return false;
+	}
+	double After = FPlatformMisc::Seconds();
+	CalibrationTicks = Ticks & TimestampMask;
+	CalibrationSeconds = (Before + After) * 0.5;
+	LastCalibration = After;
+	return true;
+}
+
+void FVulkanGpuProfiler::CalibrateSubmit(VkQueue Queue, uint32_t QueueFamilyIndex)
+{
+	VkCommandPoolCreateInfo CommandPoolInfo{};
+	CommandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	CommandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	CommandPoolInfo.queueFamilyIndex = QueueFamilyIndex;
+	VkCommandPool CommandPool;
+	verify(vkCreateCommandPool(Device, &CommandPoolInfo, nullptr, &CommandPool) == VK_SUCCESS);
+
+	VkCommandBufferAllocateInfo AllocateInfo{};
+	AllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	AllocateInfo.commandPool = CommandPool;
+	AllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	AllocateInfo.commandBufferCount = 1;
+	VkCommandBuffer CommandBuffer;
+	verify(vkAllocateCommandBuffers(Device, &AllocateInfo, &CommandBuffer) == VK_SUCCESS);
+
+	VkCommandBufferBeginInfo BeginInfo{};
+	BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	verify(vkBeginCommandBuffer(CommandBuffer, &BeginInfo) == VK_SUCCESS);
+	// query 0 is reset again by the first frame using it
+	vkCmdResetQueryPool(CommandBuffer, QueryPool, 0, 1);
+	vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool, 0);
+	verify(vkEndCommandBuffer(CommandBuffer) == VK_SUCCESS);
+
+	VkFenceCreateInfo FenceInfo{};
+	FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	VkFence Fence;
+	verify(vkCreateFence(Device, &FenceInfo, nullptr, &Fence) == VK_SUCCESS);
+	VkSubmitInfo SubmitInfo{};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &CommandBuffer;
+
+	// the timestamp lands somewhere between the submit and the fence wait returning, which is
+	// accurate to the submit latency
+	double Before = FPlatformMisc::Seconds();
+	verify(vkQueueSubmit(Queue, 1, &SubmitInfo, Fence) == VK_SUCCESS);
+	verify(vkWaitForFences(Device, 1, &Fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS);
+	double After = FPlatformMisc::Seconds();
+	uint64_t Ticks = 0;
+	verify(vkGetQueryPoolResults(Device, QueryPool, 0, 1, sizeof(Ticks), &Ticks, sizeof(Ticks), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS);
+	CalibrationTicks = Ticks & TimestampMask;
+	CalibrationSeconds = (Before + After) * 0.5;
+	LastCalibration = After;
+
+	vkDestroyFence(Device, Fence, nullptr);
+	vkDestroyCommandPool(Device, CommandPool, nullptr);
+}
+
+double FVulkanGpuProfiler::ToSeconds(uint64_t Ticks) const
+{
+	// signed, timestamps read back are older than a recalibration
+	int64_t Delta = (int64_t)((Ticks - CalibrationTicks) & TimestampMask);
+	if (TimestampMask != ~0ull && Delta > (int64_t)(TimestampMask >> 1))
+	{
+		Delta -= (int64_t)TimestampMask + 1;
+	}
+	return CalibrationSeconds + (double)Delta * TimestampPeriod * 1e-9;
+}
+
+void FVulkanGpuProfiler::ReadBack(FFrame& Frame, uint32_t FirstQuery)
+{
+	if (Frame.NumQueries == 0)
+	{
+		return;
+	}
+	// the frame's fence signaled, so this only fails for scopes whose command buffer was never submitted
+	VkResult Result = vkGetQueryPoolResults(Device, QueryPool, FirstQuery, Frame.NumQueries, Frame.NumQueries * sizeof(uint64_t),
+		Results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (Result == VK_SUCCESS)
+	{
+		for (const FScope& Scope : Frame.Scopes)
+		{
+			if (Scope.BeginQuery != INDEX_NONE && Scope.EndQuery != INDEX_NONE)
+			{
+				FProfiler::Get().AddGpuEvent(Track, Scope.Name, ToSeconds(Results[Scope.BeginQuery]), ToSeconds(Results[Scope.EndQuery]));
+			}
+		}
+	}
+	Frame.Scopes.clear();
+	Frame.NumQueries = 0;
+}
+
+void FVulkanGpuProfiler::BeginFrame(VkCommandBuffer CommandBuffer, uint32_t FrameIndex)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+	if (GetCalibratedTimestamps && FPlatformMisc::Seconds() - LastCalibration > RECALIBRATION_INTERVAL)
+	{
+		CalibrateHostQuery();
+	}
+	CurrentFrame = &Frames[FrameIndex];
+	CurrentFirstQuery = FrameIndex * MAX_QUERIES_PER_FRAME;
+	ReadBack(*CurrentFrame, CurrentFirstQuery);
+	vkCmdResetQueryPool(CommandBuffer, QueryPool, CurrentFirstQuery, MAX_QUERIES_PER_FRAME);
+	OpenScopes.clear();
+	BeginScope(CommandBuffer, "Frame");
+}
+
+void FVulkanGpuProfiler::EndFrame(VkCommandBuffer CommandBuffer)
+{
+	if (!IsActive())
+	{
+		return;
+	}
+	while (!OpenScopes.empty())
+	{
+		EndScope(CommandBuffer);
+	}
+	CurrentFrame = nullptr;
+}
+
+void FVulkanGpuProfiler::BeginScope(VkCommandBuffer CommandBuffer, const char* Name)
+{
+	if (CurrentFrame == nullptr)
+	{
+		return;
+	}
+	FScope Scope{Name, INDEX_NONE, INDEX_NONE};
+	// keeps room for the end queries of all open scopes
+	if (CurrentFrame->NumQueries + OpenScopes.size() + 2 <= MAX_QUERIES_PER_FRAME)
+	{
+		Scope.BeginQuery = CurrentFrame->NumQueries++;
+		vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, QueryPool, CurrentFirstQuery + Scope.BeginQuery);
+	}
+	OpenScopes.push_back((uint32_t)CurrentFrame->Scopes.size());
+	CurrentFrame->Scopes.push_back(Scope);
+}
+
+void FVulkanGpuProfiler::EndScope(VkCommandBuffer CommandBuffer)
+{
+	if (CurrentFrame == nullptr || OpenScopes.empty())
+	{
+		return;
+	}
+	FScope& Scope = CurrentFrame->Scopes[OpenScopes.back()];
+	OpenScopes.pop_back();
+	if (Scope.BeginQuery != INDEX_NONE)
+	{
+		Scope.EndQuery = CurrentFrame->NumQueries++;
+		vkCmdWriteTimestamp(CommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, QueryPool, CurrentFirstQuery + Scope.EndQuery);
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+
+// Times GPU work with timestamp queries and feeds it to FProfiler as a GPU track. Every frame in
+// flight owns a range of one query pool; a frame's timestamps are read back when its slot comes
+// around again, after its fence signaled, so reading never stalls. GPU ticks are mapped to
+// FPlatformMisc::Seconds through VK_EXT_calibrated_timestamps when available, recalibrated every
+// second, and otherwise through a single timestamp written at Init.
+//
+// Inactive, with every call a no-op, when the profiler was disabled at Init or the queue family
+// has no timestamps.
+class FVulkanGpuProfiler
+{
+public:
+	static const uint32_t MAX_QUERIES_PER_FRAME = 256;
+
+	void Init(VkPhysicalDevice PhysicalDevice, VkDevice InDevice, VkQueue Queue, uint32_t QueueFamilyIndex,
+		uint32_t NumFrames, bool UseCalibratedTimestamps, const char* TrackName);
+	// Reads back the frames still pending, the GPU must be idle.
+	void Shutdown();
+
+	bool IsActive() const { return QueryPool != VK_NULL_HANDLE; }
+
+	// First thing recorded into a frame slot's command buffer, once its fence signaled. Reads back
+	// the timestamps the slot wrote last time, resets its queries and opens a scope for the frame.
+	void BeginFrame(VkCommandBuffer CommandBuffer, uint32_t FrameIndex);
+	void EndFrame(VkCommandBuffer CommandBuffer);
+
+	// Scopes nest and may be recorded inside render passes, but not inside subpasses recorded
+	// with secondary command buffers. Name must outlive the profiler, see FProfiler::InternName.
+	void BeginScope(VkCommandBuffer CommandBuffer, const char* Name);
+	void EndScope(VkCommandBuffer CommandBuffer);
+
+private:
+	struct FScope
+	{
+		const char* Name;
+		// INDEX_NONE when the frame ran out of queries
+		uint32_t BeginQuery;
+		uint32_t EndQuery;
+	};
+
+	struct FFrame
+	{
+		std::vector<FScope> Scopes;
+		uint32_t NumQueries = 0;
+	};
+
+	// with VK_EXT_calibrated_timestamps, false if unavailable
+	bool CalibrateHostQuery();
+	// submits a timestamp write and waits for it
+	void CalibrateSubmit(VkQueue Queue, uint32_t QueueFamilyIndex);
+	void ReadBack(FFrame& Frame, uint32_t FirstQuery);
+	double ToSeconds(uint64_t Ticks) const;
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkQueryPool QueryPool = VK_NULL_HANDLE;
+	std::vector<FFrame> Frames;
+	FFrame* CurrentFrame = nullptr;
+	uint32_t CurrentFirstQuery = 0;
+	// indices into CurrentFrame->Scopes
+	std::vector<uint32_t> OpenScopes;
+	std::vector<uint64_t> Results;
+	uint32_t Track = 0;
+
+	// nanoseconds per tick
+	double TimestampPeriod = 1.0;
+	uint64_t TimestampMask = ~0ull;
+	// a GPU timestamp and the FPlatformMisc::Seconds it was taken at
+	uint64_t CalibrationTicks = 0;
+	double CalibrationSeconds = 0.0;
+	// FPlatformMisc::Seconds of the last calibration
+	double LastCalibration = 0.0;
+	PFN_vkGetCalibratedTimestampsEXT GetCalibratedTimestamps = nullptr;
+};
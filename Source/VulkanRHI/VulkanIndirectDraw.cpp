@@ -0,0 +1,123 @@
+#include "VulkanIndirectDraw.h"
+#include "VulkanMemory.h"
+#include "VulkanMesh.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include <string.h>
+
+void FVulkanIndirectDrawBatcher::Init(VkDevice Device, FVulkanMemoryAllocator& InMemoryAllocator, uint32_t NumFrames, const VkPhysicalDeviceFeatures& EnabledFeatures,
+	uint32_t InMaxDrawIndirectCount, bool UseDrawIndirectCount, uint32_t InMaxDraws)
+{
+	MemoryAllocator = &InMemoryAllocator;
+	MaxDraws = InMaxDraws;
+	SupportsMultiDraw = EnabledFeatures.multiDrawIndirect == VK_TRUE;
+	SupportsFirstInstance = EnabledFeatures.drawIndirectFirstInstance == VK_TRUE;
+	MaxDrawIndirectCount = SupportsMultiDraw && InMaxDrawIndirectCount > 0 ? InMaxDrawIndirectCount : 1;
+	if (UseDrawIndirectCount)
+	{
+		DrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(Device, "vkCmdDrawIndexedIndirectCountKHR");
+	}
+	VkDeviceSize BufferSize = COMMANDS_OFFSET + (VkDeviceSize)MaxDraws * sizeof(VkDrawIndexedIndirectCommand);
+	for (uint32_t i = 0; i < NumFrames; ++i)
+	{
+		FVulkanAllocation* Buffer = MemoryAllocator->CreateBuffer(BufferSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, EVulkanMemoryUsage::CpuToGpu);
+		verify(Buffer != nullptr && Buffer->MappedData != nullptr);
+		FrameBuffers.push_back(Buffer);
+	}
+	Commands.reserve(MaxDraws);
+	const char* Mode = !SupportsFirstInstance ? "direct draws" : DrawIndexedIndirectCount ? "draw indirect count" : SupportsMultiDraw ? "multi draw indirect" : "single draw indirect";
+	FPlatformMisc::LocalPrintf("Indirect draws: %s, %u draws per frame", Mode, MaxDraws);
+}
+
+void FVulkanIndirectDrawBatcher::Shutdown()
+{
+	for (FVulkanAllocation* Buffer : FrameBuffers)
+	{
+		MemoryAllocator->DestroyBuffer(Buffer);
+	}
+	FrameBuffers.clear();
+	CurrentBuffer = nullptr;
+}
+
+void FVulkanIndirectDrawBatcher::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentBuffer = FrameBuffers[FrameIndex];
+	Commands.clear();
+	++NumFrames;
+}
+
+bool FVulkanIndirectDrawBatcher::AddDraw(const FVulkanMesh& Mesh, uint32_t FirstInstance, uint32_t NumInstances)
+{
+	++TotalDraws;
+	if (!Commands.empty())
+	{
+		VkDrawIndexedIndirectCommand& Last = Commands.back();
+		if (Last.firstIndex == Mesh.FirstIndex && Last.vertexOffset == Mesh.VertexOffset && Last.indexCount == Mesh.NumIndices &&
+			Last.firstInstance + Last.instanceCount == FirstInstance)
+		{
+			Last.instanceCount += NumInstances;
+			return true;
+		}
+	}
+	if (Commands.size() >= MaxDraws)
+	{
+		return false;
+	}
+	VkDrawIndexedIndirectCommand Command;
+	Command.indexCount = Mesh.NumIndices;
+	Command.instanceCount = NumInstances;
+	Command.firstIndex = Mesh.FirstIndex;
+	Command.vertexOffset = Mesh.VertexOffset;
+	Command.firstInstance = FirstInstance;
+	Commands.push_back(Command);
+	return true;
+}
+
+void FVulkanIndirectDrawBatcher::Record(VkCommandBuffer CommandBuffer)
+{
+	uint32_t NumCommands = (uint32_t)Commands.size();
+	TotalCommands += NumCommands;
+	if (NumCommands == 0)
+	{
+		return;
+	}
+	if (!SupportsFirstInstance)
+	{
+		for (const VkDrawIndexedIndirectCommand& Command : Commands)
+		{
+			vkCmdDrawIndexed(CommandBuffer, Command.indexCount, Command.instanceCount, Command.firstIndex, Command.vertexOffset, Command.firstInstance);
+		}
+		TotalDrawCalls += NumCommands;
+		return;
+	}
+
+	// host coherent, and host writes before the submit are visible to the GPU without a barrier
+	uint8_t* Data = (uint8_t*)CurrentBuffer->MappedData;
+	memcpy(Data, &NumCommands, sizeof(NumCommands));
+	memcpy(Data + COMMANDS_OFFSET, Commands.data(), NumCommands * sizeof(VkDrawIndexedIndirectCommand));
+	MemoryAllocator->Flush(CurrentBuffer);
+
+	const uint32_t Stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (DrawIndexedIndirectCount)
+	{
+		DrawIndexedIndirectCount(CommandBuffer, CurrentBuffer->Buffer, COMMANDS_OFFSET, CurrentBuffer->Buffer, 0, NumCommands, Stride);
+		++TotalDrawCalls;
+		return;
+	}
+	for (uint32_t First = 0; First < NumCommands; First += MaxDrawIndirectCount)
+	{
+		uint32_t Count = NumCommands - First < MaxDrawIndirectCount ? NumCommands - First : MaxDrawIndirectCount;
+		vkCmdDrawIndexedIndirect(CommandBuffer, CurrentBuffer->Buffer, COMMANDS_OFFSET + (VkDeviceSize)First * Stride, Count, Stride);
+		++TotalDrawCalls;
+	}
+}
+
+void FVulkanIndirectDrawBatcher::ReportStats() const
+{
+	if (NumFrames == 0)
+	{
+		return;
+	}
+	FPlatformMisc::LocalPrintf("Indirect draws: %.1f draws batched into %.1f commands and %.1f draw calls per frame",
+		(double)TotalDraws / NumFrames, (double)TotalCommands / NumFrames, (double)TotalDrawCalls / NumFrames);
+}
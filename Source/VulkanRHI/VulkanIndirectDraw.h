@@ -0,0 +1,55 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+
+class FVulkanMemoryAllocator;
+struct FVulkanAllocation;
+struct FVulkanMesh;
+
+// Turns a frame's mesh draws into VkDrawIndexedIndirectCommands and submits them with as few
+// commands as the device allows: one vkCmdDrawIndexedIndirectCountKHR with VK_KHR_draw_indirect_count,
+// one vkCmdDrawIndexedIndirect per maxDrawIndirectCount commands with multiDrawIndirect, one per
+// command otherwise. Without drawIndirectFirstInstance, indirect commands can't select instances,
+// so the commands are recorded as direct draws instead.
+// Every frame in flight owns a host visible indirect buffer: the draw count, then the commands.
+class FVulkanIndirectDrawBatcher
+{
+public:
+	static const uint32_t DEFAULT_MAX_DRAWS = 1u << 16;
+
+	void Init(VkDevice Device, FVulkanMemoryAllocator& InMemoryAllocator, uint32_t NumFrames, const VkPhysicalDeviceFeatures& EnabledFeatures,
+		uint32_t InMaxDrawIndirectCount, bool UseDrawIndirectCount, uint32_t InMaxDraws = DEFAULT_MAX_DRAWS);
+	void Shutdown();
+
+	// Starts a frame slot whose previous commands finished executing on the GPU.
+	void BeginFrame(uint32_t FrameIndex);
+	// Draws NumInstances instances of Mesh from FirstInstance on. A draw continuing the previous
+	// one (same mesh, next instances) extends its command. False when the frame is full.
+	bool AddDraw(const FVulkanMesh& Mesh, uint32_t FirstInstance, uint32_t NumInstances);
+	// Writes the frame's commands to its indirect buffer and records the draws. The pipeline,
+	// vertex and index buffers must be bound.
+	void Record(VkCommandBuffer CommandBuffer);
+
+	uint32_t NumCommands() const { return (uint32_t)Commands.size(); }
+	void ReportStats() const;
+
+private:
+	// draw count, padded so the commands start 16 byte aligned
+	static const VkDeviceSize COMMANDS_OFFSET = 16;
+
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	std::vector<FVulkanAllocation*> FrameBuffers;
+	FVulkanAllocation* CurrentBuffer = nullptr;
+	std::vector<VkDrawIndexedIndirectCommand> Commands;
+	uint32_t MaxDraws = 0;
+	uint32_t MaxDrawIndirectCount = 1;
+	bool SupportsMultiDraw = false;
+	bool SupportsFirstInstance = false;
+	PFN_vkCmdDrawIndexedIndirectCountKHR DrawIndexedIndirectCount = nullptr;
+
+	uint64_t NumFrames = 0;
+	uint64_t TotalDraws = 0;
+	uint64_t TotalCommands = 0;
+	uint64_t TotalDrawCalls = 0;
+};
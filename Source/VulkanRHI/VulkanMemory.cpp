@@ -0,0 +1,536 @@
+#include "VulkanMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include <algorithm>
+
+// One vkAllocateMemory, carved up by a TLSF allocator.
+struct FVulkanMemoryBlock
+{
+	FTLSFAllocator Allocator;
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	// whole block mapped once, null unless host visible
+	uint8_t* MappedData = nullptr;
+	uint32_t MemoryTypeIndex = 0;
+	// holds a single resource too big to share a block
+	bool IsDedicated = false;
+	// allocation living at each TLSF node, for defragmentation
+	std::vector<FVulkanAllocation*> Owners;
+	// index in FVulkanMemoryAllocator::BlockLists
+	uint32_t ListIndex = 0;
+	// being emptied by Defragment, receives no moved allocations
+	bool IsEvacuating = false;
+};
+
+static const char* GetUsageName(EVulkanMemoryUsage Usage)
+{
+	switch (Usage)
+	{
+	case EVulkanMemoryUsage::GpuOnly: return "GpuOnly";
+	case EVulkanMemoryUsage::CpuToGpu: return "CpuToGpu";
+	case EVulkanMemoryUsage::GpuToCpu: return "GpuToCpu";
+	}
+	return "Unknown";
+}
+
+void FVulkanMemoryAllocator::Init(VkPhysicalDevice InPhysicalDevice, VkDevice InDevice, VkDeviceSize InBlockSize)
+{
+	PhysicalDevice = InPhysicalDevice;
+	Device = InDevice;
+	BlockSize = InBlockSize;
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+	Limits = Properties.limits;
+	SeparateLinearBlocks = Limits.bufferImageGranularity > 1;
+
+	BlockLists.resize(MemoryProperties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < BlockLists.size(); ++i)
+	{
+		BlockLists[i].MemoryTypeIndex = i / 2;
+		BlockLists[i].IsLinear = (i & 1) != 0;
+	}
+	FPlatformMisc::LocalPrintf("Memory allocator: %llu MB blocks, bufferImageGranularity %llu, maxMemoryAllocationCount %u",
+		(unsigned long long)(BlockSize >> 20), (unsigned long long)Limits.bufferImageGranularity, Limits.maxMemoryAllocationCount);
+}
+
+void FVulkanMemoryAllocator::Shutdown()
+{
+	FinishDefragment();
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (FBlockList& List : BlockLists)
+	{
+		for (FVulkanMemoryBlock* Block : List.Blocks)
+		{
+			if (Block->Allocator.NumAllocations() > 0)
+			{
+				FPlatformMisc::LocalPrintf("Memory allocator: %d allocations leaked in memory type %d",
+					Block->Allocator.NumAllocations(), List.MemoryTypeIndex);
+				for (FVulkanAllocation* Owner : Block->Owners)
+					delete Owner;
+			}
+			DestroyBlock(Block);
+		}
+		List.Blocks.clear();
+	}
+	BlockLists.clear();
+}
+
+bool FVulkanMemoryAllocator::FindMemoryType(uint32_t TypeBits, EVulkanMemoryUsage Usage, uint32_t& OutMemoryTypeIndex) const
+{
+	VkMemoryPropertyFlags Required = 0, Preferred = 0;
+	switch (Usage)
+	{
+	case EVulkanMemoryUsage::GpuOnly:
+		Required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		break;
+	case EVulkanMemoryUsage::CpuToGpu:
+		Required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		break;
+	case EVulkanMemoryUsage::GpuToCpu:
+		Required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		Preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	}
+
+	// memory types are ordered by the driver from best to worst, take the first that fits
+	for (int Pass = 0; Pass < 2; ++Pass)
+	{
+		VkMemoryPropertyFlags Flags = Pass == 0 ? Required | Preferred : Required;
+		for (uint32_t i = 0; i < MemoryProperties.memoryTypeCount; ++i)
+		{
+			if ((TypeBits & (1u << i)) && (MemoryProperties.memoryTypes[i].propertyFlags & Flags) == Flags)
+			{
+				OutMemoryTypeIndex = i;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool FVulkanMemoryAllocator::IsCoherent(uint32_t MemoryTypeIndex) const
+{
+	return (MemoryProperties.memoryTypes[MemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+bool FVulkanMemoryAllocator::IsHostVisible(uint32_t MemoryTypeIndex) const
+{
+	return (MemoryProperties.memoryTypes[MemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+FVulkanMemoryAllocator::FBlockList& FVulkanMemoryAllocator::GetBlockList(uint32_t MemoryTypeIndex, bool IsLinear)
+{
+	return BlockLists[MemoryTypeIndex * 2 + (SeparateLinearBlocks && IsLinear ? 1 : 0)];
+}
+
+FVulkanMemoryBlock* FVulkanMemoryAllocator::CreateBlock(FBlockList& List, VkDeviceSize Size, bool IsDedicated)
+{
+	if (DeviceAllocationCount >= Limits.maxMemoryAllocationCount)
+	{
+		TE_LOG(LogRHI, Error, "Memory allocator: maxMemoryAllocationCount (%u) reached", Limits.maxMemoryAllocationCount);
+		return nullptr;
+	}
+
+	VkMemoryAllocateInfo AllocInfo{};
+	AllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	AllocInfo.allocationSize = Size;
+	AllocInfo.memoryTypeIndex = List.MemoryTypeIndex;
+	VkDeviceMemory Memory;
+	if (vkAllocateMemory(Device, &AllocInfo, nullptr, &Memory) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Memory allocator: vkAllocateMemory of %llu bytes in memory type %d failed",
+			(unsigned long long)Size, List.MemoryTypeIndex);
+		return nullptr;
+	}
+
+	FVulkanMemoryBlock* Block = new FVulkanMemoryBlock();
+	Block->Allocator.Reset(Size);
+	Block->Memory = Memory;
+	Block->MemoryTypeIndex = List.MemoryTypeIndex;
+	Block->IsDedicated = IsDedicated;
+	Block->ListIndex = (uint32_t)(&List - BlockLists.data());
+	if (IsHostVisible(List.MemoryTypeIndex))
+	{
+		verify(vkMapMemory(Device, Memory, 0, VK_WHOLE_SIZE, 0, (void**)&Block->MappedData) == VK_SUCCESS);
+	}
+	List.Blocks.push_back(Block);
+	++DeviceAllocationCount;
+	DeviceAllocatedBytes += Size;
+	return Block;
+}
+
+void FVulkanMemoryAllocator::DestroyBlock(FVulkanMemoryBlock* Block)
+{
+	// freeing the memory unmaps it
+	vkFreeMemory(Device, Block->Memory, nullptr);
+	--DeviceAllocationCount;
+	DeviceAllocatedBytes -= Block->Allocator.GetSize();
+	delete Block;
+}
+
+bool FVulkanMemoryAllocator::AllocateFromList(FBlockList& List, VkDeviceSize Size, VkDeviceSize Alignment, FVulkanAllocation& Allocation)
+{
+	for (FVulkanMemoryBlock* Block : List.Blocks)
+	{
+		FTLSFAllocator::FAllocation Range;
+		if (Block->IsDedicated || Block->IsEvacuating || !Block->Allocator.Allocate(Size, Alignment, Range))
+			continue;
+		Allocation.Block = Block;
+		Allocation.Node = Range.Node;
+		Allocation.Memory = Block->Memory;
+		Allocation.Offset = Range.Offset;
+		Allocation.MappedData = Block->MappedData ? Block->MappedData + Range.Offset : nullptr;
+		if (Block->Owners.size() <= Range.Node)
+			Block->Owners.resize(Range.Node + 1, nullptr);
+		Block->Owners[Range.Node] = &Allocation;
+		return true;
+	}
+	return false;
+}
+
+FVulkanAllocation* FVulkanMemoryAllocator::Allocate(const VkMemoryRequirements& Requirements, EVulkanMemoryUsage Usage, bool IsLinear)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	return AllocateLocked(Requirements, Usage, IsLinear);
+}
+
+FVulkanAllocation* FVulkanMemoryAllocator::AllocateLocked(const VkMemoryRequirements& Requirements, EVulkanMemoryUsage Usage, bool IsLinear)
+{
+	uint32_t MemoryTypeIndex;
+	if (!FindMemoryType(Requirements.memoryTypeBits, Usage, MemoryTypeIndex))
+	{
+		TE_LOG(LogRHI, Error, "Memory allocator: no memory type for %s in type bits 0x%x", GetUsageName(Usage), Requirements.memoryTypeBits);
+		return nullptr;
+	}
+
+	VkDeviceSize Alignment = std::max<VkDeviceSize>(Requirements.alignment, 1);
+	VkDeviceSize Size = Requirements.size;
+	AlignToAtoms(MemoryTypeIndex, Size, Alignment);
+
+	FBlockList& List = GetBlockList(MemoryTypeIndex, IsLinear);
+	FVulkanAllocation* Allocation = new FVulkanAllocation();
+	Allocation->Size = Requirements.size;
+
+	// anything bigger than half a block would waste the rest of it
+	if (Size > BlockSize / 2)
+	{
+		FVulkanMemoryBlock* Block = CreateBlock(List, Size, true);
+		FTLSFAllocator::FAllocation Range;
+		if (!Block || !Block->Allocator.Allocate(Size, 1, Range))
+		{
+			delete Allocation;
+			return nullptr;
+		}
+		Allocation->Block = Block;
+		Allocation->Node = Range.Node;
+		Allocation->Memory = Block->Memory;
+		Allocation->Offset = 0;
+		Allocation->MappedData = Block->MappedData;
+		Block->Owners.assign(Range.Node + 1, nullptr);
+		Block->Owners[Range.Node] = Allocation;
+		return Allocation;
+	}
+
+	if (!AllocateFromList(List, Size, Alignment, *Allocation))
+	{
+		if (!CreateBlock(List, BlockSize, false) || !AllocateFromList(List, Size, Alignment, *Allocation))
+		{
+			delete Allocation;
+			return nullptr;
+		}
+	}
+	return Allocation;
+}
+
+void FVulkanMemoryAllocator::AlignToAtoms(uint32_t MemoryTypeIndex, VkDeviceSize& InOutSize, VkDeviceSize& InOutAlignment) const
+{
+	if (IsHostVisible(MemoryTypeIndex) && !IsCoherent(MemoryTypeIndex))
+	{
+		// flushes and invalidates work on whole atoms, keep them from touching a neighbour
+		VkDeviceSize AtomSize = Limits.nonCoherentAtomSize;
+		InOutAlignment = std::max(InOutAlignment, AtomSize);
+		InOutSize = (InOutSize + AtomSize - 1) / AtomSize * AtomSize;
+	}
+}
+
+void FVulkanMemoryAllocator::FreeRange(FVulkanMemoryBlock* Block, uint32_t Node)
+{
+	Block->Owners[Node] = nullptr;
+	Block->Allocator.Free(Node);
+	if (Block->Allocator.NumAllocations() > 0)
+		return;
+
+	// keep one empty block per list around, so a resource coming and going doesn't thrash vkAllocateMemory
+	FBlockList& List = BlockLists[Block->ListIndex];
+	if (!Block->IsDedicated)
+	{
+		auto IsOtherEmptyBlock = [Block](const FVulkanMemoryBlock* Other)
+		{
+			return Other != Block && !Other->IsDedicated && Other->Allocator.NumAllocations() == 0;
+		};
+		if (std::none_of(List.Blocks.begin(), List.Blocks.end(), IsOtherEmptyBlock))
+			return;
+	}
+	List.Blocks.erase(std::find(List.Blocks.begin(), List.Blocks.end(), Block));
+	DestroyBlock(Block);
+}
+
+void FVulkanMemoryAllocator::Free(FVulkanAllocation* Allocation)
+{
+	if (!Allocation)
+		return;
+	std::lock_guard<std::mutex> Lock(Mutex);
+	FreeRange(Allocation->Block, Allocation->Node);
+	delete Allocation;
+}
+
+FVulkanAllocation* FVulkanMemoryAllocator::CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags BufferUsage, EVulkanMemoryUsage Usage)
+{
+	VkBufferCreateInfo CreateInfo{};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	CreateInfo.size = Size;
+	// transfer usage lets Defragment copy the buffer elsewhere
+	CreateInfo.usage = BufferUsage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer Buffer;
+	if (vkCreateBuffer(Device, &CreateInfo, nullptr, &Buffer) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Memory allocator: vkCreateBuffer of %llu bytes failed", (unsigned long long)Size);
+		return nullptr;
+	}
+
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(Device, Buffer, &Requirements);
+	FVulkanAllocation* Allocation = Allocate(Requirements, Usage, true);
+	if (!Allocation)
+	{
+		vkDestroyBuffer(Device, Buffer, nullptr);
+		return nullptr;
+	}
+	verify(vkBindBufferMemory(Device, Buffer, Allocation->Memory, Allocation->Offset) == VK_SUCCESS);
+	Allocation->Buffer = Buffer;
+	Allocation->BufferSize = Size;
+	Allocation->BufferUsage = CreateInfo.usage;
+	return Allocation;
+}
+
+void FVulkanMemoryAllocator::DestroyBuffer(FVulkanAllocation* Allocation)
+{
+	if (!Allocation)
+		return;
+	vkDestroyBuffer(Device, Allocation->Buffer, nullptr);
+	Free(Allocation);
+}
+
+FVulkanAllocation* FVulkanMemoryAllocator::CreateImage(const VkImageCreateInfo& CreateInfo, EVulkanMemoryUsage Usage, VkImage& OutImage)
+{
+	if (vkCreateImage(Device, &CreateInfo, nullptr, &OutImage) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Memory allocator: vkCreateImage failed");
+		return nullptr;
+	}
+
+	VkMemoryRequirements Requirements;
+	vkGetImageMemoryRequirements(Device, OutImage, &Requirements);
+	FVulkanAllocation* Allocation = Allocate(Requirements, Usage, CreateInfo.tiling == VK_IMAGE_TILING_LINEAR);
+	if (!Allocation)
+	{
+		vkDestroyImage(Device, OutImage, nullptr);
+		OutImage = VK_NULL_HANDLE;
+		return nullptr;
+	}
+	verify(vkBindImageMemory(Device, OutImage, Allocation->Memory, Allocation->Offset) == VK_SUCCESS);
+	return Allocation;
+}
+
+void FVulkanMemoryAllocator::DestroyImage(VkImage Image, FVulkanAllocation* Allocation)
+{
+	vkDestroyImage(Device, Image, nullptr);
+	Free(Allocation);
+}
+
+VkMappedMemoryRange FVulkanMemoryAllocator::GetMappedRange(const FVulkanAllocation* Allocation) const
+{
+	// non-coherent allocations start on an atom and own whole atoms, see AllocateLocked
+	VkDeviceSize AtomSize = Limits.nonCoherentAtomSize;
+	VkDeviceSize Size = (Allocation->Size + AtomSize - 1) / AtomSize * AtomSize;
+	VkMappedMemoryRange Range{};
+	Range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	Range.memory = Allocation->Memory;
+	Range.offset = Allocation->Offset;
+	Range.size = Allocation->Offset + Size > Allocation->Block->Allocator.GetSize() ? VK_WHOLE_SIZE : Size;
+	return Range;
+}
+
+void FVulkanMemoryAllocator::Flush(const FVulkanAllocation* Allocation)
+{
+	if (!Allocation->MappedData || IsCoherent(Allocation->Block->MemoryTypeIndex))
+		return;
+	VkMappedMemoryRange Range = GetMappedRange(Allocation);
+	verify(vkFlushMappedMemoryRanges(Device, 1, &Range) == VK_SUCCESS);
+}
+
+void FVulkanMemoryAllocator::Invalidate(const FVulkanAllocation* Allocation)
+{
+	if (!Allocation->MappedData || IsCoherent(Allocation->Block->MemoryTypeIndex))
+		return;
+	VkMappedMemoryRange Range = GetMappedRange(Allocation);
+	verify(vkInvalidateMappedMemoryRanges(Device, 1, &Range) == VK_SUCCESS);
+}
+
+uint32_t FVulkanMemoryAllocator::Defragment(VkCommandBuffer CommandBuffer, VkDeviceSize MaxBytesToMove, bool MoveHostVisible)
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	VkDeviceSize BytesMoved = 0;
+	uint32_t NumMoves = 0;
+	std::vector<FVulkanMemoryBlock*> Evacuated;
+
+	for (FBlockList& List : BlockLists)
+	{
+		if (!MoveHostVisible && IsHostVisible(List.MemoryTypeIndex))
+			continue;
+		// empty the least used blocks into the fuller ones
+		std::vector<FVulkanMemoryBlock*> Sources;
+		for (FVulkanMemoryBlock* Block : List.Blocks)
+		{
+			const FTLSFAllocator& Allocator = Block->Allocator;
+			if (!Block->IsDedicated && Allocator.NumAllocations() > 0 && Allocator.GetFreeSize() > Allocator.GetSize() / 2)
+				Sources.push_back(Block);
+		}
+		if (Sources.size() < 2)
+			continue;
+		std::sort(Sources.begin(), Sources.end(), [](const FVulkanMemoryBlock* A, const FVulkanMemoryBlock* B)
+		{
+			return A->Allocator.GetFreeSize() > B->Allocator.GetFreeSize();
+		});
+
+		// the fullest candidate only receives. All sources are closed to moves up front: an
+		// allocation moved into a later source would be copied twice, the second copy reading
+		// the first one's destination without a barrier
+		Evacuated.insert(Evacuated.end(), Sources.begin(), Sources.end() - 1);
+		for (size_t SourceIndex = 0; SourceIndex + 1 < Sources.size(); ++SourceIndex)
+		{
+			Sources[SourceIndex]->IsEvacuating = true;
+		}
+		for (size_t SourceIndex = 0; SourceIndex + 1 < Sources.size(); ++SourceIndex)
+		{
+			FVulkanMemoryBlock* Source = Sources[SourceIndex];
+			std::vector<FVulkanAllocation*> Movable;
+			Source->Allocator.ForEachAllocation([&](uint64_t, uint64_t, uint32_t Node)
+			{
+				FVulkanAllocation* Owner = Source->Owners[Node];
+				if (Owner && Owner->Buffer != VK_NULL_HANDLE)
+					Movable.push_back(Owner);
+			});
+
+			for (FVulkanAllocation* Allocation : Movable)
+			{
+				if (BytesMoved + Allocation->Size > MaxBytesToMove)
+					goto Done;
+
+				VkBufferCreateInfo CreateInfo{};
+				CreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+				CreateInfo.size = Allocation->BufferSize;
+				CreateInfo.usage = Allocation->BufferUsage;
+				CreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				VkBuffer NewBuffer;
+				if (vkCreateBuffer(Device, &CreateInfo, nullptr, &NewBuffer) != VK_SUCCESS)
+					goto Done;
+				VkMemoryRequirements Requirements;
+				vkGetBufferMemoryRequirements(Device, NewBuffer, &Requirements);
+				VkDeviceSize Size = Requirements.size;
+				VkDeviceSize Alignment = std::max<VkDeviceSize>(Requirements.alignment, 1);
+				AlignToAtoms(List.MemoryTypeIndex, Size, Alignment);
+
+				// only into blocks that are already in use, never a fresh one
+				FVulkanAllocation Moved;
+				FVulkanMemoryBlock* OldBlock = Allocation->Block;
+				uint32_t OldNode = Allocation->Node;
+				if (!AllocateFromList(List, Size, Alignment, Moved) ||
+					Moved.Block->Allocator.NumAllocations() == 1)
+				{
+					if (Moved.Block)
+						FreeRange(Moved.Block, Moved.Node);
+					vkDestroyBuffer(Device, NewBuffer, nullptr);
+					break;
+				}
+				verify(vkBindBufferMemory(Device, NewBuffer, Moved.Memory, Moved.Offset) == VK_SUCCESS);
+
+				VkBufferCopy Copy{};
+				Copy.size = Allocation->BufferSize;
+				vkCmdCopyBuffer(CommandBuffer, Allocation->Buffer, NewBuffer, 1, &Copy);
+
+				// the old range keeps its owner slot cleared, the allocation object moves to the new one
+				OldBlock->Owners[OldNode] = nullptr;
+				RetiredRanges.push_back({ Allocation->Buffer, OldBlock, OldNode });
+				Allocation->Buffer = NewBuffer;
+				Allocation->Block = Moved.Block;
+				Allocation->Node = Moved.Node;
+				Allocation->Memory = Moved.Memory;
+				Allocation->Offset = Moved.Offset;
+				Allocation->MappedData = Moved.MappedData;
+				Allocation->Generation++;
+				Moved.Block->Owners[Moved.Node] = Allocation;
+
+				BytesMoved += Allocation->Size;
+				++NumMoves;
+			}
+		}
+	}
+Done:
+	for (FVulkanMemoryBlock* Block : Evacuated)
+	{
+		Block->IsEvacuating = false;
+	}
+	if (NumMoves > 0)
+	{
+		VkMemoryBarrier Barrier{};
+		Barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 1, &Barrier, 0, nullptr, 0, nullptr);
+		FPlatformMisc::LocalPrintf("Memory allocator: defragmentation moved %d buffers, %llu KB",
+			NumMoves, (unsigned long long)(BytesMoved >> 10));
+	}
+	return NumMoves;
+}
+
+void FVulkanMemoryAllocator::FinishDefragment()
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	for (const FRetiredRange& Retired : RetiredRanges)
+	{
+		vkDestroyBuffer(Device, Retired.Buffer, nullptr);
+		FreeRange(Retired.Block, Retired.Node);
+	}
+	RetiredRanges.clear();
+}
+
+void FVulkanMemoryAllocator::DumpStats() const
+{
+	std::lock_guard<std::mutex> Lock(Mutex);
+	FPlatformMisc::LocalPrintf("Memory allocator: %u of %u device allocations, %llu MB",
+		DeviceAllocationCount, Limits.maxMemoryAllocationCount, (unsigned long long)(DeviceAllocatedBytes >> 20));
+	for (const FBlockList& List : BlockLists)
+	{
+		if (List.Blocks.empty())
+			continue;
+		uint64_t Size = 0, Free = 0, Largest = 0;
+		uint32_t NumAllocations = 0, NumFreeBlocks = 0, NumDedicated = 0;
+		for (const FVulkanMemoryBlock* Block : List.Blocks)
+		{
+			Size += Block->Allocator.GetSize();
+			Free += Block->Allocator.GetFreeSize();
+			Largest = std::max(Largest, Block->Allocator.GetLargestFreeBlock());
+			NumAllocations += Block->Allocator.NumAllocations();
+			NumFreeBlocks += Block->Allocator.NumFreeBlocks();
+			NumDedicated += Block->IsDedicated ? 1 : 0;
+		}
+		// fragmentation: how much of the free memory is unusable for one allocation of that size
+		double Fragmentation = Free > 0 ? 1.0 - (double)Largest / Free : 0.0;
+		FPlatformMisc::LocalPrintf("  type %d %s: %d blocks (%d dedicated), %llu KB used of %llu KB, %d allocations, %d free ranges, fragmentation %.0f%%",
+			List.MemoryTypeIndex, List.IsLinear ? "linear" : "optimal", (int)List.Blocks.size(), NumDedicated,
+			(unsigned long long)((Size - Free) >> 10), (unsigned long long)(Size >> 10), NumAllocations, NumFreeBlocks, Fragmentation * 100.0);
+	}
+}
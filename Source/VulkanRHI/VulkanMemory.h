@@ -0,0 +1,123 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "Memory/TLSFAllocator.h"
+#include <vector>
+#include <mutex>
+
+enum class EVulkanMemoryUsage : uint8_t
+{
+	// device local, never touched by the CPU
+	GpuOnly,
+	// host visible and coherent, written by the CPU and read by the GPU (staging, per-frame data)
+	CpuToGpu,
+	// host visible, preferably cached, written by the GPU and read back by the CPU
+	GpuToCpu,
+};
+
+struct FVulkanMemoryBlock;
+
+// A sub-allocation. Owned by FVulkanMemoryAllocator; the pointer stays valid until freed,
+// and the fields are updated in place when defragmentation moves it.
+struct FVulkanAllocation
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	// persistent mapping of Offset, null unless host visible
+	void* MappedData = nullptr;
+	// buffer created by FVulkanMemoryAllocator::CreateBuffer, replaced when the allocation moves
+	VkBuffer Buffer = VK_NULL_HANDLE;
+	// bumped every time defragmentation moves the allocation, so users can refresh descriptors
+	uint32_t Generation = 0;
+
+private:
+	friend class FVulkanMemoryAllocator;
+	FVulkanMemoryBlock* Block = nullptr;
+	uint32_t Node = FTLSFAllocator::INVALID_NODE;
+	// to recreate Buffer when the allocation moves
+	VkDeviceSize BufferSize = 0;
+	VkBufferUsageFlags BufferUsage = 0;
+};
+
+// Sub-allocates resources from large VkDeviceMemory blocks, one list of blocks per memory type,
+// instead of one vkAllocateMemory per resource. Host visible blocks are mapped once for their
+// whole lifetime. When bufferImageGranularity is above 1, linear resources (buffers) and
+// optimal-tiling images get separate blocks, so they never share a granularity page.
+// All functions are thread-safe.
+class FVulkanMemoryAllocator
+{
+public:
+	static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+	void Init(VkPhysicalDevice InPhysicalDevice, VkDevice InDevice, VkDeviceSize InBlockSize = DEFAULT_BLOCK_SIZE);
+	void Shutdown();
+
+	// Raw sub-allocation; bind it with Memory/Offset. IsLinear is true for buffers and linear images.
+	FVulkanAllocation* Allocate(const VkMemoryRequirements& Requirements, EVulkanMemoryUsage Usage, bool IsLinear);
+	void Free(FVulkanAllocation* Allocation);
+
+	// Creates a buffer bound to a new allocation. Such buffers can be moved by Defragment.
+	FVulkanAllocation* CreateBuffer(VkDeviceSize Size, VkBufferUsageFlags BufferUsage, EVulkanMemoryUsage Usage);
+	void DestroyBuffer(FVulkanAllocation* Allocation);
+
+	// Creates an image bound to a new allocation.
+	FVulkanAllocation* CreateImage(const VkImageCreateInfo& CreateInfo, EVulkanMemoryUsage Usage, VkImage& OutImage);
+	void DestroyImage(VkImage Image, FVulkanAllocation* Allocation);
+
+	// Needed after CPU writes / before CPU reads of non-coherent memory; no-ops on coherent memory.
+	void Flush(const FVulkanAllocation* Allocation);
+	void Invalidate(const FVulkanAllocation* Allocation);
+
+	// Records copies that move buffers from the least used blocks into fuller ones, at most
+	// MaxBytesToMove per call. Returns the number of moves. The old buffers and ranges are kept
+	// until FinishDefragment(), to be called once CommandBuffer finished executing. Host visible
+	// buffers only move with MoveHostVisible, when the CPU doesn't write them until then.
+	uint32_t Defragment(VkCommandBuffer CommandBuffer, VkDeviceSize MaxBytesToMove, bool MoveHostVisible);
+	void FinishDefragment();
+
+	void DumpStats() const;
+
+private:
+	struct FBlockList
+	{
+		uint32_t MemoryTypeIndex;
+		bool IsLinear;
+		std::vector<FVulkanMemoryBlock*> Blocks;
+	};
+
+	// moved-from buffer and range, released by FinishDefragment
+	struct FRetiredRange
+	{
+		VkBuffer Buffer;
+		FVulkanMemoryBlock* Block;
+		uint32_t Node;
+	};
+
+	FVulkanAllocation* AllocateLocked(const VkMemoryRequirements& Requirements, EVulkanMemoryUsage Usage, bool IsLinear);
+	// rounds non-coherent host visible ranges out to whole atoms
+	void AlignToAtoms(uint32_t MemoryTypeIndex, VkDeviceSize& InOutSize, VkDeviceSize& InOutAlignment) const;
+	bool AllocateFromList(FBlockList& List, VkDeviceSize Size, VkDeviceSize Alignment, FVulkanAllocation& Allocation);
+	FVulkanMemoryBlock* CreateBlock(FBlockList& List, VkDeviceSize Size, bool IsDedicated);
+	void DestroyBlock(FVulkanMemoryBlock* Block);
+	void FreeRange(FVulkanMemoryBlock* Block, uint32_t Node);
+	FBlockList& GetBlockList(uint32_t MemoryTypeIndex, bool IsLinear);
+	bool FindMemoryType(uint32_t TypeBits, EVulkanMemoryUsage Usage, uint32_t& OutMemoryTypeIndex) const;
+	bool IsCoherent(uint32_t MemoryTypeIndex) const;
+	bool IsHostVisible(uint32_t MemoryTypeIndex) const;
+	VkMappedMemoryRange GetMappedRange(const FVulkanAllocation* Allocation) const;
+
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice Device = VK_NULL_HANDLE;
+	VkDeviceSize BlockSize = DEFAULT_BLOCK_SIZE;
+	VkPhysicalDeviceMemoryProperties MemoryProperties{};
+	VkPhysicalDeviceLimits Limits{};
+	bool SeparateLinearBlocks = false;
+
+	mutable std::mutex Mutex;
+	// two lists per memory type: optimal-tiling images, then linear resources
+	std::vector<FBlockList> BlockLists;
+	std::vector<FRetiredRange> RetiredRanges;
+	uint32_t DeviceAllocationCount = 0;
+	VkDeviceSize DeviceAllocatedBytes = 0;
+};
@@ -0,0 +1,102 @@
+#include "VulkanMesh.h"
+#include "VulkanMemory.h"
+#include "VulkanUpload.h"
+#include "HAL/PlatformMisc.h"
+
+bool FVulkanMeshPool::Init(FVulkanMemoryAllocator& InMemoryAllocator, FVulkanUploadManager& InUploadManager, uint32_t InVertexStride,
+	uint32_t MaxVertices, uint32_t MaxIndices)
+{
+	MemoryAllocator = &InMemoryAllocator;
+	UploadManager = &InUploadManager;
+	VertexStride = InVertexStride;
+	VertexBuffer = MemoryAllocator->CreateBuffer((VkDeviceSize)MaxVertices * VertexStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly);
+	IndexBuffer = MemoryAllocator->CreateBuffer((VkDeviceSize)MaxIndices * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, EVulkanMemoryUsage::GpuOnly);
+	if (VertexBuffer == nullptr || IndexBuffer == nullptr)
+	{
+		TE_LOG(LogRHI, Error, "Mesh pool: failed to create the vertex and index buffers");
+		return false;
+	}
+	VertexRanges.Reset(MaxVertices);
+	IndexRanges.Reset(MaxIndices);
+	return true;
+}
+
+void FVulkanMeshPool::Shutdown()
+{
+	if (MemoryAllocator != nullptr)
+	{
+		MemoryAllocator->DestroyBuffer(VertexBuffer);
+		MemoryAllocator->DestroyBuffer(IndexBuffer);
+	}
+	VertexBuffer = IndexBuffer = nullptr;
+	Meshes.clear();
+	FreeMeshes.clear();
+}
+
+uint32_t FVulkanMeshPool::AddMesh(const void* Vertices, uint32_t NumVertices, const uint32_t* Indices, uint32_t NumIndices)
+{
+	FTLSFAllocator::FAllocation VertexRange, IndexRange;
+	if (NumVertices == 0 || NumIndices == 0 || !VertexRanges.Allocate(NumVertices, 1, VertexRange))
+	{
+		return INVALID_MESH;
+	}
+	if (!IndexRanges.Allocate(NumIndices, 1, IndexRange))
+	{
+		VertexRanges.Free(VertexRange.Node);
+		return INVALID_MESH;
+	}
+
+	FVulkanMesh Mesh;
+	Mesh.FirstIndex = (uint32_t)IndexRange.Offset;
+	Mesh.NumIndices = NumIndices;
+	Mesh.VertexOffset = (int32_t)VertexRange.Offset;
+	Mesh.NumVertices = NumVertices;
+	Mesh.VertexNode = VertexRange.Node;
+	Mesh.IndexNode = IndexRange.Node;
+	UploadManager->UploadBuffer(VertexBuffer->Buffer, VertexRange.Offset * VertexStride, Vertices, (VkDeviceSize)NumVertices * VertexStride);
+	Mesh.UploadTicket = UploadManager->UploadBuffer(IndexBuffer->Buffer, IndexRange.Offset * sizeof(uint32_t), Indices, (VkDeviceSize)NumIndices * sizeof(uint32_t));
+	LastUploadTicket = Mesh.UploadTicket;
+
+	uint32_t MeshIndex;
+	if (!FreeMeshes.empty())
+	{
+		MeshIndex = FreeMeshes.back();
+		FreeMeshes.pop_back();
+		Meshes[MeshIndex] = Mesh;
+	}
+	else
+	{
+		MeshIndex = (uint32_t)Meshes.size();
+		Meshes.push_back(Mesh);
+	}
+	return MeshIndex;
+}
+
+void FVulkanMeshPool::RemoveMesh(uint32_t MeshIndex)
+{
+	FVulkanMesh& Mesh = Meshes[MeshIndex];
+	VertexRanges.Free(Mesh.VertexNode);
+	IndexRanges.Free(Mesh.IndexNode);
+	Mesh = FVulkanMesh();
+	FreeMeshes.push_back(MeshIndex);
+}
+
+bool FVulkanMeshPool::IsReady(uint32_t Mesh) const
+{
+	return Meshes[Mesh].NumIndices > 0 && UploadManager->IsComplete(Meshes[Mesh].UploadTicket);
+}
+
+void FVulkanMeshPool::Bind(VkCommandBuffer CommandBuffer) const
+{
+	// read every time, defragmentation may have replaced the buffers
+	VkDeviceSize Offset = 0;
+	vkCmdBindVertexBuffers(CommandBuffer, 0, 1, &VertexBuffer->Buffer, &Offset);
+	vkCmdBindIndexBuffer(CommandBuffer, IndexBuffer->Buffer, 0, VK_INDEX_TYPE_UINT32);
+}
+
+void FVulkanMeshPool::ReportStats() const
+{
+	FPlatformMisc::LocalPrintf("Mesh pool: %u meshes, %llu of %llu vertices, %llu of %llu indices",
+		VertexRanges.NumAllocations(), (unsigned long long)(VertexRanges.GetSize() - VertexRanges.GetFreeSize()), (unsigned long long)VertexRanges.GetSize(),
+		(unsigned long long)(IndexRanges.GetSize() - IndexRanges.GetFreeSize()), (unsigned long long)IndexRanges.GetSize());
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "Memory/TLSFAllocator.h"
+#include <vector>
+
+class FVulkanMemoryAllocator;
+class FVulkanUploadManager;
+struct FVulkanAllocation;
+
+// Where a mesh lives in the pool's buffers, in elements. Feeds VkDrawIndexedIndirectCommand.
+struct FVulkanMesh
+{
+	uint32_t FirstIndex = 0;
+	uint32_t NumIndices = 0;
+	int32_t VertexOffset = 0;
+	uint32_t NumVertices = 0;
+	// upload ticket of the mesh's data, see FVulkanUploadManager::IsComplete
+	uint64_t UploadTicket = 0;
+	uint32_t IndexNode = FTLSFAllocator::INVALID_NODE;
+	uint32_t VertexNode = FTLSFAllocator::INVALID_NODE;
+};
+
+// Packs meshes into one device local vertex buffer and one index buffer, so any number of meshes
+// draw with a single set of buffer bindings and can be batched into indirect draws. Ranges are
+// sub-allocated with a TLSF allocator over element counts; every vertex has the same stride and
+// indices are 32 bit. Data goes through the upload manager. Not thread-safe.
+class FVulkanMeshPool
+{
+public:
+	static const uint32_t INVALID_MESH = ~0u;
+	static const uint32_t DEFAULT_MAX_VERTICES = 1u << 20;
+	static const uint32_t DEFAULT_MAX_INDICES = 1u << 22;
+
+	bool Init(FVulkanMemoryAllocator& InMemoryAllocator, FVulkanUploadManager& InUploadManager, uint32_t InVertexStride,
+		uint32_t MaxVertices = DEFAULT_MAX_VERTICES, uint32_t MaxIndices = DEFAULT_MAX_INDICES);
+	void Shutdown();
+
+	// Returns INVALID_MESH when the pool is full. Indices are relative to the mesh's first vertex.
+	uint32_t AddMesh(const void* Vertices, uint32_t NumVertices, const uint32_t* Indices, uint32_t NumIndices);
+	// The mesh must not be in use on the GPU anymore.
+	void RemoveMesh(uint32_t Mesh);
+
+	const FVulkanMesh& GetMesh(uint32_t Mesh) const { return Meshes[Mesh]; }
+	// True once the mesh's data is usable by graphics command buffers recorded from now on.
+	bool IsReady(uint32_t Mesh) const;
+	// Ticket of the last upload, to wait for every mesh added so far.
+	uint64_t GetLastUploadTicket() const { return LastUploadTicket; }
+
+	// Binds the vertex buffer to binding 0 and the index buffer.
+	void Bind(VkCommandBuffer CommandBuffer) const;
+
+	void ReportStats() const;
+
+private:
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	FVulkanUploadManager* UploadManager = nullptr;
+	uint32_t VertexStride = 0;
+	FVulkanAllocation* VertexBuffer = nullptr;
+	FVulkanAllocation* IndexBuffer = nullptr;
+	FTLSFAllocator VertexRanges;
+	FTLSFAllocator IndexRanges;
+	std::vector<FVulkanMesh> Meshes;
+	std::vector<uint32_t> FreeMeshes;
+	uint64_t LastUploadTicket = 0;
+};
@@ -0,0 +1,105 @@
+#include "VulkanParallelRecorder.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include "Async/JobSystem.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+
+
+void FVulkanParallelRecorder::Init(VkDevice InDevice, uint32_t QueueFamilyIndex, uint32_t NumFrames)
+{
+	Device = InDevice;
+	NumThreads = std::max(1u, FJobSystem::Get().NumThreads());
+
+	// transient: the buffers are re-recorded every time the frame comes around
+	VkCommandPoolCreateInfo CreateInfo{};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	CreateInfo.queueFamilyIndex = QueueFamilyIndex;
+	CreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	Pools.resize(NumFrames * (NumThreads + 1));
+	for (FThreadFramePool& Pool : Pools)
+	{
+		verify(vkCreateCommandPool(Device, &CreateInfo, nullptr, &Pool.CommandPool) == VK_SUCCESS);
+	}
+	FPlatformMisc::LocalPrintf("Parallel command recording: %d threads, %d pools", NumThreads, (int)Pools.size());
+}
+
+void FVulkanParallelRecorder::Shutdown()
+{
+	// destroying the pool frees its command buffers
+	for (FThreadFramePool& Pool : Pools)
+	{
+		vkDestroyCommandPool(Device, Pool.CommandPool, nullptr);
+	}
+	Pools.clear();
+}
+
+void FVulkanParallelRecorder::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentFrame = FrameIndex;
+	for (uint32_t i = 0; i <= NumThreads; ++i)
+	{
+		FThreadFramePool& Pool = GetPool(i);
+		if (Pool.NumUsed > 0)
+		{
+			verify(vkResetCommandPool(Device, Pool.CommandPool, 0) == VK_SUCCESS);
+			Pool.NumUsed = 0;
+		}
+	}
+}
+
+VkCommandBuffer FVulkanParallelRecorder::AllocateCommandBuffer(FThreadFramePool& Pool)
+{
+	if (Pool.NumUsed == Pool.CommandBuffers.size())
+	{
+		VkCommandBufferAllocateInfo AllocInfo{};
+		AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		AllocInfo.commandPool = Pool.CommandPool;
+		AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		AllocInfo.commandBufferCount = 1;
+		VkCommandBuffer CommandBuffer;
+		verify(vkAllocateCommandBuffers(Device, &AllocInfo, &CommandBuffer) == VK_SUCCESS);
+		Pool.CommandBuffers.push_back(CommandBuffer);
+	}
+	return Pool.CommandBuffers[Pool.NumUsed++];
+}
+
+void FVulkanParallelRecorder::Record(VkRenderPass RenderPass, uint32_t Subpass, VkFramebuffer Framebuffer,
+	uint32_t NumChunks, const FRecordFunction& RecordFunction, std::vector<VkCommandBuffer>& OutCommandBuffers)
+{
+	OutCommandBuffers.resize(NumChunks);
+
+	VkCommandBufferInheritanceInfo InheritanceInfo{};
+	InheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	InheritanceInfo.renderPass = RenderPass;
+	InheritanceInfo.subpass = Subpass;
+	InheritanceInfo.framebuffer = Framebuffer;
+
+	// one chunk per job, run by the workers and by the calling thread while it waits for them
+	FJobSystem::Get().ParallelFor(NumChunks, 1, [&](uint32_t Begin, uint32_t End)
+	{
+		uint32_t ThreadIndex = FJobSystem::Get().IsInitialized() ? FJobSystem::Get().GetThreadIndex() : 0;
+		std::unique_lock<std::mutex> ExternalLock(ExternalPoolMutex, std::defer_lock);
+		if (ThreadIndex == FJobSystem::INDEX_NONE)
+		{
+			ThreadIndex = NumThreads;
+			ExternalLock.lock();
+		}
+		FThreadFramePool& Pool = GetPool(ThreadIndex);
+		for (uint32_t ChunkIndex = Begin; ChunkIndex < End; ++ChunkIndex)
+		{
+			SCOPED_CPU_EVENT("RecordChunk");
+			VkCommandBuffer CommandBuffer = AllocateCommandBuffer(Pool);
+
+			VkCommandBufferBeginInfo BeginInfo{};
+			BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			BeginInfo.pInheritanceInfo = &InheritanceInfo;
+			verify(vkBeginCommandBuffer(CommandBuffer, &BeginInfo) == VK_SUCCESS);
+			RecordFunction(CommandBuffer, ChunkIndex);
+			verify(vkEndCommandBuffer(CommandBuffer) == VK_SUCCESS);
+
+			OutCommandBuffers[ChunkIndex] = CommandBuffer;
+		}
+	});
+}
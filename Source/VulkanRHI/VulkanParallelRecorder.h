@@ -0,0 +1,54 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+#include <functional>
+#include <mutex>
+
+// Records one render pass (or subpass) as secondary command buffers on the job system.
+// Every job system thread owns one command pool per frame in flight, so threads never share a
+// pool, and a frame's pools are reset in bulk with vkResetCommandPool instead of buffer by buffer.
+// Threads outside the job system, like the render thread, share one more pool per frame, taking
+// turns at it.
+class FVulkanParallelRecorder
+{
+public:
+	// Records chunk ChunkIndex of the pass into a secondary command buffer that is already begun.
+	// Secondary buffers inherit no state: bind the pipeline and set dynamic state in every chunk.
+	typedef std::function<void(VkCommandBuffer CommandBuffer, uint32_t ChunkIndex)> FRecordFunction;
+
+	// Call after FJobSystem::Init.
+	void Init(VkDevice InDevice, uint32_t QueueFamilyIndex, uint32_t NumFrames);
+	void Shutdown();
+
+	// Resets all pools of the frame. The frame's fence must have been waited on.
+	void BeginFrame(uint32_t FrameIndex);
+
+	// Records NumChunks secondary command buffers for the given render pass and subpass, and returns
+	// them in chunk order, ready for vkCmdExecuteCommands in a pass begun with
+	// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS. Blocks until every chunk is recorded, helping
+	// with the jobs meanwhile.
+	void Record(VkRenderPass RenderPass, uint32_t Subpass, VkFramebuffer Framebuffer,
+		uint32_t NumChunks, const FRecordFunction& RecordFunction, std::vector<VkCommandBuffer>& OutCommandBuffers);
+
+private:
+	// one per thread per frame in flight
+	struct FThreadFramePool
+	{
+		VkCommandPool CommandPool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> CommandBuffers;
+		// buffers handed out since the last reset
+		uint32_t NumUsed = 0;
+	};
+
+	// ThreadIndex NumThreads is the pool of threads outside the job system
+	FThreadFramePool& GetPool(uint32_t ThreadIndex) { return Pools[CurrentFrame * (NumThreads + 1) + ThreadIndex]; }
+	VkCommandBuffer AllocateCommandBuffer(FThreadFramePool& Pool);
+
+	VkDevice Device = VK_NULL_HANDLE;
+	uint32_t NumThreads = 0;
+	std::vector<FThreadFramePool> Pools;
+	uint32_t CurrentFrame = 0;
+	// held while a thread outside the job system records into its pool
+	std::mutex ExternalPoolMutex;
+};
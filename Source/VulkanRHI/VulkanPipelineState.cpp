@@ -0,0 +1,438 @@
+#include "VulkanPipelineState.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/Hash.h"
+#include "Stats/Profiler.h"
+
+
+FGraphicsPipelineStateDesc::FGraphicsPipelineStateDesc()
+{
+	memset(this, 0, sizeof(*this));
+	Topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	PolygonMode = VK_POLYGON_MODE_FILL;
+	CullMode = VK_CULL_MODE_BACK_BIT;
+	FrontFace = VK_FRONT_FACE_CLOCKWISE;
+	SampleCount = VK_SAMPLE_COUNT_1_BIT;
+	DepthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	SrcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	DstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	ColorBlendOp = VK_BLEND_OP_ADD;
+	SrcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	DstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	AlphaBlendOp = VK_BLEND_OP_ADD;
+	ColorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+}
+
+uint64_t FGraphicsPipelineStateDesc::GetHash() const
+{
+	return HashBytes(this, sizeof(*this));
+}
+
+uint64_t HashRenderPassCompatibility(const VkFormat* ColorFormats, uint32_t NumColorFormats, VkFormat DepthFormat, VkSampleCountFlagBits Samples)
+{
+	uint64_t Hash = HashBytes(ColorFormats, NumColorFormats * sizeof(VkFormat));
+	Hash = HashCombine(Hash, (uint64_t)DepthFormat);
+	Hash = HashCombine(Hash, (uint64_t)Samples);
+	return Hash;
+}
+
+uint64_t HashVertexInputLayout(const FVertexInputLayout& VertexLayout)
+{
+	uint64_t Hash = HashBytes(VertexLayout.Bindings.data(), VertexLayout.Bindings.size() * sizeof(VkVertexInputBindingDescription));
+	Hash = HashCombine(Hash, HashBytes(VertexLayout.Attributes.data(), VertexLayout.Attributes.size() * sizeof(VkVertexInputAttributeDescription)));
+	return Hash != 0 ? Hash : 1;
+}
+
+// On-disk layout of the pre-warm list: header followed by Count raw descriptions.
+struct FPrewarmFileHeader
+{
+	static const uint32_t MAGIC = 0x57505445; // "ETPW"
+
+	uint32_t Magic;
+	uint32_t DescSize;
+	uint32_t Count;
+	uint32_t Padding;
+};
+
+void FVulkanPipelineStateCache::Init(VkDevice InDevice, VkPipelineCache InPipelineCache, bool InSupportsCreationFeedback, uint32_t NumWorkers)
+{
+	Device = InDevice;
+	PipelineCache = InPipelineCache;
+	SupportsCreationFeedback = InSupportsCreationFeedback;
+	StopWorkers = false;
+	for (uint32_t i = 0; i < NumWorkers; ++i)
+	{
+		Workers.emplace_back(&FVulkanPipelineStateCache::WorkerLoop, this);
+	}
+	FPlatformMisc::LocalPrintf("Pipeline state cache: %d compile threads", NumWorkers);
+}
+
+void FVulkanPipelineStateCache::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		StopWorkers = true;
+		Queue.clear();
+	}
+	QueueCondition.notify_all();
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+	Tick();
+
+	for (auto& Pair : Entries)
+	{
+		if (Pair.second.Pipeline != VK_NULL_HANDLE)
+		{
+			vkDestroyPipeline(Device, Pair.second.Pipeline, nullptr);
+		}
+	}
+	Entries.clear();
+	PendingCount = 0;
+}
+
+void FVulkanPipelineStateCache::Tick()
+{
+	std::vector<FCompileResult> Results;
+	{
+		std::lock_guard<std::mutex> Lock(CompletedMutex);
+		Results.swap(Completed);
+	}
+	for (const FCompileResult& Result : Results)
+	{
+		--PendingCount;
+		FEntry& Entry = Entries[Result.Desc];
+		if (Entry.State != EState::Pending)
+		{
+			// FindOrCompileBlocking got there first
+			if (Result.Pipeline != VK_NULL_HANDLE)
+				vkDestroyPipeline(Device, Result.Pipeline, nullptr);
+			continue;
+		}
+		Entry.State = Result.Pipeline != VK_NULL_HANDLE ? EState::Ready : EState::Failed;
+		Entry.Pipeline = Result.Pipeline;
+		CompileTime.Add(Result.CompileTime * 1000.0);
+	}
+}
+
+VkShaderModule FVulkanPipelineStateCache::FindShader(uint64_t Hash) const
+{
+	auto Found = Shaders.find(Hash);
+	if (Found != Shaders.end())
+	{
+		return Found->second;
+	}
+	return ShaderLibrary ? ShaderLibrary->GetModule(Hash) : VK_NULL_HANDLE;
+}
+
+bool FVulkanPipelineStateCache::ResolveRequest(const FGraphicsPipelineStateDesc& Desc, FCompileRequest& OutRequest) const
+{
+	auto RenderPass = RenderPasses.find(Desc.RenderPass);
+	auto Layout = Layouts.find(Desc.Layout);
+	if (RenderPass == RenderPasses.end() || Layout == Layouts.end())
+	{
+		return false;
+	}
+	OutRequest.VertexShader = FindShader(Desc.VertexShader);
+	OutRequest.FragmentShader = FindShader(Desc.FragmentShader);
+	if (OutRequest.VertexShader == VK_NULL_HANDLE || OutRequest.FragmentShader == VK_NULL_HANDLE)
+	{
+		return false;
+	}
+	OutRequest.VertexLayout = nullptr;
+	if (Desc.VertexLayout != 0)
+	{
+		auto VertexLayout = VertexLayouts.find(Desc.VertexLayout);
+		if (VertexLayout == VertexLayouts.end())
+		{
+			return false;
+		}
+		OutRequest.VertexLayout = &VertexLayout->second;
+	}
+	OutRequest.Desc = Desc;
+	OutRequest.RenderPass = RenderPass->second;
+	OutRequest.Layout = Layout->second;
+	return true;
+}
+
+VkPipeline FVulkanPipelineStateCache::FindOrCompile(const FGraphicsPipelineStateDesc& Desc)
+{
+	++NumRequests;
+	auto Found = Entries.find(Desc);
+	if (Found != Entries.end())
+	{
+		return Found->second.Pipeline;
+	}
+
+	++NumMisses;
+	FCompileRequest Request;
+	if (!ResolveRequest(Desc, Request))
+	{
+		FPlatformMisc::LocalPrint("Pipeline state references unregistered shaders, render pass or layout");
+		Entries[Desc] = { EState::Failed, VK_NULL_HANDLE };
+		return VK_NULL_HANDLE;
+	}
+	Entries[Desc] = { EState::Pending, VK_NULL_HANDLE };
+	++PendingCount;
+	{
+		std::lock_guard<std::mutex> Lock(QueueMutex);
+		Queue.push_back(Request);
+	}
+	QueueCondition.notify_one();
+	return VK_NULL_HANDLE;
+}
+
+VkPipeline FVulkanPipelineStateCache::FindOrCompileBlocking(const FGraphicsPipelineStateDesc& Desc)
+{
+	auto Found = Entries.find(Desc);
+	if (Found != Entries.end() && Found->second.State != EState::Pending)
+	{
+		return Found->second.Pipeline;
+	}
+
+	// if a worker is already on it, Tick drops its result
+	FCompileRequest Request;
+	if (!ResolveRequest(Desc, Request))
+	{
+		return VK_NULL_HANDLE;
+	}
+	double StartTime = FPlatformMisc::Seconds();
+	VkPipeline Pipeline = CreatePipeline(Request);
+	CompileTime.Add((FPlatformMisc::Seconds() - StartTime) * 1000.0);
+	Entries[Desc] = { Pipeline != VK_NULL_HANDLE ? EState::Ready : EState::Failed, Pipeline };
+	return Pipeline;
+}
+
+VkPipeline FVulkanPipelineStateCache::CreatePipeline(const FCompileRequest& Request)
+{
+	const FGraphicsPipelineStateDesc& Desc = Request.Desc;
+
+	VkPipelineShaderStageCreateInfo ShaderStages[2] = {};
+	ShaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	ShaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	ShaderStages[0].module = Request.VertexShader;
+	ShaderStages[0].pName = "main";
+	ShaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	ShaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	ShaderStages[1].module = Request.FragmentShader;
+	ShaderStages[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo VertexInputInfo{};
+	VertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	if (Request.VertexLayout != nullptr)
+	{
+		VertexInputInfo.vertexBindingDescriptionCount = (uint32_t)Request.VertexLayout->Bindings.size();
+		VertexInputInfo.pVertexBindingDescriptions = Request.VertexLayout->Bindings.data();
+		VertexInputInfo.vertexAttributeDescriptionCount = (uint32_t)Request.VertexLayout->Attributes.size();
+		VertexInputInfo.pVertexAttributeDescriptions = Request.VertexLayout->Attributes.data();
+	}
+
+	VkPipelineInputAssemblyStateCreateInfo InputAssembly{};
+	InputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	InputAssembly.topology = (VkPrimitiveTopology)Desc.Topology;
+	InputAssembly.primitiveRestartEnable = VK_FALSE;
+
+	// viewport and scissor are dynamic, so pipelines don't depend on the swapchain extent
+	VkPipelineViewportStateCreateInfo ViewportState{};
+	ViewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	ViewportState.viewportCount = 1;
+	ViewportState.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo RasterState{};
+	RasterState.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	RasterState.depthClampEnable = Desc.DepthClampEnable ? VK_TRUE : VK_FALSE;
+	RasterState.rasterizerDiscardEnable = VK_FALSE;
+	RasterState.polygonMode = (VkPolygonMode)Desc.PolygonMode;
+	RasterState.lineWidth = 1.f;
+	RasterState.cullMode = (VkCullModeFlags)Desc.CullMode;
+	RasterState.frontFace = (VkFrontFace)Desc.FrontFace;
+	RasterState.depthBiasEnable = Desc.DepthBiasEnable ? VK_TRUE : VK_FALSE;
+	RasterState.depthBiasConstantFactor = Desc.DepthBiasConstantFactor;
+	RasterState.depthBiasClamp = 0.f;
+	RasterState.depthBiasSlopeFactor = Desc.DepthBiasSlopeFactor;
+
+	VkPipelineMultisampleStateCreateInfo MultiSampleState{};
+	MultiSampleState.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	MultiSampleState.sampleShadingEnable = VK_FALSE;
+	MultiSampleState.rasterizationSamples = (VkSampleCountFlagBits)Desc.SampleCount;
+	MultiSampleState.minSampleShading = 1.f;
+
+	VkPipelineDepthStencilStateCreateInfo DepthStencilState{};
+	DepthStencilState.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	DepthStencilState.depthTestEnable = Desc.DepthTestEnable ? VK_TRUE : VK_FALSE;
+	DepthStencilState.depthWriteEnable = Desc.DepthWriteEnable ? VK_TRUE : VK_FALSE;
+	DepthStencilState.depthCompareOp = (VkCompareOp)Desc.DepthCompareOp;
+	DepthStencilState.depthBoundsTestEnable = VK_FALSE;
+	DepthStencilState.stencilTestEnable = VK_FALSE;
+	DepthStencilState.back.failOp = VK_STENCIL_OP_KEEP;
+	DepthStencilState.back.passOp = VK_STENCIL_OP_KEEP;
+	DepthStencilState.back.depthFailOp = VK_STENCIL_OP_KEEP;
+	DepthStencilState.back.compareOp = VK_COMPARE_OP_ALWAYS;
+	DepthStencilState.front = DepthStencilState.back;
+
+	VkPipelineColorBlendAttachmentState ColorBlendAttachState{};
+	ColorBlendAttachState.colorWriteMask = Desc.ColorWriteMask;
+	ColorBlendAttachState.blendEnable = Desc.BlendEnable ? VK_TRUE : VK_FALSE;
+	ColorBlendAttachState.srcColorBlendFactor = (VkBlendFactor)Desc.SrcColorBlendFactor;
+	ColorBlendAttachState.dstColorBlendFactor = (VkBlendFactor)Desc.DstColorBlendFactor;
+	ColorBlendAttachState.colorBlendOp = (VkBlendOp)Desc.ColorBlendOp;
+	ColorBlendAttachState.srcAlphaBlendFactor = (VkBlendFactor)Desc.SrcAlphaBlendFactor;
+	ColorBlendAttachState.dstAlphaBlendFactor = (VkBlendFactor)Desc.DstAlphaBlendFactor;
+	ColorBlendAttachState.alphaBlendOp = (VkBlendOp)Desc.AlphaBlendOp;
+	VkPipelineColorBlendStateCreateInfo BlendState{};
+	BlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	BlendState.attachmentCount = 1;
+	BlendState.pAttachments = &ColorBlendAttachState;
+	BlendState.logicOpEnable = VK_FALSE;
+	BlendState.logicOp = VK_LOGIC_OP_NO_OP;
+	BlendState.blendConstants[0] = 1.0f;
+	BlendState.blendConstants[1] = 1.0f;
+	BlendState.blendConstants[2] = 1.0f;
+	BlendState.blendConstants[3] = 1.0f;
+
+	VkDynamicState DynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_LINE_WIDTH };
+	VkPipelineDynamicStateCreateInfo DynamicState{};
+	DynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	DynamicState.dynamicStateCount = 3;
+	DynamicState.pDynamicStates = DynamicStates;
+
+	VkGraphicsPipelineCreateInfo PipelineInfo{};
+	PipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	PipelineInfo.stageCount = 2;
+	PipelineInfo.pStages = ShaderStages;
+	PipelineInfo.pVertexInputState = &VertexInputInfo;
+	PipelineInfo.pInputAssemblyState = &InputAssembly;
+	PipelineInfo.pViewportState = &ViewportState;
+	PipelineInfo.pRasterizationState = &RasterState;
+	PipelineInfo.pMultisampleState = &MultiSampleState;
+	PipelineInfo.pDepthStencilState = &DepthStencilState;
+	PipelineInfo.pColorBlendState = &BlendState;
+	PipelineInfo.pDynamicState = &DynamicState;
+	PipelineInfo.layout = Request.Layout;
+	PipelineInfo.renderPass = Request.RenderPass;
+	PipelineInfo.subpass = Desc.Subpass;
+	PipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	PipelineInfo.basePipelineIndex = -1;
+
+	VkPipelineCreationFeedbackEXT CreationFeedback{};
+	VkPipelineCreationFeedbackCreateInfoEXT FeedbackInfo{};
+	FeedbackInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT;
+	FeedbackInfo.pPipelineCreationFeedback = &CreationFeedback;
+	if (SupportsCreationFeedback)
+	{
+		PipelineInfo.pNext = &FeedbackInfo;
+	}
+
+	// VkPipelineCache is internally synchronized, all workers share the one loaded from disk
+	VkPipeline Pipeline = VK_NULL_HANDLE;
+	VkResult Res = vkCreateGraphicsPipelines(Device, PipelineCache, 1, &PipelineInfo, nullptr, &Pipeline);
+	if (Res != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Create Graphics Pipeline Failed: %d", (int32_t)Res);
+		return VK_NULL_HANDLE;
+	}
+
+	bool CacheHit = false;
+	if (CreationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT)
+	{
+		CacheHit = (CreationFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT) != 0;
+		if (CacheHit)
+			++DriverCacheHits;
+		else
+			++DriverCacheMisses;
+	}
+	if (!CacheHit)
+	{
+		PipelineCacheDirty = true;
+	}
+	return Pipeline;
+}
+
+void FVulkanPipelineStateCache::WorkerLoop()
+{
+	FProfiler::Get().SetThreadName("Pipeline Compiler");
+	for (;;)
+	{
+		FCompileRequest Request;
+		{
+			std::unique_lock<std::mutex> Lock(QueueMutex);
+			QueueCondition.wait(Lock, [this] { return StopWorkers || !Queue.empty(); });
+			if (StopWorkers)
+				return;
+			Request = Queue.front();
+			Queue.pop_front();
+		}
+
+		double StartTime = FPlatformMisc::Seconds();
+		VkPipeline Pipeline = CreatePipeline(Request);
+		double EndTime = FPlatformMisc::Seconds();
+		if (FProfiler::Get().IsEnabled())
+		{
+			FProfiler::Get().AddCpuEvent("CompilePipeline", StartTime, EndTime);
+		}
+
+		std::lock_guard<std::mutex> Lock(CompletedMutex);
+		Completed.push_back({ Request.Desc, Pipeline, EndTime - StartTime });
+	}
+}
+
+void FVulkanPipelineStateCache::LoadPrewarmList(const char* Filename)
+{
+	std::vector<char> Data = FPlatformMisc::ReadSavedFile(Filename);
+	if (Data.size() < sizeof(FPrewarmFileHeader))
+		return;
+	FPrewarmFileHeader Header;
+	memcpy(&Header, Data.data(), sizeof(Header));
+	if (Header.Magic != FPrewarmFileHeader::MAGIC || Header.DescSize != sizeof(FGraphicsPipelineStateDesc) ||
+		Data.size() != sizeof(Header) + (size_t)Header.Count * sizeof(FGraphicsPipelineStateDesc))
+	{
+		FPlatformMisc::LocalPrint("Pipeline pre-warm list is stale or corrupt, ignored");
+		return;
+	}
+
+	uint32_t NumQueued = 0;
+	for (uint32_t i = 0; i < Header.Count; ++i)
+	{
+		FGraphicsPipelineStateDesc Desc;
+		memcpy(&Desc, Data.data() + sizeof(Header) + i * sizeof(Desc), sizeof(Desc));
+		FCompileRequest Request;
+		// shaders may have changed since the list was written
+		if (Entries.find(Desc) != Entries.end() || !ResolveRequest(Desc, Request))
+			continue;
+		FindOrCompile(Desc);
+		++NumQueued;
+	}
+	NumRequests -= NumQueued;
+	NumMisses -= NumQueued;
+	NumPrewarmed += NumQueued;
+	FPlatformMisc::LocalPrintf("Pipeline pre-warm: %d of %d pipelines queued", NumQueued, Header.Count);
+}
+
+void FVulkanPipelineStateCache::SavePrewarmList(const char* Filename) const
+{
+	std::vector<char> Data(sizeof(FPrewarmFileHeader));
+	FPrewarmFileHeader Header;
+	Header.Magic = FPrewarmFileHeader::MAGIC;
+	Header.DescSize = sizeof(FGraphicsPipelineStateDesc);
+	Header.Count = 0;
+	Header.Padding = 0;
+	for (const auto& Pair : Entries)
+	{
+		if (Pair.second.State != EState::Ready)
+			continue;
+		const char* DescData = (const char*)&Pair.first;
+		Data.insert(Data.end(), DescData, DescData + sizeof(FGraphicsPipelineStateDesc));
+		++Header.Count;
+	}
+	memcpy(Data.data(), &Header, sizeof(Header));
+	FPlatformMisc::WriteSavedFile(Filename, Data.data(), Data.size());
+}
+
+void FVulkanPipelineStateCache::ReportStats() const
+{
+	FPlatformMisc::LocalPrintf("Pipeline state cache: %d lookups, %d misses, %d pre-warmed, %d pending, %zu pipelines",
+		NumRequests, NumMisses, NumPrewarmed, PendingCount, Entries.size());
+	FPlatformMisc::LocalPrintf("Pipeline cache (driver): %d hits, %d misses", DriverCacheHits.load(), DriverCacheMisses.load());
+	CompileTime.Report();
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "Stats/StatSamples.h"
+#include "VulkanRHI/VulkanShaderLibrary.h"
+#include <string.h>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+// Everything that selects a graphics pipeline. Objects are referenced by stable 64-bit keys
+// (shader content hash, render pass compatibility hash, layout key) rather than handles, so a
+// description can be hashed, compared bytewise and written to the pre-warm list of the next run.
+// Fields are fixed-size and the struct is zeroed on construction, so padding never changes the hash.
+struct FGraphicsPipelineStateDesc
+{
+	FGraphicsPipelineStateDesc();
+
+	// shaders, see FVulkanPipelineStateCache::RegisterShader
+	uint64_t VertexShader;
+	uint64_t FragmentShader;
+	// render pass compatibility, see HashRenderPassCompatibility
+	uint64_t RenderPass;
+	uint64_t Layout;
+	// see HashVertexInputLayout, 0 for pipelines without vertex buffers
+	uint64_t VertexLayout;
+	uint32_t Subpass;
+
+	// input assembly
+	uint8_t Topology;			// VkPrimitiveTopology
+
+	// rasterizer
+	uint8_t PolygonMode;		// VkPolygonMode
+	uint8_t CullMode;			// VkCullModeFlags
+	uint8_t FrontFace;			// VkFrontFace
+	uint8_t DepthClampEnable;
+	uint8_t DepthBiasEnable;
+	uint8_t SampleCount;		// VkSampleCountFlagBits
+	uint8_t Padding0;
+	float DepthBiasConstantFactor;
+	float DepthBiasSlopeFactor;
+
+	// depth stencil
+	uint8_t DepthTestEnable;
+	uint8_t DepthWriteEnable;
+	uint8_t DepthCompareOp;		// VkCompareOp
+	uint8_t Padding1;
+
+	// blend state of color attachment 0
+	uint8_t BlendEnable;
+	uint8_t SrcColorBlendFactor;	// VkBlendFactor
+	uint8_t DstColorBlendFactor;
+	uint8_t ColorBlendOp;		// VkBlendOp
+	uint8_t SrcAlphaBlendFactor;
+	uint8_t DstAlphaBlendFactor;
+	uint8_t AlphaBlendOp;
+	uint8_t ColorWriteMask;		// VkColorComponentFlags
+
+	uint64_t GetHash() const;
+
+	bool operator==(const FGraphicsPipelineStateDesc& Other) const
+	{
+		return memcmp(this, &Other, sizeof(*this)) == 0;
+	}
+
+	struct FHasher
+	{
+		size_t operator()(const FGraphicsPipelineStateDesc& Desc) const { return (size_t)Desc.GetHash(); }
+	};
+};
+
+// Vertex buffer bindings and attributes of a pipeline.
+struct FVertexInputLayout
+{
+	std::vector<VkVertexInputBindingDescription> Bindings;
+	std::vector<VkVertexInputAttributeDescription> Attributes;
+};
+
+// Key under which a vertex input layout is registered, never 0.
+uint64_t HashVertexInputLayout(const FVertexInputLayout& VertexLayout);
+
+// Key under which a render pass is registered: two render passes with equal attachment formats
+// and sample counts are compatible, and can share pipelines.
+uint64_t HashRenderPassCompatibility(const VkFormat* ColorFormats, uint32_t NumColorFormats, VkFormat DepthFormat, VkSampleCountFlagBits Samples);
+
+// Runtime cache of graphics pipelines keyed by FGraphicsPipelineStateDesc.
+// Lookups happen on the rendering thread without locking. A miss queues the compile on a worker
+// thread and returns VK_NULL_HANDLE, so the caller draws with a fallback instead of hitching;
+// finished pipelines are picked up by the next Tick().
+class FVulkanPipelineStateCache
+{
+public:
+	void Init(VkDevice InDevice, VkPipelineCache InPipelineCache, bool InSupportsCreationFeedback, uint32_t NumWorkers);
+	void Shutdown();
+
+	void RegisterShader(uint64_t Hash, VkShaderModule Module) { Shaders[Hash] = Module; }
+	// Shaders not registered are looked up here, which creates their modules on first use.
+	void SetShaderLibrary(FVulkanShaderLibrary* InShaderLibrary) { ShaderLibrary = InShaderLibrary; }
+	void RegisterRenderPass(uint64_t Hash, VkRenderPass RenderPass) { RenderPasses[Hash] = RenderPass; }
+	void RegisterLayout(uint64_t Key, VkPipelineLayout Layout) { Layouts[Key] = Layout; }
+	void RegisterVertexLayout(uint64_t Key, const FVertexInputLayout& VertexLayout) { VertexLayouts[Key] = VertexLayout; }
+
+	// Collects pipelines finished by the workers. Call once per frame.
+	void Tick();
+
+	// Never blocks. Returns VK_NULL_HANDLE while the pipeline is compiling or if it failed.
+	VkPipeline FindOrCompile(const FGraphicsPipelineStateDesc& Desc);
+
+	// Compiles on the calling thread if needed, for pipelines that must exist up front (fallbacks).
+	VkPipeline FindOrCompileBlocking(const FGraphicsPipelineStateDesc& Desc);
+
+	// Queues compiles for every description seen by a previous run.
+	void LoadPrewarmList(const char* Filename);
+	void SavePrewarmList(const char* Filename) const;
+
+	// True once if a pipeline missed the driver's VkPipelineCache since the last call.
+	bool ConsumePipelineCacheDirty() { return PipelineCacheDirty.exchange(false); }
+
+	uint32_t NumPending() const { return PendingCount; }
+	// Pipelines created so far that hit and missed the driver's cache, from creation feedback.
+	uint32_t NumDriverCacheHits() const { return DriverCacheHits; }
+	uint32_t NumDriverCacheMisses() const { return DriverCacheMisses; }
+	void ReportStats() const;
+
+private:
+	enum class EState : uint8_t
+	{
+		Pending,
+		Ready,
+		Failed,
+	};
+
+	struct FEntry
+	{
+		EState State;
+		VkPipeline Pipeline;
+	};
+
+	struct FCompileRequest
+	{
+		FGraphicsPipelineStateDesc Desc;
+		VkShaderModule VertexShader;
+		VkShaderModule FragmentShader;
+		VkRenderPass RenderPass;
+		VkPipelineLayout Layout;
+		// nullptr without vertex buffers
+		const FVertexInputLayout* VertexLayout;
+	};
+
+	struct FCompileResult
+	{
+		FGraphicsPipelineStateDesc Desc;
+		VkPipeline Pipeline;
+		double CompileTime;
+	};
+
+	VkShaderModule FindShader(uint64_t Hash) const;
+	bool ResolveRequest(const FGraphicsPipelineStateDesc& Desc, FCompileRequest& OutRequest) const;
+	VkPipeline CreatePipeline(const FCompileRequest& Request);
+	void WorkerLoop();
+
+	VkDevice Device = VK_NULL_HANDLE;
+	VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+	bool SupportsCreationFeedback = false;
+
+	std::unordered_map<uint64_t, VkShaderModule> Shaders;
+	FVulkanShaderLibrary* ShaderLibrary = nullptr;
+	std::unordered_map<uint64_t, VkRenderPass> RenderPasses;
+	std::unordered_map<uint64_t, VkPipelineLayout> Layouts;
+	std::unordered_map<uint64_t, FVertexInputLayout> VertexLayouts;
+
+	// only touched by the rendering thread
+	std::unordered_map<FGraphicsPipelineStateDesc, FEntry, FGraphicsPipelineStateDesc::FHasher> Entries;
+	uint32_t PendingCount = 0;
+	uint32_t NumRequests = 0;
+	uint32_t NumMisses = 0;
+	uint32_t NumPrewarmed = 0;
+	FStatSamples CompileTime{"PSO compile"};
+
+	std::vector<std::thread> Workers;
+	std::mutex QueueMutex;
+	std::condition_variable QueueCondition;
+	std::deque<FCompileRequest> Queue;
+	bool StopWorkers = false;
+
+	std::mutex CompletedMutex;
+	std::vector<FCompileResult> Completed;
+
+	std::atomic<uint32_t> DriverCacheHits{0};
+	std::atomic<uint32_t> DriverCacheMisses{0};
+	std::atomic<bool> PipelineCacheDirty{false};
+};
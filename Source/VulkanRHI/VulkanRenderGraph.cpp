@@ -0,0 +1,1112 @@
+#include "VulkanRenderGraph.h"
+#include "VulkanMemory.h"
+#include "VulkanPipelineState.h"
+#include "VulkanGpuProfiler.h"
+#include "VulkanDeletionQueue.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include "Misc/Hash.h"
+#include "Stats/Profiler.h"
+#include <algorithm>
+#include <string>
+
+
+static const uint32_t INDEX_NONE = ~0u;
+static const VkAccessFlags WRITE_ACCESS_MASK = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+struct FRGAccessInfo
+{
+	VkImageLayout Layout;
+	VkPipelineStageFlags Stages;
+	VkAccessFlags Access;
+	bool IsWrite;
+	bool IsAttachment;
+};
+
+static bool IsDepthFormat(VkFormat Format)
+{
+	switch (Format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool HasStencil(VkFormat Format)
+{
+	return Format == VK_FORMAT_D16_UNORM_S8_UINT || Format == VK_FORMAT_D24_UNORM_S8_UINT || Format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+static VkImageAspectFlags GetAspectMask(VkFormat Format)
+{
+	if (!IsDepthFormat(Format))
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	return HasStencil(Format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+static FRGAccessInfo GetAccessInfo(ERGAccess Access, VkFormat Format)
+{
+	const VkPipelineStageFlags FragmentTests = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	// depth is read in the read-only depth layout, whether as attachment or texture
+	VkImageLayout ReadLayout = IsDepthFormat(Format) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	switch (Access)
+	{
+	case ERGAccess::ColorAttachment:
+		return {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true, true};
+	case ERGAccess::DepthAttachment:
+		return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, FragmentTests,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true, true};
+	case ERGAccess::DepthReadOnly:
+		return {VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, FragmentTests, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, false, true};
+	case ERGAccess::InputAttachment:
+		return {ReadLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, false, true};
+	case ERGAccess::SampledFragment:
+		return {ReadLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false, false};
+	case ERGAccess::SampledCompute:
+		return {ReadLayout, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, false, false};
+	case ERGAccess::StorageCompute:
+		return {VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, true, false};
+	case ERGAccess::TransferSrc:
+		return {VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, false, false};
+	case ERGAccess::TransferDst:
+	default:
+		return {VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, true, false};
+	}
+}
+
+static VkImageUsageFlags GetImageUsage(ERGAccess Access)
+{
+	switch (Access)
+	{
+	case ERGAccess::ColorAttachment: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case ERGAccess::DepthAttachment:
+	case ERGAccess::DepthReadOnly: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case ERGAccess::InputAttachment: return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+	case ERGAccess::SampledFragment:
+	case ERGAccess::SampledCompute: return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case ERGAccess::StorageCompute: return VK_IMAGE_USAGE_STORAGE_BIT;
+	case ERGAccess::TransferSrc: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case ERGAccess::TransferDst:
+	default: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+}
+
+// Only attachments cleared or discarded on load are known to overwrite everything; any other
+// write may be partial, and keeps the previous contents alive.
+static bool ReadsContents(const FRGAccessInfo& Info, VkAttachmentLoadOp LoadOp)
+{
+	return !(Info.IsAttachment && Info.IsWrite && LoadOp != VK_ATTACHMENT_LOAD_OP_LOAD);
+}
+
+static void AddDependency(std::vector<VkSubpassDependency>& Dependencies, uint32_t SrcSubpass, uint32_t DstSubpass,
+	VkPipelineStageFlags SrcStages, VkPipelineStageFlags DstStages, VkAccessFlags SrcAccess, VkAccessFlags DstAccess)
+{
+	for (VkSubpassDependency& Dependency : Dependencies)
+	{
+		if (Dependency.srcSubpass == SrcSubpass && Dependency.dstSubpass == DstSubpass)
+		{
+			Dependency.srcStageMask |= SrcStages;
+			Dependency.dstStageMask |= DstStages;
+			Dependency.srcAccessMask |= SrcAccess;
+			Dependency.dstAccessMask |= DstAccess;
+			return;
+		}
+	}
+	VkSubpassDependency Dependency{};
+	Dependency.srcSubpass = SrcSubpass;
+	Dependency.dstSubpass = DstSubpass;
+	Dependency.srcStageMask = SrcStages;
+	Dependency.dstStageMask = DstStages;
+	Dependency.srcAccessMask = SrcAccess;
+	Dependency.dstAccessMask = DstAccess;
+	// between subpasses every dependency is through attachments, so framebuffer local
+	bool IsInternal = SrcSubpass != VK_SUBPASS_EXTERNAL && DstSubpass != VK_SUBPASS_EXTERNAL;
+	Dependency.dependencyFlags = IsInternal ? VK_DEPENDENCY_BY_REGION_BIT : 0;
+	Dependencies.push_back(Dependency);
+}
+
+FRGPassBuilder& FRGPassBuilder::WriteColor(FRGTexture Texture, VkAttachmentLoadOp LoadOp, VkClearColorValue ClearValue)
+{
+	FRenderGraph::FRGUse& Use = Graph.AddUse(Pass, Texture, ERGAccess::ColorAttachment);
+	Use.LoadOp = LoadOp;
+	Use.ClearValue.color = ClearValue;
+	return *this;
+}
+
+FRGPassBuilder& FRGPassBuilder::WriteDepth(FRGTexture Texture, VkAttachmentLoadOp LoadOp, VkClearDepthStencilValue ClearValue)
+{
+	FRenderGraph::FRGUse& Use = Graph.AddUse(Pass, Texture, ERGAccess::DepthAttachment);
+	Use.LoadOp = LoadOp;
+	Use.ClearValue.depthStencil = ClearValue;
+	return *this;
+}
+
+FRGPassBuilder& FRGPassBuilder::Read(FRGTexture Texture, ERGAccess Access)
+{
+	assert(!GetAccessInfo(Access, VK_FORMAT_UNDEFINED).IsWrite);
+	Graph.AddUse(Pass, Texture, Access);
+	return *this;
+}
+
+FRGPassBuilder& FRGPassBuilder::Write(FRGTexture Texture, ERGAccess Access)
+{
+	// attachments are written with WriteColor / WriteDepth, which take the load op
+	assert(GetAccessInfo(Access, VK_FORMAT_UNDEFINED).IsWrite && !GetAccessInfo(Access, VK_FORMAT_UNDEFINED).IsAttachment);
+	Graph.AddUse(Pass, Texture, Access);
+	return *this;
+}
+
+FRGPassBuilder& FRGPassBuilder::SetSideEffects()
+{
+	Graph.Passes[Pass].HasSideEffects = true;
+	return *this;
+}
+
+FRGPassBuilder& FRGPassBuilder::SetSecondaryCommandBuffers()
+{
+	Graph.Passes[Pass].UseSecondaryCommandBuffers = true;
+	return *this;
+}
+
+void FRenderGraph::Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator)
+{
+	Device = InDevice;
+	MemoryAllocator = &InMemoryAllocator;
+}
+
+void FRenderGraph::Shutdown()
+{
+	ReleasePlans();
+	BeginFrame();
+}
+
+void FRenderGraph::BeginFrame()
+{
+	Textures.clear();
+	Passes.clear();
+	CurrentPlan = nullptr;
+}
+
+FRGTexture FRenderGraph::ImportTexture(const char* Name, VkImage Image, VkImageView ImageView, const FRGTextureDesc& Desc,
+	VkImageLayout InitialLayout, VkImageLayout FinalLayout)
+{
+	Textures.push_back({Name, Desc, true, Image, ImageView, InitialLayout, FinalLayout});
+	return (FRGTexture)Textures.size() - 1;
+}
+
+FRGTexture FRenderGraph::CreateTexture(const char* Name, const FRGTextureDesc& Desc)
+{
+	Textures.push_back({Name, Desc, false, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED});
+	return (FRGTexture)Textures.size() - 1;
+}
+
+FRGPassBuilder FRenderGraph::AddRasterPass(const char* Name, FRGExecuteFunction Execute)
+{
+	Passes.push_back({Name, std::move(Execute), true, false, false, {}});
+	return FRGPassBuilder(*this, (FRGPass)Passes.size() - 1);
+}
+
+FRGPassBuilder FRenderGraph::AddPass(const char* Name, FRGExecuteFunction Execute)
+{
+	Passes.push_back({Name, std::move(Execute), false, false, false, {}});
+	return FRGPassBuilder(*this, (FRGPass)Passes.size() - 1);
+}
+
+FRenderGraph::FRGUse& FRenderGraph::AddUse(FRGPass Pass, FRGTexture Texture, ERGAccess Access)
+{
+	assert(Pass < Passes.size() && Texture < Textures.size());
+	// raster passes only sample outside of their attachments; compute and copies have none
+	assert(Passes[Pass].IsRaster ? (GetAccessInfo(Access, VK_FORMAT_UNDEFINED).IsAttachment || Access == ERGAccess::SampledFragment)
+		: !GetAccessInfo(Access, VK_FORMAT_UNDEFINED).IsAttachment);
+	Passes[Pass].Uses.push_back({Texture, Access, VK_ATTACHMENT_LOAD_OP_LOAD, {}});
+	return Passes[Pass].Uses.back();
+}
+
+uint64_t FRenderGraph::HashStructure() const
+{
+	// everything the plan depends on; handles of imported textures and clear values are looked up
+	// at execution
+	uint64_t Hash = HashCombine(Textures.size(), Passes.size());
+	for (const FRGTextureDecl& Texture : Textures)
+	{
+		Hash = HashCombine(Hash, Texture.IsImported);
+		Hash = HashCombine(Hash, Texture.Desc.Format);
+		Hash = HashCombine(Hash, ((uint64_t)Texture.Desc.Extent.width << 32) | Texture.Desc.Extent.height);
+		Hash = HashCombine(Hash, Texture.Desc.Samples);
+		Hash = HashCombine(Hash, ((uint64_t)Texture.InitialLayout << 32) | Texture.FinalLayout);
+	}
+	for (const FRGPassDecl& Pass : Passes)
+	{
+		Hash = HashCombine(Hash, ((uint64_t)Pass.IsRaster << 1) | Pass.HasSideEffects);
+		for (const FRGUse& Use : Pass.Uses)
+		{
+			Hash = HashCombine(Hash, ((uint64_t)Use.Texture << 32) | ((uint64_t)Use.Access << 8) | (uint64_t)Use.LoadOp);
+		}
+	}
+	return Hash;
+}
+
+void FRenderGraph::Compile()
+{
+	uint64_t Hash = HashStructure();
+	auto It = Plans.find(Hash);
+	if (It != Plans.end())
+	{
+		CurrentPlan = It->second;
+		return;
+	}
+	CurrentPlan = new FRGPlan;
+	CompilePlan(*CurrentPlan);
+	Plans[Hash] = CurrentPlan;
+}
+
+void FRenderGraph::CompilePlan(FRGPlan& Plan)
+{
+	CullPasses(Plan);
+	BuildSteps(Plan);
+	AllocateTransients(Plan);
+	BuildDependencies(Plan);
+	for (FRGStep& Step : Plan.Steps)
+	{
+		std::string Name;
+		for (FRGPass Pass : Step.Passes)
+		{
+			Name += Name.empty() ? Passes[Pass].Name : std::string(" + ") + Passes[Pass].Name;
+		}
+		Step.Name = FProfiler::Get().InternName(Name);
+		if (Step.IsRenderPass)
+		{
+			CreateRenderPass(Plan, Step);
+		}
+	}
+}
+
+void FRenderGraph::CullPasses(FRGPlan& Plan) const
+{
+	// Walks the passes backwards, tracking which textures a kept later pass still reads. A pass is
+	// kept if it writes one of them, an imported texture, or has side effects.
+	Plan.IsCulled.assign(Passes.size(), true);
+	std::vector<bool> IsRead(Textures.size(), false);
+	for (uint32_t PassIndex = (uint32_t)Passes.size(); PassIndex-- > 0;)
+	{
+		const FRGPassDecl& Pass = Passes[PassIndex];
+		bool Keep = Pass.HasSideEffects;
+		for (const FRGUse& Use : Pass.Uses)
+		{
+			if (GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format).IsWrite && (Textures[Use.Texture].IsImported || IsRead[Use.Texture]))
+			{
+				Keep = true;
+			}
+		}
+		if (!Keep)
+			continue;
+
+		Plan.IsCulled[PassIndex] = false;
+		// a full overwrite ends the lifetime of what earlier passes wrote
+		for (const FRGUse& Use : Pass.Uses)
+		{
+			FRGAccessInfo Info = GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format);
+			if (Info.IsWrite && !ReadsContents(Info, Use.LoadOp))
+			{
+				IsRead[Use.Texture] = false;
+			}
+		}
+		for (const FRGUse& Use : Pass.Uses)
+		{
+			if (ReadsContents(GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format), Use.LoadOp))
+			{
+				IsRead[Use.Texture] = true;
+			}
+		}
+	}
+}
+
+void FRenderGraph::BuildSteps(FRGPlan& Plan) const
+{
+	Plan.PassStep.assign(Passes.size(), INDEX_NONE);
+	Plan.PassSubpass.assign(Passes.size(), 0);
+
+	auto FindAttachment = [](const FRGStep& Step, FRGTexture Texture)
+	{
+		return std::find_if(Step.Attachments.begin(), Step.Attachments.end(),
+			[Texture](const FRGAttachment& Attachment) { return Attachment.Texture == Texture; }) != Step.Attachments.end();
+	};
+
+	for (FRGPass PassIndex = 0; PassIndex < Passes.size(); ++PassIndex)
+	{
+		if (Plan.IsCulled[PassIndex])
+			continue;
+
+		const FRGPassDecl& Pass = Passes[PassIndex];
+		VkExtent2D Extent = {0, 0};
+		VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+		for (const FRGUse& Use : Pass.Uses)
+		{
+			if (GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format).IsAttachment)
+			{
+				assert(Extent.width == 0 || (Extent.width == Textures[Use.Texture].Desc.Extent.width && Extent.height == Textures[Use.Texture].Desc.Extent.height));
+				Extent = Textures[Use.Texture].Desc.Extent;
+				Samples = Textures[Use.Texture].Desc.Samples;
+			}
+		}
+		assert(!Pass.IsRaster || Extent.width > 0);
+
+		// The pass becomes the next subpass of the previous render pass if it has the same size, and
+		// only touches that render pass' attachments as attachments itself (including input
+		// attachments). Sampling one of them needs a barrier outside the render pass.
+		bool CanMerge = Pass.IsRaster && !Plan.Steps.empty() && Plan.Steps.back().IsRenderPass;
+		if (CanMerge)
+		{
+			const FRGStep& Step = Plan.Steps.back();
+			auto IsSampledInStep = [this, &Step](FRGTexture Texture)
+			{
+				for (FRGPass StepPass : Step.Passes)
+				{
+					for (const FRGUse& StepUse : Passes[StepPass].Uses)
+					{
+						if (StepUse.Texture == Texture && !GetAccessInfo(StepUse.Access, Textures[Texture].Desc.Format).IsAttachment)
+							return true;
+					}
+				}
+				return false;
+			};
+			CanMerge = Step.Extent.width == Extent.width && Step.Extent.height == Extent.height &&
+				Textures[Step.Attachments[0].Texture].Desc.Samples == Samples;
+			for (const FRGUse& Use : Pass.Uses)
+			{
+				bool IsAttachmentUse = GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format).IsAttachment;
+				bool IsStepAttachment = FindAttachment(Step, Use.Texture);
+				if ((!IsAttachmentUse && IsStepAttachment) || (IsAttachmentUse && !IsStepAttachment && IsSampledInStep(Use.Texture)))
+				{
+					CanMerge = false;
+				}
+			}
+		}
+
+		if (!CanMerge)
+		{
+			Plan.Steps.emplace_back();
+			Plan.Steps.back().IsRenderPass = Pass.IsRaster;
+			Plan.Steps.back().Extent = Extent;
+		}
+		FRGStep& Step = Plan.Steps.back();
+		Plan.PassStep[PassIndex] = (uint32_t)Plan.Steps.size() - 1;
+		Plan.PassSubpass[PassIndex] = (uint32_t)Step.Passes.size();
+		Step.Passes.push_back(PassIndex);
+		for (uint32_t UseIndex = 0; UseIndex < Pass.Uses.size(); ++UseIndex)
+		{
+			const FRGUse& Use = Pass.Uses[UseIndex];
+			if (GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format).IsAttachment && !FindAttachment(Step, Use.Texture))
+			{
+				FRGAttachment Attachment{};
+				Attachment.Texture = Use.Texture;
+				Attachment.FirstPass = PassIndex;
+				Attachment.FirstUse = UseIndex;
+				Step.Attachments.push_back(Attachment);
+			}
+		}
+	}
+}
+
+void FRenderGraph::AllocateTransients(FRGPlan& Plan)
+{
+	// lifetimes in pass order, and the union of all usages
+	std::vector<uint32_t> FirstPass(Textures.size(), INDEX_NONE);
+	std::vector<uint32_t> LastPass(Textures.size(), 0);
+	std::vector<VkImageUsageFlags> Usage(Textures.size(), 0);
+	for (FRGPass PassIndex = 0; PassIndex < Passes.size(); ++PassIndex)
+	{
+		if (Plan.IsCulled[PassIndex])
+			continue;
+		for (const FRGUse& Use : Passes[PassIndex].Uses)
+		{
+			FirstPass[Use.Texture] = std::min(FirstPass[Use.Texture], PassIndex);
+			LastPass[Use.Texture] = std::max(LastPass[Use.Texture], PassIndex);
+			Usage[Use.Texture] |= GetImageUsage(Use.Access);
+		}
+	}
+
+	Plan.Transients.resize(Textures.size());
+	std::vector<FRGTexture> Sorted;
+	std::vector<VkMemoryRequirements> Requirements(Textures.size());
+	for (FRGTexture Texture = 0; Texture < Textures.size(); ++Texture)
+	{
+		if (Textures[Texture].IsImported || FirstPass[Texture] == INDEX_NONE)
+			continue;
+
+		const FRGTextureDesc& Desc = Textures[Texture].Desc;
+		VkImageCreateInfo ImageInfo{};
+		ImageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+		ImageInfo.format = Desc.Format;
+		ImageInfo.extent = {Desc.Extent.width, Desc.Extent.height, 1};
+		ImageInfo.mipLevels = 1;
+		ImageInfo.arrayLayers = 1;
+		ImageInfo.samples = Desc.Samples;
+		ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		ImageInfo.usage = Usage[Texture];
+		ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		verify(vkCreateImage(Device, &ImageInfo, nullptr, &Plan.Transients[Texture].Image) == VK_SUCCESS);
+		vkGetImageMemoryRequirements(Device, Plan.Transients[Texture].Image, &Requirements[Texture]);
+		Plan.TransientBytes += Requirements[Texture].size;
+		Sorted.push_back(Texture);
+	}
+
+	// Greedy interval packing, largest first: a texture shares a slot with textures whose lifetimes
+	// don't overlap its own. The slot is as large and as aligned as its largest occupant.
+	struct FSlot
+	{
+		VkMemoryRequirements Requirements;
+		std::vector<FRGTexture> Textures;
+	};
+	std::vector<FSlot> Slots;
+	std::stable_sort(Sorted.begin(), Sorted.end(), [&Requirements](FRGTexture A, FRGTexture B) { return Requirements[A].size > Requirements[B].size; });
+	for (FRGTexture Texture : Sorted)
+	{
+		const VkMemoryRequirements& Required = Requirements[Texture];
+		uint32_t SlotIndex = 0;
+		for (; SlotIndex < Slots.size(); ++SlotIndex)
+		{
+			FSlot& Slot = Slots[SlotIndex];
+			bool Overlaps = std::any_of(Slot.Textures.begin(), Slot.Textures.end(), [&](FRGTexture Other)
+			{
+				return FirstPass[Texture] <= LastPass[Other] && FirstPass[Other] <= LastPass[Texture];
+			});
+			if (!Overlaps && (Slot.Requirements.memoryTypeBits & Required.memoryTypeBits) != 0)
+			{
+				Slot.Requirements.size = std::max(Slot.Requirements.size, Required.size);
+				Slot.Requirements.alignment = std::max(Slot.Requirements.alignment, Required.alignment);
+				Slot.Requirements.memoryTypeBits &= Required.memoryTypeBits;
+				Slot.Textures.push_back(Texture);
+				break;
+			}
+		}
+		if (SlotIndex == Slots.size())
+		{
+			Slots.push_back({Required, {Texture}});
+		}
+		Plan.Transients[Texture].Slot = SlotIndex;
+	}
+
+	for (FSlot& Slot : Slots)
+	{
+		FVulkanAllocation* Allocation = MemoryAllocator->Allocate(Slot.Requirements, EVulkanMemoryUsage::GpuOnly, false);
+		verify(Allocation != nullptr);
+		Plan.Slots.push_back(Allocation);
+		Plan.AliasedBytes += Slot.Requirements.size;
+
+		std::sort(Slot.Textures.begin(), Slot.Textures.end(), [&FirstPass](FRGTexture A, FRGTexture B) { return FirstPass[A] < FirstPass[B]; });
+		for (size_t i = 0; i < Slot.Textures.size(); ++i)
+		{
+			FRGTexture Texture = Slot.Textures[i];
+			FRGTransient& Transient = Plan.Transients[Texture];
+			Transient.PreviousOccupant = Slot.Textures[i > 0 ? i - 1 : Slot.Textures.size() - 1];
+			verify(vkBindImageMemory(Device, Transient.Image, Allocation->Memory, Allocation->Offset) == VK_SUCCESS);
+
+			VkImageViewCreateInfo ViewInfo{};
+			ViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			ViewInfo.image = Transient.Image;
+			ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			ViewInfo.format = Textures[Texture].Desc.Format;
+			ViewInfo.subresourceRange = {GetAspectMask(Textures[Texture].Desc.Format), 0, 1, 0, 1};
+			verify(vkCreateImageView(Device, &ViewInfo, nullptr, &Transient.ImageView) == VK_SUCCESS);
+		}
+	}
+}
+
+void FRenderGraph::BuildDependencies(FRGPlan& Plan) const
+{
+	// Synchronization state of a texture after its latest use. ReadStages are the stages that read
+	// it since the last write and already wait for that write.
+	struct FTextureState
+	{
+		VkImageLayout Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags WriteStages = 0;
+		VkAccessFlags WriteAccess = 0;
+		VkPipelineStageFlags ReadStages = 0;
+		uint32_t Step = INDEX_NONE;
+		uint32_t Subpass = 0;
+		bool IsAttachment = false;
+		// The pre barrier or render pass out dependency that synchronized the latest layout transition.
+		// Later reads in the same layout are added to it instead of getting a barrier of their own.
+		uint32_t SyncStep = INDEX_NONE;
+		uint32_t SyncSubpass = INDEX_NONE;
+		uint32_t SyncBarrier = INDEX_NONE;
+	};
+	std::vector<FTextureState> States(Textures.size());
+
+	// all stages and writes of each texture, which the next user of its memory waits for
+	std::vector<VkPipelineStageFlags> UseStages(Textures.size(), 0);
+	std::vector<VkAccessFlags> UseWriteAccess(Textures.size(), 0);
+	for (FRGPass PassIndex = 0; PassIndex < Passes.size(); ++PassIndex)
+	{
+		if (Plan.IsCulled[PassIndex])
+			continue;
+		for (const FRGUse& Use : Passes[PassIndex].Uses)
+		{
+			FRGAccessInfo Info = GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format);
+			UseStages[Use.Texture] |= Info.Stages;
+			UseWriteAccess[Use.Texture] |= Info.Access & WRITE_ACCESS_MASK;
+		}
+	}
+
+	auto GetAttachment = [](FRGStep& Step, FRGTexture Texture) -> FRGAttachment&
+	{
+		return *std::find_if(Step.Attachments.begin(), Step.Attachments.end(),
+			[Texture](const FRGAttachment& Attachment) { return Attachment.Texture == Texture; });
+	};
+
+	for (uint32_t StepIndex = 0; StepIndex < Plan.Steps.size(); ++StepIndex)
+	{
+		FRGStep& Step = Plan.Steps[StepIndex];
+		for (uint32_t Subpass = 0; Subpass < Step.Passes.size(); ++Subpass)
+		{
+			for (const FRGUse& Use : Passes[Step.Passes[Subpass]].Uses)
+			{
+				const FRGTextureDecl& Texture = Textures[Use.Texture];
+				FRGAccessInfo Info = GetAccessInfo(Use.Access, Texture.Desc.Format);
+				FTextureState& State = States[Use.Texture];
+				if (State.Step == StepIndex && State.Subpass == Subpass)
+					continue;
+
+				// what this use has to wait for
+				VkImageLayout OldLayout = State.Layout;
+				VkPipelineStageFlags SrcStages = 0;
+				VkAccessFlags SrcAccess = 0;
+				bool NeedsSync;
+				bool IsFirstUse = State.Step == INDEX_NONE;
+				if (IsFirstUse && Texture.IsImported)
+				{
+					// chains with a semaphore wait at the same stages
+					OldLayout = Texture.InitialLayout;
+					SrcStages = Info.Stages;
+					NeedsSync = Info.IsWrite || OldLayout != Info.Layout;
+				}
+				else if (IsFirstUse)
+				{
+					// the memory's previous user, this frame or the last one
+					FRGTexture Previous = Plan.Transients[Use.Texture].PreviousOccupant;
+					SrcStages = UseStages[Previous];
+					SrcAccess = UseWriteAccess[Previous];
+					NeedsSync = true;
+				}
+				else if (Info.IsWrite || OldLayout != Info.Layout)
+				{
+					SrcStages = State.WriteStages | State.ReadStages;
+					SrcAccess = State.WriteAccess;
+					NeedsSync = true;
+				}
+				else
+				{
+					SrcStages = State.WriteStages;
+					SrcAccess = State.WriteAccess;
+					NeedsSync = State.WriteStages != 0 && (State.ReadStages & Info.Stages) != Info.Stages;
+				}
+				if (SrcStages == 0)
+				{
+					SrcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+				}
+
+				bool IsSyncedRead = NeedsSync && !IsFirstUse && !Info.IsWrite && OldLayout == Info.Layout && State.SyncStep != INDEX_NONE;
+				if (IsSyncedRead)
+				{
+					FRGStep& SyncStep = Plan.Steps[State.SyncStep];
+					if (State.SyncBarrier != INDEX_NONE)
+					{
+						SyncStep.PreBarriers.DstStages |= Info.Stages;
+						SyncStep.PreBarriers.ImageBarriers[State.SyncBarrier].DstAccess |= Info.Access;
+					}
+					else
+					{
+						AddDependency(SyncStep.Dependencies, State.SyncSubpass, VK_SUBPASS_EXTERNAL, 0, Info.Stages, 0, Info.Access);
+					}
+					NeedsSync = false;
+				}
+				uint32_t SyncStep = INDEX_NONE;
+				uint32_t SyncSubpass = INDEX_NONE;
+				uint32_t SyncBarrier = INDEX_NONE;
+
+				if (Info.IsAttachment)
+				{
+					FRGAttachment& Attachment = GetAttachment(Step, Use.Texture);
+					if (State.Step == StepIndex)
+					{
+						// layouts between subpasses are handled by the attachment references
+						if (NeedsSync)
+						{
+							AddDependency(Step.Dependencies, State.Subpass, Subpass, SrcStages, Info.Stages, SrcAccess, Info.Access);
+						}
+					}
+					else
+					{
+						bool KeepContents = ReadsContents(Info, Use.LoadOp);
+						Attachment.Description.format = Texture.Desc.Format;
+						Attachment.Description.samples = Texture.Desc.Samples;
+						Attachment.Description.loadOp = KeepContents ? VK_ATTACHMENT_LOAD_OP_LOAD : Use.LoadOp;
+						Attachment.Description.initialLayout = KeepContents ? OldLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+						if (NeedsSync)
+						{
+							AddDependency(Step.Dependencies, VK_SUBPASS_EXTERNAL, Subpass, SrcStages, Info.Stages, SrcAccess, Info.Access);
+						}
+					}
+					// until a later use needs something else
+					Attachment.Description.finalLayout = Info.Layout;
+				}
+				else if (!IsFirstUse && State.IsAttachment)
+				{
+					// the render pass that wrote the attachment transitions it on the way out
+					assert(State.Step != StepIndex);
+					FRGStep& Producer = Plan.Steps[State.Step];
+					GetAttachment(Producer, Use.Texture).Description.finalLayout = Info.Layout;
+					if (NeedsSync)
+					{
+						AddDependency(Producer.Dependencies, State.Subpass, VK_SUBPASS_EXTERNAL, SrcStages, Info.Stages, SrcAccess, Info.Access);
+						SyncStep = State.Step;
+						SyncSubpass = State.Subpass;
+					}
+				}
+				else if (NeedsSync)
+				{
+					Step.PreBarriers.SrcStages |= SrcStages;
+					Step.PreBarriers.DstStages |= Info.Stages;
+					SyncStep = StepIndex;
+					SyncBarrier = (uint32_t)Step.PreBarriers.ImageBarriers.size();
+					Step.PreBarriers.ImageBarriers.push_back({Use.Texture, OldLayout, Info.Layout, SrcAccess, Info.Access});
+					++Plan.NumBarriers;
+				}
+
+				if (Info.IsWrite)
+				{
+					State.WriteStages = Info.Stages;
+					State.WriteAccess = Info.Access & WRITE_ACCESS_MASK;
+					State.ReadStages = 0;
+				}
+				else if (OldLayout != Info.Layout)
+				{
+					// later readers in other stages wait for the transition
+					State.WriteStages = Info.Stages;
+					State.WriteAccess = 0;
+					State.ReadStages = Info.Stages;
+				}
+				else
+				{
+					State.ReadStages |= Info.Stages;
+				}
+				if (!IsSyncedRead)
+				{
+					State.SyncStep = SyncStep;
+					State.SyncSubpass = SyncSubpass;
+					State.SyncBarrier = SyncBarrier;
+				}
+				State.Layout = Info.Layout;
+				State.Step = StepIndex;
+				State.Subpass = Subpass;
+				State.IsAttachment = Info.IsAttachment;
+			}
+		}
+	}
+
+	for (FRGTexture TextureIndex = 0; TextureIndex < Textures.size(); ++TextureIndex)
+	{
+		const FTextureState& State = States[TextureIndex];
+		const FRGTextureDecl& Texture = Textures[TextureIndex];
+		if (State.Step == INDEX_NONE)
+			continue;
+
+		// attachments are only stored if something uses them after their render pass
+		for (uint32_t StepIndex = 0; StepIndex <= State.Step; ++StepIndex)
+		{
+			for (FRGAttachment& Attachment : Plan.Steps[StepIndex].Attachments)
+			{
+				if (Attachment.Texture == TextureIndex)
+				{
+					bool IsUsedLater = Texture.IsImported || StepIndex < State.Step;
+					Attachment.Description.storeOp = IsUsedLater ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+				}
+			}
+		}
+
+		if (!Texture.IsImported || Texture.FinalLayout == VK_IMAGE_LAYOUT_UNDEFINED || Texture.FinalLayout == State.Layout)
+			continue;
+		if (State.IsAttachment)
+		{
+			// made visible to whoever waits on the frame's semaphore or fence
+			GetAttachment(Plan.Steps[State.Step], TextureIndex).Description.finalLayout = Texture.FinalLayout;
+		}
+		else
+		{
+			Plan.PostBarriers.SrcStages |= State.WriteStages | State.ReadStages;
+			Plan.PostBarriers.DstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+			Plan.PostBarriers.ImageBarriers.push_back({TextureIndex, State.Layout, Texture.FinalLayout, State.WriteAccess, 0});
+			++Plan.NumBarriers;
+		}
+	}
+}
+
+void FRenderGraph::CreateRenderPass(FRGPlan& Plan, FRGStep& Step)
+{
+	std::vector<VkAttachmentDescription> Descriptions;
+	for (FRGAttachment& Attachment : Step.Attachments)
+	{
+		VkAttachmentDescription& Description = Attachment.Description;
+		bool UsesStencil = HasStencil(Description.format);
+		Description.stencilLoadOp = UsesStencil ? Description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		Description.stencilStoreOp = UsesStencil ? Description.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		Descriptions.push_back(Description);
+	}
+
+	uint32_t NumSubpasses = (uint32_t)Step.Passes.size();
+	std::vector<std::vector<VkAttachmentReference>> ColorReferences(NumSubpasses);
+	std::vector<std::vector<VkAttachmentReference>> InputReferences(NumSubpasses);
+	std::vector<VkAttachmentReference> DepthReferences(NumSubpasses, {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED});
+	std::vector<std::vector<uint32_t>> PreserveAttachments(NumSubpasses);
+	// first and last subpass using each attachment
+	std::vector<uint32_t> FirstSubpass(Step.Attachments.size(), INDEX_NONE);
+	std::vector<uint32_t> LastSubpass(Step.Attachments.size(), 0);
+	std::vector<std::vector<bool>> IsUsed(NumSubpasses, std::vector<bool>(Step.Attachments.size(), false));
+
+	uint64_t Key = HashCombine(0, NumSubpasses);
+	for (uint32_t Subpass = 0; Subpass < NumSubpasses; ++Subpass)
+	{
+		std::vector<VkFormat> ColorFormats;
+		VkFormat DepthFormat = VK_FORMAT_UNDEFINED;
+		for (const FRGUse& Use : Passes[Step.Passes[Subpass]].Uses)
+		{
+			FRGAccessInfo Info = GetAccessInfo(Use.Access, Textures[Use.Texture].Desc.Format);
+			if (!Info.IsAttachment)
+				continue;
+			uint32_t Index = (uint32_t)(std::find_if(Step.Attachments.begin(), Step.Attachments.end(),
+				[&Use](const FRGAttachment& Attachment) { return Attachment.Texture == Use.Texture; }) - Step.Attachments.begin());
+			VkAttachmentReference Reference = {Index, Info.Layout};
+			if (Use.Access == ERGAccess::ColorAttachment)
+			{
+				ColorReferences[Subpass].push_back(Reference);
+				ColorFormats.push_back(Textures[Use.Texture].Desc.Format);
+			}
+			else if (Use.Access == ERGAccess::InputAttachment)
+			{
+				InputReferences[Subpass].push_back(Reference);
+				Key = HashCombine(Key, Textures[Use.Texture].Desc.Format);
+			}
+			else
+			{
+				DepthReferences[Subpass] = Reference;
+				DepthFormat = Textures[Use.Texture].Desc.Format;
+			}
+			IsUsed[Subpass][Index] = true;
+			FirstSubpass[Index] = std::min(FirstSubpass[Index], Subpass);
+			LastSubpass[Index] = std::max(LastSubpass[Index], Subpass);
+		}
+		uint64_t SubpassKey = HashRenderPassCompatibility(ColorFormats.data(), (uint32_t)ColorFormats.size(), DepthFormat,
+			Textures[Step.Attachments[0].Texture].Desc.Samples);
+		// single subpass render passes use the same key as everywhere else
+		Key = NumSubpasses == 1 ? SubpassKey : HashCombine(Key, SubpassKey);
+	}
+	Step.RenderPassKey = Key;
+
+	std::vector<VkSubpassDescription> Subpasses(NumSubpasses);
+	for (uint32_t Subpass = 0; Subpass < NumSubpasses; ++Subpass)
+	{
+		// attachments written before and read after this subpass must survive it
+		for (uint32_t Index = 0; Index < Step.Attachments.size(); ++Index)
+		{
+			if (!IsUsed[Subpass][Index] && FirstSubpass[Index] < Subpass && LastSubpass[Index] > Subpass)
+			{
+				PreserveAttachments[Subpass].push_back(Index);
+			}
+		}
+		VkSubpassDescription& Description = Subpasses[Subpass];
+		Description.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		Description.colorAttachmentCount = (uint32_t)ColorReferences[Subpass].size();
+		Description.pColorAttachments = ColorReferences[Subpass].data();
+		Description.inputAttachmentCount = (uint32_t)InputReferences[Subpass].size();
+		Description.pInputAttachments = InputReferences[Subpass].data();
+		Description.pDepthStencilAttachment = DepthReferences[Subpass].attachment != VK_ATTACHMENT_UNUSED ? &DepthReferences[Subpass] : nullptr;
+		Description.preserveAttachmentCount = (uint32_t)PreserveAttachments[Subpass].size();
+		Description.pPreserveAttachments = PreserveAttachments[Subpass].data();
+	}
+
+	VkRenderPassCreateInfo RenderPassInfo{};
+	RenderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	RenderPassInfo.attachmentCount = (uint32_t)Descriptions.size();
+	RenderPassInfo.pAttachments = Descriptions.data();
+	RenderPassInfo.subpassCount = NumSubpasses;
+	RenderPassInfo.pSubpasses = Subpasses.data();
+	RenderPassInfo.dependencyCount = (uint32_t)Step.Dependencies.size();
+	RenderPassInfo.pDependencies = Step.Dependencies.data();
+	verify(vkCreateRenderPass(Device, &RenderPassInfo, nullptr, &Step.RenderPass) == VK_SUCCESS);
+}
+
+void FRenderGraph::RecordBarriers(VkCommandBuffer CommandBuffer, const FRGBarrierBatch& Batch)
+{
+	if (Batch.SrcStages == 0)
+		return;
+
+	ScratchBarriers.clear();
+	for (const FRGImageBarrier& Barrier : Batch.ImageBarriers)
+	{
+		VkImageMemoryBarrier ImageBarrier{};
+		ImageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		ImageBarrier.srcAccessMask = Barrier.SrcAccess;
+		ImageBarrier.dstAccessMask = Barrier.DstAccess;
+		ImageBarrier.oldLayout = Barrier.OldLayout;
+		ImageBarrier.newLayout = Barrier.NewLayout;
+		ImageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		ImageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		ImageBarrier.image = GetImage(Barrier.Texture);
+		ImageBarrier.subresourceRange = {GetAspectMask(Textures[Barrier.Texture].Desc.Format), 0, 1, 0, 1};
+		ScratchBarriers.push_back(ImageBarrier);
+	}
+	vkCmdPipelineBarrier(CommandBuffer, Batch.SrcStages, Batch.DstStages, 0, 0, nullptr, 0, nullptr,
+		(uint32_t)ScratchBarriers.size(), ScratchBarriers.data());
+}
+
+VkFramebuffer FRenderGraph::GetFramebuffer(const FRGStep& Step)
+{
+	ScratchViews.clear();
+	for (const FRGAttachment& Attachment : Step.Attachments)
+	{
+		ScratchViews.push_back(GetImageView(Attachment.Texture));
+	}
+	uint64_t Key = HashBytes(ScratchViews.data(), ScratchViews.size() * sizeof(VkImageView));
+	Key = HashCombine(Key, (uint64_t)Step.RenderPass);
+	auto It = Framebuffers.find(Key);
+	if (It != Framebuffers.end())
+	{
+		return It->second.Framebuffer;
+	}
+
+	VkFramebufferCreateInfo CreateInfo{};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	CreateInfo.renderPass = Step.RenderPass;
+	CreateInfo.attachmentCount = (uint32_t)ScratchViews.size();
+	CreateInfo.pAttachments = ScratchViews.data();
+	CreateInfo.width = Step.Extent.width;
+	CreateInfo.height = Step.Extent.height;
+	CreateInfo.layers = 1;
+	VkFramebuffer Framebuffer;
+	verify(vkCreateFramebuffer(Device, &CreateInfo, nullptr, &Framebuffer) == VK_SUCCESS);
+	Framebuffers[Key] = {Framebuffer, ScratchViews};
+	return Framebuffer;
+}
+
+void FRenderGraph::Execute(VkCommandBuffer CommandBuffer)
+{
+	assert(CurrentPlan != nullptr);
+	for (const FRGStep& Step : CurrentPlan->Steps)
+	{
+		// around the whole render pass, timestamps can't be written in subpasses using secondary command buffers
+		if (GpuProfiler)
+		{
+			GpuProfiler->BeginScope(CommandBuffer, Step.Name);
+		}
+		RecordBarriers(CommandBuffer, Step.PreBarriers);
+
+		FRGPassContext Context{CommandBuffer, VK_NULL_HANDLE, 0, VK_NULL_HANDLE, Step.Extent, this};
+		if (!Step.IsRenderPass)
+		{
+			const FRGPassDecl& Pass = Passes[Step.Passes[0]];
+			if (Pass.Execute)
+			{
+				SCOPED_CPU_EVENT(Pass.Name);
+				Pass.Execute(Context);
+			}
+			if (GpuProfiler)
+			{
+				GpuProfiler->EndScope(CommandBuffer);
+			}
+			continue;
+		}
+
+		Context.RenderPass = Step.RenderPass;
+		Context.Framebuffer = GetFramebuffer(Step);
+		ScratchClearValues.clear();
+		for (const FRGAttachment& Attachment : Step.Attachments)
+		{
+			ScratchClearValues.push_back(Passes[Attachment.FirstPass].Uses[Attachment.FirstUse].ClearValue);
+		}
+
+		VkRenderPassBeginInfo BeginInfo{};
+		BeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		BeginInfo.renderPass = Step.RenderPass;
+		BeginInfo.framebuffer = Context.Framebuffer;
+		BeginInfo.renderArea = {{0, 0}, Step.Extent};
+		BeginInfo.clearValueCount = (uint32_t)ScratchClearValues.size();
+		BeginInfo.pClearValues = ScratchClearValues.data();
+		for (uint32_t Subpass = 0; Subpass < Step.Passes.size(); ++Subpass)
+		{
+			const FRGPassDecl& Pass = Passes[Step.Passes[Subpass]];
+			VkSubpassContents Contents = Pass.UseSecondaryCommandBuffers ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE;
+			if (Subpass == 0)
+			{
+				vkCmdBeginRenderPass(CommandBuffer, &BeginInfo, Contents);
+			}
+			else
+			{
+				vkCmdNextSubpass(CommandBuffer, Contents);
+			}
+			Context.Subpass = Subpass;
+			if (Pass.Execute)
+			{
+				SCOPED_CPU_EVENT(Pass.Name);
+				Pass.Execute(Context);
+			}
+		}
+		vkCmdEndRenderPass(CommandBuffer);
+		if (GpuProfiler)
+		{
+			GpuProfiler->EndScope(CommandBuffer);
+		}
+	}
+	RecordBarriers(CommandBuffer, CurrentPlan->PostBarriers);
+}
+
+VkRenderPass FRenderGraph::GetRenderPass(FRGPass Pass, uint32_t& OutSubpass) const
+{
+	assert(CurrentPlan != nullptr && Passes[Pass].IsRaster);
+	OutSubpass = CurrentPlan->PassSubpass[Pass];
+	return CurrentPlan->IsCulled[Pass] ? VK_NULL_HANDLE : CurrentPlan->Steps[CurrentPlan->PassStep[Pass]].RenderPass;
+}
+
+uint64_t FRenderGraph::GetRenderPassKey(FRGPass Pass) const
+{
+	assert(CurrentPlan != nullptr && Passes[Pass].IsRaster);
+	return CurrentPlan->IsCulled[Pass] ? 0 : CurrentPlan->Steps[CurrentPlan->PassStep[Pass]].RenderPassKey;
+}
+
+VkImage FRenderGraph::GetImage(FRGTexture Texture) const
+{
+	return Textures[Texture].IsImported ? Textures[Texture].Image : CurrentPlan->Transients[Texture].Image;
+}
+
+VkImageView FRenderGraph::GetImageView(FRGTexture Texture) const
+{
+	return Textures[Texture].IsImported ? Textures[Texture].ImageView : CurrentPlan->Transients[Texture].ImageView;
+}
+
+void FRenderGraph::ReleasePlans()
+{
+	for (auto& It : Plans)
+	{
+		FRGPlan* Plan = It.second;
+		for (FRGStep& Step : Plan->Steps)
+		{
+			vkDestroyRenderPass(Device, Step.RenderPass, nullptr);
+		}
+		for (FRGTransient& Transient : Plan->Transients)
+		{
+			vkDestroyImageView(Device, Transient.ImageView, nullptr);
+			vkDestroyImage(Device, Transient.Image, nullptr);
+		}
+		for (FVulkanAllocation* Allocation : Plan->Slots)
+		{
+			MemoryAllocator->Free(Allocation);
+		}
+		delete Plan;
+	}
+	Plans.clear();
+	CurrentPlan = nullptr;
+	for (auto& It : Framebuffers)
+	{
+		vkDestroyFramebuffer(Device, It.second.Framebuffer, nullptr);
+	}
+	Framebuffers.clear();
+}
+
+void FRenderGraph::RetirePlans(FVulkanDeletionQueue& DeletionQueue)
+{
+	for (auto& It : Framebuffers)
+	{
+		DeletionQueue.Delete(It.second.Framebuffer);
+	}
+	Framebuffers.clear();
+	for (auto& It : Plans)
+	{
+		FRGPlan* Plan = It.second;
+		for (FRGStep& Step : Plan->Steps)
+		{
+			DeletionQueue.Delete(Step.RenderPass);
+		}
+		for (FRGTransient& Transient : Plan->Transients)
+		{
+			DeletionQueue.Delete(Transient.ImageView);
+			// bound to one of the slots
+			DeletionQueue.DeleteImage(Transient.Image, nullptr);
+		}
+		for (FVulkanAllocation* Allocation : Plan->Slots)
+		{
+			DeletionQueue.Free(Allocation);
+		}
+		delete Plan;
+	}
+	Plans.clear();
+	CurrentPlan = nullptr;
+}
+
+void FRenderGraph::ReleaseFramebuffers(const std::vector<VkImageView>& Views, std::vector<VkFramebuffer>& OutFramebuffers)
+{
+	for (auto It = Framebuffers.begin(); It != Framebuffers.end();)
+	{
+		const std::vector<VkImageView>& Used = It->second.Views;
+		bool UsesView = std::find_first_of(Used.begin(), Used.end(), Views.begin(), Views.end()) != Used.end();
+		if (UsesView)
+		{
+			OutFramebuffers.push_back(It->second.Framebuffer);
+			It = Framebuffers.erase(It);
+		}
+		else
+		{
+			++It;
+		}
+	}
+}
+
+void FRenderGraph::DumpPlan() const
+{
+	assert(CurrentPlan != nullptr);
+	uint32_t NumCulled = (uint32_t)std::count(CurrentPlan->IsCulled.begin(), CurrentPlan->IsCulled.end(), true);
+	uint32_t NumRenderPasses = (uint32_t)std::count_if(CurrentPlan->Steps.begin(), CurrentPlan->Steps.end(),
+		[](const FRGStep& Step) { return Step.IsRenderPass; });
+	FPlatformMisc::LocalPrintf("Render graph: %d passes, %d culled, %d render passes, %d pipeline barriers",
+		(int)Passes.size(), NumCulled, NumRenderPasses, CurrentPlan->NumBarriers);
+	for (const FRGStep& Step : CurrentPlan->Steps)
+	{
+		if (!Step.IsRenderPass)
+		{
+			FPlatformMisc::LocalPrintf("  %s", Passes[Step.Passes[0]].Name);
+			continue;
+		}
+		FPlatformMisc::LocalPrintf("  render pass %dx%d: %s, %d dependencies", Step.Extent.width, Step.Extent.height,
+			Step.Name, (int)Step.Dependencies.size());
+		for (const FRGAttachment& Attachment : Step.Attachments)
+		{
+			const VkAttachmentDescription& Description = Attachment.Description;
+			FPlatformMisc::LocalPrintf("    %s: %s/%s, layout %d -> %d", Textures[Attachment.Texture].Name,
+				Description.loadOp == VK_ATTACHMENT_LOAD_OP_LOAD ? "load" : Description.loadOp == VK_ATTACHMENT_LOAD_OP_CLEAR ? "clear" : "discard",
+				Description.storeOp == VK_ATTACHMENT_STORE_OP_STORE ? "store" : "discard",
+				Description.initialLayout, Description.finalLayout);
+		}
+	}
+	for (FRGPass Pass = 0; Pass < Passes.size(); ++Pass)
+	{
+		if (CurrentPlan->IsCulled[Pass])
+		{
+			FPlatformMisc::LocalPrintf("  culled: %s", Passes[Pass].Name);
+		}
+	}
+	if (!CurrentPlan->Slots.empty())
+	{
+		FPlatformMisc::LocalPrintf("Transient textures: %.1f MB in %d allocations, %.1f MB without aliasing",
+			CurrentPlan->AliasedBytes / (1024.0 * 1024.0), (int)CurrentPlan->Slots.size(), CurrentPlan->TransientBytes / (1024.0 * 1024.0));
+	}
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+#include <functional>
+#include <unordered_map>
+
+class FVulkanMemoryAllocator;
+class FVulkanGpuProfiler;
+class FVulkanDeletionQueue;
+struct FVulkanAllocation;
+class FRenderGraph;
+
+// How a pass uses a texture. Selects the layout, pipeline stages and access flags the graph
+// synchronizes with.
+enum class ERGAccess : uint8_t
+{
+	// attachments, handled by the render pass
+	ColorAttachment,
+	DepthAttachment,
+	DepthReadOnly,
+	// read with subpassLoad; lets the producer and the reader share a render pass
+	InputAttachment,
+	// everything else is synchronized with pipeline barriers
+	SampledFragment,
+	SampledCompute,
+	StorageCompute,
+	TransferSrc,
+	TransferDst,
+};
+
+struct FRGTextureDesc
+{
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	VkExtent2D Extent = {0, 0};
+	VkSampleCountFlagBits Samples = VK_SAMPLE_COUNT_1_BIT;
+};
+
+// index into the textures / passes declared this frame
+typedef uint32_t FRGTexture;
+typedef uint32_t FRGPass;
+
+struct FRGPassContext
+{
+	VkCommandBuffer CommandBuffer;
+	// the render pass, subpass and framebuffer of raster passes, null for the others
+	VkRenderPass RenderPass;
+	uint32_t Subpass;
+	VkFramebuffer Framebuffer;
+	VkExtent2D Extent;
+	const FRenderGraph* Graph;
+};
+
+typedef std::function<void(const FRGPassContext& Context)> FRGExecuteFunction;
+
+// Declares what a pass reads and writes. Returned by FRenderGraph::Add*Pass.
+class FRGPassBuilder
+{
+public:
+	FRGPassBuilder(FRenderGraph& InGraph, FRGPass InPass) : Graph(InGraph), Pass(InPass) {}
+
+	FRGPassBuilder& WriteColor(FRGTexture Texture, VkAttachmentLoadOp LoadOp, VkClearColorValue ClearValue = {});
+	FRGPassBuilder& WriteDepth(FRGTexture Texture, VkAttachmentLoadOp LoadOp, VkClearDepthStencilValue ClearValue = {1.f, 0});
+	FRGPassBuilder& Read(FRGTexture Texture, ERGAccess Access);
+	FRGPassBuilder& Write(FRGTexture Texture, ERGAccess Access);
+	// never culled, for passes whose results leave the graph by other means (readbacks, queries)
+	FRGPassBuilder& SetSideEffects();
+	// the pass records its subpass with vkCmdExecuteCommands
+	FRGPassBuilder& SetSecondaryCommandBuffers();
+
+	operator FRGPass() const { return Pass; }
+
+private:
+	FRenderGraph& Graph;
+	FRGPass Pass;
+};
+
+// Frame render graph. Passes and textures are declared every frame, in execution order, then
+// Compile() culls the passes nothing reads from, merges consecutive raster passes that only
+// depend on each other through attachments into subpasses of one render pass, derives layout
+// transitions and dependencies, and places transient textures with disjoint lifetimes in the
+// same memory.
+//
+// Dependencies go into the render passes wherever possible: attachment transitions are folded
+// into initial/final layouts and external subpass dependencies, and vkCmdPipelineBarrier is only
+// recorded between non-attachment uses. Everything runs on one queue, and the first use of a
+// transient texture in a frame waits for the previous frame's last use of its memory, so transient
+// textures are shared by all frames in flight.
+//
+// The compiled plan (render passes, transient images and their memory) is cached by the graph's
+// structure, so rebuilding an unchanged graph every frame creates no Vulkan objects.
+class FRenderGraph
+{
+public:
+	void Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator);
+	void Shutdown();
+	// Times every render pass and non-raster pass on the GPU, may be null.
+	void SetGpuProfiler(FVulkanGpuProfiler* InGpuProfiler) { GpuProfiler = InGpuProfiler; }
+
+	// Forgets the passes and textures of the previous frame.
+	void BeginFrame();
+
+	// A texture that lives outside the graph, like a swapchain image. It is in InitialLayout before
+	// its first use, whose stages are also the ones a semaphore guarding it must wait at, and it is
+	// left in FinalLayout.
+	FRGTexture ImportTexture(const char* Name, VkImage Image, VkImageView ImageView, const FRGTextureDesc& Desc,
+		VkImageLayout InitialLayout, VkImageLayout FinalLayout);
+	// A texture created by the graph, whose contents only live from its first to its last use.
+	FRGTexture CreateTexture(const char* Name, const FRGTextureDesc& Desc);
+
+	// Names must outlive the graph and the profiler, e.g. string literals.
+	// Draws into a render pass made of its attachments.
+	FRGPassBuilder AddRasterPass(const char* Name, FRGExecuteFunction Execute);
+	// Compute, copies or anything else recorded outside of a render pass.
+	FRGPassBuilder AddPass(const char* Name, FRGExecuteFunction Execute);
+
+	void Compile();
+	// Records all passes that survived culling.
+	void Execute(VkCommandBuffer CommandBuffer);
+
+	// Valid after Compile. The render pass a raster pass is recorded in, for pipeline creation;
+	// null if the pass was culled.
+	VkRenderPass GetRenderPass(FRGPass Pass, uint32_t& OutSubpass) const;
+	// Pipeline compatibility key of that render pass, see HashRenderPassCompatibility.
+	uint64_t GetRenderPassKey(FRGPass Pass) const;
+	VkImage GetImage(FRGTexture Texture) const;
+	VkImageView GetImageView(FRGTexture Texture) const;
+
+	// Destroys all cached plans and framebuffers. The GPU must be idle.
+	void ReleasePlans();
+	// Hands all cached plans and framebuffers to DeletionQueue, e.g. when the plans keyed by the old
+	// swapchain extent won't be compiled again. The next Compile builds a fresh plan.
+	void RetirePlans(FVulkanDeletionQueue& DeletionQueue);
+	// Forgets the cached framebuffers using any of Views, e.g. of a retired swapchain, and appends
+	// them to OutFramebuffers, for the caller to destroy once the GPU is done with them.
+	void ReleaseFramebuffers(const std::vector<VkImageView>& Views, std::vector<VkFramebuffer>& OutFramebuffers);
+	void DumpPlan() const;
+
+private:
+	friend class FRGPassBuilder;
+
+	struct FRGTextureDecl
+	{
+		const char* Name;
+		FRGTextureDesc Desc;
+		bool IsImported;
+		VkImage Image;
+		VkImageView ImageView;
+		VkImageLayout InitialLayout;
+		VkImageLayout FinalLayout;
+	};
+
+	struct FRGUse
+	{
+		FRGTexture Texture;
+		ERGAccess Access;
+		VkAttachmentLoadOp LoadOp;
+		VkClearValue ClearValue;
+	};
+
+	struct FRGPassDecl
+	{
+		const char* Name;
+		FRGExecuteFunction Execute;
+		bool IsRaster;
+		bool HasSideEffects;
+		bool UseSecondaryCommandBuffers;
+		std::vector<FRGUse> Uses;
+	};
+
+	struct FRGImageBarrier
+	{
+		FRGTexture Texture;
+		VkImageLayout OldLayout;
+		VkImageLayout NewLayout;
+		VkAccessFlags SrcAccess;
+		VkAccessFlags DstAccess;
+	};
+
+	struct FRGBarrierBatch
+	{
+		VkPipelineStageFlags SrcStages = 0;
+		VkPipelineStageFlags DstStages = 0;
+		std::vector<FRGImageBarrier> ImageBarriers;
+	};
+
+	struct FRGAttachment
+	{
+		FRGTexture Texture;
+		// first use in the render pass, for the clear value
+		FRGPass FirstPass;
+		uint32_t FirstUse;
+		VkAttachmentDescription Description;
+	};
+
+	// a render pass made of one or more raster passes, or a single non-raster pass
+	struct FRGStep
+	{
+		bool IsRenderPass;
+		// pass names joined by " + ", interned for the profiler
+		const char* Name;
+		std::vector<FRGPass> Passes;
+		VkExtent2D Extent;
+		std::vector<FRGAttachment> Attachments;
+		std::vector<VkSubpassDependency> Dependencies;
+		VkRenderPass RenderPass = VK_NULL_HANDLE;
+		uint64_t RenderPassKey = 0;
+		FRGBarrierBatch PreBarriers;
+	};
+
+	struct FRGTransient
+	{
+		VkImage Image = VK_NULL_HANDLE;
+		VkImageView ImageView = VK_NULL_HANDLE;
+		uint32_t Slot = ~0u;
+		// the texture using the memory before this one, the slot's last one for its first user
+		FRGTexture PreviousOccupant = ~0u;
+	};
+
+	struct FRGFramebuffer
+	{
+		VkFramebuffer Framebuffer;
+		std::vector<VkImageView> Views;
+	};
+
+	struct FRGPlan
+	{
+		std::vector<FRGStep> Steps;
+		std::vector<bool> IsCulled;
+		// per pass: step and subpass it is recorded in
+		std::vector<uint32_t> PassStep;
+		std::vector<uint32_t> PassSubpass;
+		// per texture, only set for transient ones
+		std::vector<FRGTransient> Transients;
+		std::vector<FVulkanAllocation*> Slots;
+		// returns imported textures to their final layout
+		FRGBarrierBatch PostBarriers;
+		VkDeviceSize TransientBytes = 0;
+		VkDeviceSize AliasedBytes = 0;
+		uint32_t NumBarriers = 0;
+	};
+
+	uint64_t HashStructure() const;
+	void CompilePlan(FRGPlan& Plan);
+	void CullPasses(FRGPlan& Plan) const;
+	void BuildSteps(FRGPlan& Plan) const;
+	void AllocateTransients(FRGPlan& Plan);
+	void BuildDependencies(FRGPlan& Plan) const;
+	void CreateRenderPass(FRGPlan& Plan, FRGStep& Step);
+	void RecordBarriers(VkCommandBuffer CommandBuffer, const FRGBarrierBatch& Batch);
+	VkFramebuffer GetFramebuffer(const FRGStep& Step);
+	FRGUse& AddUse(FRGPass Pass, FRGTexture Texture, ERGAccess Access);
+
+	VkDevice Device = VK_NULL_HANDLE;
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	FVulkanGpuProfiler* GpuProfiler = nullptr;
+
+	std::vector<FRGTextureDecl> Textures;
+	std::vector<FRGPassDecl> Passes;
+
+	std::unordered_map<uint64_t, FRGPlan*> Plans;
+	FRGPlan* CurrentPlan = nullptr;
+	std::unordered_map<uint64_t, FRGFramebuffer> Framebuffers;
+	// reused by Execute to avoid allocations every frame
+	std::vector<VkImageMemoryBarrier> ScratchBarriers;
+	std::vector<VkClearValue> ScratchClearValues;
+	std::vector<VkImageView> ScratchViews;
+};
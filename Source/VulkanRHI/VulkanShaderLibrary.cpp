@@ -0,0 +1,71 @@
+#include "VulkanShaderLibrary.h"
+#include "HAL/PlatformMisc.h"
+
+bool FVulkanShaderLibrary::FinishLoad(VkDevice InDevice)
+{
+	Device = InDevice;
+	return Library.FinishLoad();
+}
+
+void FVulkanShaderLibrary::Shutdown()
+{
+	FPlatformMisc::LocalPrintf("Shader library: %u of %u modules created", (uint32_t)Modules.size(), Library.GetNumModules());
+	for (auto& Pair : Modules)
+	{
+		if (Pair.second != VK_NULL_HANDLE)
+		{
+			vkDestroyShaderModule(Device, Pair.second, nullptr);
+		}
+	}
+	Modules.clear();
+	Library.Unload();
+}
+
+uint64_t FVulkanShaderLibrary::FindShader(const char* Name) const
+{
+	const FShaderLibraryModule* Module = Library.FindShader(Name);
+	if (Module == nullptr)
+	{
+		FPlatformMisc::LocalPrintf("Shader not found in library: %s", Name);
+		return 0;
+	}
+	return Module->ContentHash;
+}
+
+VkShaderModule FVulkanShaderLibrary::GetModule(uint64_t ContentHash)
+{
+	std::lock_guard<std::mutex> Lock(ModulesMutex);
+	auto Found = Modules.find(ContentHash);
+	if (Found != Modules.end())
+	{
+		return Found->second;
+	}
+	const FShaderLibraryModule* Module = Library.FindModule(ContentHash);
+	if (Module == nullptr)
+	{
+		return VK_NULL_HANDLE;
+	}
+	VkShaderModuleCreateInfo CreateInfo = {};
+	CreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	CreateInfo.codeSize = Module->CodeSize;
+	CreateInfo.pCode = Library.GetCode(*Module);
+	VkShaderModule ShaderModule = VK_NULL_HANDLE;
+	if (vkCreateShaderModule(Device, &CreateInfo, nullptr, &ShaderModule) != VK_SUCCESS)
+	{
+		TE_LOG(LogRHI, Error, "Create Shader Module Failed: %016llx", (unsigned long long)ContentHash);
+	}
+	// failures are cached too, so a broken module is not retried every frame
+	Modules[ContentHash] = ShaderModule;
+	return ShaderModule;
+}
+
+bool FVulkanShaderLibrary::GetReflection(uint64_t ContentHash, FShaderReflection& OutReflection) const
+{
+	const FShaderLibraryModule* Module = Library.FindModule(ContentHash);
+	if (Module == nullptr)
+	{
+		return false;
+	}
+	Library.GetReflection(*Module, OutReflection);
+	return true;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "Shader/ShaderLibrary.h"
+#include <unordered_map>
+#include <mutex>
+
+// The shader library with its VkShaderModules. Loading only reads the library; a module is created
+// the first time a pipeline needs it and kept until Shutdown, so shaders nothing draws with never
+// reach the driver. Shaders are referred to by content hash, the key FGraphicsPipelineStateDesc uses.
+class FVulkanShaderLibrary
+{
+public:
+	// Reads the library in the background until FinishLoad, see FShaderLibrary::BeginLoad.
+	void BeginLoad(const char* Filename) { Library.BeginLoad(Filename); }
+	bool FinishLoad(VkDevice InDevice);
+	// Destroys every module created, no pipeline may be compiling.
+	void Shutdown();
+
+	// Content hash of a shader, 0 when the library has no shader of that name.
+	uint64_t FindShader(const char* Name) const;
+	// Creates the module on first use. VK_NULL_HANDLE for unknown hashes. Thread safe.
+	VkShaderModule GetModule(uint64_t ContentHash);
+	bool GetReflection(uint64_t ContentHash, FShaderReflection& OutReflection) const;
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	FShaderLibrary Library;
+	std::mutex ModulesMutex;
+	std::unordered_map<uint64_t, VkShaderModule> Modules;
+};
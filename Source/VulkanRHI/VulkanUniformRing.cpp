@@ -0,0 +1,162 @@
+#include "VulkanUniformRing.h"
+#include "VulkanDescriptors.h"
+#include "HAL/PlatformMisc.h"
+#include <algorithm>
+#include <utility>
+#include <assert.h>
+
+bool FVulkanUniformRing::Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, FVulkanDescriptorAllocator& InDescriptorAllocator,
+	const VkPhysicalDeviceLimits& Limits, uint32_t NumFrames, VkDeviceSize InitialFrameSize)
+{
+	Device = InDevice;
+	MemoryAllocator = &InMemoryAllocator;
+	DescriptorAllocator = &InDescriptorAllocator;
+	// a power of two, at most 256
+	Alignment = std::max<VkDeviceSize>(Limits.minUniformBufferOffsetAlignment, 16);
+	Range = std::min(MAX_ALLOCATION_SIZE, Limits.maxUniformBufferRange);
+
+	VkDescriptorSetLayoutBinding Binding{};
+	Binding.binding = 0;
+	Binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	Binding.descriptorCount = 1;
+	Binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+	VkDescriptorSetLayoutCreateInfo LayoutInfo{};
+	LayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	LayoutInfo.bindingCount = 1;
+	LayoutInfo.pBindings = &Binding;
+	if (vkCreateDescriptorSetLayout(Device, &LayoutInfo, nullptr, &Layout) != VK_SUCCESS)
+	{
+		return false;
+	}
+
+	Frames.resize(NumFrames);
+	for (FFrameBuffers& Frame : Frames)
+	{
+		if (!AddBuffer(Frame, InitialFrameSize))
+		{
+			Shutdown();
+			return false;
+		}
+	}
+	CurrentFrame = &Frames[0];
+	return true;
+}
+
+void FVulkanUniformRing::Shutdown()
+{
+	for (FFrameBuffers& Frame : Frames)
+	{
+		ReleaseBuffers(Frame);
+	}
+	Frames.clear();
+	CurrentFrame = nullptr;
+	vkDestroyDescriptorSetLayout(Device, Layout, nullptr);
+	Layout = VK_NULL_HANDLE;
+}
+
+bool FVulkanUniformRing::AddBuffer(FFrameBuffers& Frame, VkDeviceSize Capacity)
+{
+	// allocations start below Capacity, and the descriptor reading them covers a whole Range
+	FRingBuffer Buffer;
+	Buffer.Capacity = (Capacity + Alignment - 1) & ~(Alignment - 1);
+	Buffer.Allocation = MemoryAllocator->CreateBuffer(Buffer.Capacity + Range, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, EVulkanMemoryUsage::CpuToGpu);
+	if (Buffer.Allocation == nullptr)
+	{
+		return false;
+	}
+	Frame.Buffers.push_back(Buffer);
+	return true;
+}
+
+void FVulkanUniformRing::ReleaseBuffers(FFrameBuffers& Frame)
+{
+	for (FRingBuffer& Buffer : Frame.Buffers)
+	{
+		MemoryAllocator->DestroyBuffer(Buffer.Allocation);
+	}
+	Frame.Buffers.clear();
+}
+
+void FVulkanUniformRing::BeginFrame(uint32_t FrameIndex)
+{
+	CurrentFrame = &Frames[FrameIndex];
+	FFrameBuffers& Frame = *CurrentFrame;
+	PeakFrameUse = std::max(PeakFrameUse, Frame.FrameUsed);
+	// the GPU is done with the slot's buffers, so they can be replaced. A quarter of headroom, and
+	// a power of two, keeps a slowly growing scene from resizing every few frames.
+	if (Frame.Buffers.size() > 1 || Frame.Buffers[0].Capacity < PeakFrameUse)
+	{
+		VkDeviceSize Capacity = DEFAULT_FRAME_SIZE;
+		while (Capacity < PeakFrameUse + PeakFrameUse / 4)
+		{
+			Capacity *= 2;
+		}
+		// out of memory, the frame keeps chaining the buffers it has
+		FFrameBuffers Resized;
+		if (AddBuffer(Resized, Capacity))
+		{
+			ReleaseBuffers(Frame);
+			Frame.Buffers = std::move(Resized.Buffers);
+			++NumResizes;
+		}
+	}
+	Frame.CurrentBuffer = 0;
+	Frame.Used = 0;
+	Frame.FrameUsed = 0;
+	Frame.Set = VK_NULL_HANDLE;
+	++NumFrames;
+}
+
+bool FVulkanUniformRing::Allocate(uint32_t Size, FUniformAllocation& OutAllocation)
+{
+	assert(Size <= Range);
+	FFrameBuffers& Frame = *CurrentFrame;
+	VkDeviceSize Offset = (Frame.Used + Alignment - 1) & ~(Alignment - 1);
+	if (Offset + Size > Frame.Buffers[Frame.CurrentBuffer].Capacity)
+	{
+		// overflow buffers double, so a frame far above its estimate needs few of them
+		if (++Frame.CurrentBuffer == (uint32_t)Frame.Buffers.size())
+		{
+			if (!AddBuffer(Frame, Frame.Buffers.back().Capacity * 2))
+			{
+				--Frame.CurrentBuffer;
+				return false;
+			}
+			++NumOverflows;
+		}
+		Frame.Used = 0;
+		Frame.Set = VK_NULL_HANDLE;
+		Offset = 0;
+	}
+	const FRingBuffer& Buffer = Frame.Buffers[Frame.CurrentBuffer];
+	if (Frame.Set == VK_NULL_HANDLE)
+	{
+		FDescriptorBinding Binding = FDescriptorBinding::Buffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, Buffer.Allocation->Buffer, 0, Range);
+		Frame.Set = DescriptorAllocator->FindOrAllocate(Layout, &Binding, 1);
+		if (Frame.Set == VK_NULL_HANDLE)
+		{
+			return false;
+		}
+	}
+
+	// the unused end of an overflowed buffer isn't counted, one buffer of FrameUsed fits the frame
+	Frame.FrameUsed += Offset + Size - Frame.Used;
+	Frame.Used = Offset + Size;
+	// host coherent memory, nothing to flush
+	OutAllocation.Data = (uint8_t*)Buffer.Allocation->MappedData + Offset;
+	OutAllocation.Set = Frame.Set;
+	OutAllocation.Offset = (uint32_t)Offset;
+	++TotalAllocations;
+	TotalBytes += Size;
+	return true;
+}
+
+void FVulkanUniformRing::ReportStats() const
+{
+	if (NumFrames == 0)
+	{
+		return;
+	}
+	FPlatformMisc::LocalPrintf("Uniform ring: %.1f allocations and %.0f bytes per frame, peak %llu bytes, %u overflows, %u resizes",
+		(double)TotalAllocations / NumFrames, (double)TotalBytes / NumFrames, (unsigned long long)PeakFrameUse, NumOverflows, NumResizes);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include "VulkanRHI/VulkanMemory.h"
+#include <vector>
+
+class FVulkanDescriptorAllocator;
+
+// Where to write one piece of uniform data, and how to bind it: Set with Offset as its dynamic offset.
+struct FUniformAllocation
+{
+	void* Data = nullptr;
+	VkDescriptorSet Set = VK_NULL_HANDLE;
+	uint32_t Offset = 0;
+};
+
+// Uniform data the CPU writes every frame, bump-allocated from persistently mapped buffers, one
+// per frame in flight. Data is written in place and bound with a dynamic offset into the same
+// VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC set, so allocations never map memory or write
+// descriptors. A frame slot's allocations stay valid until the slot is used again, which its
+// fence guards. A frame that doesn't fit chains more buffers, and the next time the slot comes
+// around they are replaced by one buffer sized from the largest frame seen so far.
+// Used from the thread recording the frame.
+class FVulkanUniformRing
+{
+public:
+	static const VkDeviceSize DEFAULT_FRAME_SIZE = 64 * 1024;
+	// range of the dynamic uniform buffer descriptor, so the largest allocation
+	static const uint32_t MAX_ALLOCATION_SIZE = 1024;
+
+	// Sets come from DescriptorAllocator, whose BeginFrame has to come first.
+	bool Init(VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator, FVulkanDescriptorAllocator& InDescriptorAllocator,
+		const VkPhysicalDeviceLimits& Limits, uint32_t NumFrames, VkDeviceSize InitialFrameSize = DEFAULT_FRAME_SIZE);
+	void Shutdown();
+
+	// One dynamic uniform buffer at binding 0, visible to vertex, fragment and compute shaders.
+	VkDescriptorSetLayout GetLayout() const { return Layout; }
+
+	// Starts a frame slot whose previous commands finished executing on the GPU.
+	void BeginFrame(uint32_t FrameIndex);
+
+	// Size is at most MAX_ALLOCATION_SIZE. False when out of memory.
+	bool Allocate(uint32_t Size, FUniformAllocation& OutAllocation);
+	template<typename UniformType>
+	UniformType* Allocate(FUniformAllocation& OutAllocation)
+	{
+		static_assert(sizeof(UniformType) <= MAX_ALLOCATION_SIZE, "too large for the ring's descriptor range");
+		return Allocate(sizeof(UniformType), OutAllocation) ? (UniformType*)OutAllocation.Data : nullptr;
+	}
+
+	void ReportStats() const;
+
+private:
+	struct FRingBuffer
+	{
+		FVulkanAllocation* Allocation = nullptr;
+		// bytes allocations can start in; the buffer is one descriptor range larger
+		VkDeviceSize Capacity = 0;
+	};
+
+	struct FFrameBuffers
+	{
+		// the first sized from the peak use, the others added by a frame that overflowed it
+		std::vector<FRingBuffer> Buffers;
+		uint32_t CurrentBuffer = 0;
+		// end of the last allocation in CurrentBuffer
+		VkDeviceSize Used = 0;
+		// in all buffers, alignment included
+		VkDeviceSize FrameUsed = 0;
+		// of CurrentBuffer, looked up on its first allocation of the frame
+		VkDescriptorSet Set = VK_NULL_HANDLE;
+	};
+
+	bool AddBuffer(FFrameBuffers& Frame, VkDeviceSize Capacity);
+	void ReleaseBuffers(FFrameBuffers& Frame);
+
+	VkDevice Device = VK_NULL_HANDLE;
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	FVulkanDescriptorAllocator* DescriptorAllocator = nullptr;
+	VkDescriptorSetLayout Layout = VK_NULL_HANDLE;
+	VkDeviceSize Alignment = 256;
+	uint32_t Range = MAX_ALLOCATION_SIZE;
+	std::vector<FFrameBuffers> Frames;
+	FFrameBuffers* CurrentFrame = nullptr;
+
+	VkDeviceSize PeakFrameUse = 0;
+	uint64_t NumFrames = 0;
+	uint64_t TotalAllocations = 0;
+	uint64_t TotalBytes = 0;
+	uint32_t NumOverflows = 0;
+	uint32_t NumResizes = 0;
+};
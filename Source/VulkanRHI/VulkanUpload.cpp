@@ -0,0 +1,428 @@
+#include "VulkanUpload.h"
+#include "VulkanMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AssertionMacros.h"
+#include <algorithm>
+#include <string.h>
+
+
+void FVulkanUploadManager::Init(VkPhysicalDevice PhysicalDevice, VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator,
+	VkQueue InTransferQueue, uint32_t InTransferFamilyIndex, uint32_t InGraphicsFamilyIndex,
+	bool UseTimelineSemaphore, VkDeviceSize InRingSize)
+{
+	Device = InDevice;
+	MemoryAllocator = &InMemoryAllocator;
+	TransferQueue = InTransferQueue;
+	TransferFamilyIndex = InTransferFamilyIndex;
+	GraphicsFamilyIndex = InGraphicsFamilyIndex;
+
+	VkPhysicalDeviceProperties Properties;
+	vkGetPhysicalDeviceProperties(PhysicalDevice, &Properties);
+	// 16 is a multiple of every texel block size copies need to be aligned to, except 3 and 12 byte formats
+	RingAlignment = std::max<VkDeviceSize>(16, Properties.limits.optimalBufferCopyOffsetAlignment);
+	RingSize = (InRingSize + RingAlignment - 1) / RingAlignment * RingAlignment;
+
+	VkCommandPoolCreateInfo PoolInfo{};
+	PoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	PoolInfo.queueFamilyIndex = TransferFamilyIndex;
+	PoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	verify(vkCreateCommandPool(Device, &PoolInfo, nullptr, &CommandPool) == VK_SUCCESS);
+
+	if (UseTimelineSemaphore)
+	{
+		GetSemaphoreCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(Device, "vkGetSemaphoreCounterValueKHR");
+		WaitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(Device, "vkWaitSemaphoresKHR");
+	}
+	if (GetSemaphoreCounterValue && WaitSemaphores)
+	{
+		VkSemaphoreTypeCreateInfoKHR TypeInfo{};
+		TypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+		TypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+		TypeInfo.initialValue = 0;
+		VkSemaphoreCreateInfo SemaphoreInfo{};
+		SemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		SemaphoreInfo.pNext = &TypeInfo;
+		verify(vkCreateSemaphore(Device, &SemaphoreInfo, nullptr, &TimelineSemaphore) == VK_SUCCESS);
+	}
+
+	// not created through FVulkanMemoryAllocator::CreateBuffer, so defragmentation never moves
+	// the ring while it is mapped and in use
+	VkBufferCreateInfo BufferInfo{};
+	BufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	BufferInfo.size = RingSize;
+	BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer RingBuffer;
+	verify(vkCreateBuffer(Device, &BufferInfo, nullptr, &RingBuffer) == VK_SUCCESS);
+	VkMemoryRequirements Requirements;
+	vkGetBufferMemoryRequirements(Device, RingBuffer, &Requirements);
+	RingAllocation = MemoryAllocator->Allocate(Requirements, EVulkanMemoryUsage::CpuToGpu, true);
+	verify(RingAllocation != nullptr);
+	verify(vkBindBufferMemory(Device, RingBuffer, RingAllocation->Memory, RingAllocation->Offset) == VK_SUCCESS);
+	RingAllocation->Buffer = RingBuffer;
+	RingData = (uint8_t*)RingAllocation->MappedData;
+
+	FPlatformMisc::LocalPrintf("Upload: %d MB staging ring, %s transfer queue (family %d), %s",
+		(int)(RingSize >> 20), HasDedicatedTransferQueue() ? "dedicated" : "graphics", TransferFamilyIndex,
+		TimelineSemaphore != VK_NULL_HANDLE ? "timeline semaphore" : "fences");
+}
+
+void FVulkanUploadManager::Shutdown()
+{
+	{
+		std::unique_lock<std::mutex> Lock(Mutex);
+		WaitLocked(FlushLocked());
+	}
+	for (FBatch* Batch : AllBatches)
+	{
+		vkDestroyFence(Device, Batch->Fence, nullptr);
+		delete Batch;
+	}
+	AllBatches.clear();
+	FreeBatches.clear();
+	// destroying the pool frees the batches' command buffers
+	vkDestroyCommandPool(Device, CommandPool, nullptr);
+	vkDestroySemaphore(Device, TimelineSemaphore, nullptr);
+	vkDestroyBuffer(Device, RingAllocation->Buffer, nullptr);
+	RingAllocation->Buffer = VK_NULL_HANDLE;
+	MemoryAllocator->Free(RingAllocation);
+	RingAllocation = nullptr;
+	RingData = nullptr;
+}
+
+bool FVulkanUploadManager::AllocateStaging(VkDeviceSize Size, VkDeviceSize& OutOffset)
+{
+	uint64_t Position = (RingHead + RingAlignment - 1) / RingAlignment * RingAlignment;
+	// an allocation never wraps around, the rest of the ring is skipped instead
+	VkDeviceSize RingOffset = Position % RingSize;
+	if (RingOffset + Size > RingSize)
+	{
+		Position += RingSize - RingOffset;
+		RingOffset = 0;
+	}
+	if (Position + Size - RingTail > RingSize)
+	{
+		return false;
+	}
+	RingHead = Position + Size;
+	OutOffset = RingOffset;
+	return true;
+}
+
+bool FVulkanUploadManager::AllocateStagingBlocking(VkDeviceSize Size, VkDeviceSize& OutOffset)
+{
+	while (!AllocateStaging(Size, OutOffset))
+	{
+		// the current batch holds part of the ring as well
+		FlushLocked();
+		if (InFlightBatches.empty())
+		{
+			return false;
+		}
+		++NumRingFullWaits;
+		WaitLocked(InFlightBatches.front()->Ticket);
+	}
+	return true;
+}
+
+FVulkanUploadManager::FBatch& FVulkanUploadManager::GetCurrentBatch()
+{
+	if (CurrentBatch == nullptr)
+	{
+		if (FreeBatches.empty())
+		{
+			FBatch* Batch = new FBatch;
+			VkCommandBufferAllocateInfo AllocInfo{};
+			AllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			AllocInfo.commandPool = CommandPool;
+			AllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			AllocInfo.commandBufferCount = 1;
+			verify(vkAllocateCommandBuffers(Device, &AllocInfo, &Batch->CommandBuffer) == VK_SUCCESS);
+			if (TimelineSemaphore == VK_NULL_HANDLE)
+			{
+				VkFenceCreateInfo FenceInfo{};
+				FenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+				verify(vkCreateFence(Device, &FenceInfo, nullptr, &Batch->Fence) == VK_SUCCESS);
+			}
+			AllBatches.push_back(Batch);
+			FreeBatches.push_back(Batch);
+		}
+		CurrentBatch = FreeBatches.back();
+		FreeBatches.pop_back();
+		CurrentBatch->Ticket = NextTicket++;
+		CurrentBatch->RingEnd = RingHead;
+		CurrentBatch->NumUploads = 0;
+
+		// begin implicitly resets the buffer
+		VkCommandBufferBeginInfo BeginInfo{};
+		BeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		verify(vkBeginCommandBuffer(CurrentBatch->CommandBuffer, &BeginInfo) == VK_SUCCESS);
+	}
+	return *CurrentBatch;
+}
+
+uint64_t FVulkanUploadManager::UploadBuffer(VkBuffer Buffer, VkDeviceSize Offset, const void* Data, VkDeviceSize Size, bool IsConcurrent)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	const uint8_t* Src = (const uint8_t*)Data;
+	uint64_t Ticket = 0;
+	while (Size > 0)
+	{
+		VkDeviceSize ChunkSize = std::min(Size, RingSize / 2);
+		VkDeviceSize StagingOffset;
+		verify(AllocateStagingBlocking(ChunkSize, StagingOffset));
+		memcpy(RingData + StagingOffset, Src, ChunkSize);
+
+		FBatch& Batch = GetCurrentBatch();
+		VkBufferCopy Region{StagingOffset, Offset, ChunkSize};
+		vkCmdCopyBuffer(Batch.CommandBuffer, RingAllocation->Buffer, Buffer, 1, &Region);
+
+		VkBufferMemoryBarrier Barrier{};
+		Barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		Barrier.buffer = Buffer;
+		Barrier.offset = Offset;
+		Barrier.size = ChunkSize;
+		if (HasDedicatedTransferQueue() && !IsConcurrent)
+		{
+			// release; the graphics queue acquires the range once the batch retired
+			Barrier.srcQueueFamilyIndex = TransferFamilyIndex;
+			Barrier.dstQueueFamilyIndex = GraphicsFamilyIndex;
+			vkCmdPipelineBarrier(Batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+				0, 0, nullptr, 1, &Barrier, 0, nullptr);
+			Barrier.srcAccessMask = 0;
+			Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			Batch.BufferAcquires.push_back(Barrier);
+		}
+		else
+		{
+			Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+			Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			vkCmdPipelineBarrier(Batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+				0, 0, nullptr, 1, &Barrier, 0, nullptr);
+		}
+		Batch.RingEnd = RingHead;
+		++Batch.NumUploads;
+		Ticket = Batch.Ticket;
+
+		++NumUploads;
+		UploadedBytes += ChunkSize;
+		Src += ChunkSize;
+		Offset += ChunkSize;
+		Size -= ChunkSize;
+	}
+	return Ticket;
+}
+
+uint64_t FVulkanUploadManager::UploadImage(VkImage Image, const VkExtent3D& Extent, VkImageLayout FinalLayout, const void* Data, VkDeviceSize Size)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	VkDeviceSize StagingOffset;
+	if (!AllocateStagingBlocking(Size, StagingOffset))
+	{
+		FPlatformMisc::LocalPrintf("Upload: image of %llu bytes does not fit in the staging ring", (unsigned long long)Size);
+		return 0;
+	}
+	memcpy(RingData + StagingOffset, Data, Size);
+	FBatch& Batch = GetCurrentBatch();
+
+	VkImageMemoryBarrier Barrier{};
+	Barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	Barrier.srcAccessMask = 0;
+	Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	Barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	Barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	Barrier.image = Image;
+	Barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+	vkCmdPipelineBarrier(Batch.CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &Barrier);
+
+	VkBufferImageCopy Region{};
+	Region.bufferOffset = StagingOffset;
+	Region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+	Region.imageExtent = Extent;
+	vkCmdCopyBufferToImage(Batch.CommandBuffer, RingAllocation->Buffer, Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &Region);
+
+	// the transition to FinalLayout is part of the release and of the acquire
+	Barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	Barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	Barrier.newLayout = FinalLayout;
+	if (HasDedicatedTransferQueue())
+	{
+		Barrier.dstAccessMask = 0;
+		Barrier.srcQueueFamilyIndex = TransferFamilyIndex;
+		Barrier.dstQueueFamilyIndex = GraphicsFamilyIndex;
+		vkCmdPipelineBarrier(Batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &Barrier);
+		Barrier.srcAccessMask = 0;
+		Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		Batch.ImageAcquires.push_back(Barrier);
+	}
+	else
+	{
+		Barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		vkCmdPipelineBarrier(Batch.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &Barrier);
+	}
+	Batch.RingEnd = RingHead;
+	++Batch.NumUploads;
+
+	++NumUploads;
+	UploadedBytes += Size;
+	return Batch.Ticket;
+}
+
+uint64_t FVulkanUploadManager::Flush()
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	return FlushLocked();
+}
+
+uint64_t FVulkanUploadManager::FlushLocked()
+{
+	if (CurrentBatch == nullptr)
+	{
+		// everything recorded so far is in the last submitted batch or an older one
+		return NextTicket - 1;
+	}
+	FBatch* Batch = CurrentBatch;
+	CurrentBatch = nullptr;
+	verify(vkEndCommandBuffer(Batch->CommandBuffer) == VK_SUCCESS);
+	// no-op on coherent memory
+	MemoryAllocator->Flush(RingAllocation);
+
+	VkSubmitInfo SubmitInfo{};
+	SubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	SubmitInfo.commandBufferCount = 1;
+	SubmitInfo.pCommandBuffers = &Batch->CommandBuffer;
+	VkTimelineSemaphoreSubmitInfoKHR TimelineInfo{};
+	if (TimelineSemaphore != VK_NULL_HANDLE)
+	{
+		TimelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+		TimelineInfo.signalSemaphoreValueCount = 1;
+		TimelineInfo.pSignalSemaphoreValues = &Batch->Ticket;
+		SubmitInfo.pNext = &TimelineInfo;
+		SubmitInfo.signalSemaphoreCount = 1;
+		SubmitInfo.pSignalSemaphores = &TimelineSemaphore;
+	}
+	verify(vkQueueSubmit(TransferQueue, 1, &SubmitInfo, Batch->Fence) == VK_SUCCESS);
+	InFlightBatches.push_back(Batch);
+	++NumSubmits;
+	return Batch->Ticket;
+}
+
+void FVulkanUploadManager::Tick()
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	FlushLocked();
+	RetireCompleted();
+}
+
+void FVulkanUploadManager::Wait(uint64_t Ticket)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	if (CurrentBatch != nullptr && Ticket >= CurrentBatch->Ticket)
+	{
+		FlushLocked();
+	}
+	WaitLocked(Ticket);
+}
+
+void FVulkanUploadManager::WaitLocked(uint64_t Ticket)
+{
+	if (Ticket <= RetiredTicket)
+	{
+		return;
+	}
+	if (TimelineSemaphore != VK_NULL_HANDLE)
+	{
+		VkSemaphoreWaitInfoKHR WaitInfo{};
+		WaitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		WaitInfo.semaphoreCount = 1;
+		WaitInfo.pSemaphores = &TimelineSemaphore;
+		WaitInfo.pValues = &Ticket;
+		verify(WaitSemaphores(Device, &WaitInfo, UINT64_MAX) == VK_SUCCESS);
+	}
+	else
+	{
+		// batches complete in submission order, so waiting on the ticket's own fence is enough
+		for (FBatch* Batch : InFlightBatches)
+		{
+			if (Batch->Ticket >= Ticket)
+			{
+				verify(vkWaitForFences(Device, 1, &Batch->Fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS);
+				break;
+			}
+		}
+	}
+	RetireCompleted();
+}
+
+void FVulkanUploadManager::RetireCompleted()
+{
+	uint64_t CompletedTicket = 0;
+	if (TimelineSemaphore != VK_NULL_HANDLE)
+	{
+		verify(GetSemaphoreCounterValue(Device, TimelineSemaphore, &CompletedTicket) == VK_SUCCESS);
+	}
+	while (!InFlightBatches.empty())
+	{
+		FBatch* Batch = InFlightBatches.front();
+		if (TimelineSemaphore != VK_NULL_HANDLE ? Batch->Ticket > CompletedTicket : vkGetFenceStatus(Device, Batch->Fence) != VK_SUCCESS)
+		{
+			break;
+		}
+		if (Batch->Fence != VK_NULL_HANDLE)
+		{
+			vkResetFences(Device, 1, &Batch->Fence);
+		}
+		RingTail = Batch->RingEnd;
+		RetiredTicket = Batch->Ticket;
+		ReadyBufferAcquires.insert(ReadyBufferAcquires.end(), Batch->BufferAcquires.begin(), Batch->BufferAcquires.end());
+		ReadyImageAcquires.insert(ReadyImageAcquires.end(), Batch->ImageAcquires.begin(), Batch->ImageAcquires.end());
+		Batch->BufferAcquires.clear();
+		Batch->ImageAcquires.clear();
+		InFlightBatches.pop_front();
+		FreeBatches.push_back(Batch);
+	}
+}
+
+void FVulkanUploadManager::RecordAcquireBarriers(VkCommandBuffer CommandBuffer)
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	// The release was observed complete on the CPU before this command buffer is submitted, which
+	// orders it before the acquire without a semaphore wait on the graphics queue.
+	if (!ReadyBufferAcquires.empty() || !ReadyImageAcquires.empty())
+	{
+		vkCmdPipelineBarrier(CommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr,
+			(uint32_t)ReadyBufferAcquires.size(), ReadyBufferAcquires.data(),
+			(uint32_t)ReadyImageAcquires.size(), ReadyImageAcquires.data());
+		ReadyBufferAcquires.clear();
+		ReadyImageAcquires.clear();
+	}
+	AcquiredTicket = RetiredTicket;
+}
+
+bool FVulkanUploadManager::IsComplete(uint64_t Ticket) const
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	return Ticket <= AcquiredTicket;
+}
+
+bool FVulkanUploadManager::IsIdle() const
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	return CurrentBatch == nullptr && AcquiredTicket == NextTicket - 1;
+}
+
+void FVulkanUploadManager::ReportStats() const
+{
+	std::unique_lock<std::mutex> Lock(Mutex);
+	FPlatformMisc::LocalPrintf("Upload: %llu uploads (%.1f MB) in %llu submits, %.1f uploads per submit, %d waits on a full ring",
+		(unsigned long long)NumUploads, UploadedBytes / (1024.0 * 1024.0), (unsigned long long)NumSubmits,
+		NumSubmits > 0 ? (double)NumUploads / NumSubmits : 0.0, NumRingFullWaits);
+}
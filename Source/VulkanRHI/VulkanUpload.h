@@ -0,0 +1,116 @@
+#pragma once
+
+#include "VulkanRHI/VulkanCommon.h"
+#include <vector>
+#include <deque>
+#include <mutex>
+
+class FVulkanMemoryAllocator;
+struct FVulkanAllocation;
+
+// Streams data to device local resources through a persistently mapped staging ring buffer.
+// Uploads are recorded into the current batch and go out in a single submit on the transfer
+// queue, which is a dedicated transfer family when the device has one. In that case resources are
+// released by the transfer queue and acquired again by RecordAcquireBarriers on the graphics queue.
+// Batches retire in order, through a timeline semaphore when available and per-batch fences
+// otherwise, and give their ring space back when they do. Upload functions are thread-safe, but
+// without a dedicated transfer family they submit to the graphics queue, so they must then be
+// called from the thread that submits graphics work.
+class FVulkanUploadManager
+{
+public:
+	static const VkDeviceSize DEFAULT_RING_SIZE = 32ull << 20;
+
+	void Init(VkPhysicalDevice PhysicalDevice, VkDevice InDevice, FVulkanMemoryAllocator& InMemoryAllocator,
+		VkQueue InTransferQueue, uint32_t InTransferFamilyIndex, uint32_t InGraphicsFamilyIndex,
+		bool UseTimelineSemaphore, VkDeviceSize InRingSize = DEFAULT_RING_SIZE);
+	void Shutdown();
+
+	// Destinations must not be in use on the GPU; afterwards they are owned by the graphics family.
+	// Copies Size bytes of Data into Buffer at Offset. Uploads larger than half the ring are split.
+	// Returns the ticket of the batch the copy went into. Buffers created with
+	// VK_SHARING_MODE_CONCURRENT pass IsConcurrent, they have no owner to transfer.
+	uint64_t UploadBuffer(VkBuffer Buffer, VkDeviceSize Offset, const void* Data, VkDeviceSize Size, bool IsConcurrent = false);
+	// Copies tightly packed texels into mip 0, layer 0 of a color image, whose previous contents are
+	// discarded, and leaves it in FinalLayout. Returns 0 when the data does not fit in the ring.
+	uint64_t UploadImage(VkImage Image, const VkExtent3D& Extent, VkImageLayout FinalLayout, const void* Data, VkDeviceSize Size);
+
+	// Submits the current batch, if it recorded anything. Returns its ticket.
+	uint64_t Flush();
+	// Once per frame: flushes the current batch and retires the completed ones. Never blocks.
+	void Tick();
+	// Blocks until the batch with the given ticket finished executing on the transfer queue.
+	void Wait(uint64_t Ticket);
+
+	// Records the queue family acquire barriers of all retired batches into a graphics command
+	// buffer, outside of a render pass. Their resources are usable by graphics commands recorded
+	// after this call.
+	void RecordAcquireBarriers(VkCommandBuffer CommandBuffer);
+	// True when the upload is usable by graphics command buffers recorded from now on.
+	bool IsComplete(uint64_t Ticket) const;
+	// True when every upload so far is usable by graphics command buffers recorded from now on.
+	bool IsIdle() const;
+
+	bool HasDedicatedTransferQueue() const { return TransferFamilyIndex != GraphicsFamilyIndex; }
+	void ReportStats() const;
+
+private:
+	struct FBatch
+	{
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		// only without timeline semaphores
+		VkFence Fence = VK_NULL_HANDLE;
+		uint64_t Ticket = 0;
+		// ring position after the batch's last staging allocation
+		uint64_t RingEnd = 0;
+		uint32_t NumUploads = 0;
+		std::vector<VkBufferMemoryBarrier> BufferAcquires;
+		std::vector<VkImageMemoryBarrier> ImageAcquires;
+	};
+
+	bool AllocateStaging(VkDeviceSize Size, VkDeviceSize& OutOffset);
+	// allocates staging space, flushing and waiting for older batches while the ring is full
+	bool AllocateStagingBlocking(VkDeviceSize Size, VkDeviceSize& OutOffset);
+	FBatch& GetCurrentBatch();
+	uint64_t FlushLocked();
+	void WaitLocked(uint64_t Ticket);
+	void RetireCompleted();
+
+	VkDevice Device = VK_NULL_HANDLE;
+	FVulkanMemoryAllocator* MemoryAllocator = nullptr;
+	VkQueue TransferQueue = VK_NULL_HANDLE;
+	uint32_t TransferFamilyIndex = 0;
+	uint32_t GraphicsFamilyIndex = 0;
+	VkCommandPool CommandPool = VK_NULL_HANDLE;
+
+	// VK_KHR_timeline_semaphore, signaled to each batch's ticket
+	VkSemaphore TimelineSemaphore = VK_NULL_HANDLE;
+	PFN_vkGetSemaphoreCounterValueKHR GetSemaphoreCounterValue = nullptr;
+	PFN_vkWaitSemaphoresKHR WaitSemaphores = nullptr;
+
+	FVulkanAllocation* RingAllocation = nullptr;
+	uint8_t* RingData = nullptr;
+	VkDeviceSize RingSize = 0;
+	VkDeviceSize RingAlignment = 16;
+	// monotonic byte positions, the ring offset is position % RingSize
+	uint64_t RingHead = 0;
+	uint64_t RingTail = 0;
+
+	mutable std::mutex Mutex;
+	FBatch* CurrentBatch = nullptr;
+	// submitted, oldest first
+	std::deque<FBatch*> InFlightBatches;
+	std::vector<FBatch*> FreeBatches;
+	std::vector<FBatch*> AllBatches;
+	uint64_t NextTicket = 1;
+	uint64_t RetiredTicket = 0;
+	// retired tickets whose acquire barriers were recorded
+	uint64_t AcquiredTicket = 0;
+	std::vector<VkBufferMemoryBarrier> ReadyBufferAcquires;
+	std::vector<VkImageMemoryBarrier> ReadyImageAcquires;
+
+	uint64_t NumUploads = 0;
+	uint64_t NumSubmits = 0;
+	uint64_t UploadedBytes = 0;
+	uint32_t NumRingFullWaits = 0;
+};
@@ -1,3 +0,0 @@
-cd Resource/Shaders
-glslc shader.vert -o vert.spv
-glslc shader.frag -o frag.spv
\ No newline at end of file
@@ -0,0 +1,4 @@
+#!/bin/sh
+cd "$(dirname "$0")"
+cmake -DCMAKE_BUILD_TYPE=Release -B Build/Linux
+cmake --build Build/Linux -j